@@ -0,0 +1,321 @@
+#include "account_pool.h"
+
+#include "bulk_io.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Pause before the refill thread retries after a failed account creation.
+const auto kRetryDelay = std::chrono::seconds(1);
+
+std::string normalizeAddress(const std::string& address)
+{
+    std::string hex = address;
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex = hex.substr(2);
+    }
+    std::transform(hex.begin(), hex.end(), hex.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return "0x" + hex;
+}
+
+// Compares without an early exit so timing does not reveal the matching prefix.
+bool constantTimeEqual(const std::string& a, const std::string& b)
+{
+    unsigned char diff = a.size() == b.size() ? 0 : 1;
+    const std::string& shorter = a.size() < b.size() ? a : b;
+    const std::string& longer = a.size() < b.size() ? b : a;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        diff |= static_cast<unsigned char>(longer[i] ^ (i < shorter.size() ? shorter[i] : 0));
+    }
+    return diff == 0;
+}
+
+void wipe(std::string& secret)
+{
+    volatile char* p = secret.empty() ? nullptr : &secret[0];
+    for (size_t i = 0; i < secret.size(); ++i) {
+        p[i] = 0;
+    }
+    secret.clear();
+}
+
+} // namespace
+
+AccountPool::AccountPool(Ops ops, const std::string& journalPath)
+    : ops(std::move(ops)), journalPath(journalPath), journalFd(-1), journalDirty(false), size(0), refillPerMinute(0),
+      enabled(false), active(false), generated(0), hits(0), misses(0)
+{
+    // Replay "+address" / "-address" lines into the reserved set, keeping the
+    // order accounts were generated in.
+    std::ifstream in(journalPath);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.size() < 3 || (line[0] != '+' && line[0] != '-')) {
+            continue;
+        }
+        const std::string address = line.substr(1);
+        const std::string key = normalizeAddress(address);
+        if (line[0] == '+') {
+            if (reservedSet.insert(key).second) {
+                unverified.push_back(address);
+            }
+        } else if (reservedSet.erase(key)) {
+            unverified.erase(std::remove_if(unverified.begin(), unverified.end(),
+                                            [&](const std::string& a) { return normalizeAddress(a) == key; }),
+                             unverified.end());
+        }
+    }
+    // Nothing touches the directory until the pool has something to record.
+    if (in.is_open()) {
+        in.close();
+        compactJournal();
+    }
+}
+
+AccountPool::~AccountPool()
+{
+    stop();
+    if (journalFd >= 0) {
+        close(journalFd);
+    }
+    wipe(passphrase);
+}
+
+void AccountPool::compactJournal()
+{
+    if (journalFd >= 0) {
+        close(journalFd);
+        journalFd = -1;
+    }
+    if (reservedSet.empty()) {
+        unlink(journalPath.c_str());
+    } else {
+        const std::string tmp = journalPath + ".tmp";
+        std::string contents;
+        for (const auto& address : unverified) {
+            contents += "+" + address + "\n";
+        }
+        const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0 || !writeAll(fd, contents.data(), contents.size()) || fdatasync(fd) != 0 ||
+            rename(tmp.c_str(), journalPath.c_str()) != 0) {
+            fprintf(stderr, "AccountPool: cannot rewrite journal %s\n", journalPath.c_str());
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool AccountPool::record(char op, const std::string& address, bool sync)
+{
+    if (journalFd < 0) {
+        journalFd = open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    }
+    const std::string line = op + address + "\n";
+    if (journalFd < 0 || !writeAll(journalFd, line.data(), line.size()) || (sync && fdatasync(journalFd) != 0)) {
+        lastError = "cannot write account pool journal";
+        fprintf(stderr, "AccountPool: %s\n", lastError.c_str());
+        return false;
+    }
+    journalDirty = journalDirty || !sync;
+    return true;
+}
+
+void AccountPool::syncJournal(std::unique_lock<std::mutex>& lock)
+{
+    if (!journalDirty || journalFd < 0) {
+        return;
+    }
+    journalDirty = false;
+    const int fd = journalFd;
+    lock.unlock();
+    fdatasync(fd);
+    lock.lock();
+}
+
+void AccountPool::release(const std::string& address)
+{
+    record('-', address);
+    reservedSet.erase(normalizeAddress(address));
+}
+
+bool AccountPool::configure(const std::string& newPassphrase, size_t newSize, uint64_t newRefillPerMinute)
+{
+    if (newSize == 0) {
+        stop();
+        std::deque<std::string> stock;
+        std::string current;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            enabled = false;
+            stock.swap(ready);
+            stock.insert(stock.end(), unverified.begin(), unverified.end());
+            unverified.clear();
+            current = passphrase.empty() ? newPassphrase : passphrase;
+        }
+        // Unused accounts were never handed out, so deleting them is safe; any
+        // that cannot be deleted (wrong passphrase) become normal accounts.
+        for (const auto& address : stock) {
+            if (!ops.remove(address, current)) {
+                fprintf(stderr, "AccountPool: releasing %s, it could not be deleted\n", address.c_str());
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            release(address);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        wipe(current);
+        wipe(passphrase);
+        size = 0;
+        refillPerMinute = 0;
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!constantTimeEqual(passphrase, newPassphrase)) {
+            // Accounts encrypted under the old passphrase must be checked again.
+            unverified.insert(unverified.begin(), ready.begin(), ready.end());
+            ready.clear();
+            passphrase = newPassphrase;
+        }
+        size = newSize;
+        refillPerMinute = newRefillPerMinute;
+        nextCreate = std::chrono::steady_clock::now();
+        enabled = true;
+        if (!active) {
+            active = true;
+            thread = std::thread(&AccountPool::run, this);
+        }
+    }
+    cv.notify_all();
+    return true;
+}
+
+void AccountPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = false;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    syncJournal(lock);
+}
+
+void AccountPool::run()
+{
+    lowerThreadPriority();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (active) {
+        // Handouts since the last pass reach the disk here.
+        syncJournal(lock);
+        if (!unverified.empty()) {
+            const std::string address = unverified.front();
+            unverified.pop_front();
+            const std::string key = passphrase;
+            lock.unlock();
+            const bool ok = ops.verify(address, key);
+            lock.lock();
+            if (!ok) {
+                lastError = "pooled account " + address + " does not match the pool passphrase";
+                fprintf(stderr, "AccountPool: releasing %s: %s\n", address.c_str(), lastError.c_str());
+                release(address);
+            } else if (key == passphrase) {
+                ready.push_back(address);
+            } else {
+                unverified.push_back(address); // reconfigured meanwhile
+            }
+            continue;
+        }
+        if (ready.size() >= size) {
+            cv.wait(lock, [&] { return !active || journalDirty || !unverified.empty() || ready.size() < size; });
+            continue;
+        }
+        if (std::chrono::steady_clock::now() < nextCreate) {
+            cv.wait_until(lock, nextCreate);
+            continue;
+        }
+        const std::string key = passphrase;
+        lock.unlock();
+        std::string error;
+        const std::string address = ops.create(key, error);
+        lock.lock();
+        const auto now = std::chrono::steady_clock::now();
+        if (address.empty()) {
+            lastError = error;
+            nextCreate = now + kRetryDelay;
+            continue;
+        }
+        reservedSet.insert(normalizeAddress(address));
+        if (!record('+', address)) {
+            // Not reserved durably: leave it as a normal account.
+            reservedSet.erase(normalizeAddress(address));
+            nextCreate = now + kRetryDelay;
+            continue;
+        }
+        ++generated;
+        (key == passphrase ? ready : unverified).push_back(address);
+        if (refillPerMinute > 0) {
+            nextCreate = now + std::chrono::microseconds(60000000 / refillPerMinute);
+        }
+    }
+}
+
+bool AccountPool::take(const std::string& requested, std::string& address)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!enabled || !constantTimeEqual(requested, passphrase)) {
+        return false;
+    }
+    if (ready.empty()) {
+        ++misses;
+        return false;
+    }
+    // The journal entry is removed before the account is returned, so a
+    // restart cannot hand the same account out again; the refill thread,
+    // woken below, syncs the removal.
+    if (!record('-', ready.front(), false)) {
+        ++misses;
+        return false;
+    }
+    address = ready.front();
+    ready.pop_front();
+    reservedSet.erase(normalizeAddress(address));
+    ++hits;
+    lock.unlock();
+    cv.notify_all();
+    return true;
+}
+
+bool AccountPool::reserved(const std::string& address) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return reservedSet.count(normalizeAddress(address)) > 0;
+}
+
+AccountPool::Stats AccountPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.enabled = enabled;
+    s.ready = ready.size();
+    s.pendingVerification = unverified.size();
+    s.size = size;
+    s.refillPerMinute = refillPerMinute;
+    s.generated = generated;
+    s.hits = hits;
+    s.misses = misses;
+    s.lastError = lastError;
+    return s;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Keeps a stock of accounts that are already generated and encrypted (with the
+// pool's passphrase) in the keystore, so a new account can be handed out without
+// waiting for scrypt. A background thread tops the stock up to the configured
+// size, at most refillPerMinute accounts a minute (0: no limit).
+//
+// Pooled accounts live in the keystore directory like any other account but are
+// reserved: they are listed in a journal next to the key files and are hidden
+// from account listings until handed out. The journal survives restarts, and a
+// handed-out account is removed from it before it is returned, so a restart
+// never hands it out again. The removal is synced by the refill thread rather
+// than on the request path; only a power failure before that sync can offer
+// the account again. Accounts found in the journal at startup are re-verified
+// against the configured passphrase before use.
+class AccountPool {
+public:
+    struct Ops {
+        // Generates and stores a new account; returns its address or "" with error set.
+        std::function<std::string(const std::string& passphrase, std::string& error)> create;
+        // True when the account exists and decrypts with passphrase.
+        std::function<bool(const std::string& address, const std::string& passphrase)> verify;
+        // Deletes an unused account.
+        std::function<bool(const std::string& address, const std::string& passphrase)> remove;
+    };
+
+    struct Stats {
+        bool enabled = false;
+        size_t ready = 0;
+        size_t pendingVerification = 0;
+        size_t size = 0;
+        uint64_t refillPerMinute = 0;
+        uint64_t generated = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0; // matching requests that found the pool empty
+        std::string lastError;
+    };
+
+    // Loads the reserved accounts recorded in journalPath (created on first use).
+    AccountPool(Ops ops, const std::string& journalPath);
+    ~AccountPool();
+
+    AccountPool(const AccountPool&) = delete;
+    AccountPool& operator=(const AccountPool&) = delete;
+
+    // Starts or reconfigures the pool. A new passphrase sends the stock back
+    // through verification. Size 0 disables the pool and deletes the unused
+    // accounts (those that cannot be deleted are released as normal accounts).
+    bool configure(const std::string& passphrase, size_t size, uint64_t refillPerMinute);
+    // Hands out a pooled account when passphrase matches the pool's.
+    bool take(const std::string& passphrase, std::string& address);
+    // True for accounts held back for the pool (address in any case, 0x-prefixed).
+    bool reserved(const std::string& address) const;
+    Stats stats() const;
+    // Stops the refill thread; the stock stays reserved for the next session.
+    void stop();
+
+private:
+    void run();
+    // Appends a journal line; unless sync, the refill thread syncs it later.
+    bool record(char op, const std::string& address, bool sync = true);
+    void syncJournal(std::unique_lock<std::mutex>& lock);
+    void compactJournal();
+    void release(const std::string& address);
+
+    Ops ops;
+    std::string journalPath;
+    int journalFd;
+    bool journalDirty; // removals written since the last sync
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::set<std::string> reservedSet; // lower-case addresses
+    std::deque<std::string> ready;
+    std::deque<std::string> unverified;
+    std::string passphrase;
+    size_t size;
+    uint64_t refillPerMinute;
+    std::chrono::steady_clock::time_point nextCreate;
+    bool enabled;
+    bool active;
+    uint64_t generated;
+    uint64_t hits;
+    uint64_t misses;
+    std::string lastError;
+    std::thread thread;
+};
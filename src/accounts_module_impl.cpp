@@ -1,14 +1,360 @@
 #include "accounts_module_impl.h"
+#include "bip39.h"
+#include "bip39_wordlist.h"
+#include "bulk_io.h"
+#include "chacha20_drbg.h"
+#include "ecrecover.h"
+#include "ext_key.h"
+#include "go_string.h"
+#include "key_file.h"
+#include "keystore_family.h"
+#include "pbkdf2_sha512.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <nlohmann/json.hpp>
 
-AccountsModuleImpl::AccountsModuleImpl() : keystoreHandle(0), extkeystoreHandle(0)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t kDefaultBulkMemoryBudget = 1ull << 30;
+const int64_t kMaxMnemonicBatch = 100000;
+// Mnemonics handed to one worker at a time by createRandomMnemonics.
+const size_t kMnemonicChunk = 256;
+// BIP-39 seed derivation: PBKDF2-HMAC-SHA512, 2048 rounds, salt "mnemonic" + passphrase.
+const uint32_t kBip39SeedIterations = 2048;
+const size_t kBip39SeedSize = 64;
+const size_t kMaxWordSuggestions = 5;
+
+size_t defaultBulkThreads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Signature cache scopes: the two default keystores and one per tenant.
+const char* const kKeystoreScope = KeystoreFamily::kScope;
+const char* const kExtKeystoreScope = ExtKeystoreFamily::kScope;
+
+// Error text reported by an SDK call, for logging and error fields.
+const char* errorMessage(const GoString& err)
+{
+    return err ? err.c_str() : "unknown error";
+}
+
+std::string tenantScope(const std::string& tenant)
+{
+    return "tenant:" + tenant;
+}
+
+// The key file path of an account's "keystore://<path>" URL.
+std::string keyFilePath(const std::string& url)
+{
+    const auto scheme = url.find("://");
+    return scheme == std::string::npos ? url : url.substr(scheme + 3);
+}
+
+// The SDK's light scrypt parameters, used by in-memory keystores unless the
+// caller picks others.
+const int64_t kLightScryptN = 4096;
+const int64_t kLightScryptP = 6;
+
+// Estimated memory held by an open keystore handle: the SDK's per-handle state
+// plus the accounts it caches.
+const uint64_t kKeystoreHandleBytes = 256 * 1024;
+const uint64_t kKeystoreAccountBytes = 2 * 1024;
+
+uint64_t keystoreFootprint(const std::string& dir)
+{
+    uint64_t files = 0;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            files += entry->d_name[0] != '.' ? 1 : 0;
+        }
+        closedir(d);
+    }
+    return kKeystoreHandleBytes + files * kKeystoreAccountBytes;
+}
+
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+// Decrypts the key file of address in dir natively; false (logged) when there
+// is none or it does not open with passphrase.
+bool decryptKeyFile(const std::string& dir, const std::string& address, const std::string& passphrase, uint8_t key[32])
+{
+    const std::string path = keyFileFind(dir, address);
+    if (path.empty()) {
+        fprintf(stderr, "AccountsModuleImpl: native unlock: no key file for %s\n", address.c_str());
+        return false;
+    }
+    FileBuffer file(path);
+    std::string error = "cannot read " + path;
+    if (!file.valid() || !keyFileDecrypt(std::string_view(file.data(), file.size()), passphrase, key, error)) {
+        fprintf(stderr, "AccountsModuleImpl: native unlock of %s: %s\n", address.c_str(), error.c_str());
+        return false;
+    }
+    return true;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Decodes exactly size bytes of hex, with or without 0x.
+bool parseHex(const std::string& text, uint8_t* out, size_t size)
+{
+    std::string_view hex(text);
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex.remove_prefix(2);
+    }
+    if (hex.size() != 2 * size) {
+        return false;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        const int hi = hexValue(hex[2 * i]);
+        const int lo = hexValue(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+std::string hexString(const uint8_t* data, size_t size)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex = "0x";
+    for (size_t i = 0; i < size; ++i) {
+        hex += kHex[data[i] >> 4];
+        hex += kHex[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+// Signs a 32-byte hex hash with a key held by signer, formatted as the SDK's
+// SignHash returns it; false when the hash is malformed or no key is held.
+bool signNative(NativeSigner& signer, const char* scope, const std::string& address, const std::string& hashHex,
+                std::string& signature)
+{
+    uint8_t hash[32];
+    if (!parseHex(hashHex, hash, sizeof(hash))) {
+        return false;
+    }
+    uint8_t raw[NativeSigner::kSignatureSize];
+    if (!signer.sign(scope, address, hash, raw)) {
+        return false;
+    }
+    signature = hexString(raw, sizeof(raw));
+    return true;
+}
+
+// The signer of a hex hash and hex signature; false when either is malformed
+// or recovery fails.
+bool recoverHex(const std::string& hashHex, const std::string& signatureHex, uint8_t address[kAddressSize])
+{
+    uint8_t hash[32], signature[kRecoverableSignatureSize];
+    return parseHex(hashHex, hash, sizeof(hash)) && parseHex(signatureHex, signature, sizeof(signature)) &&
+           ecrecover(hash, signature, address);
+}
+
+struct RecoveryItem {
+    std::string hash;
+    std::string signature;
+    std::string address;
+};
+
+// Parses the items of recoverAddressBatch and verifyBatch; false (logged)
+// when the input is not a JSON array of such objects.
+bool parseRecoveryItems(const char* op, const std::string& itemsJSON, bool withAddress, std::vector<RecoveryItem>& items)
+{
+    try {
+        const nlohmann::json parsed = nlohmann::json::parse(itemsJSON);
+        if (!parsed.is_array()) {
+            fprintf(stderr, "AccountsModuleImpl: %s: items JSON is not an array\n", op);
+            return false;
+        }
+        items.reserve(parsed.size());
+        for (const auto& entry : parsed) {
+            RecoveryItem item;
+            item.hash = entry.at("hash").get<std::string>();
+            item.signature = entry.at("signature").get<std::string>();
+            if (withAddress) {
+                item.address = entry.at("address").get<std::string>();
+            }
+            items.push_back(std::move(item));
+        }
+    } catch (const nlohmann::json::exception& e) {
+        fprintf(stderr, "AccountsModuleImpl: %s: invalid items JSON: %s\n", op, e.what());
+        return false;
+    }
+    return true;
+}
+
+KeystoreRegistry::Ops tenantKeystoreOps()
+{
+    KeystoreRegistry::Ops ops;
+    ops.open = [](const KeystoreRegistry::Config& config, std::string& error) -> unsigned long long {
+        GoString err;
+        char* dir = const_cast<char*>(config.dir.c_str());
+        const int n = static_cast<int>(config.scryptN);
+        const int p = static_cast<int>(config.scryptP);
+        const unsigned long long handle = config.kind == KeystoreRegistry::Kind::ExtKeystore
+            ? GoWSK_accounts_extkeystore_NewKeyStore(dir, n, p, err.out())
+            : GoWSK_accounts_keystore_NewKeyStore(dir, n, p, err.out());
+        if (handle == 0) {
+            error = errorMessage(err);
+        }
+        return handle;
+    };
+    ops.close = [](const KeystoreRegistry::Config& config, unsigned long long handle) {
+        if (config.kind == KeystoreRegistry::Kind::ExtKeystore) {
+            GoWSK_accounts_extkeystore_CloseKeyStore(handle);
+        } else {
+            GoWSK_accounts_keystore_CloseKeyStore(handle);
+        }
+    };
+    ops.footprint = [](const KeystoreRegistry::Config& config) { return keystoreFootprint(config.dir); };
+    return ops;
+}
+
+bool isAscii(const std::string& s)
+{
+    return std::all_of(s.begin(), s.end(), [](unsigned char c) { return c < 0x80; });
+}
+
+std::string lowerHex(std::string address)
+{
+    std::transform(address.begin(), address.end(), address.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return address;
+}
+
+// Hex of the first 16 bytes of the digest of parts, for names derived from them.
+std::string digestHex(std::initializer_list<std::string> parts)
+{
+    const std::string digest = singleFlightKey(parts);
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < 16; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(digest[i]);
+        hex += kHex[byte >> 4];
+        hex += kHex[byte & 0x0f];
+    }
+    return hex;
+}
+
+// Append-only list of accounts bulk jobs have finished, one "<job> <address>"
+// per line, where job is a digest of what the job does (keystore directory and
+// target scrypt parameters). Each entry is synced before the next account is
+// reported done, so a crashed job can be resumed without redoing (or skipping)
+// work, while a job with another directory or parameters sharing the file
+// skips nothing of it. A full run that ends without failures appends "<job> done";
+// the digest cannot tell a later rotation from a resume, so a journal whose
+// job is done is refused rather than skipping every account.
+class BulkJournal {
+public:
+    BulkJournal(const std::string& path, const std::string& job) : fd(-1), job(job)
+    {
+        if (path.empty()) {
+            return;
+        }
+        if (FILE* f = fopen(path.c_str(), "r")) {
+            char line[256];
+            while (fgets(line, sizeof(line), f)) {
+                std::string entry(line);
+                while (!entry.empty() && (entry.back() == '\n' || entry.back() == '\r')) {
+                    entry.pop_back();
+                }
+                if (!entry.empty()) {
+                    done.insert(entry);
+                }
+            }
+            fclose(f);
+        }
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    }
+    ~BulkJournal()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    bool usable(const std::string& path) const { return path.empty() || fd >= 0; }
+    bool contains(const std::string& address) const { return done.count(entry(address)) != 0; }
+    bool finished() const { return done.count(job + " done") != 0; }
+    void finish() { append(job + " done\n"); }
+    void record(const std::string& address) { append(entry(address) + "\n"); }
+
+    // Identifies a job by keystore directory and target scrypt parameters.
+    static std::string jobId(const std::string& dir, int64_t scryptN, int64_t scryptP)
+    {
+        return digestHex({"BulkUpdate", dir, std::to_string(scryptN), std::to_string(scryptP)});
+    }
+
+private:
+    std::string entry(const std::string& address) const { return job + ' ' + lowerHex(address); }
+    void append(const std::string& line)
+    {
+        if (fd < 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size())) {
+            fdatasync(fd);
+        }
+    }
+
+    int fd;
+    std::string job;
+    std::mutex mutex;
+    std::set<std::string> done;
+};
+
+} // namespace
+
+AccountsModuleImpl::AccountsModuleImpl()
+    : keystoreHandle(0), extkeystoreHandle(0), keystoreScryptN(0), keystoreScryptP(0),
+      extkeystoreScryptN(0), extkeystoreScryptP(0),
+      bulkThreads(defaultBulkThreads()), bulkMemoryBudget(kDefaultBulkMemoryBudget), tenants(tenantKeystoreOps()),
+      nativeSigning(false)
 {
     fprintf(stderr, "AccountsModuleImpl: Initializing...\n");
+    // Memory keystores of a module instance that crashed.
+    MemoryDir::sweep(std::string("logos-") + KeystoreFamily::kScope + "-");
+    MemoryDir::sweep(std::string("logos-") + ExtKeystoreFamily::kScope + "-");
 }
 
 AccountsModuleImpl::~AccountsModuleImpl()
 {
+    awaitLoad(keystoreLoad);
+    awaitLoad(extkeystoreLoad);
+    stopAddressPools();
+    closeAccountPool();
+    tenants.closeAll();
     if (keystoreHandle != 0) {
         GoWSK_accounts_keystore_CloseKeyStore(keystoreHandle);
         keystoreHandle = 0;
@@ -19,19 +365,26 @@ AccountsModuleImpl::~AccountsModuleImpl()
     }
 }
 
-std::vector<std::string> AccountsModuleImpl::parseAccountsJson(const char* jsonStr)
+std::vector<std::string> AccountsModuleImpl::parseAccountsJson(std::string_view jsonStr, bool hidePooled)
 {
     std::vector<std::string> addresses;
     try {
-        auto doc = nlohmann::json::parse(jsonStr);
+        auto doc = nlohmann::json::parse(jsonStr.begin(), jsonStr.end());
         if (!doc.is_array()) {
             fprintf(stderr, "AccountsModuleImpl: Failed to parse accounts JSON: not an array\n");
             return addresses;
         }
+        auto pool = hidePooled ? currentAccountPool() : nullptr;
         for (const auto& value : doc) {
-            if (value.is_object()) {
-                addresses.push_back(value.dump());
+            if (!value.is_object()) {
+                continue;
+            }
+            // Accounts held back by the account pool are not listed until handed out.
+            const auto address = value.find("address");
+            if (pool && address != value.end() && address->is_string() && pool->reserved(address->get<std::string>())) {
+                continue;
             }
+            addresses.push_back(value.dump());
         }
     } catch (const nlohmann::json::parse_error& e) {
         fprintf(stderr, "AccountsModuleImpl: Failed to parse accounts JSON: %s\n", e.what());
@@ -39,897 +392,2872 @@ std::vector<std::string> AccountsModuleImpl::parseAccountsJson(const char* jsonS
     return addresses;
 }
 
-// Keystore operations
-
-bool AccountsModuleImpl::initKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP)
+void AccountsModuleImpl::awaitLoad(KeystoreLoad& load)
 {
-    fprintf(stderr, "AccountsModuleImpl::initKeystore %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
-    if (keystoreHandle != 0) {
-        GoWSK_accounts_keystore_CloseKeyStore(keystoreHandle);
+    std::shared_future<void> pending;
+    {
+        std::lock_guard<std::mutex> lock(load.mutex);
+        pending = load.pending;
     }
-    char* err = nullptr;
-    keystoreHandle = GoWSK_accounts_keystore_NewKeyStore(
-        const_cast<char*>(dir.c_str()), static_cast<int>(scryptN), static_cast<int>(scryptP), &err);
-    if (keystoreHandle == 0) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Failed to create keystore: %s\n", emsg.c_str());
-        return false;
+    if (pending.valid()) {
+        pending.wait();
     }
-    fprintf(stderr, "AccountsModuleImpl: Keystore created: handle=%llu\n", (unsigned long long)keystoreHandle);
-    return true;
 }
 
-bool AccountsModuleImpl::closeKeystore(const std::string& privateKey)
+std::unique_lock<std::mutex> AccountsModuleImpl::lockLoad(KeystoreLoad& load)
 {
-    (void)privateKey;
-    fprintf(stderr, "AccountsModuleImpl::closeKeystore\n");
-    if (keystoreHandle != 0) {
-        GoWSK_accounts_keystore_CloseKeyStore(keystoreHandle);
-        keystoreHandle = 0;
-        return true;
+    std::unique_lock<std::mutex> lock(load.mutex);
+    while (load.state == LoadState::Loading && load.pending.valid()) {
+        std::shared_future<void> pending = load.pending;
+        lock.unlock();
+        pending.wait();
+        lock.lock();
+    }
+    return lock;
+}
+
+std::string AccountsModuleImpl::loadStateName(KeystoreLoad& load)
+{
+    std::lock_guard<std::mutex> lock(load.mutex);
+    switch (load.state) {
+    case LoadState::Loading: return "loading";
+    case LoadState::Ready: return "ready";
+    case LoadState::Failed: return "failed";
+    case LoadState::Closed: break;
+    }
+    return "closed";
+}
+
+bool AccountsModuleImpl::waitLoad(KeystoreLoad& load, int64_t timeoutMs)
+{
+    std::shared_future<void> pending;
+    {
+        std::lock_guard<std::mutex> lock(load.mutex);
+        pending = load.pending;
+    }
+    if (pending.valid()) {
+        if (timeoutMs < 0) {
+            pending.wait();
+        } else if (pending.wait_for(std::chrono::milliseconds(timeoutMs)) != std::future_status::ready) {
+            return false;
+        }
     }
-    return false;
+    std::lock_guard<std::mutex> lock(load.mutex);
+    return load.state == LoadState::Ready;
 }
 
-std::vector<std::string> AccountsModuleImpl::keystoreAccounts()
+// Keystore families
+//
+// Each keystore operation is written once as a template over its SDK family
+// (keystore_family.h); the keystore* and extKeystore* methods forward here.
+
+template <>
+AccountsModuleImpl::FamilyState AccountsModuleImpl::familyState<KeystoreFamily>()
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreAccounts\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    return {keystoreLoad, keystoreHandle, keystoreWatcher, keystoreDir, keystoreScryptN, keystoreScryptP, keystoreMemoryDir};
+}
+
+template <>
+AccountsModuleImpl::FamilyState AccountsModuleImpl::familyState<ExtKeystoreFamily>()
+{
+    return {extkeystoreLoad, extkeystoreHandle, extkeystoreWatcher, extkeystoreDir, extkeystoreScryptN, extkeystoreScryptP,
+            extkeystoreMemoryDir};
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familySetDir(const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    FamilyState state = familyState<Family>();
+    state.memoryDir.release();
+    state.dir = dir;
+    state.scryptN = scryptN;
+    state.scryptP = scryptP;
+    if (dir != kMemoryKeystoreDir && dir != kTempKeystoreDir) {
+        return true;
     }
-    char* err = nullptr;
-    char* accountsJson = GoWSK_accounts_keystore_Accounts(keystoreHandle, &err);
-    if (accountsJson == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Accounts error: %s\n", emsg.c_str());
-        return {};
+    const MemoryDir::Backing backing = dir == kTempKeystoreDir ? MemoryDir::Backing::MemoryOrDisk : MemoryDir::Backing::Memory;
+    if (!state.memoryDir.create(std::string("logos-") + Family::kScope + "-", backing)) {
+        fprintf(stderr, "AccountsModuleImpl: Failed to create in-memory %s\n", Family::kNoun);
+        return false;
     }
-    auto result = parseAccountsJson(accountsJson);
-    GoWSK_FreeCString(accountsJson);
-    return result;
+    state.dir = state.memoryDir.path();
+    state.scryptN = scryptN > 0 ? scryptN : kLightScryptN;
+    state.scryptP = scryptP > 0 ? scryptP : kLightScryptP;
+    fprintf(stderr, "AccountsModuleImpl: in-memory %s at %s\n", Family::kNoun, state.dir.c_str());
+    return true;
 }
 
-std::string AccountsModuleImpl::keystoreNewAccount(const std::string& passphrase)
+template <typename Family>
+AccountsModuleImpl::FamilyTarget AccountsModuleImpl::familyTarget(uint64_t* generation)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreNewAccount\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    FamilyTarget target;
+    target.handle = familyHandle<Family>(generation);
+    target.scope = Family::kScope;
+    return target;
+}
+
+AccountsModuleImpl::FamilyTarget AccountsModuleImpl::tenantTarget(const std::string& tenant, const char* label, TenantScope scope)
+{
+    FamilyTarget target;
+    target.lease = leaseTenant(tenant, label, scope);
+    if (!target.lease) {
+        return target;
+    }
+    target.handle = target.lease.sdkHandle();
+    target.scope = tenantScope(tenant);
+    target.tenant = tenant;
+    target.ext = target.lease.kind() == KeystoreRegistry::Kind::ExtKeystore;
+    return target;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyKeyWritten(const FamilyTarget& target, std::string address)
+{
+    if (address.empty() || !target.own()) {
+        return address;
+    }
+    FamilyState state = familyState<Family>();
+    familyRecordWrite<Family>(target.handle, state.dir, address);
+    // Reads answered from the watcher's view see the new key file.
+    state.watcher.flush();
+    return address;
+}
+
+template <typename Family>
+void AccountsModuleImpl::familyRecordWrite(unsigned long long handle, const std::string& dir, const std::string& address)
+{
+    // A synchronous write is synced on its own, so it is worth asking the SDK
+    // where the file is rather than scanning the directory for it.
+    std::string path;
+    if (durability.synchronous()) {
+        GoString err;
+        GoString account(Family::find(handle, address.c_str(), "", err.out()));
+        if (account) {
+            auto doc = nlohmann::json::parse(account.view(), nullptr, false);
+            path = doc.is_object() ? keyFilePath(doc.value("url", std::string())) : std::string();
+        }
     }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_keystore_NewAccount(
-        keystoreHandle, const_cast<char*>(passphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: NewAccount error: %s\n", emsg.c_str());
-        return {};
+    if (!durability.written(dir, address, path)) {
+        fprintf(stderr, "AccountsModuleImpl: %s: key file of %s not synced\n", Family::kName, address.c_str());
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
 }
 
-std::string AccountsModuleImpl::keystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase)
+template <typename Family>
+unsigned long long AccountsModuleImpl::familyHandle(uint64_t* generation)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreImport\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    const unsigned long long handle = state.handle;
+    if (generation) {
+        *generation = state.load.generation;
     }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_keystore_Import(
-        keystoreHandle, const_cast<char*>(keyJSON.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Import error: %s\n", emsg.c_str());
-        return {};
+    if (handle == 0) {
+        fprintf(stderr, "AccountsModuleImpl: %s not initialized\n", Family::kName);
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
+    return handle;
 }
 
-std::string AccountsModuleImpl::keystoreExport(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+template <typename Family, typename Call>
+GoString AccountsModuleImpl::familyCall(AdmissionControl::Lane lane, const char* op, const Call& call)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreExport\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    AdmissionControl::Ticket ticket = admit(lane, op, Family::kLabelPrefix);
+    if (!ticket) {
+        return GoString();
     }
-    char* err = nullptr;
-    char* keyJson = GoWSK_accounts_keystore_Export(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (keyJson == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Export error: %s\n", emsg.c_str());
-        return {};
+    GoString err;
+    GoString value(call(err.out()));
+    if (!value) {
+        fprintf(stderr, "AccountsModuleImpl: %s%s error: %s\n", Family::kLabelPrefix, op, errorMessage(err));
     }
-    std::string result(keyJson);
-    GoWSK_FreeCString(keyJson);
-    return result;
+    return value;
 }
 
-bool AccountsModuleImpl::keystoreDelete(const std::string& address, const std::string& passphrase)
+template <typename Family, typename Call>
+bool AccountsModuleImpl::familyVoidCall(AdmissionControl::Lane lane, const char* op, const Call& call)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreDelete\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+    AdmissionControl::Ticket ticket = admit(lane, op, Family::kLabelPrefix);
+    if (!ticket) {
         return false;
     }
-    char* err = nullptr;
-    GoWSK_accounts_keystore_Delete(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Delete error: %s\n", emsg.c_str());
+    GoString err;
+    call(err.out());
+    if (err) {
+        fprintf(stderr, "AccountsModuleImpl: %s%s error: %s\n", Family::kLabelPrefix, op, err.c_str());
         return false;
     }
     return true;
 }
 
-bool AccountsModuleImpl::keystoreHasAddress(const std::string& address)
+template <typename Family>
+void AccountsModuleImpl::familyStopPools()
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreHasAddress\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return false;
+    if constexpr (Family::kAccountPool) {
+        closeAccountPool();
+    } else {
+        stopAddressPools();
     }
-    char* err = nullptr;
-    int result = GoWSK_accounts_keystore_HasAddress(
-        keystoreHandle, const_cast<char*>(address.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: HasAddress error: %s\n", emsg.c_str());
-        return false;
-    }
-    return result != 0;
 }
 
-bool AccountsModuleImpl::keystoreUnlock(const std::string& address, const std::string& passphrase)
+template <typename Family>
+bool AccountsModuleImpl::familyInit(const std::string& dir, int64_t scryptN, int64_t scryptP)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreUnlock\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    state.watcher.stop();
+    familyStopPools<Family>();
+    signatures.invalidateScope(Family::kScope);
+    nativeKeys.invalidateScope(Family::kScope);
+    ++state.load.generation;
+    durability.drain();
+    if (state.handle != 0) {
+        Family::close(state.handle);
+        state.handle = 0;
+    }
+    if (!familySetDir<Family>(dir, scryptN, scryptP)) {
+        state.load.state = LoadState::Failed;
         return false;
     }
-    char* err = nullptr;
-    GoWSK_accounts_keystore_Unlock(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Unlock error: %s\n", emsg.c_str());
+    GoString err;
+    state.handle = Family::open(state.dir.c_str(), static_cast<int>(state.scryptN), static_cast<int>(state.scryptP), err.out());
+    if (state.handle == 0) {
+        fprintf(stderr, "AccountsModuleImpl: Failed to create %s: %s\n", Family::kNoun, errorMessage(err));
+        state.load.state = LoadState::Failed;
+        state.memoryDir.release();
         return false;
     }
+    fprintf(stderr, "AccountsModuleImpl: %s created: handle=%llu\n", Family::kName, state.handle.load());
+    if constexpr (Family::kAccountPool) {
+        openAccountPool(state.dir);
+    }
+    state.load.state = LoadState::Ready;
     return true;
 }
 
-bool AccountsModuleImpl::keystoreLock(const std::string& address)
+template <typename Family>
+bool AccountsModuleImpl::familyInitAsync(const std::string& dir, int64_t scryptN, int64_t scryptP)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreLock\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_keystore_Lock(
-        keystoreHandle, const_cast<char*>(address.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Lock error: %s\n", emsg.c_str());
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    state.watcher.stop();
+    familyStopPools<Family>();
+    signatures.invalidateScope(Family::kScope);
+    nativeKeys.invalidateScope(Family::kScope);
+    ++state.load.generation;
+    durability.drain();
+    if (state.handle != 0) {
+        Family::close(state.handle);
+        state.handle = 0;
+    }
+    if (!familySetDir<Family>(dir, scryptN, scryptP)) {
+        state.load.state = LoadState::Failed;
         return false;
     }
+    state.load.state = LoadState::Loading;
+    state.load.pending = std::async(std::launch::async, [this, dir = state.dir, scryptN = state.scryptN, scryptP = state.scryptP]() {
+        FamilyState state = familyState<Family>();
+        GoString err;
+        unsigned long long handle = Family::open(dir.c_str(), static_cast<int>(scryptN), static_cast<int>(scryptP), err.out());
+        std::lock_guard<std::mutex> lock(state.load.mutex);
+        state.handle = handle;
+        if (handle == 0) {
+            fprintf(stderr, "AccountsModuleImpl: Failed to create %s: %s\n", Family::kNoun, errorMessage(err));
+            state.load.state = LoadState::Failed;
+            state.memoryDir.release();
+            return;
+        }
+        fprintf(stderr, "AccountsModuleImpl: %s created: handle=%llu\n", Family::kName, handle);
+        if constexpr (Family::kAccountPool) {
+            openAccountPool(dir);
+        }
+        state.load.state = LoadState::Ready;
+    }).share();
     return true;
 }
 
-bool AccountsModuleImpl::keystoreTimedUnlock(const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds)
+template <typename Family>
+bool AccountsModuleImpl::familyClose()
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreTimedUnlock\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_keystore_TimedUnlock(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()),
-        static_cast<unsigned long>(timeoutSeconds), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: TimedUnlock error: %s\n", emsg.c_str());
-        return false;
-    }
-    return true;
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    state.load.state = LoadState::Closed;
+    state.watcher.stop();
+    familyStopPools<Family>();
+    signatures.invalidateScope(Family::kScope);
+    nativeKeys.invalidateScope(Family::kScope);
+    ++state.load.generation;
+    durability.drain();
+    bool closed = false;
+    if (state.handle != 0) {
+        Family::close(state.handle);
+        state.handle = 0;
+        closed = true;
+    }
+    state.memoryDir.release();
+    return closed;
 }
 
-bool AccountsModuleImpl::keystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+template <typename Family>
+bool AccountsModuleImpl::familyWatch(int64_t debounceMs)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreUpdate\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    if (state.handle == 0) {
+        fprintf(stderr, "AccountsModuleImpl: %s not initialized\n", Family::kName);
         return false;
     }
-    char* err = nullptr;
-    GoWSK_accounts_keystore_Update(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Update error: %s\n", emsg.c_str());
+    return state.watcher.start(state.dir, debounceMs);
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyUnwatch()
+{
+    FamilyState state = familyState<Family>();
+    // Serialised with familyWatch, which starts the watcher under this lock.
+    std::lock_guard<std::mutex> lock(state.load.mutex);
+    if (!state.watcher.running()) {
         return false;
     }
+    state.watcher.stop();
     return true;
 }
 
-std::string AccountsModuleImpl::keystoreSignHash(const std::string& address, const std::string& hashHex)
+template <typename Family>
+std::vector<std::string> AccountsModuleImpl::familyAccounts(const FamilyTarget& target)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreSignHash\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+    if (!target) {
         return {};
     }
-    char* err = nullptr;
-    char* signature = GoWSK_accounts_keystore_SignHash(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(hashHex.c_str()), &err);
-    if (signature == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: SignHash error: %s\n", emsg.c_str());
+    if (target.own()) {
+        KeystoreWatcher& watcher = familyState<Family>().watcher;
+        if (watcher.running()) {
+            if constexpr (Family::kAccountPool) {
+                return hidePooledAccounts(watcher.accounts());
+            } else {
+                return watcher.accounts();
+            }
+        }
+    }
+    GoString accountsJson = familyCall<Family>(AdmissionControl::Lane::Cheap, "Accounts", [&](char** err) {
+        return Family::accounts(target.handle, err);
+    });
+    if (!accountsJson) {
         return {};
     }
-    std::string result(signature);
-    GoWSK_FreeCString(signature);
-    return result;
+    // Pooled accounts only exist in the module's own keystore.
+    return parseAccountsJson(accountsJson.view(), target.own());
 }
 
-std::string AccountsModuleImpl::keystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex)
+template <typename Family>
+std::string AccountsModuleImpl::familyNewAccount(const FamilyTarget& target, const std::string& passphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreSignHashWithPassphrase\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+    if (!target) {
         return {};
     }
-    char* err = nullptr;
-    char* signature = GoWSK_accounts_keystore_SignHashWithPassphrase(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(hashHex.c_str()), &err);
-    if (signature == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: SignHashWithPassphrase error: %s\n", emsg.c_str());
-        return {};
+    if constexpr (Family::kAccountPool) {
+        if (auto pool = target.own() ? currentAccountPool() : nullptr) {
+            std::string pooled;
+            if (pool->take(passphrase, pooled)) {
+                return familyKeyWritten<Family>(target, pooled);
+            }
+        }
     }
-    std::string result(signature);
-    GoWSK_FreeCString(signature);
-    return result;
+    return familyKeyWritten<Family>(target, familyCall<Family>(AdmissionControl::Lane::Scrypt, "NewAccount", [&](char** err) {
+        return Family::newAccount(target.handle, passphrase.c_str(), err);
+    }).str());
 }
 
-std::string AccountsModuleImpl::keystoreImportECDSA(const std::string& privateKeyHex, const std::string& passphrase)
+template <typename Family>
+std::string AccountsModuleImpl::familyImport(const FamilyTarget& target, const std::string& keyJSON, const std::string& passphrase,
+                                             const std::string& newPassphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreImportECDSA\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_keystore_ImportECDSA(
-        keystoreHandle, const_cast<char*>(privateKeyHex.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ImportECDSA error: %s\n", emsg.c_str());
+    if (!target) {
         return {};
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
+    return familyKeyWritten<Family>(target, familyCall<Family>(AdmissionControl::Lane::Scrypt, "Import", [&](char** err) {
+        return Family::import(target.handle, keyJSON.c_str(), passphrase.c_str(), newPassphrase.c_str(), err);
+    }).str());
 }
 
-std::string AccountsModuleImpl::keystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex)
+template <typename Family, auto Export>
+std::string AccountsModuleImpl::familyExport(const FamilyTarget& target, const char* op, const std::string& address,
+                                             const std::string& passphrase, const std::string& newPassphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreSignTx\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* signedTx = GoWSK_accounts_keystore_SignTx(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(txJSON.c_str()), const_cast<char*>(chainIDHex.c_str()), &err);
-    if (signedTx == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: SignTx error: %s\n", emsg.c_str());
+    if (!target || familyPooled<Family>(target, op, address)) {
         return {};
     }
-    std::string result(signedTx);
-    GoWSK_FreeCString(signedTx);
-    return result;
+    return flights.run(singleFlightKey({op, target.scope, address, passphrase, newPassphrase}), [&] {
+        return familyCall<Family>(AdmissionControl::Lane::Scrypt, op, [&](char** err) {
+            return Export(target.handle, address.c_str(), passphrase.c_str(), newPassphrase.c_str(), err);
+        }).str();
+    });
 }
 
-std::string AccountsModuleImpl::keystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex)
+template <typename Family>
+bool AccountsModuleImpl::familyDelete(const FamilyTarget& target, const std::string& address, const std::string& passphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreSignTxWithPassphrase\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    if (!target) {
+        return false;
     }
-    char* err = nullptr;
-    char* signedTx = GoWSK_accounts_keystore_SignTxWithPassphrase(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(txJSON.c_str()),
-        const_cast<char*>(chainIDHex.c_str()), &err);
-    if (signedTx == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: SignTxWithPassphrase error: %s\n", emsg.c_str());
-        return {};
+    if (!familyVoidCall<Family>(AdmissionControl::Lane::Scrypt, "Delete", [&](char** err) {
+            Family::remove(target.handle, address.c_str(), passphrase.c_str(), err);
+        })) {
+        return false;
     }
-    std::string result(signedTx);
-    GoWSK_FreeCString(signedTx);
-    return result;
+    signatures.invalidate(target.scope, address);
+    nativeKeys.invalidate(target.scope, address);
+    if (!target.own()) {
+        tenants.unpin(target.tenant, address);
+        return true;
+    }
+    FamilyState state = familyState<Family>();
+    // A removal only needs the directory synced.
+    durability.written(state.dir, "");
+    state.watcher.flush();
+    return true;
 }
 
-std::string AccountsModuleImpl::keystoreFind(const std::string& address, const std::string& url)
+template <typename Family>
+bool AccountsModuleImpl::familyHasAddress(const FamilyTarget& target, const std::string& address)
 {
-    fprintf(stderr, "AccountsModuleImpl::keystoreFind\n");
-    if (keystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
-        return {};
+    if (!target) {
+        return false;
     }
-    char* err = nullptr;
-    char* resultStr = GoWSK_accounts_keystore_Find(
-        keystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(url.c_str()), &err);
-    if (resultStr == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Find error: %s\n", emsg.c_str());
-        return {};
+    if (target.own()) {
+        if (familyPooled<Family>(target, nullptr, address)) {
+            return false;
+        }
+        KeystoreWatcher& watcher = familyState<Family>().watcher;
+        if (watcher.running()) {
+            return watcher.hasAddress(address);
+        }
     }
-    std::string result(resultStr);
-    GoWSK_FreeCString(resultStr);
-    return result;
-}
-
+    int result = 0;
+    if (!familyVoidCall<Family>(AdmissionControl::Lane::Cheap, "HasAddress", [&](char** err) {
+            result = Family::hasAddress(target.handle, address.c_str(), err);
+        })) {
+        return false;
+    }
+    return result != 0;
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyPooled(const FamilyTarget& target, const char* op, const std::string& address)
+{
+    if constexpr (Family::kAccountPool) {
+        auto pool = target.own() ? currentAccountPool() : nullptr;
+        if (pool && pool->reserved(address)) {
+            if (op) {
+                fprintf(stderr, "AccountsModuleImpl: %s%s error: %s is held by the account pool\n", Family::kLabelPrefix, op,
+                        address.c_str());
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Family, typename Call>
+bool AccountsModuleImpl::familyUnlockAccount(const FamilyTarget& target, const char* op, const std::string& address,
+                                             const std::string& passphrase, uint64_t timeoutSeconds, const Call& call)
+{
+    uint8_t key[32];
+    // Taken before the unlock: a Lock in between must not be undone below.
+    const uint64_t generation = nativeKeys.generation(target.scope, address);
+    // The SDK's timer starts during its call, so the expiry is taken before
+    // it and never outlasts that timer; a deferred SDK unlock gets what is
+    // left of it.
+    const auto until = timeoutSeconds == 0 ? std::chrono::steady_clock::time_point::max()
+                                           : std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+    bool decryptedKey = false;
+    if (Family::kNativeSigning && nativeSigning && target.own()) {
+        {
+            AdmissionControl::Ticket ticket = admission.enter(AdmissionControl::Lane::Scrypt);
+            decryptedKey = ticket && decryptKeyFile(familyState<Family>().dir, address, passphrase, key);
+        }
+        // The key file opened with passphrase, so the SDK's unlock would too.
+        // An earlier SDK unlock is dropped so its timer cannot outlast this one.
+        if (decryptedKey && passphrase.size() <= NativeSigner::kMaxDeferredPassphrase) {
+            familyVoidCall<Family>(AdmissionControl::Lane::Cheap, "Lock", [&](char** err) {
+                Family::lock(target.handle, address.c_str(), err);
+            });
+            const bool held = nativeKeys.unlocked(target.scope, address, key, until, generation, &passphrase);
+            if (held) {
+                wipe(key, sizeof(key));
+                signatures.unlocked(target.scope, address, until);
+                return true;
+            }
+        }
+    }
+    const bool unlocked = familyVoidCall<Family>(AdmissionControl::Lane::Scrypt, op, call);
+    if (unlocked) {
+        // The tenant's handle now holds the key and is pinned open; the
+        // target's lease keeps it from being evicted before this.
+        if (!target.own()) {
+            tenants.pin(target.tenant, address, until);
+        }
+        signatures.unlocked(target.scope, address, until);
+        if (decryptedKey && !nativeKeys.unlocked(target.scope, address, key, until, generation)) {
+            fprintf(stderr, "AccountsModuleImpl: %s%s: key of %s not held for native signing\n", Family::kLabelPrefix, op,
+                    address.c_str());
+        }
+    }
+    wipe(key, sizeof(key));
+    return unlocked;
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familySdkUnlocked(const FamilyTarget& target, const char* op, const std::string& address)
+{
+    if (!Family::kNativeSigning || !target.own()) {
+        return true;
+    }
+    return unlockFlights.run(singleFlightKey({"SdkUnlock", target.scope, lowerHex(address)}), [&] {
+        NativeSigner::SdkUnlock pending;
+        return !nativeKeys.takeSdkUnlock(target.scope, address, pending) || familyCompleteUnlock<Family>(target, op, pending);
+    });
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyCompleteUnlock(const FamilyTarget& target, const char* op, NativeSigner::SdkUnlock& pending)
+{
+    bool unlocked = false;
+    if (pending.until == std::chrono::steady_clock::time_point::max()) {
+        unlocked = familyVoidCall<Family>(AdmissionControl::Lane::Scrypt, op, [&](char** err) {
+            Family::unlock(target.handle, pending.address.c_str(), pending.passphrase.c_str(), err);
+        });
+    } else {
+        const auto left = std::chrono::duration_cast<std::chrono::seconds>(pending.until - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            fprintf(stderr, "AccountsModuleImpl: %s%s error: the unlock of %s has expired\n", Family::kLabelPrefix, op,
+                    pending.address.c_str());
+        } else {
+            unlocked = familyVoidCall<Family>(AdmissionControl::Lane::Scrypt, op, [&](char** err) {
+                Family::timedUnlock(target.handle, pending.address.c_str(), pending.passphrase.c_str(),
+                                    static_cast<unsigned long>(left.count()), err);
+            });
+        }
+    }
+    if (!pending.passphrase.empty()) {
+        wipe(&pending.passphrase[0], pending.passphrase.size());
+    }
+    if (unlocked && nativeKeys.generation(target.scope, pending.address) != pending.generation) {
+        familyVoidCall<Family>(AdmissionControl::Lane::Cheap, "Lock", [&](char** err) {
+            Family::lock(target.handle, pending.address.c_str(), err);
+        });
+        unlocked = false;
+    }
+    return unlocked;
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyUnlock(const FamilyTarget& target, const std::string& address, const std::string& passphrase)
+{
+    if (!target) {
+        return false;
+    }
+    return unlockFlights.run(singleFlightKey({"Unlock", target.scope, address, passphrase}), [&] {
+        return familyUnlockAccount<Family>(target, "Unlock", address, passphrase, 0, [&](char** err) {
+            Family::unlock(target.handle, address.c_str(), passphrase.c_str(), err);
+        });
+    });
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyLock(const FamilyTarget& target, const std::string& address)
+{
+    if (!target) {
+        return false;
+    }
+    const bool locked = familyVoidCall<Family>(AdmissionControl::Lane::Cheap, "Lock", [&](char** err) {
+        Family::lock(target.handle, address.c_str(), err);
+    });
+    signatures.invalidate(target.scope, address);
+    nativeKeys.invalidate(target.scope, address);
+    if (locked && !target.own()) {
+        tenants.unpin(target.tenant, address);
+    }
+    return locked;
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyTimedUnlock(const FamilyTarget& target, const std::string& address, const std::string& passphrase,
+                                           uint64_t timeoutSeconds)
+{
+    if (!target) {
+        return false;
+    }
+    return unlockFlights.run(singleFlightKey({"TimedUnlock", target.scope, address, passphrase, std::to_string(timeoutSeconds)}), [&] {
+        return familyUnlockAccount<Family>(target, "TimedUnlock", address, passphrase, timeoutSeconds, [&](char** err) {
+            Family::timedUnlock(target.handle, address.c_str(), passphrase.c_str(), static_cast<unsigned long>(timeoutSeconds), err);
+        });
+    });
+}
+
+template <typename Family>
+bool AccountsModuleImpl::familyUpdate(const FamilyTarget& target, const std::string& address, const std::string& passphrase,
+                                      const std::string& newPassphrase)
+{
+    if (!target) {
+        return false;
+    }
+    if (!familyVoidCall<Family>(AdmissionControl::Lane::Scrypt, "Update", [&](char** err) {
+            Family::update(target.handle, address.c_str(), passphrase.c_str(), newPassphrase.c_str(), err);
+        })) {
+        return false;
+    }
+    signatures.invalidate(target.scope, address);
+    nativeKeys.invalidate(target.scope, address);
+    familyKeyWritten<Family>(target, address);
+    return true;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignHash(const FamilyTarget& target, const std::string& address, const std::string& hashHex)
+{
+    if (!target || familyPooled<Family>(target, "SignHash", address)) {
+        return {};
+    }
+    std::string cached;
+    uint64_t epoch = 0;
+    if (signatures.lookup(target.scope, address, "hash", hashHex, "", cached, epoch)) {
+        return cached;
+    }
+    if (Family::kNativeSigning && nativeSigning && target.own() &&
+        signNative(nativeKeys, target.scope.c_str(), address, hashHex, cached)) {
+        signatures.store(target.scope, address, "hash", hashHex, "", cached, epoch);
+        return cached;
+    }
+    if (!familySdkUnlocked<Family>(target, "SignHash", address)) {
+        return {};
+    }
+    GoString signature = familyCall<Family>(AdmissionControl::Lane::Cheap, "SignHash", [&](char** err) {
+        char* result = nullptr;
+        ffi.run([&] { result = Family::signHash(target.handle, address.c_str(), hashHex.c_str(), err); });
+        return result;
+    });
+    if (!signature) {
+        return {};
+    }
+    std::string result = signature.str();
+    signatures.store(target.scope, address, "hash", hashHex, "", result, epoch);
+    return result;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignTypedData(const std::string& address, const std::string& typedDataJSON)
+{
+    const std::string hashHex = hashTypedData(typedDataJSON);
+    if (hashHex.empty()) {
+        return {};
+    }
+    return familySignHash<Family>(familyTarget<Family>(), address, hashHex);
+}
+
+template <typename Family>
+int64_t AccountsModuleImpl::familySignMessageBegin(const std::string& address, int64_t length)
+{
+    uint64_t generation = 0;
+    if (familyHandle<Family>(&generation) == 0) {
+        return 0;
+    }
+    if (length < 0) {
+        fprintf(stderr, "AccountsModuleImpl: %sSignMessageBegin: negative length\n", Family::kLabelPrefix);
+        return 0;
+    }
+    const int64_t session = messageSessions.begin(Family::kScope, address, generation, static_cast<uint64_t>(length));
+    if (session == 0) {
+        fprintf(stderr, "AccountsModuleImpl: %sSignMessageBegin: %zu sessions already open\n", Family::kLabelPrefix,
+                PersonalMessageSessions::kMaxSessions);
+    }
+    return session;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignMessageFd(const std::string& address, int64_t fd, int64_t length)
+{
+    if (familyHandle<Family>() == 0) {
+        return {};
+    }
+    uint8_t digest[Keccak256::kDigestSize];
+    std::string error;
+    if (!personalMessageHashFd(static_cast<int>(fd), length, digest, error)) {
+        fprintf(stderr, "AccountsModuleImpl: %sSignMessageFd: %s\n", Family::kLabelPrefix, error.c_str());
+        return {};
+    }
+    return familySignHash<Family>(familyTarget<Family>(), address, hexString(digest, sizeof(digest)));
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignHashWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                                             const std::string& passphrase, const std::string& hashHex)
+{
+    if (!target || familyPooled<Family>(target, "SignHashWithPassphrase", address)) {
+        return {};
+    }
+    return flights.run(singleFlightKey({"SignHashWithPassphrase", target.scope, address, passphrase, hashHex}), [&] {
+        return familyCall<Family>(AdmissionControl::Lane::Scrypt, "SignHashWithPassphrase", [&](char** err) {
+            return Family::signHashWithPassphrase(target.handle, address.c_str(), passphrase.c_str(), hashHex.c_str(), err);
+        }).str();
+    });
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignTx(const FamilyTarget& target, const std::string& address, const std::string& txJSON,
+                                             const std::string& chainIDHex)
+{
+    if (!target || familyPooled<Family>(target, "SignTx", address)) {
+        return {};
+    }
+    std::string cached;
+    uint64_t epoch = 0;
+    if (signatures.lookup(target.scope, address, "tx", txJSON, chainIDHex, cached, epoch)) {
+        return cached;
+    }
+    if (!familySdkUnlocked<Family>(target, "SignTx", address)) {
+        return {};
+    }
+    GoString signedTx = familyCall<Family>(AdmissionControl::Lane::Cheap, "SignTx", [&](char** err) {
+        char* result = nullptr;
+        ffi.run([&] { result = Family::signTx(target.handle, address.c_str(), txJSON.c_str(), chainIDHex.c_str(), err); });
+        return result;
+    });
+    if (!signedTx) {
+        return {};
+    }
+    std::string result = signedTx.str();
+    signatures.store(target.scope, address, "tx", txJSON, chainIDHex, result, epoch);
+    return result;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familySignTxWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                                           const std::string& passphrase, const std::string& txJSON,
+                                                           const std::string& chainIDHex)
+{
+    if (!target || familyPooled<Family>(target, "SignTxWithPassphrase", address)) {
+        return {};
+    }
+    return flights.run(singleFlightKey({"SignTxWithPassphrase", target.scope, address, passphrase, txJSON, chainIDHex}), [&] {
+        return familyCall<Family>(AdmissionControl::Lane::Scrypt, "SignTxWithPassphrase", [&](char** err) {
+            return Family::signTxWithPassphrase(target.handle, address.c_str(), passphrase.c_str(), txJSON.c_str(),
+                                                chainIDHex.c_str(), err);
+        }).str();
+    });
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyFind(const FamilyTarget& target, const std::string& address, const std::string& url)
+{
+    if (!target || familyPooled<Family>(target, "Find", address)) {
+        return {};
+    }
+    std::string account = familyCall<Family>(AdmissionControl::Lane::Cheap, "Find", [&](char** err) {
+        return Family::find(target.handle, address.c_str(), url.c_str(), err);
+    }).str();
+    // Found by URL: the address is only known now.
+    if (!account.empty()) {
+        auto doc = nlohmann::json::parse(account, nullptr, false);
+        if (doc.is_object() && familyPooled<Family>(target, "Find", doc.value("address", std::string()))) {
+            return {};
+        }
+    }
+    return account;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyImportECDSA(const FamilyTarget& target, const std::string& privateKeyHex,
+                                                  const std::string& passphrase)
+{
+    if (!target) {
+        return {};
+    }
+    return familyKeyWritten<Family>(target, familyCall<Family>(AdmissionControl::Lane::Scrypt, "ImportECDSA", [&](char** err) {
+        return Family::importECDSA(target.handle, privateKeyHex.c_str(), passphrase.c_str(), err);
+    }).str());
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyImportExtendedKey(const FamilyTarget& target, const std::string& extKeyStr,
+                                                        const std::string& passphrase)
+{
+    if (!target) {
+        return {};
+    }
+    return familyKeyWritten<Family>(target, familyCall<Family>(AdmissionControl::Lane::Scrypt, "ImportExtendedKey", [&](char** err) {
+        return Family::importExtendedKey(target.handle, extKeyStr.c_str(), passphrase.c_str(), err);
+    }).str());
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyDerive(const FamilyTarget& target, const std::string& address, const std::string& derivationPath,
+                                             int64_t pin)
+{
+    if (!target) {
+        return {};
+    }
+    int64_t poolPin = 0;
+    if (auto pool = target.own() ? findAddressPool(address, &poolPin) : nullptr) {
+        std::string pooled;
+        if (poolPin == pin && pool->takePath(derivationPath, pooled)) {
+            return pin != 0 ? familyKeyWritten<Family>(target, pooled) : pooled;
+        }
+    }
+    std::string derived = familyCall<Family>(AdmissionControl::Lane::Scrypt, "Derive", [&](char** err) {
+        return Family::derive(target.handle, address.c_str(), derivationPath.c_str(), static_cast<int>(pin), err);
+    }).str();
+    // Only a pinned derivation stores the derived account.
+    return pin != 0 ? familyKeyWritten<Family>(target, derived) : derived;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyDeriveWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                                           const std::string& derivationPath, int64_t pin,
+                                                           const std::string& passphrase, const std::string& newPassphrase)
+{
+    if (!target) {
+        return {};
+    }
+    return familyCall<Family>(AdmissionControl::Lane::Scrypt, "DeriveWithPassphrase", [&](char** err) {
+        return Family::deriveWithPassphrase(target.handle, address.c_str(), derivationPath.c_str(), static_cast<int>(pin),
+                                            passphrase.c_str(), newPassphrase.c_str(), err);
+    }).str();
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyImportDirectory(const std::string& srcDir, const std::string& passphraseSource,
+                                                      const std::string& newPassphrase)
+{
+    const unsigned long long handle = familyHandle<Family>();
+    if (handle == 0) {
+        return {};
+    }
+    FamilyState state = familyState<Family>();
+    const std::string label = std::string(Family::kLabelPrefix) + "ImportDirectory";
+    const std::string report = importDirectory(label.c_str(), srcDir, passphraseSource, newPassphrase, state.scryptN,
+        [this, handle, dir = state.dir](const char* keyJSON, const char* passphrase, const char* newPassphrase, char** err) {
+            char* address = Family::import(handle, keyJSON, passphrase, newPassphrase, err);
+            if (address != nullptr) {
+                familyRecordWrite<Family>(handle, dir, address);
+            }
+            return address;
+        });
+    state.watcher.flush();
+    return report;
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                                 const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                                 const std::string& journalPath)
+{
+    const unsigned long long handle = familyHandle<Family>();
+    if (handle == 0) {
+        return {};
+    }
+    RekeyOps ops;
+    ops.open = &Family::open;
+    ops.close = &Family::close;
+    ops.accounts = &Family::accounts;
+    ops.update = &Family::update;
+    signatures.invalidateScope(Family::kScope);
+    nativeKeys.invalidateScope(Family::kScope);
+    FamilyState state = familyState<Family>();
+    const std::string label = std::string(Family::kLabelPrefix) + "BulkUpdate";
+    const std::string report = bulkUpdate(label.c_str(), ops, handle, state.dir, state.scryptN, state.scryptP, addressesJSON,
+                                          passphraseSource, newPassphraseSource, scryptN, scryptP, journalPath);
+    state.watcher.flush();
+    if (!report.empty()) {
+        familyReloadParams<Family>(handle, scryptN, scryptP);
+    }
+    return report;
+}
+
+template <typename Family>
+void AccountsModuleImpl::familyReloadParams(unsigned long long handle, int64_t scryptN, int64_t scryptP)
+{
+    FamilyState state = familyState<Family>();
+    std::unique_lock<std::mutex> lock = lockLoad(state.load);
+    const int64_t targetN = scryptN > 0 ? scryptN : state.scryptN;
+    const int64_t targetP = scryptP > 0 ? scryptP : state.scryptP;
+    // Nothing migrated, or the keystore was reopened while the job ran.
+    if ((targetN == state.scryptN && targetP == state.scryptP) || state.handle != handle) {
+        return;
+    }
+    GoString err;
+    const unsigned long long reopened = Family::open(state.dir.c_str(), static_cast<int>(targetN), static_cast<int>(targetP), err.out());
+    if (reopened == 0) {
+        fprintf(stderr, "AccountsModuleImpl: Failed to reopen %s: %s\n", Family::kNoun, errorMessage(err));
+        return;
+    }
+    // Unlocks and cached signatures belong to the handle being replaced.
+    signatures.invalidateScope(Family::kScope);
+    nativeKeys.invalidateScope(Family::kScope);
+    ++state.load.generation;
+    state.handle = reopened;
+    state.scryptN = targetN;
+    state.scryptP = targetP;
+    Family::close(handle);
+    fprintf(stderr, "AccountsModuleImpl: %s reopened with scrypt N=%lld P=%lld: handle=%llu\n", Family::kName,
+            (long long)targetN, (long long)targetP, reopened);
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource)
+{
+    const unsigned long long handle = familyHandle<Family>();
+    if (handle == 0) {
+        return {};
+    }
+    const std::string label = std::string(Family::kLabelPrefix) + "Backup";
+    return backupKeystore(label.c_str(),
+        [handle](char** err) { return Family::accounts(handle, err); },
+        [handle](const char* address, const char* passphrase, const char* newPassphrase, char** err) {
+            return Family::exportKey(handle, address, passphrase, newPassphrase, err);
+        },
+        familyState<Family>().scryptN, fd, passphraseSource, backupPassphraseSource);
+}
+
+template <typename Family>
+std::string AccountsModuleImpl::familyRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource)
+{
+    const unsigned long long handle = familyHandle<Family>();
+    if (handle == 0) {
+        return {};
+    }
+    FamilyState state = familyState<Family>();
+    const std::string label = std::string(Family::kLabelPrefix) + "Restore";
+    const std::string report = restoreKeystore(label.c_str(),
+        [this, handle, dir = state.dir](const char* keyJSON, const char* passphrase, const char* newPassphrase, char** err) {
+            char* address = Family::import(handle, keyJSON, passphrase, newPassphrase, err);
+            if (address != nullptr) {
+                familyRecordWrite<Family>(handle, dir, address);
+            }
+            return address;
+        },
+        state.scryptN, fd, backupPassphraseSource, newPassphraseSource);
+    state.watcher.flush();
+    return report;
+}
+
+// Keystore operations
+
+bool AccountsModuleImpl::initKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::initKeystore %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
+    return familyInit<KeystoreFamily>(dir, scryptN, scryptP);
+}
+
+bool AccountsModuleImpl::initKeystoreAsync(const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::initKeystoreAsync %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
+    return familyInitAsync<KeystoreFamily>(dir, scryptN, scryptP);
+}
+
+std::string AccountsModuleImpl::keystoreState()
+{
+    return loadStateName(keystoreLoad);
+}
+
+bool AccountsModuleImpl::waitKeystoreReady(int64_t timeoutMs)
+{
+    return waitLoad(keystoreLoad, timeoutMs);
+}
+
+bool AccountsModuleImpl::closeKeystore(const std::string& privateKey)
+{
+    (void)privateKey;
+    fprintf(stderr, "AccountsModuleImpl::closeKeystore\n");
+    return familyClose<KeystoreFamily>();
+}
+
+bool AccountsModuleImpl::keystoreWatch(int64_t debounceMs)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreWatch %lld\n", (long long)debounceMs);
+    return familyWatch<KeystoreFamily>(debounceMs);
+}
+
+bool AccountsModuleImpl::keystoreUnwatch()
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreUnwatch\n");
+    return familyUnwatch<KeystoreFamily>();
+}
+
+std::vector<std::string> AccountsModuleImpl::keystoreAccounts()
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreAccounts\n");
+    return familyAccounts<KeystoreFamily>(familyTarget<KeystoreFamily>());
+}
+
+std::string AccountsModuleImpl::keystoreNewAccount(const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreNewAccount\n");
+    return familyNewAccount<KeystoreFamily>(familyTarget<KeystoreFamily>(), passphrase);
+}
+
+std::shared_ptr<AccountPool> AccountsModuleImpl::currentAccountPool()
+{
+    std::lock_guard<std::mutex> lock(accountPoolMutex);
+    return accountPool;
+}
+
+void AccountsModuleImpl::openAccountPool(const std::string& dir)
+{
+    AccountPool::Ops ops;
+    // Refills run in the background, behind interactive scrypt calls.
+    ops.create = [this](const std::string& passphrase, std::string& error) {
+        AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+        GoString err;
+        GoString address(GoWSK_accounts_keystore_NewAccount(keystoreHandle, const_cast<char*>(passphrase.c_str()), err.out()));
+        if (!address) {
+            error = errorMessage(err);
+            fprintf(stderr, "AccountsModuleImpl: NewAccount error: %s\n", error.c_str());
+            return std::string();
+        }
+        return address.str();
+    };
+    ops.verify = [this](const std::string& address, const std::string& passphrase) {
+        AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+        GoString err;
+        GoWSK_accounts_keystore_Unlock(keystoreHandle, const_cast<char*>(address.c_str()),
+                                       const_cast<char*>(passphrase.c_str()), err.out());
+        if (err) {
+            return false;
+        }
+        GoWSK_accounts_keystore_Lock(keystoreHandle, const_cast<char*>(address.c_str()), err.out());
+        return true;
+    };
+    ops.remove = [this](const std::string& address, const std::string& passphrase) {
+        AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+        GoString err;
+        GoWSK_accounts_keystore_Delete(keystoreHandle, const_cast<char*>(address.c_str()),
+                                       const_cast<char*>(passphrase.c_str()), err.out());
+        if (err) {
+            return false;
+        }
+        return true;
+    };
+    auto pool = std::make_shared<AccountPool>(ops, dir + "/.account-pool");
+    std::lock_guard<std::mutex> lock(accountPoolMutex);
+    accountPool = pool;
+}
+
+void AccountsModuleImpl::closeAccountPool()
+{
+    std::shared_ptr<AccountPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(accountPoolMutex);
+        pool.swap(accountPool);
+    }
+    if (pool) {
+        pool->stop();
+    }
+}
+
+std::vector<std::string> AccountsModuleImpl::hidePooledAccounts(std::vector<std::string> accounts)
+{
+    auto pool = currentAccountPool();
+    if (!pool) {
+        return accounts;
+    }
+    accounts.erase(std::remove_if(accounts.begin(), accounts.end(),
+                                  [&](const std::string& account) {
+                                      auto doc = nlohmann::json::parse(account, nullptr, false);
+                                      return doc.is_object() && pool->reserved(doc.value("address", std::string()));
+                                  }),
+                   accounts.end());
+    return accounts;
+}
+
+bool AccountsModuleImpl::keystoreConfigureAccountPool(const std::string& passphraseSource, int64_t size,
+                                                      int64_t refillPerMinute)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreConfigureAccountPool %lld %lld\n", (long long)size,
+            (long long)refillPerMinute);
+    awaitLoad(keystoreLoad);
+    auto pool = currentAccountPool();
+    if (keystoreHandle == 0 || !pool) {
+        fprintf(stderr, "AccountsModuleImpl: Keystore not initialized\n");
+        return false;
+    }
+    if (size < 0 || refillPerMinute < 0) {
+        fprintf(stderr, "AccountsModuleImpl: keystoreConfigureAccountPool: invalid arguments\n");
+        return false;
+    }
+    std::string passphrase;
+    if (!resolvePassphraseSource(passphraseSource, passphrase)) {
+        fprintf(stderr, "AccountsModuleImpl: keystoreConfigureAccountPool: cannot resolve passphrase source\n");
+        return false;
+    }
+    return pool->configure(passphrase, static_cast<size_t>(size), static_cast<uint64_t>(refillPerMinute));
+}
+
+std::string AccountsModuleImpl::keystoreAccountPoolStatus()
+{
+    auto pool = currentAccountPool();
+    if (!pool) {
+        return {};
+    }
+    const AccountPool::Stats stats = pool->stats();
+    nlohmann::json status = {
+        {"enabled", stats.enabled},
+        {"ready", stats.ready},
+        {"pendingVerification", stats.pendingVerification},
+        {"size", stats.size},
+        {"refillPerMinute", stats.refillPerMinute},
+        {"generated", stats.generated},
+        {"hits", stats.hits},
+        {"misses", stats.misses},
+        {"lastError", stats.lastError},
+    };
+    return status.dump();
+}
+
+std::string AccountsModuleImpl::keystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreImport\n");
+    return familyImport<KeystoreFamily>(familyTarget<KeystoreFamily>(), keyJSON, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::keystoreExport(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreExport\n");
+    return familyExport<KeystoreFamily, &KeystoreFamily::exportKey>(familyTarget<KeystoreFamily>(), "Export", address, passphrase, newPassphrase);
+}
+
+bool AccountsModuleImpl::keystoreDelete(const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreDelete\n");
+    return familyDelete<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase);
+}
+
+bool AccountsModuleImpl::keystoreHasAddress(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreHasAddress\n");
+    return familyHasAddress<KeystoreFamily>(familyTarget<KeystoreFamily>(), address);
+}
+
+bool AccountsModuleImpl::keystoreUnlock(const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreUnlock\n");
+    return familyUnlock<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase);
+}
+
+bool AccountsModuleImpl::keystoreLock(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreLock\n");
+    return familyLock<KeystoreFamily>(familyTarget<KeystoreFamily>(), address);
+}
+
+bool AccountsModuleImpl::keystoreTimedUnlock(const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreTimedUnlock\n");
+    return familyTimedUnlock<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase, timeoutSeconds);
+}
+
+bool AccountsModuleImpl::keystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreUpdate\n");
+    return familyUpdate<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::keystoreSignHash(const std::string& address, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignHash\n");
+    return familySignHash<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, hashHex);
+}
+
+std::string AccountsModuleImpl::keystoreSignTypedData(const std::string& address, const std::string& typedDataJSON)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignTypedData\n");
+    return familySignTypedData<KeystoreFamily>(address, typedDataJSON);
+}
+
+int64_t AccountsModuleImpl::keystoreSignMessageBegin(const std::string& address, int64_t length)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignMessageBegin %lld\n", (long long)length);
+    return familySignMessageBegin<KeystoreFamily>(address, length);
+}
+
+bool AccountsModuleImpl::signMessageUpdate(int64_t session, const std::string& chunk)
+{
+    if (!messageSessions.update(session, reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size())) {
+        fprintf(stderr, "AccountsModuleImpl: signMessageUpdate: unknown session %lld or chunk past the declared length\n",
+                (long long)session);
+        return false;
+    }
+    return true;
+}
+
+std::string AccountsModuleImpl::signMessageFinish(int64_t session)
+{
+    fprintf(stderr, "AccountsModuleImpl::signMessageFinish %lld\n", (long long)session);
+    std::string scope, address;
+    uint64_t begun = 0;
+    uint8_t digest[Keccak256::kDigestSize];
+    if (!messageSessions.finish(session, scope, address, begun, digest)) {
+        fprintf(stderr, "AccountsModuleImpl: signMessageFinish: unknown session or incomplete message\n");
+        return {};
+    }
+    const std::string hashHex = hexString(digest, sizeof(digest));
+    uint64_t generation = 0;
+    const bool ext = scope != KeystoreFamily::kScope;
+    FamilyTarget target = ext ? familyTarget<ExtKeystoreFamily>(&generation) : familyTarget<KeystoreFamily>(&generation);
+    if (target && generation != begun) {
+        fprintf(stderr, "AccountsModuleImpl: signMessageFinish: the %s was closed or re-initialized since the session began\n",
+                ext ? ExtKeystoreFamily::kNoun : KeystoreFamily::kNoun);
+        return {};
+    }
+    return ext ? familySignHash<ExtKeystoreFamily>(target, address, hashHex) : familySignHash<KeystoreFamily>(target, address, hashHex);
+}
+
+bool AccountsModuleImpl::signMessageAbort(int64_t session)
+{
+    fprintf(stderr, "AccountsModuleImpl::signMessageAbort %lld\n", (long long)session);
+    return messageSessions.abort(session);
+}
+
+std::string AccountsModuleImpl::keystoreSignMessageFd(const std::string& address, int64_t fd, int64_t length)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignMessageFd %lld %lld\n", (long long)fd, (long long)length);
+    return familySignMessageFd<KeystoreFamily>(address, fd, length);
+}
+
+std::string AccountsModuleImpl::keystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignHashWithPassphrase\n");
+    return familySignHashWithPassphrase<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase, hashHex);
+}
+
+std::string AccountsModuleImpl::keystoreImportECDSA(const std::string& privateKeyHex, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreImportECDSA\n");
+    return familyImportECDSA<KeystoreFamily>(familyTarget<KeystoreFamily>(), privateKeyHex, passphrase);
+}
+
+std::string AccountsModuleImpl::keystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignTx\n");
+    return familySignTx<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::keystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreSignTxWithPassphrase\n");
+    return familySignTxWithPassphrase<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, passphrase, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::keystoreFind(const std::string& address, const std::string& url)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreFind\n");
+    return familyFind<KeystoreFamily>(familyTarget<KeystoreFamily>(), address, url);
+}
+
+std::string AccountsModuleImpl::keystoreImportDirectory(const std::string& srcDir, const std::string& passphraseSource, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreImportDirectory %s\n", srcDir.c_str());
+    return familyImportDirectory<KeystoreFamily>(srcDir, passphraseSource, newPassphrase);
+}
+
+std::string AccountsModuleImpl::keystoreBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                                   const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                                   const std::string& journalPath)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreBulkUpdate %lld %lld\n", (long long)scryptN, (long long)scryptP);
+    return familyBulkUpdate<KeystoreFamily>(addressesJSON, passphraseSource, newPassphraseSource, scryptN, scryptP, journalPath);
+}
+
+std::string AccountsModuleImpl::keystoreBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreBackup %lld\n", (long long)fd);
+    return familyBackup<KeystoreFamily>(fd, passphraseSource, backupPassphraseSource);
+}
+
+std::string AccountsModuleImpl::keystoreRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource)
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreRestore %lld\n", (long long)fd);
+    return familyRestore<KeystoreFamily>(fd, backupPassphraseSource, newPassphraseSource);
+}
+
 // Extended keystore operations
 
-bool AccountsModuleImpl::initExtKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP)
+bool AccountsModuleImpl::initExtKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::initExtKeystore %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
+    return familyInit<ExtKeystoreFamily>(dir, scryptN, scryptP);
+}
+
+bool AccountsModuleImpl::initExtKeystoreAsync(const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::initExtKeystoreAsync %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
+    return familyInitAsync<ExtKeystoreFamily>(dir, scryptN, scryptP);
+}
+
+std::string AccountsModuleImpl::extKeystoreState()
+{
+    return loadStateName(extkeystoreLoad);
+}
+
+bool AccountsModuleImpl::waitExtKeystoreReady(int64_t timeoutMs)
+{
+    return waitLoad(extkeystoreLoad, timeoutMs);
+}
+
+bool AccountsModuleImpl::closeExtKeystore()
+{
+    fprintf(stderr, "AccountsModuleImpl::closeExtKeystore\n");
+    return familyClose<ExtKeystoreFamily>();
+}
+
+bool AccountsModuleImpl::extKeystoreWatch(int64_t debounceMs)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreWatch %lld\n", (long long)debounceMs);
+    return familyWatch<ExtKeystoreFamily>(debounceMs);
+}
+
+bool AccountsModuleImpl::extKeystoreUnwatch()
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreUnwatch\n");
+    return familyUnwatch<ExtKeystoreFamily>();
+}
+
+std::vector<std::string> AccountsModuleImpl::extKeystoreAccounts()
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreAccounts\n");
+    return familyAccounts<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>());
+}
+
+std::string AccountsModuleImpl::extKeystoreNewAccount(const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreNewAccount\n");
+    return familyNewAccount<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), passphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreImport\n");
+    return familyImport<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), keyJSON, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreImportExtendedKey(const std::string& extKeyStr, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreImportExtendedKey\n");
+    return familyImportExtendedKey<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), extKeyStr, passphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreImportExtendedKeyHandle(int64_t handle, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreImportExtendedKeyHandle\n");
+    ExtKey key;
+    if (!extKeys.get(handle, key)) {
+        fprintf(stderr, "AccountsModuleImpl: unknown extended-key handle %lld\n", static_cast<long long>(handle));
+        return {};
+    }
+    // The SDK only takes the serialized form; it never outlives this call.
+    std::string extKeyStr = extKeySerialize(key);
+    std::string result = extKeystoreImportExtendedKey(extKeyStr, passphrase);
+    std::fill(extKeyStr.begin(), extKeyStr.end(), '\0');
+    return result;
+}
+
+std::string AccountsModuleImpl::extKeystoreExportExt(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreExportExt\n");
+    return familyExport<ExtKeystoreFamily, &ExtKeystoreFamily::exportKey>(familyTarget<ExtKeystoreFamily>(), "ExportExt", address, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreExportPriv(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreExportPriv\n");
+    return familyExport<ExtKeystoreFamily, &ExtKeystoreFamily::exportPriv>(familyTarget<ExtKeystoreFamily>(), "ExportPriv", address, passphrase, newPassphrase);
+}
+
+bool AccountsModuleImpl::extKeystoreDelete(const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreDelete\n");
+    return familyDelete<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase);
+}
+
+bool AccountsModuleImpl::extKeystoreHasAddress(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreHasAddress\n");
+    return familyHasAddress<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address);
+}
+
+bool AccountsModuleImpl::extKeystoreUnlock(const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreUnlock\n");
+    return familyUnlock<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase);
+}
+
+bool AccountsModuleImpl::extKeystoreLock(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreLock\n");
+    return familyLock<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address);
+}
+
+bool AccountsModuleImpl::extKeystoreTimedUnlock(const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreTimedUnlock\n");
+    return familyTimedUnlock<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase, timeoutSeconds);
+}
+
+bool AccountsModuleImpl::extKeystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreUpdate\n");
+    return familyUpdate<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignHash(const std::string& address, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignHash\n");
+    return familySignHash<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, hashHex);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignTypedData(const std::string& address, const std::string& typedDataJSON)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignTypedData\n");
+    return familySignTypedData<ExtKeystoreFamily>(address, typedDataJSON);
+}
+
+int64_t AccountsModuleImpl::extKeystoreSignMessageBegin(const std::string& address, int64_t length)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignMessageBegin %lld\n", (long long)length);
+    return familySignMessageBegin<ExtKeystoreFamily>(address, length);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignMessageFd(const std::string& address, int64_t fd, int64_t length)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignMessageFd %lld %lld\n", (long long)fd, (long long)length);
+    return familySignMessageFd<ExtKeystoreFamily>(address, fd, length);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignHashWithPassphrase\n");
+    return familySignHashWithPassphrase<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase, hashHex);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignTx\n");
+    return familySignTx<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::extKeystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignTxWithPassphrase\n");
+    return familySignTxWithPassphrase<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, passphrase, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::extKeystoreDerive(const std::string& address, const std::string& derivationPath, int64_t pin)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreDerive\n");
+    return familyDerive<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, derivationPath, pin);
+}
+
+std::shared_ptr<AddressPool> AccountsModuleImpl::findAddressPool(const std::string& address, int64_t* pin)
+{
+    std::lock_guard<std::mutex> lock(addressPoolsMutex);
+    auto it = addressPools.find(lowerHex(address));
+    if (it == addressPools.end()) {
+        return nullptr;
+    }
+    if (pin) {
+        *pin = it->second.pin;
+    }
+    return it->second.pool;
+}
+
+void AccountsModuleImpl::stopAddressPools()
 {
-    fprintf(stderr, "AccountsModuleImpl::initExtKeystore %s %lld %lld\n", dir.c_str(), (long long)scryptN, (long long)scryptP);
-    if (extkeystoreHandle != 0) {
-        GoWSK_accounts_extkeystore_CloseKeyStore(extkeystoreHandle);
+    std::map<std::string, PooledMaster> pools;
+    {
+        std::lock_guard<std::mutex> lock(addressPoolsMutex);
+        pools.swap(addressPools);
     }
-    char* err = nullptr;
-    extkeystoreHandle = GoWSK_accounts_extkeystore_NewKeyStore(
-        const_cast<char*>(dir.c_str()), static_cast<int>(scryptN), static_cast<int>(scryptP), &err);
+    for (auto& entry : pools) {
+        entry.second.pool->stop();
+    }
+}
+
+bool AccountsModuleImpl::extKeystoreStartAddressPool(const std::string& address, const std::string& basePath,
+                                                     int64_t startIndex, int64_t size, int64_t lowWaterMark, int64_t pin)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreStartAddressPool %s %lld\n", basePath.c_str(), (long long)size);
+    awaitLoad(extkeystoreLoad);
     if (extkeystoreHandle == 0) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: Failed to create ext keystore: %s\n", emsg.c_str());
+        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+        return false;
+    }
+    if (startIndex < 0 || size <= 0 || basePath.empty() || basePath.back() == '/') {
+        fprintf(stderr, "AccountsModuleImpl: extKeystoreStartAddressPool: invalid arguments\n");
+        return false;
+    }
+    const size_t lowWater = lowWaterMark > 0 ? static_cast<size_t>(lowWaterMark)
+                                             : std::max<size_t>(1, static_cast<size_t>(size) / 2);
+    // Reads the live handle: a parameter migration reopens the keystore under a running pool.
+    auto derive = [this, address, pin](const std::string& path, std::string& error) {
+        AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+        GoString err;
+        GoString derivedAddress(GoWSK_accounts_extkeystore_Derive(
+            extkeystoreHandle, const_cast<char*>(address.c_str()), const_cast<char*>(path.c_str()), static_cast<int>(pin), err.out()));
+        if (!derivedAddress) {
+            error = errorMessage(err);
+            fprintf(stderr, "AccountsModuleImpl: ExtDerive error: %s\n", error.c_str());
+            return std::string();
+        }
+        return derivedAddress.str();
+    };
+
+    // A pool that pins its key files keeps a journal next to them, so a
+    // restarted pool neither loses nor re-derives the accounts it stored.
+    std::string journalPath;
+    if (pin != 0) {
+        journalPath = familyState<ExtKeystoreFamily>().dir + "/.address-pool-" + digestHex({lowerHex(address), basePath});
+    }
+    // The previous pool may share the journal; it stops before the new one reads it.
+    if (auto previous = findAddressPool(address)) {
+        previous->stop();
+    }
+    PooledMaster master;
+    master.pool = std::make_shared<AddressPool>(derive, basePath, static_cast<uint64_t>(startIndex),
+                                                static_cast<size_t>(size), lowWater, journalPath);
+    master.pin = pin;
+    std::lock_guard<std::mutex> lock(addressPoolsMutex);
+    addressPools[lowerHex(address)] = master;
+    return true;
+}
+
+std::string AccountsModuleImpl::extKeystoreNextAddress(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreNextAddress\n");
+    int64_t pin = 0;
+    auto pool = findAddressPool(address, &pin);
+    if (!pool) {
+        fprintf(stderr, "AccountsModuleImpl: No address pool for %s\n", address.c_str());
+        return {};
+    }
+    AddressPool::Entry entry;
+    if (!pool->take(entry)) {
+        return {};
+    }
+    // A pinned pool derived the key file ahead of time; it is handed out as
+    // a new account, as extKeystoreDerive hands out a pooled path.
+    if (pin != 0) {
+        familyKeyWritten<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), entry.address);
+    }
+    nlohmann::json result = {{"address", entry.address}, {"path", entry.path}, {"index", entry.index}};
+    return result.dump();
+}
+
+std::string AccountsModuleImpl::extKeystoreAddressPoolStatus(const std::string& address)
+{
+    auto pool = findAddressPool(address);
+    if (!pool) {
+        return {};
+    }
+    const AddressPool::Stats stats = pool->stats();
+    nlohmann::json status = {
+        {"ready", stats.ready},
+        {"size", stats.capacity},
+        {"lowWaterMark", stats.lowWater},
+        {"nextIndex", stats.nextIndex},
+        {"derived", stats.derived},
+        {"hits", stats.hits},
+        {"misses", stats.misses},
+        {"abandoned", stats.abandoned},
+        {"lastError", stats.lastError},
+    };
+    return status.dump();
+}
+
+bool AccountsModuleImpl::extKeystoreStopAddressPool(const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreStopAddressPool\n");
+    std::shared_ptr<AddressPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(addressPoolsMutex);
+        auto it = addressPools.find(lowerHex(address));
+        if (it == addressPools.end()) {
+            return false;
+        }
+        pool = it->second.pool;
+        addressPools.erase(it);
+    }
+    pool->stop();
+    return true;
+}
+
+std::string AccountsModuleImpl::extKeystoreDeriveWithPassphrase(const std::string& address, const std::string& derivationPath, int64_t pin, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreDeriveWithPassphrase\n");
+    return familyDeriveWithPassphrase<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, derivationPath, pin,
+                                                         passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreFind(const std::string& address, const std::string& url)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreFind\n");
+    return familyFind<ExtKeystoreFamily>(familyTarget<ExtKeystoreFamily>(), address, url);
+}
+
+std::string AccountsModuleImpl::extKeystoreImportDirectory(const std::string& srcDir, const std::string& passphraseSource, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreImportDirectory %s\n", srcDir.c_str());
+    return familyImportDirectory<ExtKeystoreFamily>(srcDir, passphraseSource, newPassphrase);
+}
+
+std::string AccountsModuleImpl::extKeystoreBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                                      const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                                      const std::string& journalPath)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreBulkUpdate %lld %lld\n", (long long)scryptN, (long long)scryptP);
+    return familyBulkUpdate<ExtKeystoreFamily>(addressesJSON, passphraseSource, newPassphraseSource, scryptN, scryptP, journalPath);
+}
+
+std::string AccountsModuleImpl::extKeystoreBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreBackup %lld\n", (long long)fd);
+    return familyBackup<ExtKeystoreFamily>(fd, passphraseSource, backupPassphraseSource);
+}
+
+std::string AccountsModuleImpl::extKeystoreRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource)
+{
+    fprintf(stderr, "AccountsModuleImpl::extKeystoreRestore %lld\n", (long long)fd);
+    return familyRestore<ExtKeystoreFamily>(fd, backupPassphraseSource, newPassphraseSource);
+}
+
+// Signature cache
+
+bool AccountsModuleImpl::configureSignatureCache(int64_t capacity)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureSignatureCache %lld\n", (long long)capacity);
+    if (capacity < 0) {
+        fprintf(stderr, "AccountsModuleImpl: configureSignatureCache: capacity must not be negative\n");
+        return false;
+    }
+    signatures.setCapacity(static_cast<size_t>(capacity));
+    return true;
+}
+
+std::string AccountsModuleImpl::signatureCacheStatus()
+{
+    const SignatureCache::Stats stats = signatures.stats();
+    const uint64_t lookups = stats.hits + stats.misses;
+    nlohmann::json status;
+    status["capacity"] = stats.capacity;
+    status["entries"] = stats.entries;
+    status["unlockedAccounts"] = stats.unlockedAccounts;
+    status["hits"] = stats.hits;
+    status["misses"] = stats.misses;
+    status["hitRate"] = lookups != 0 ? static_cast<double>(stats.hits) / static_cast<double>(lookups) : 0.0;
+    status["invalidations"] = stats.invalidations;
+    return status.dump();
+}
+
+// FFI executor
+
+bool AccountsModuleImpl::configureFfiExecutor(bool enabled, int64_t batchWindowMicros, int64_t maxBatch)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureFfiExecutor %d %lld %lld\n", enabled ? 1 : 0,
+            (long long)batchWindowMicros, (long long)maxBatch);
+    if (batchWindowMicros < 0 || maxBatch < 1) {
+        fprintf(stderr, "AccountsModuleImpl: configureFfiExecutor: window must not be negative and maxBatch must be positive\n");
+        return false;
+    }
+    ffi.configure(enabled, static_cast<uint64_t>(batchWindowMicros), static_cast<size_t>(maxBatch));
+    return true;
+}
+
+std::string AccountsModuleImpl::ffiExecutorStatus()
+{
+    const FfiExecutor::Stats stats = ffi.stats();
+    nlohmann::json status;
+    status["enabled"] = stats.enabled;
+    status["batchWindowMicros"] = stats.windowMicros;
+    status["maxBatch"] = stats.maxBatch;
+    status["calls"] = stats.calls;
+    status["inlineCalls"] = stats.inlineCalls;
+    status["batches"] = stats.batches;
+    status["largestBatch"] = stats.largestBatch;
+    status["averageBatch"] = stats.batches != 0 ? static_cast<double>(stats.calls) / static_cast<double>(stats.batches) : 0.0;
+    return status.dump();
+}
+
+// Native signing
+
+bool AccountsModuleImpl::configureNativeSigning(bool enabled)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureNativeSigning %d\n", enabled ? 1 : 0);
+    nativeSigning = enabled;
+    if (!enabled) {
+        // Accounts whose SDK unlock was deferred stay unlocked in the SDK.
+        std::vector<NativeSigner::SdkUnlock> pending = nativeKeys.takeSdkUnlocks(KeystoreFamily::kScope);
+        if (!pending.empty()) {
+            const FamilyTarget target = familyTarget<KeystoreFamily>();
+            for (NativeSigner::SdkUnlock& unlock : pending) {
+                if (target) {
+                    familyCompleteUnlock<KeystoreFamily>(target, "Unlock", unlock);
+                } else if (!unlock.passphrase.empty()) {
+                    wipe(&unlock.passphrase[0], unlock.passphrase.size());
+                }
+            }
+        }
+        nativeKeys.clear();
+    }
+    return true;
+}
+
+std::string AccountsModuleImpl::nativeSigningStatus()
+{
+    const NativeSigner::Stats stats = nativeKeys.stats();
+    nlohmann::json status;
+    status["enabled"] = nativeSigning.load();
+    status["backend"] = NativeSigner::backend();
+    status["keys"] = stats.keys;
+    status["deferredUnlocks"] = stats.deferredUnlocks;
+    status["signatures"] = stats.signatures;
+    status["misses"] = stats.misses;
+    status["expired"] = stats.expired;
+    return status.dump();
+}
+
+// Durability
+
+bool AccountsModuleImpl::configureDurability(const std::string& mode, int64_t windowMs)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureDurability %s %lld\n", mode.c_str(), (long long)windowMs);
+    GroupCommit::Mode parsed;
+    if (mode == "off") {
+        parsed = GroupCommit::Mode::Off;
+    } else if (mode == "sync") {
+        parsed = GroupCommit::Mode::Sync;
+    } else if (mode == "group") {
+        parsed = GroupCommit::Mode::Group;
+    } else {
+        fprintf(stderr, "AccountsModuleImpl: configureDurability: unknown mode %s\n", mode.c_str());
+        return false;
+    }
+    if (windowMs < 0) {
+        fprintf(stderr, "AccountsModuleImpl: configureDurability: window must not be negative\n");
+        return false;
+    }
+    durability.configure(parsed, static_cast<uint64_t>(windowMs));
+    return true;
+}
+
+bool AccountsModuleImpl::keystoreFlush()
+{
+    fprintf(stderr, "AccountsModuleImpl::keystoreFlush\n");
+    return durability.flush();
+}
+
+std::string AccountsModuleImpl::durabilityStatus()
+{
+    const GroupCommit::Stats stats = durability.stats();
+    nlohmann::json status;
+    status["mode"] = stats.mode == GroupCommit::Mode::Group ? "group" : stats.mode == GroupCommit::Mode::Sync ? "sync" : "off";
+    status["windowMs"] = stats.windowMillis;
+    status["pending"] = stats.pending;
+    status["commits"] = stats.commits;
+    status["files"] = stats.files;
+    status["failures"] = stats.failures;
+    status["lastError"] = stats.lastError;
+    return status.dump();
+}
+
+// Admission control
+
+AdmissionControl::Ticket AccountsModuleImpl::admit(AdmissionControl::Lane lane, const char* label, const char* labelPrefix)
+{
+    AdmissionControl::Ticket ticket = admission.enter(lane);
+    if (!ticket) {
+        fprintf(stderr, "AccountsModuleImpl: %s%s: %s lane queue is full\n", labelPrefix, label, AdmissionControl::laneName(lane));
+    }
+    return ticket;
+}
+
+bool AccountsModuleImpl::configureAdmissionLane(const std::string& lane, int64_t maxConcurrent, int64_t maxQueued, int64_t priority)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureAdmissionLane %s %lld %lld %lld\n", lane.c_str(),
+            (long long)maxConcurrent, (long long)maxQueued, (long long)priority);
+    AdmissionControl::Lane which;
+    if (!AdmissionControl::laneFromName(lane, which)) {
+        fprintf(stderr, "AccountsModuleImpl: configureAdmissionLane: unknown lane %s\n", lane.c_str());
+        return false;
+    }
+    if (maxConcurrent < 1 || maxQueued < 0) {
+        fprintf(stderr, "AccountsModuleImpl: configureAdmissionLane: maxConcurrent must be positive and maxQueued not negative\n");
+        return false;
+    }
+    AdmissionControl::LaneConfig config;
+    config.maxConcurrent = static_cast<size_t>(maxConcurrent);
+    config.maxQueued = static_cast<size_t>(maxQueued);
+    config.priority = static_cast<int>(priority);
+    return admission.configureLane(which, config);
+}
+
+bool AccountsModuleImpl::configureAdmissionTotal(int64_t maxConcurrent)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureAdmissionTotal %lld\n", (long long)maxConcurrent);
+    if (maxConcurrent < 0) {
+        fprintf(stderr, "AccountsModuleImpl: configureAdmissionTotal: limit must not be negative\n");
+        return false;
+    }
+    admission.setMaxTotal(static_cast<size_t>(maxConcurrent));
+    return true;
+}
+
+std::string AccountsModuleImpl::admissionStatus()
+{
+    const AdmissionControl::Stats stats = admission.stats();
+    nlohmann::json status;
+    status["maxTotal"] = stats.maxTotal;
+    status["running"] = stats.running;
+    for (AdmissionControl::Lane lane : {AdmissionControl::Lane::Cheap, AdmissionControl::Lane::Scrypt}) {
+        const AdmissionControl::LaneStats& laneStats = stats.lanes[static_cast<size_t>(lane)];
+        nlohmann::json entry;
+        entry["maxConcurrent"] = laneStats.config.maxConcurrent;
+        entry["maxQueued"] = laneStats.config.maxQueued;
+        entry["priority"] = laneStats.config.priority;
+        entry["running"] = laneStats.running;
+        entry["queued"] = laneStats.queued;
+        entry["background"] = laneStats.background;
+        entry["peakQueued"] = laneStats.peakQueued;
+        entry["admitted"] = laneStats.admitted;
+        entry["rejected"] = laneStats.rejected;
+        entry["avgWaitMicros"] = laneStats.admitted != 0 ? laneStats.totalWaitMicros / laneStats.admitted : 0;
+        entry["maxWaitMicros"] = laneStats.maxWaitMicros;
+        status[AdmissionControl::laneName(lane)] = entry;
+    }
+    return status.dump();
+}
+
+// Coalesced calls
+
+std::string AccountsModuleImpl::coalescedCallsStatus()
+{
+    const SingleFlight<std::string>::Stats calls = flights.stats();
+    const SingleFlight<bool>::Stats unlocks = unlockFlights.stats();
+    nlohmann::json status;
+    status["calls"] = calls.calls + unlocks.calls;
+    status["coalesced"] = calls.coalesced + unlocks.coalesced;
+    status["inFlight"] = calls.inFlight + unlocks.inFlight;
+    return status.dump();
+}
+
+// Keystore registry
+
+bool AccountsModuleImpl::registerKeystore(const std::string& tenant, const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::registerKeystore %s\n", tenant.c_str());
+    KeystoreRegistry::Config config;
+    config.kind = KeystoreRegistry::Kind::Keystore;
+    config.dir = dir;
+    config.scryptN = scryptN;
+    config.scryptP = scryptP;
+    if (!tenants.add(tenant, config)) {
+        fprintf(stderr, "AccountsModuleImpl: registerKeystore: %s is empty or registered with another configuration\n",
+                tenant.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AccountsModuleImpl::registerExtKeystore(const std::string& tenant, const std::string& dir, int64_t scryptN, int64_t scryptP)
+{
+    fprintf(stderr, "AccountsModuleImpl::registerExtKeystore %s\n", tenant.c_str());
+    KeystoreRegistry::Config config;
+    config.kind = KeystoreRegistry::Kind::ExtKeystore;
+    config.dir = dir;
+    config.scryptN = scryptN;
+    config.scryptP = scryptP;
+    if (!tenants.add(tenant, config)) {
+        fprintf(stderr, "AccountsModuleImpl: registerExtKeystore: %s is empty or registered with another configuration\n",
+                tenant.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AccountsModuleImpl::unregisterKeystore(const std::string& tenant)
+{
+    fprintf(stderr, "AccountsModuleImpl::unregisterKeystore %s\n", tenant.c_str());
+    signatures.invalidateScope(tenantScope(tenant));
+    nativeKeys.invalidateScope(tenantScope(tenant));
+    return tenants.remove(tenant);
+}
+
+bool AccountsModuleImpl::configureKeystoreRegistry(int64_t maxOpenHandles, int64_t maxMemoryBytes)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureKeystoreRegistry %lld %lld\n", (long long)maxOpenHandles, (long long)maxMemoryBytes);
+    if (maxOpenHandles < 0 || maxMemoryBytes < 0) {
+        fprintf(stderr, "AccountsModuleImpl: configureKeystoreRegistry: limits must not be negative\n");
+        return false;
+    }
+    tenants.setLimits(static_cast<size_t>(maxOpenHandles), static_cast<uint64_t>(maxMemoryBytes));
+    return true;
+}
+
+std::string AccountsModuleImpl::keystoreRegistryStatus()
+{
+    const KeystoreRegistry::Stats stats = tenants.stats();
+    nlohmann::json status;
+    status["maxOpen"] = stats.maxOpen;
+    status["maxBytes"] = stats.maxBytes;
+    status["open"] = stats.open;
+    status["bytes"] = stats.bytes;
+    status["hits"] = stats.hits;
+    status["opens"] = stats.opens;
+    status["evictions"] = stats.evictions;
+    status["lastError"] = stats.lastError;
+    status["tenants"] = nlohmann::json::array();
+    for (const auto& tenant : stats.tenants) {
+        nlohmann::json entry;
+        entry["name"] = tenant.name;
+        entry["kind"] = tenant.config.kind == KeystoreRegistry::Kind::ExtKeystore ? "extKeystore" : "keystore";
+        entry["dir"] = tenant.config.dir;
+        entry["open"] = tenant.open;
+        entry["leases"] = tenant.leases;
+        entry["unlocked"] = tenant.unlocked;
+        entry["bytes"] = tenant.bytes;
+        status["tenants"].push_back(entry);
+    }
+    return status.dump();
+}
+
+KeystoreRegistry::Lease AccountsModuleImpl::leaseTenant(const std::string& tenant, const char* label, TenantScope scope)
+{
+    std::string error;
+    KeystoreRegistry::Lease lease = tenants.acquire(tenant, error);
+    if (!lease) {
+        fprintf(stderr, "AccountsModuleImpl: %s: %s\n", label, error.c_str());
+        return lease;
+    }
+    const bool ext = lease.kind() == KeystoreRegistry::Kind::ExtKeystore;
+    if ((scope == TenantScope::KeystoreOnly && ext) || (scope == TenantScope::ExtKeystoreOnly && !ext)) {
+        fprintf(stderr, "AccountsModuleImpl: %s: not supported by %s's keystore kind\n", label, tenant.c_str());
+        return KeystoreRegistry::Lease();
+    }
+    return lease;
+}
+
+std::vector<std::string> AccountsModuleImpl::tenantKeystoreAccounts(const std::string& tenant)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreAccounts %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Accounts", TenantScope::Any);
+    return target.ext ? familyAccounts<ExtKeystoreFamily>(target) : familyAccounts<KeystoreFamily>(target);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreNewAccount(const std::string& tenant, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreNewAccount %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "NewAccount", TenantScope::Any);
+    return target.ext ? familyNewAccount<ExtKeystoreFamily>(target, passphrase) : familyNewAccount<KeystoreFamily>(target, passphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreImport(const std::string& tenant, const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreImport %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Import", TenantScope::Any);
+    return target.ext ? familyImport<ExtKeystoreFamily>(target, keyJSON, passphrase, newPassphrase)
+                      : familyImport<KeystoreFamily>(target, keyJSON, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreExport(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreExport %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Export", TenantScope::Any);
+    return target.ext
+        ? familyExport<ExtKeystoreFamily, &ExtKeystoreFamily::exportKey>(target, "ExportExt", address, passphrase, newPassphrase)
+        : familyExport<KeystoreFamily, &KeystoreFamily::exportKey>(target, "Export", address, passphrase, newPassphrase);
+}
+
+bool AccountsModuleImpl::tenantKeystoreDelete(const std::string& tenant, const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreDelete %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Delete", TenantScope::Any);
+    return target.ext ? familyDelete<ExtKeystoreFamily>(target, address, passphrase)
+                      : familyDelete<KeystoreFamily>(target, address, passphrase);
+}
+
+bool AccountsModuleImpl::tenantKeystoreHasAddress(const std::string& tenant, const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreHasAddress %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "HasAddress", TenantScope::Any);
+    return target.ext ? familyHasAddress<ExtKeystoreFamily>(target, address) : familyHasAddress<KeystoreFamily>(target, address);
+}
+
+bool AccountsModuleImpl::tenantKeystoreUnlock(const std::string& tenant, const std::string& address, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreUnlock %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Unlock", TenantScope::Any);
+    return target.ext ? familyUnlock<ExtKeystoreFamily>(target, address, passphrase)
+                      : familyUnlock<KeystoreFamily>(target, address, passphrase);
+}
+
+bool AccountsModuleImpl::tenantKeystoreLock(const std::string& tenant, const std::string& address)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreLock %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Lock", TenantScope::Any);
+    if (!target) {
+        // Cached signatures go even when the lock fails, as in familyLock.
+        signatures.invalidate(tenantScope(tenant), address);
         return false;
     }
-    fprintf(stderr, "AccountsModuleImpl: Ext keystore created: handle=%llu\n", (unsigned long long)extkeystoreHandle);
+    return target.ext ? familyLock<ExtKeystoreFamily>(target, address) : familyLock<KeystoreFamily>(target, address);
+}
+
+bool AccountsModuleImpl::tenantKeystoreTimedUnlock(const std::string& tenant, const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreTimedUnlock %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "TimedUnlock", TenantScope::Any);
+    return target.ext ? familyTimedUnlock<ExtKeystoreFamily>(target, address, passphrase, timeoutSeconds)
+                      : familyTimedUnlock<KeystoreFamily>(target, address, passphrase, timeoutSeconds);
+}
+
+bool AccountsModuleImpl::tenantKeystoreUpdate(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreUpdate %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Update", TenantScope::Any);
+    return target.ext ? familyUpdate<ExtKeystoreFamily>(target, address, passphrase, newPassphrase)
+                      : familyUpdate<KeystoreFamily>(target, address, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreSignHash(const std::string& tenant, const std::string& address, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreSignHash %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "SignHash", TenantScope::Any);
+    return target.ext ? familySignHash<ExtKeystoreFamily>(target, address, hashHex)
+                      : familySignHash<KeystoreFamily>(target, address, hashHex);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreSignHashWithPassphrase(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& hashHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreSignHashWithPassphrase %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "SignHashWithPassphrase", TenantScope::Any);
+    return target.ext ? familySignHashWithPassphrase<ExtKeystoreFamily>(target, address, passphrase, hashHex)
+                      : familySignHashWithPassphrase<KeystoreFamily>(target, address, passphrase, hashHex);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreImportECDSA(const std::string& tenant, const std::string& privateKeyHex, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreImportECDSA %s\n", tenant.c_str());
+    return familyImportECDSA<KeystoreFamily>(tenantTarget(tenant, "ImportECDSA", TenantScope::KeystoreOnly), privateKeyHex,
+                                             passphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreSignTx(const std::string& tenant, const std::string& address, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreSignTx %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "SignTx", TenantScope::Any);
+    return target.ext ? familySignTx<ExtKeystoreFamily>(target, address, txJSON, chainIDHex)
+                      : familySignTx<KeystoreFamily>(target, address, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreSignTxWithPassphrase(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreSignTxWithPassphrase %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "SignTxWithPassphrase", TenantScope::Any);
+    return target.ext ? familySignTxWithPassphrase<ExtKeystoreFamily>(target, address, passphrase, txJSON, chainIDHex)
+                      : familySignTxWithPassphrase<KeystoreFamily>(target, address, passphrase, txJSON, chainIDHex);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreFind(const std::string& tenant, const std::string& address, const std::string& url)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreFind %s\n", tenant.c_str());
+    FamilyTarget target = tenantTarget(tenant, "Find", TenantScope::Any);
+    return target.ext ? familyFind<ExtKeystoreFamily>(target, address, url) : familyFind<KeystoreFamily>(target, address, url);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreImportExtendedKey(const std::string& tenant, const std::string& extKeyStr, const std::string& passphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreImportExtendedKey %s\n", tenant.c_str());
+    return familyImportExtendedKey<ExtKeystoreFamily>(tenantTarget(tenant, "ImportExtendedKey", TenantScope::ExtKeystoreOnly),
+                                                      extKeyStr, passphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreExportPriv(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreExportPriv %s\n", tenant.c_str());
+    return familyExport<ExtKeystoreFamily, &ExtKeystoreFamily::exportPriv>(
+        tenantTarget(tenant, "ExportPriv", TenantScope::ExtKeystoreOnly), "ExportPriv", address, passphrase, newPassphrase);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreDerive(const std::string& tenant, const std::string& address, const std::string& derivationPath, int64_t pin)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreDerive %s\n", tenant.c_str());
+    return familyDerive<ExtKeystoreFamily>(tenantTarget(tenant, "Derive", TenantScope::ExtKeystoreOnly), address, derivationPath,
+                                           pin);
+}
+
+std::string AccountsModuleImpl::tenantKeystoreDeriveWithPassphrase(const std::string& tenant, const std::string& address, const std::string& derivationPath, int64_t pin, const std::string& passphrase, const std::string& newPassphrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::tenantKeystoreDeriveWithPassphrase %s\n", tenant.c_str());
+    return familyDeriveWithPassphrase<ExtKeystoreFamily>(tenantTarget(tenant, "DeriveWithPassphrase", TenantScope::ExtKeystoreOnly),
+                                                         address, derivationPath, pin, passphrase, newPassphrase);
+}
+
+// Bulk operations
+
+bool AccountsModuleImpl::configureBulkOperations(int64_t maxThreads, int64_t memoryBudgetBytes)
+{
+    fprintf(stderr, "AccountsModuleImpl::configureBulkOperations %lld %lld\n", (long long)maxThreads, (long long)memoryBudgetBytes);
+    bulkThreads = maxThreads > 0 ? static_cast<size_t>(maxThreads) : defaultBulkThreads();
+    bulkMemoryBudget = memoryBudgetBytes > 0 ? static_cast<uint64_t>(memoryBudgetBytes) : kDefaultBulkMemoryBudget;
     return true;
 }
 
-bool AccountsModuleImpl::closeExtKeystore()
-{
-    fprintf(stderr, "AccountsModuleImpl::closeExtKeystore\n");
-    if (extkeystoreHandle != 0) {
-        GoWSK_accounts_extkeystore_CloseKeyStore(extkeystoreHandle);
-        extkeystoreHandle = 0;
-        return true;
+std::string AccountsModuleImpl::bulkUpdateProgress()
+{
+    nlohmann::json progress;
+    progress["running"] = bulkProgress.running.load();
+    progress["total"] = bulkProgress.total.load();
+    progress["updated"] = bulkProgress.updated.load();
+    progress["skipped"] = bulkProgress.skipped.load();
+    progress["failed"] = bulkProgress.failed.load();
+    return progress.dump();
+}
+
+std::string AccountsModuleImpl::bulkUpdate(const char* label, const RekeyOps& ops, unsigned long long handle, const std::string& dir,
+                                           int64_t currentN, int64_t currentP, const std::string& addressesJSON,
+                                           const std::string& passphraseSource, const std::string& newPassphraseSource,
+                                           int64_t scryptN, int64_t scryptP, const std::string& journalPath)
+{
+    std::string passphrase;
+    std::string newPassphrase;
+    if (!resolvePassphraseSource(passphraseSource, passphrase) ||
+        !resolvePassphraseSource(newPassphraseSource.empty() ? passphraseSource : newPassphraseSource, newPassphrase)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot resolve passphrase source\n", label);
+        return {};
+    }
+    std::set<std::string> filter;
+    if (!addressesJSON.empty()) {
+        auto doc = nlohmann::json::parse(addressesJSON, nullptr, false);
+        if (!doc.is_array()) {
+            fprintf(stderr, "AccountsModuleImpl: %s error: addresses must be a JSON array\n", label);
+            return {};
+        }
+        for (const auto& value : doc) {
+            if (value.is_string()) {
+                filter.insert(lowerHex(value.get<std::string>()));
+            }
+        }
+    }
+    const int64_t targetN = scryptN > 0 ? scryptN : currentN;
+    const int64_t targetP = scryptP > 0 ? scryptP : currentP;
+    BulkJournal journal(journalPath, BulkJournal::jobId(dir, targetN, targetP));
+    if (!journal.usable(journalPath)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot open journal %s\n", label, journalPath.c_str());
+        return {};
+    }
+    if (journal.finished()) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: journal %s records this job as done\n", label, journalPath.c_str());
+        return {};
+    }
+    bool expected = false;
+    if (!bulkProgress.running.compare_exchange_strong(expected, true)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: another bulk update is running\n", label);
+        return {};
+    }
+
+    // The SDK encrypts with the scrypt parameters of the handle it is called on,
+    // so migrating parameters goes through a second handle on the same directory.
+    const bool migrating = targetN != currentN || targetP != currentP;
+    unsigned long long workHandle = handle;
+    if (migrating) {
+        GoString err;
+        workHandle = ops.open(dir.c_str(), static_cast<int>(targetN), static_cast<int>(targetP), err.out());
+        if (workHandle == 0) {
+            fprintf(stderr, "AccountsModuleImpl: %s error: %s\n", label, errorMessage(err));
+            bulkProgress.running = false;
+            return {};
+        }
+    }
+
+    struct Target {
+        std::string address;
+        std::string path;
+        std::string error;
+        bool skipped = false;
+    };
+    std::vector<Target> targets;
+    GoString err;
+    GoString accountsJson(ops.accounts(workHandle, err.out()));
+    if (!accountsJson) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: %s\n", label, errorMessage(err));
+        if (migrating) {
+            ops.close(workHandle);
+        }
+        bulkProgress.running = false;
+        return {};
+    }
+    {
+        for (const auto& account : parseAccountsJson(accountsJson.view())) {
+            auto doc = nlohmann::json::parse(account);
+            Target target;
+            target.address = doc.value("address", std::string());
+            target.path = keyFilePath(doc.value("url", std::string()));
+            if (filter.empty() || filter.count(lowerHex(target.address))) {
+                targets.push_back(std::move(target));
+            }
+        }
+    }
+
+    bulkProgress.total = targets.size();
+    bulkProgress.updated = 0;
+    bulkProgress.skipped = 0;
+    bulkProgress.failed = 0;
+    MemoryBudget budget(bulkMemoryBudget);
+    const uint64_t encryptCost = scryptMemoryCost(static_cast<uint64_t>(std::max<int64_t>(targetN, 0)), 8);
+    const auto started = std::chrono::steady_clock::now();
+
+    parallelFor(targets.size(), bulkThreads, [&](size_t i) {
+        Target& target = targets[i];
+        if (journal.contains(target.address)) {
+            target.skipped = true;
+            ++bulkProgress.skipped;
+            return;
+        }
+        uint64_t decryptCost = 0;
+        {
+            FileBuffer file(target.path);
+            decryptCost = keyFileScryptCost(file.data(), file.size());
+        }
+        const uint64_t cost = std::max(decryptCost, encryptCost);
+        budget.acquire(cost);
+        GoString err;
+        {
+            AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+            ops.update(workHandle, target.address.c_str(), passphrase.c_str(), newPassphrase.c_str(), err.out());
+        }
+        budget.release(cost);
+        if (err) {
+            target.error = err.str();
+            ++bulkProgress.failed;
+            return;
+        }
+        // Update rewrites the key file in place, at the path listed above.
+        if (!durability.written(dir, target.address, target.path)) {
+            fprintf(stderr, "AccountsModuleImpl: %s: key file of %s not synced\n", label, target.address.c_str());
+        }
+        journal.record(target.address);
+        ++bulkProgress.updated;
+    });
+
+    if (migrating) {
+        ops.close(workHandle);
+    }
+    // A filtered run covers part of the job; the rest may still follow.
+    if (filter.empty() && bulkProgress.failed == 0) {
+        journal.finish();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    nlohmann::json report;
+    report["errors"] = nlohmann::json::array();
+    for (const auto& target : targets) {
+        if (!target.error.empty()) {
+            report["errors"].push_back({{"address", target.address}, {"error", target.error}});
+        }
     }
-    return false;
+    report["total"] = targets.size();
+    report["updated"] = bulkProgress.updated.load();
+    report["skipped"] = bulkProgress.skipped.load();
+    report["failed"] = bulkProgress.failed.load();
+    report["elapsedMs"] = static_cast<int64_t>(seconds * 1000);
+    fprintf(stderr, "AccountsModuleImpl: %s: %llu/%zu updated in %.2fs\n", label,
+            (unsigned long long)bulkProgress.updated.load(), targets.size(), seconds);
+    bulkProgress.running = false;
+    return report.dump();
 }
 
-std::vector<std::string> AccountsModuleImpl::extKeystoreAccounts()
+std::string AccountsModuleImpl::backupKeystore(const char* label, const AccountsFn& listAccounts, const ExportFn& exportKey,
+                                               int64_t scryptN, int64_t fd, const std::string& passphraseSource,
+                                               const std::string& backupPassphraseSource)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreAccounts\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+    std::string passphrase;
+    std::string backupPassphrase;
+    if (!resolvePassphraseSource(passphraseSource, passphrase) ||
+        !resolvePassphraseSource(backupPassphraseSource, backupPassphrase)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot resolve passphrase source\n", label);
         return {};
     }
-    char* err = nullptr;
-    char* accountsJson = GoWSK_accounts_extkeystore_Accounts(extkeystoreHandle, &err);
-    if (accountsJson == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtAccounts error: %s\n", emsg.c_str());
+    GoString err;
+    GoString accountsJson(listAccounts(err.out()));
+    if (!accountsJson) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: %s\n", label, errorMessage(err));
         return {};
     }
-    auto result = parseAccountsJson(accountsJson);
-    GoWSK_FreeCString(accountsJson);
-    return result;
-}
+    std::vector<std::pair<std::string, std::string>> accounts;
+    for (const auto& account : parseAccountsJson(accountsJson.view())) {
+        auto doc = nlohmann::json::parse(account);
+        accounts.emplace_back(doc.value("address", std::string()), keyFilePath(doc.value("url", std::string())));
+    }
 
-std::string AccountsModuleImpl::extKeystoreNewAccount(const std::string& passphrase)
-{
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreNewAccount\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+    const int out = static_cast<int>(fd);
+    const std::string header = "{\"format\":\"logos-keystore-backup\",\"version\":1}\n";
+    if (!writeAll(out, header.data(), header.size())) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot write to fd %lld\n", label, (long long)fd);
         return {};
     }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_extkeystore_NewAccount(
-        extkeystoreHandle, const_cast<char*>(passphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtNewAccount error: %s\n", emsg.c_str());
+
+    std::mutex writeMutex;
+    bool writeFailed = false;
+    uint64_t written = header.size();
+    size_t exported = 0;
+    std::vector<std::string> errors(accounts.size());
+    MemoryBudget budget(bulkMemoryBudget);
+    const uint64_t encryptCost = scryptMemoryCost(static_cast<uint64_t>(std::max<int64_t>(scryptN, 0)), 8);
+    const auto started = std::chrono::steady_clock::now();
+
+    parallelFor(accounts.size(), bulkThreads, [&](size_t i) {
+        uint64_t decryptCost = 0;
+        {
+            FileBuffer file(accounts[i].second);
+            decryptCost = keyFileScryptCost(file.data(), file.size());
+        }
+        const uint64_t cost = std::max(decryptCost, encryptCost);
+        budget.acquire(cost);
+        GoString err;
+        GoString keyJson;
+        {
+            AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+            keyJson = GoString(exportKey(accounts[i].first.c_str(), passphrase.c_str(), backupPassphrase.c_str(), err.out()));
+        }
+        budget.release(cost);
+        if (!keyJson) {
+            errors[i] = errorMessage(err);
+            return;
+        }
+        std::string line = keyJson.str();
+        if (line.find('\n') != std::string::npos) {
+            line = nlohmann::json::parse(line).dump();
+        }
+        line.push_back('\n');
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (writeFailed || !writeAll(out, line.data(), line.size())) {
+            writeFailed = true;
+            errors[i] = "write failed";
+            return;
+        }
+        written += line.size();
+        ++exported;
+    });
+
+    const std::string trailer = "{\"count\":" + std::to_string(exported) + "}\n";
+    if (writeFailed || !writeAll(out, trailer.data(), trailer.size())) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot write to fd %lld\n", label, (long long)fd);
         return {};
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
+    written += trailer.size();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    nlohmann::json report;
+    report["errors"] = nlohmann::json::array();
+    for (size_t i = 0; i < accounts.size(); ++i) {
+        if (!errors[i].empty()) {
+            report["errors"].push_back({{"address", accounts[i].first}, {"error", errors[i]}});
+        }
+    }
+    report["exported"] = exported;
+    report["failed"] = accounts.size() - exported;
+    report["bytes"] = written;
+    report["elapsedMs"] = static_cast<int64_t>(seconds * 1000);
+    fprintf(stderr, "AccountsModuleImpl: %s: %zu/%zu exported in %.2fs\n", label, exported, accounts.size(), seconds);
+    return report.dump();
 }
 
-std::string AccountsModuleImpl::extKeystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase)
+std::string AccountsModuleImpl::restoreKeystore(const char* label, const ImportFn& importKey, int64_t scryptN, int64_t fd,
+                                                const std::string& backupPassphraseSource, const std::string& newPassphraseSource)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreImport\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+    std::string backupPassphrase;
+    std::string newPassphrase;
+    if (!resolvePassphraseSource(backupPassphraseSource, backupPassphrase) ||
+        !resolvePassphraseSource(newPassphraseSource, newPassphrase)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot resolve passphrase source\n", label);
         return {};
     }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_extkeystore_Import(
-        extkeystoreHandle, const_cast<char*>(keyJSON.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtImport error: %s\n", emsg.c_str());
+    LineReader reader(static_cast<int>(fd));
+    std::string line;
+    nlohmann::json header;
+    if (reader.next(line)) {
+        header = nlohmann::json::parse(line, nullptr, false);
+    }
+    if (!header.is_object() || header.value("format", std::string()) != "logos-keystore-backup") {
+        fprintf(stderr, "AccountsModuleImpl: %s error: not a keystore backup archive\n", label);
         return {};
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
-}
 
-std::string AccountsModuleImpl::extKeystoreImportExtendedKey(const std::string& extKeyStr, const std::string& passphrase)
-{
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreImportExtendedKey\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
+    struct Record {
+        size_t line = 0;
+        std::string keyJson;
+    };
+    BoundedQueue<Record> queue(bulkThreads * 2);
+    std::mutex resultMutex;
+    size_t restored = 0;
+    nlohmann::json errors = nlohmann::json::array();
+    MemoryBudget budget(bulkMemoryBudget);
+    const uint64_t encryptCost = scryptMemoryCost(static_cast<uint64_t>(std::max<int64_t>(scryptN, 0)), 8);
+    const auto started = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < bulkThreads; ++t) {
+        workers.emplace_back([&]() {
+            Record record;
+            while (queue.pop(record)) {
+                const uint64_t cost = std::max(keyFileScryptCost(record.keyJson.data(), record.keyJson.size()), encryptCost);
+                budget.acquire(cost);
+                GoString err;
+                GoString address;
+                {
+                    AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+                    address = GoString(importKey(record.keyJson.c_str(), backupPassphrase.c_str(), newPassphrase.c_str(), err.out()));
+                }
+                budget.release(cost);
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (!address) {
+                    errors.push_back({{"line", record.line}, {"error", errorMessage(err)}});
+                    continue;
+                }
+                ++restored;
+            }
+        });
     }
-    char* err = nullptr;
-    char* address = GoWSK_accounts_extkeystore_ImportExtendedKey(
-        extkeystoreHandle, const_cast<char*>(extKeyStr.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtImportExtendedKey error: %s\n", emsg.c_str());
-        return {};
+
+    size_t lineNo = 1;
+    size_t records = 0;
+    int64_t trailerCount = -1;
+    while (reader.next(line)) {
+        ++lineNo;
+        if (line.empty()) {
+            continue;
+        }
+        if (line.compare(0, 9, "{\"count\":") == 0) {
+            auto trailer = nlohmann::json::parse(line, nullptr, false);
+            trailerCount = trailer.is_object() ? trailer.value("count", int64_t(-1)) : -1;
+            continue;
+        }
+        ++records;
+        queue.push(Record{lineNo, std::move(line)});
     }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
+    queue.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    nlohmann::json report;
+    report["restored"] = restored;
+    report["failed"] = records - restored;
+    report["errors"] = std::move(errors);
+    report["complete"] = !reader.failed() && trailerCount >= 0 && static_cast<size_t>(trailerCount) == records;
+    report["elapsedMs"] = static_cast<int64_t>(seconds * 1000);
+    fprintf(stderr, "AccountsModuleImpl: %s: %zu/%zu restored in %.2fs\n", label, restored, records, seconds);
+    return report.dump();
 }
 
-std::string AccountsModuleImpl::extKeystoreExportExt(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+std::string AccountsModuleImpl::importDirectory(const char* label, const std::string& srcDir, const std::string& passphraseSource,
+                                                const std::string& newPassphrase, int64_t scryptN, const ImportFn& importKey)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreExportExt\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+    std::string passphrase;
+    if (!resolvePassphraseSource(passphraseSource, passphrase)) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot resolve passphrase source\n", label);
         return {};
     }
-    char* err = nullptr;
-    char* extKey = GoWSK_accounts_extkeystore_ExportExt(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (extKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtExportExt error: %s\n", emsg.c_str());
+    std::vector<std::string> names;
+    DIR* dir = opendir(srcDir.c_str());
+    if (dir == nullptr) {
+        fprintf(stderr, "AccountsModuleImpl: %s error: cannot open %s\n", label, srcDir.c_str());
         return {};
     }
-    std::string result(extKey);
-    GoWSK_FreeCString(extKey);
-    return result;
+    while (struct dirent* ent = readdir(dir)) {
+        if (ent->d_name[0] != '.') {
+            names.emplace_back(ent->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    struct FileResult {
+        std::string address;
+        std::string error;
+        uint64_t bytes = 0;
+    };
+    std::vector<FileResult> results(names.size());
+    MemoryBudget budget(bulkMemoryBudget);
+    // The SDK re-encrypts with the keystore's scryptN and the standard r = 8.
+    const uint64_t encryptCost = scryptMemoryCost(static_cast<uint64_t>(std::max<int64_t>(scryptN, 0)), 8);
+    const auto started = std::chrono::steady_clock::now();
+
+    parallelFor(names.size(), bulkThreads, [&](size_t i) {
+        FileResult& result = results[i];
+        FileBuffer file(srcDir + "/" + names[i]);
+        if (!file.valid()) {
+            result.error = "cannot read file";
+            return;
+        }
+        result.bytes = file.size();
+        const uint64_t cost = std::max(keyFileScryptCost(file.data(), file.size()), encryptCost);
+        budget.acquire(cost);
+        GoString err;
+        GoString address;
+        {
+            AdmissionControl::Ticket ticket = admission.enterBackground(AdmissionControl::Lane::Scrypt);
+            address = GoString(importKey(file.c_str(), passphrase.c_str(), newPassphrase.c_str(), err.out()));
+        }
+        budget.release(cost);
+        if (!address) {
+            result.error = errorMessage(err);
+            return;
+        }
+        result.address = address.str();
+    });
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    nlohmann::json report;
+    report["results"] = nlohmann::json::array();
+    size_t imported = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        nlohmann::json entry;
+        entry["file"] = names[i];
+        if (results[i].error.empty()) {
+            entry["address"] = results[i].address;
+            ++imported;
+        } else {
+            entry["error"] = results[i].error;
+        }
+        bytes += results[i].bytes;
+        report["results"].push_back(std::move(entry));
+    }
+    report["imported"] = imported;
+    report["failed"] = names.size() - imported;
+    report["bytes"] = bytes;
+    report["elapsedMs"] = static_cast<int64_t>(seconds * 1000);
+    report["filesPerSecond"] = seconds > 0 ? names.size() / seconds : 0.0;
+    fprintf(stderr, "AccountsModuleImpl: %s: %zu/%zu imported in %.2fs\n", label, imported, names.size(), seconds);
+    return report.dump();
 }
 
-std::string AccountsModuleImpl::extKeystoreExportPriv(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+// Key operations
+
+std::string AccountsModuleImpl::createExtKeyFromMnemonic(const std::string& phrase, const std::string& passphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreExportPriv\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* privKey = GoWSK_accounts_extkeystore_ExportPriv(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (privKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtExportPriv error: %s\n", emsg.c_str());
+    fprintf(stderr, "AccountsModuleImpl::createExtKeyFromMnemonic\n");
+    GoString err;
+    GoString extKey(GoWSK_accounts_keys_CreateExtKeyFromMnemonic(
+        const_cast<char*>(phrase.c_str()), const_cast<char*>(passphrase.c_str()), err.out()));
+    if (!extKey) {
+        fprintf(stderr, "AccountsModuleImpl: CreateExtKeyFromMnemonic error: %s\n", errorMessage(err));
         return {};
     }
-    std::string result(privKey);
-    GoWSK_FreeCString(privKey);
-    return result;
+    return extKey.str();
 }
 
-bool AccountsModuleImpl::extKeystoreDelete(const std::string& address, const std::string& passphrase)
+std::vector<std::string> AccountsModuleImpl::createExtKeysFromMnemonics(const std::string& phrasesJSON,
+                                                                       const std::string& passphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreDelete\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_extkeystore_Delete(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtDelete error: %s\n", emsg.c_str());
-        return false;
+    fprintf(stderr, "AccountsModuleImpl::createExtKeysFromMnemonics (kernel %s)\n", pbkdf2Sha512Kernel());
+    std::vector<std::string> phrases;
+    try {
+        phrases = nlohmann::json::parse(phrasesJSON).get<std::vector<std::string>>();
+    } catch (const nlohmann::json::exception& e) {
+        fprintf(stderr, "AccountsModuleImpl: createExtKeysFromMnemonics: invalid phrases JSON: %s\n", e.what());
+        return {};
     }
-    return true;
-}
 
-bool AccountsModuleImpl::extKeystoreHasAddress(const std::string& address)
-{
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreHasAddress\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
+    std::vector<std::string> result(phrases.size());
+    const std::string salt = "mnemonic" + passphrase;
+    const bool asciiSalt = isAscii(salt);
+    std::vector<size_t> native;
+    std::vector<size_t> viaSdk;
+    for (size_t i = 0; i < phrases.size(); ++i) {
+        if (!asciiSalt || !isAscii(phrases[i])) {
+            viaSdk.push_back(i);
+            continue;
+        }
+        // The SDK refuses phrases that are not valid BIP-39; PBKDF2 would take
+        // any text, so the native path checks words and checksum first.
+        if (bip39Validate(phrases[i]).status != Bip39Status::Valid) {
+            fprintf(stderr, "AccountsModuleImpl: createExtKeysFromMnemonics: phrase %zu is not a valid mnemonic\n", i);
+            continue;
+        }
+        native.push_back(i);
     }
-    char* err = nullptr;
-    int result = GoWSK_accounts_extkeystore_HasAddress(
-        extkeystoreHandle, const_cast<char*>(address.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtHasAddress error: %s\n", emsg.c_str());
-        return false;
+
+    // Workers take whole lane groups so the SIMD kernel runs full.
+    const size_t group = pbkdf2Sha512Lanes();
+    const size_t groups = (native.size() + group - 1) / group;
+    parallelFor(groups, bulkThreads, [&](size_t g) {
+        const size_t first = g * group;
+        const size_t count = std::min(group, native.size() - first);
+        std::vector<uint8_t> seeds(count * kBip39SeedSize);
+        std::vector<Pbkdf2Sha512Job> jobs(count);
+        for (size_t j = 0; j < count; ++j) {
+            const std::string& phrase = phrases[native[first + j]];
+            jobs[j] = {reinterpret_cast<const uint8_t*>(phrase.data()), phrase.size(),
+                       reinterpret_cast<const uint8_t*>(salt.data()), salt.size(),
+                       seeds.data() + j * kBip39SeedSize};
+        }
+        pbkdf2HmacSha512Batch(jobs.data(), count, kBip39SeedIterations);
+        for (size_t j = 0; j < count; ++j) {
+            result[native[first + j]] = extKeyFromSeed(seeds.data() + j * kBip39SeedSize, kBip39SeedSize);
+        }
+        std::fill(seeds.begin(), seeds.end(), 0);
+    });
+
+    for (size_t i : viaSdk) {
+        GoString err;
+        GoString extKey(GoWSK_accounts_keys_CreateExtKeyFromMnemonic(
+            const_cast<char*>(phrases[i].c_str()), const_cast<char*>(passphrase.c_str()), err.out()));
+        if (!extKey) {
+            fprintf(stderr, "AccountsModuleImpl: CreateExtKeyFromMnemonic error for phrase %zu: %s\n", i, errorMessage(err));
+            continue;
+        }
+        result[i] = extKey.str();
     }
-    return result != 0;
+    return result;
 }
 
-bool AccountsModuleImpl::extKeystoreUnlock(const std::string& address, const std::string& passphrase)
+std::string AccountsModuleImpl::deriveExtKey(const std::string& extKeyStr, const std::string& pathStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreUnlock\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_extkeystore_Unlock(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtUnlock error: %s\n", emsg.c_str());
-        return false;
+    fprintf(stderr, "AccountsModuleImpl::deriveExtKey\n");
+    GoString err;
+    GoString derivedKey(GoWSK_accounts_keys_DeriveExtKey(
+        const_cast<char*>(extKeyStr.c_str()), const_cast<char*>(pathStr.c_str()), err.out()));
+    if (!derivedKey) {
+        fprintf(stderr, "AccountsModuleImpl: DeriveExtKey error: %s\n", errorMessage(err));
+        return {};
     }
-    return true;
+    return derivedKey.str();
 }
 
-bool AccountsModuleImpl::extKeystoreLock(const std::string& address)
+std::string AccountsModuleImpl::extKeyToECDSA(const std::string& extKeyStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreLock\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_extkeystore_Lock(
-        extkeystoreHandle, const_cast<char*>(address.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtLock error: %s\n", emsg.c_str());
-        return false;
+    fprintf(stderr, "AccountsModuleImpl::extKeyToECDSA\n");
+    GoString err;
+    GoString ecdsaKey(GoWSK_accounts_keys_ExtKeyToECDSA(
+        const_cast<char*>(extKeyStr.c_str()), err.out()));
+    if (!ecdsaKey) {
+        fprintf(stderr, "AccountsModuleImpl: ExtKeyToECDSA error: %s\n", errorMessage(err));
+        return {};
     }
-    return true;
+    return ecdsaKey.str();
 }
 
-bool AccountsModuleImpl::extKeystoreTimedUnlock(const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds)
+int64_t AccountsModuleImpl::extKeyHandleFromString(const std::string& extKeyStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreTimedUnlock\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_extkeystore_TimedUnlock(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()),
-        static_cast<unsigned long>(timeoutSeconds), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtTimedUnlock error: %s\n", emsg.c_str());
-        return false;
+    fprintf(stderr, "AccountsModuleImpl::extKeyHandleFromString\n");
+    ExtKey key;
+    if (!extKeyParse(extKeyStr, key)) {
+        fprintf(stderr, "AccountsModuleImpl: extKeyHandleFromString: invalid extended key\n");
+        return 0;
     }
-    return true;
+    return extKeys.add(key);
 }
 
-bool AccountsModuleImpl::extKeystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase)
+int64_t AccountsModuleImpl::extKeyHandleFromMnemonic(const std::string& phrase, const std::string& passphrase)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreUpdate\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return false;
-    }
-    char* err = nullptr;
-    GoWSK_accounts_extkeystore_Update(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtUpdate error: %s\n", emsg.c_str());
-        return false;
+    fprintf(stderr, "AccountsModuleImpl::extKeyHandleFromMnemonic\n");
+    const std::string salt = "mnemonic" + passphrase;
+    ExtKey key;
+    if (isAscii(phrase) && isAscii(salt)) {
+        if (bip39Validate(phrase).status != Bip39Status::Valid) {
+            fprintf(stderr, "AccountsModuleImpl: extKeyHandleFromMnemonic: not a valid mnemonic\n");
+            return 0;
+        }
+        uint8_t seed[kBip39SeedSize];
+        Pbkdf2Sha512Job job = {reinterpret_cast<const uint8_t*>(phrase.data()), phrase.size(),
+                               reinterpret_cast<const uint8_t*>(salt.data()), salt.size(), seed};
+        pbkdf2HmacSha512Batch(&job, 1, kBip39SeedIterations);
+        const bool ok = extKeyMasterFromSeed(seed, sizeof(seed), key);
+        std::fill(seed, seed + sizeof(seed), 0);
+        if (!ok) {
+            fprintf(stderr, "AccountsModuleImpl: extKeyHandleFromMnemonic: seed yields an invalid master key\n");
+            return 0;
+        }
+        return extKeys.add(key);
     }
-    return true;
-}
 
-std::string AccountsModuleImpl::extKeystoreSignHash(const std::string& address, const std::string& hashHex)
-{
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignHash\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
+    GoString err;
+    GoString extKey(GoWSK_accounts_keys_CreateExtKeyFromMnemonic(
+        const_cast<char*>(phrase.c_str()), const_cast<char*>(passphrase.c_str()), err.out()));
+    if (!extKey) {
+        fprintf(stderr, "AccountsModuleImpl: CreateExtKeyFromMnemonic error: %s\n", errorMessage(err));
+        return 0;
     }
-    char* err = nullptr;
-    char* signature = GoWSK_accounts_extkeystore_SignHash(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(hashHex.c_str()), &err);
-    if (signature == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtSignHash error: %s\n", emsg.c_str());
-        return {};
+    const bool ok = extKeyParse(extKey.view(), key);
+    extKey.wipe();
+    if (!ok) {
+        fprintf(stderr, "AccountsModuleImpl: extKeyHandleFromMnemonic: SDK returned an invalid extended key\n");
+        return 0;
     }
-    std::string result(signature);
-    GoWSK_FreeCString(signature);
-    return result;
+    return extKeys.add(key);
 }
 
-std::string AccountsModuleImpl::extKeystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex)
+int64_t AccountsModuleImpl::deriveExtKeyHandle(int64_t handle, const std::string& pathStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignHashWithPassphrase\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
+    fprintf(stderr, "AccountsModuleImpl::deriveExtKeyHandle\n");
+    ExtKey parent;
+    if (!extKeys.get(handle, parent)) {
+        fprintf(stderr, "AccountsModuleImpl: unknown extended-key handle %lld\n", static_cast<long long>(handle));
+        return 0;
     }
-    char* err = nullptr;
-    char* signature = GoWSK_accounts_extkeystore_SignHashWithPassphrase(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(hashHex.c_str()), &err);
-    if (signature == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtSignHashWithPassphrase error: %s\n", emsg.c_str());
-        return {};
+    std::vector<uint32_t> path;
+    if (!extKeyParsePath(pathStr, path)) {
+        fprintf(stderr, "AccountsModuleImpl: deriveExtKeyHandle: invalid path %s\n", pathStr.c_str());
+        return 0;
     }
-    std::string result(signature);
-    GoWSK_FreeCString(signature);
-    return result;
+    ExtKey child;
+    if (!extKeyDerive(parent, path, child)) {
+        fprintf(stderr, "AccountsModuleImpl: deriveExtKeyHandle: cannot derive %s\n", pathStr.c_str());
+        return 0;
+    }
+    return extKeys.add(child);
 }
 
-std::string AccountsModuleImpl::extKeystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex)
+std::string AccountsModuleImpl::extKeyHandleToString(int64_t handle)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignTx\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* signedTx = GoWSK_accounts_extkeystore_SignTx(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(txJSON.c_str()), const_cast<char*>(chainIDHex.c_str()), &err);
-    if (signedTx == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtSignTx error: %s\n", emsg.c_str());
+    fprintf(stderr, "AccountsModuleImpl::extKeyHandleToString\n");
+    ExtKey key;
+    if (!extKeys.get(handle, key)) {
+        fprintf(stderr, "AccountsModuleImpl: unknown extended-key handle %lld\n", static_cast<long long>(handle));
         return {};
     }
-    std::string result(signedTx);
-    GoWSK_FreeCString(signedTx);
-    return result;
+    return extKeySerialize(key);
 }
 
-std::string AccountsModuleImpl::extKeystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex)
+std::string AccountsModuleImpl::extKeyHandleToECDSA(int64_t handle)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreSignTxWithPassphrase\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
+    fprintf(stderr, "AccountsModuleImpl::extKeyHandleToECDSA\n");
+    ExtKey key;
+    if (!extKeys.get(handle, key)) {
+        fprintf(stderr, "AccountsModuleImpl: unknown extended-key handle %lld\n", static_cast<long long>(handle));
         return {};
     }
-    char* err = nullptr;
-    char* signedTx = GoWSK_accounts_extkeystore_SignTxWithPassphrase(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(txJSON.c_str()),
-        const_cast<char*>(chainIDHex.c_str()), &err);
-    if (signedTx == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtSignTxWithPassphrase error: %s\n", emsg.c_str());
+    if (!key.isPrivate()) {
+        fprintf(stderr, "AccountsModuleImpl: extKeyHandleToECDSA: not a private extended key\n");
         return {};
     }
-    std::string result(signedTx);
-    GoWSK_FreeCString(signedTx);
+    static const char kHex[] = "0123456789abcdef";
+    std::string result = "0x";
+    for (int i = 1; i < 33; ++i) {
+        result += kHex[key.key[i] >> 4];
+        result += kHex[key.key[i] & 0x0f];
+    }
     return result;
 }
 
-std::string AccountsModuleImpl::extKeystoreDerive(const std::string& address, const std::string& derivationPath, int64_t pin)
+bool AccountsModuleImpl::releaseExtKeyHandle(int64_t handle)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreDerive\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* derivedAddress = GoWSK_accounts_extkeystore_Derive(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(derivationPath.c_str()), static_cast<int>(pin), &err);
-    if (derivedAddress == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtDerive error: %s\n", emsg.c_str());
-        return {};
-    }
-    std::string result(derivedAddress);
-    GoWSK_FreeCString(derivedAddress);
-    return result;
+    fprintf(stderr, "AccountsModuleImpl::releaseExtKeyHandle\n");
+    return extKeys.release(handle);
 }
 
-std::string AccountsModuleImpl::extKeystoreDeriveWithPassphrase(const std::string& address, const std::string& derivationPath, int64_t pin, const std::string& passphrase, const std::string& newPassphrase)
+std::string AccountsModuleImpl::ecdsaToPublicKey(const std::string& privateKeyECDSAStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreDeriveWithPassphrase\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* derivedAddress = GoWSK_accounts_extkeystore_DeriveWithPassphrase(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(derivationPath.c_str()), static_cast<int>(pin),
-        const_cast<char*>(passphrase.c_str()), const_cast<char*>(newPassphrase.c_str()), &err);
-    if (derivedAddress == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtDeriveWithPassphrase error: %s\n", emsg.c_str());
+    fprintf(stderr, "AccountsModuleImpl::ecdsaToPublicKey\n");
+    GoString err;
+    GoString publicKey(GoWSK_accounts_keys_ECDSAToPublicKey(
+        const_cast<char*>(privateKeyECDSAStr.c_str()), err.out()));
+    if (!publicKey) {
+        fprintf(stderr, "AccountsModuleImpl: ECDSAToPublicKey error: %s\n", errorMessage(err));
         return {};
     }
-    std::string result(derivedAddress);
-    GoWSK_FreeCString(derivedAddress);
-    return result;
+    return publicKey.str();
 }
 
-std::string AccountsModuleImpl::extKeystoreFind(const std::string& address, const std::string& url)
+std::string AccountsModuleImpl::publicKeyToAddress(const std::string& publicKeyStr)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeystoreFind\n");
-    if (extkeystoreHandle == 0) {
-        fprintf(stderr, "AccountsModuleImpl: Ext keystore not initialized\n");
-        return {};
-    }
-    char* err = nullptr;
-    char* resultStr = GoWSK_accounts_extkeystore_Find(
-        extkeystoreHandle, const_cast<char*>(address.c_str()),
-        const_cast<char*>(url.c_str()), &err);
-    if (resultStr == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtFind error: %s\n", emsg.c_str());
+    fprintf(stderr, "AccountsModuleImpl::publicKeyToAddress\n");
+    GoString err;
+    GoString address(GoWSK_accounts_keys_PublicKeyToAddress(
+        const_cast<char*>(publicKeyStr.c_str()), err.out()));
+    if (!address) {
+        fprintf(stderr, "AccountsModuleImpl: PublicKeyToAddress error: %s\n", errorMessage(err));
         return {};
     }
-    std::string result(resultStr);
-    GoWSK_FreeCString(resultStr);
-    return result;
+    return address.str();
 }
 
-// Key operations
-
-std::string AccountsModuleImpl::createExtKeyFromMnemonic(const std::string& phrase, const std::string& passphrase)
+std::string AccountsModuleImpl::recoverAddress(const std::string& hashHex, const std::string& signatureHex)
 {
-    fprintf(stderr, "AccountsModuleImpl::createExtKeyFromMnemonic\n");
-    char* err = nullptr;
-    char* extKey = GoWSK_accounts_keys_CreateExtKeyFromMnemonic(
-        const_cast<char*>(phrase.c_str()), const_cast<char*>(passphrase.c_str()), &err);
-    if (extKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: CreateExtKeyFromMnemonic error: %s\n", emsg.c_str());
+    fprintf(stderr, "AccountsModuleImpl::recoverAddress\n");
+    uint8_t address[kAddressSize];
+    if (!recoverHex(hashHex, signatureHex, address)) {
+        fprintf(stderr, "AccountsModuleImpl: recoverAddress: malformed hash or signature, or no key matches\n");
         return {};
     }
-    std::string result(extKey);
-    GoWSK_FreeCString(extKey);
-    return result;
+    return addressChecksumHex(address);
 }
 
-std::string AccountsModuleImpl::deriveExtKey(const std::string& extKeyStr, const std::string& pathStr)
+std::vector<std::string> AccountsModuleImpl::recoverAddressBatch(const std::string& itemsJSON)
 {
-    fprintf(stderr, "AccountsModuleImpl::deriveExtKey\n");
-    char* err = nullptr;
-    char* derivedKey = GoWSK_accounts_keys_DeriveExtKey(
-        const_cast<char*>(extKeyStr.c_str()), const_cast<char*>(pathStr.c_str()), &err);
-    if (derivedKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: DeriveExtKey error: %s\n", emsg.c_str());
+    std::vector<RecoveryItem> items;
+    if (!parseRecoveryItems("recoverAddressBatch", itemsJSON, false, items)) {
         return {};
     }
-    std::string result(derivedKey);
-    GoWSK_FreeCString(derivedKey);
+    fprintf(stderr, "AccountsModuleImpl::recoverAddressBatch %zu items (%s)\n", items.size(), NativeSigner::backend());
+
+    std::vector<std::string> result(items.size());
+    std::atomic<size_t> failed(0);
+    parallelFor(items.size(), bulkThreads, [&](size_t i) {
+        uint8_t address[kAddressSize];
+        if (!recoverHex(items[i].hash, items[i].signature, address)) {
+            ++failed;
+            return;
+        }
+        result[i] = addressChecksumHex(address);
+    });
+    if (failed > 0) {
+        fprintf(stderr, "AccountsModuleImpl: recoverAddressBatch: %zu of %zu items failed\n", failed.load(), items.size());
+    }
     return result;
 }
 
-std::string AccountsModuleImpl::extKeyToECDSA(const std::string& extKeyStr)
+std::string AccountsModuleImpl::verifyBatch(const std::string& itemsJSON)
 {
-    fprintf(stderr, "AccountsModuleImpl::extKeyToECDSA\n");
-    char* err = nullptr;
-    char* ecdsaKey = GoWSK_accounts_keys_ExtKeyToECDSA(
-        const_cast<char*>(extKeyStr.c_str()), &err);
-    if (ecdsaKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ExtKeyToECDSA error: %s\n", emsg.c_str());
+    std::vector<RecoveryItem> items;
+    if (!parseRecoveryItems("verifyBatch", itemsJSON, true, items)) {
         return {};
     }
-    std::string result(ecdsaKey);
-    GoWSK_FreeCString(ecdsaKey);
-    return result;
+    fprintf(stderr, "AccountsModuleImpl::verifyBatch %zu items (%s)\n", items.size(), NativeSigner::backend());
+
+    // A std::vector<bool> would pack its elements into shared words.
+    std::vector<char> valid(items.size(), 0);
+    parallelFor(items.size(), bulkThreads, [&](size_t i) {
+        uint8_t expected[kAddressSize], address[kAddressSize];
+        valid[i] = parseHex(items[i].address, expected, sizeof(expected)) &&
+                   recoverHex(items[i].hash, items[i].signature, address) &&
+                   memcmp(expected, address, sizeof(address)) == 0;
+    });
+    nlohmann::json result = nlohmann::json::array();
+    for (char v : valid) {
+        result.push_back(v != 0);
+    }
+    return result.dump();
 }
 
-std::string AccountsModuleImpl::ecdsaToPublicKey(const std::string& privateKeyECDSAStr)
+std::string AccountsModuleImpl::hashTypedData(const std::string& typedDataJSON)
 {
-    fprintf(stderr, "AccountsModuleImpl::ecdsaToPublicKey\n");
-    char* err = nullptr;
-    char* publicKey = GoWSK_accounts_keys_ECDSAToPublicKey(
-        const_cast<char*>(privateKeyECDSAStr.c_str()), &err);
-    if (publicKey == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: ECDSAToPublicKey error: %s\n", emsg.c_str());
+    uint8_t digest[32];
+    std::string error;
+    if (!typedData.hash(typedDataJSON, digest, error)) {
+        fprintf(stderr, "AccountsModuleImpl: typed data: %s\n", error.c_str());
         return {};
     }
-    std::string result(publicKey);
-    GoWSK_FreeCString(publicKey);
-    return result;
+    return hexString(digest, sizeof(digest));
 }
 
-std::string AccountsModuleImpl::publicKeyToAddress(const std::string& publicKeyStr)
+std::string AccountsModuleImpl::typedDataStatus()
 {
-    fprintf(stderr, "AccountsModuleImpl::publicKeyToAddress\n");
-    char* err = nullptr;
-    char* address = GoWSK_accounts_keys_PublicKeyToAddress(
-        const_cast<char*>(publicKeyStr.c_str()), &err);
-    if (address == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: PublicKeyToAddress error: %s\n", emsg.c_str());
-        return {};
-    }
-    std::string result(address);
-    GoWSK_FreeCString(address);
-    return result;
+    const Eip712Hasher::Stats stats = typedData.stats();
+    nlohmann::json status;
+    status["capacity"] = stats.capacity;
+    status["schemas"] = stats.schemas;
+    status["hits"] = stats.hits;
+    status["misses"] = stats.misses;
+    return status.dump();
 }
 
 // Mnemonic operations
@@ -937,45 +3265,122 @@ std::string AccountsModuleImpl::publicKeyToAddress(const std::string& publicKeyS
 std::string AccountsModuleImpl::createRandomMnemonic(int64_t length)
 {
     fprintf(stderr, "AccountsModuleImpl::createRandomMnemonic %lld\n", (long long)length);
-    char* err = nullptr;
-    char* mnemonic = GoWSK_accounts_mnemonic_CreateRandomMnemonic(static_cast<int>(length), &err);
-    if (mnemonic == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: CreateRandomMnemonic error: %s\n", emsg.c_str());
+    GoString err;
+    GoString mnemonic(GoWSK_accounts_mnemonic_CreateRandomMnemonic(static_cast<int>(length), err.out()));
+    if (!mnemonic) {
+        fprintf(stderr, "AccountsModuleImpl: CreateRandomMnemonic error: %s\n", errorMessage(err));
         return {};
     }
-    std::string result(mnemonic);
-    GoWSK_FreeCString(mnemonic);
-    return result;
+    return mnemonic.str();
 }
 
 std::string AccountsModuleImpl::createRandomMnemonicWithDefaultLength()
 {
     fprintf(stderr, "AccountsModuleImpl::createRandomMnemonicWithDefaultLength\n");
-    char* err = nullptr;
-    char* mnemonic = GoWSK_accounts_mnemonic_CreateRandomMnemonicWithDefaultLength(&err);
-    if (mnemonic == nullptr) {
-        std::string emsg = err ? std::string(err) : "unknown error";
-        if (err) GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: CreateRandomMnemonicWithDefaultLength error: %s\n", emsg.c_str());
+    GoString err;
+    GoString mnemonic(GoWSK_accounts_mnemonic_CreateRandomMnemonicWithDefaultLength(err.out()));
+    if (!mnemonic) {
+        fprintf(stderr, "AccountsModuleImpl: CreateRandomMnemonicWithDefaultLength error: %s\n", errorMessage(err));
+        return {};
+    }
+    return mnemonic.str();
+}
+
+std::vector<std::string> AccountsModuleImpl::createRandomMnemonics(int64_t count, int64_t length)
+{
+    fprintf(stderr, "AccountsModuleImpl::createRandomMnemonics %lld x %lld\n", (long long)count, (long long)length);
+    const size_t entropyBytes = length > 0 && length <= 24 ? bip39EntropyBytes(static_cast<int>(length)) : 0;
+    if (entropyBytes == 0) {
+        fprintf(stderr, "AccountsModuleImpl: createRandomMnemonics: invalid length %lld\n", (long long)length);
+        return {};
+    }
+    if (count <= 0 || count > kMaxMnemonicBatch) {
+        fprintf(stderr, "AccountsModuleImpl: createRandomMnemonics: count must be in 1..%lld\n",
+                (long long)kMaxMnemonicBatch);
+        return {};
+    }
+
+    std::vector<std::string> result(static_cast<size_t>(count));
+    const size_t chunks = (result.size() + kMnemonicChunk - 1) / kMnemonicChunk;
+    std::atomic<bool> failed(false);
+    parallelFor(chunks, bulkThreads, [&](size_t chunk) {
+        // One generator per thread; it reseeds itself from the OS as needed.
+        thread_local ChaCha20Drbg drbg;
+        uint8_t entropy[32];
+        const size_t end = std::min(result.size(), (chunk + 1) * kMnemonicChunk);
+        for (size_t i = chunk * kMnemonicChunk; i < end; ++i) {
+            if (!drbg.generate(entropy, entropyBytes)) {
+                failed = true;
+                return;
+            }
+            result[i] = bip39MnemonicFromEntropy(entropy, entropyBytes);
+        }
+        std::fill(entropy, entropy + sizeof(entropy), 0);
+    });
+    if (failed) {
+        fprintf(stderr, "AccountsModuleImpl: createRandomMnemonics: entropy source failed\n");
         return {};
     }
-    std::string result(mnemonic);
-    GoWSK_FreeCString(mnemonic);
     return result;
 }
 
 int64_t AccountsModuleImpl::lengthToEntropyStrength(int64_t length)
 {
     fprintf(stderr, "AccountsModuleImpl::lengthToEntropyStrength %lld\n", (long long)length);
-    char* err = nullptr;
-    uint32_t result = GoWSK_accounts_mnemonic_LengthToEntropyStrength(static_cast<int>(length), &err);
-    if (err != nullptr) {
-        std::string emsg(err);
-        GoWSK_FreeCString(err);
-        fprintf(stderr, "AccountsModuleImpl: LengthToEntropyStrength error: %s\n", emsg.c_str());
+    GoString err;
+    uint32_t result = GoWSK_accounts_mnemonic_LengthToEntropyStrength(static_cast<int>(length), err.out());
+    if (err) {
+        fprintf(stderr, "AccountsModuleImpl: LengthToEntropyStrength error: %s\n", err.c_str());
         return 0;
     }
     return static_cast<int64_t>(result);
 }
+
+bool AccountsModuleImpl::validateMnemonic(const std::string& phrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::validateMnemonic\n");
+    return bip39Validate(phrase).status == Bip39Status::Valid;
+}
+
+std::string AccountsModuleImpl::checkMnemonic(const std::string& phrase)
+{
+    fprintf(stderr, "AccountsModuleImpl::checkMnemonic\n");
+    const Bip39Check check = bip39Validate(phrase);
+    nlohmann::json report = {
+        {"valid", check.status == Bip39Status::Valid},
+        {"words", check.words},
+    };
+    switch (check.status) {
+    case Bip39Status::Valid:
+        break;
+    case Bip39Status::BadWordCount:
+        report["error"] = "wordCount";
+        break;
+    case Bip39Status::UnknownWord:
+        report["error"] = "unknownWord";
+        break;
+    case Bip39Status::BadChecksum:
+        report["error"] = "checksum";
+        break;
+    }
+
+    nlohmann::json unknown = nlohmann::json::array();
+    if (check.firstUnknown >= 0) {
+        std::istringstream words(phrase);
+        std::string word;
+        for (int position = 0; words >> word; ++position) {
+            if (bip39WordIndex(word) >= 0) {
+                continue;
+            }
+            int suggestions[kMaxWordSuggestions];
+            const size_t count = bip39Suggest(word, suggestions, kMaxWordSuggestions);
+            nlohmann::json list = nlohmann::json::array();
+            for (size_t i = 0; i < count; ++i) {
+                list.push_back(std::string(kBip39EnglishWords[suggestions[i]]));
+            }
+            unknown.push_back({{"position", position}, {"word", word}, {"suggestions", list}});
+        }
+    }
+    report["unknownWords"] = unknown;
+    return report.dump();
+}
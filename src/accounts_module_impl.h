@@ -1,12 +1,31 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <map>
+#include <future>
+#include <memory>
+#include <mutex>
 
-extern "C" {
-    #include "lib/libgowalletsdk.h"
-}
+#include "account_pool.h"
+#include "admission_control.h"
+#include "address_pool.h"
+#include "eip712.h"
+#include "ext_key_registry.h"
+#include "ffi_executor.h"
+#include "go_string.h"
+#include "group_commit.h"
+#include "keystore_registry.h"
+#include "memory_dir.h"
+#include "native_signer.h"
+#include "personal_message.h"
+#include "signature_cache.h"
+#include "single_flight.h"
+#include "keystore_watcher.h"
 
 class AccountsModuleImpl {
 public:
@@ -14,10 +33,42 @@ public:
     ~AccountsModuleImpl();
 
     // Keystore operations
+    //
+    // Passing kMemoryKeystoreDir as the directory keeps the key files in a
+    // private tmpfs directory instead (see MemoryDir) that close removes:
+    // nothing is written to disk, for ephemeral signers and load tests. A
+    // scryptN or scryptP <= 0 then selects the SDK's light parameters. Without
+    // /dev/shm the init fails, unless kTempKeystoreDir is passed instead: it
+    // opts in to a private directory under $TMPDIR, which may be disk-backed.
+    // Such directories left by a process that died are removed at startup.
+    static constexpr const char* kMemoryKeystoreDir = ":memory:";
+    static constexpr const char* kTempKeystoreDir = ":temp:";
     bool initKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    // Returns immediately and opens the keystore on a background thread. Keystore
+    // operations issued meanwhile block until loading finishes; key and mnemonic
+    // operations do not touch the keystore and run right away.
+    bool initKeystoreAsync(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    // One of "closed", "loading", "ready" or "failed".
+    std::string keystoreState();
+    // Waits up to timeoutMs (forever when negative) for a pending load; true once ready.
+    bool waitKeystoreReady(int64_t timeoutMs);
     bool closeKeystore(const std::string& privateKey);
+    // Keeps keystoreAccounts/keystoreHasAddress in sync with files added, changed or
+    // removed by other tools, applying changes once the directory has been quiet
+    // for debounceMs. Served from memory while active; stopped by close/init.
+    bool keystoreWatch(int64_t debounceMs);
+    bool keystoreUnwatch();
     std::vector<std::string> keystoreAccounts();
     std::string keystoreNewAccount(const std::string& passphrase);
+    // Account pool: keeps `size` accounts generated and encrypted in advance with the
+    // passphrase from passphraseSource ("env:NAME", "file:/path", "literal:<passphrase>"
+    // or a bare passphrase), at most refillPerMinute a minute (0: unlimited). keystoreNewAccount with that
+    // passphrase then returns a pooled account without running scrypt. Pooled
+    // accounts are hidden from listings until handed out. Size 0 disables the pool
+    // and deletes its unused accounts.
+    bool keystoreConfigureAccountPool(const std::string& passphraseSource, int64_t size, int64_t refillPerMinute);
+    // {"enabled","ready","pendingVerification","size","refillPerMinute","generated","hits","misses","lastError"}.
+    std::string keystoreAccountPoolStatus();
     std::string keystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase);
     std::string keystoreExport(const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
     bool keystoreDelete(const std::string& address, const std::string& passphrase);
@@ -28,18 +79,68 @@ public:
     bool keystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
     std::string keystoreSignHash(const std::string& address, const std::string& hashHex);
     std::string keystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex);
+    // Signs the EIP-712 digest of typed data {"types","primaryType","domain",
+    // "message"} (see hashTypedData) as keystoreSignHash signs a hash. Empty when
+    // the document is malformed.
+    std::string keystoreSignTypedData(const std::string& address, const std::string& typedDataJSON);
+    // Streaming EIP-191 personal-message signing (personal_sign) for messages too
+    // large to pass whole: begin with the message's length in bytes, add it in
+    // chunks of any size, and finish to sign its digest as keystoreSignHash signs
+    // a hash. Begin returns a session id (> 0; 0 on failure). Finish returns the
+    // signature, empty when the chunks do not add up to the declared length or
+    // the keystore was closed or re-initialized since begin, and closes the
+    // session either way; sessions idle for ten minutes are dropped.
+    // The Fd form reads `length` bytes from fd (the rest of a regular file when
+    // length < 0) through a fixed buffer; fd is read but not closed.
+    int64_t keystoreSignMessageBegin(const std::string& address, int64_t length);
+    bool signMessageUpdate(int64_t session, const std::string& chunk);
+    std::string signMessageFinish(int64_t session);
+    bool signMessageAbort(int64_t session);
+    std::string keystoreSignMessageFd(const std::string& address, int64_t fd, int64_t length);
     std::string keystoreImportECDSA(const std::string& privateKeyHex, const std::string& passphrase);
     std::string keystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex);
     std::string keystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex);
     std::string keystoreFind(const std::string& address, const std::string& url);
+    // Imports every key file in srcDir (hidden files skipped) in parallel. The
+    // passphrase source is "env:NAME", "file:/path", "literal:<passphrase>" or
+    // a bare passphrase that starts with none of those prefixes.
+    // Returns a JSON report with per-file address or error and throughput.
+    std::string keystoreImportDirectory(const std::string& srcDir, const std::string& passphraseSource, const std::string& newPassphrase);
+    // Re-encrypts the accounts listed in addressesJSON (a JSON array; empty string
+    // for all) in parallel, with a new passphrase (empty source keeps the old one)
+    // and/or new scrypt parameters (<= 0 keeps the keystore's). Each key file is
+    // replaced atomically by the SDK; addresses finished so far are appended to
+    // journalPath (optional) and skipped when the same job (same keystore
+    // directory and target scrypt parameters) is resumed. Once a full run of
+    // the job has finished without failures the journal is refused for it; use
+    // a fresh journal per rotation. A parameter migration reopens the keystore
+    // with the new parameters.
+    std::string keystoreBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                   const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                   const std::string& journalPath);
+    // Streams every account, re-exported under the backup passphrase in parallel,
+    // to fd as a line-delimited archive (header, one key JSON per line, trailer).
+    // Memory stays bounded by the worker count; fd is written but not closed.
+    std::string keystoreBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource);
+    // Reads an archive written by keystoreBackup from fd and imports each key,
+    // re-encrypted under the new passphrase. The report's "complete" flag is false
+    // when the trailer is missing or its count does not match (truncated input).
+    std::string keystoreRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource);
 
     // Extended keystore operations
     bool initExtKeystore(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    bool initExtKeystoreAsync(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    std::string extKeystoreState();
+    bool waitExtKeystoreReady(int64_t timeoutMs);
     bool closeExtKeystore();
+    bool extKeystoreWatch(int64_t debounceMs);
+    bool extKeystoreUnwatch();
     std::vector<std::string> extKeystoreAccounts();
     std::string extKeystoreNewAccount(const std::string& passphrase);
     std::string extKeystoreImport(const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase);
     std::string extKeystoreImportExtendedKey(const std::string& extKeyStr, const std::string& passphrase);
+    // Imports the key behind an extended-key handle (see extKeyHandleFromString).
+    std::string extKeystoreImportExtendedKeyHandle(int64_t handle, const std::string& passphrase);
     std::string extKeystoreExportExt(const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
     std::string extKeystoreExportPriv(const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
     bool extKeystoreDelete(const std::string& address, const std::string& passphrase);
@@ -50,28 +151,459 @@ public:
     bool extKeystoreUpdate(const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
     std::string extKeystoreSignHash(const std::string& address, const std::string& hashHex);
     std::string extKeystoreSignHashWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& hashHex);
+    std::string extKeystoreSignTypedData(const std::string& address, const std::string& typedDataJSON);
+    int64_t extKeystoreSignMessageBegin(const std::string& address, int64_t length);
+    std::string extKeystoreSignMessageFd(const std::string& address, int64_t fd, int64_t length);
     std::string extKeystoreSignTx(const std::string& address, const std::string& txJSON, const std::string& chainIDHex);
     std::string extKeystoreSignTxWithPassphrase(const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex);
     std::string extKeystoreDerive(const std::string& address, const std::string& derivationPath, int64_t pin);
+    // Address pool: pre-derives basePath/startIndex, basePath/startIndex+1, ... of an
+    // unlocked master account in the background (with the given pin), refilling to
+    // `size` whenever fewer than `lowWaterMark` are ready (<= 0 means size / 2).
+    // extKeystoreDerive calls for a pooled path are answered from the pool. A
+    // pinned pool is journaled in the keystore directory: restarted with the
+    // same address and basePath it offers the accounts it stored but did not
+    // hand out, and continues after the indices it used.
+    bool extKeystoreStartAddressPool(const std::string& address, const std::string& basePath, int64_t startIndex,
+                                     int64_t size, int64_t lowWaterMark, int64_t pin);
+    // Next pooled address as JSON {"address","path","index"}; derives inline if the
+    // pool has run dry. Empty when no pool is running for the address or on error.
+    std::string extKeystoreNextAddress(const std::string& address);
+    // {"ready","size","lowWaterMark","nextIndex","derived","hits","misses","lastError"}.
+    std::string extKeystoreAddressPoolStatus(const std::string& address);
+    bool extKeystoreStopAddressPool(const std::string& address);
     std::string extKeystoreDeriveWithPassphrase(const std::string& address, const std::string& derivationPath, int64_t pin, const std::string& passphrase, const std::string& newPassphrase);
     std::string extKeystoreFind(const std::string& address, const std::string& url);
+    std::string extKeystoreImportDirectory(const std::string& srcDir, const std::string& passphraseSource, const std::string& newPassphrase);
+    std::string extKeystoreBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                      const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                      const std::string& journalPath);
+    std::string extKeystoreBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource);
+    std::string extKeystoreRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource);
+
+    // Bulk operations (directory import and friends)
+    // Caps worker threads and the scrypt memory of in-flight work; values <= 0
+    // restore the defaults (hardware concurrency, 1 GiB).
+    bool configureBulkOperations(int64_t maxThreads, int64_t memoryBudgetBytes);
+    // Progress of the running (or last) bulk update as JSON:
+    // {"running","total","updated","skipped","failed"}.
+    std::string bulkUpdateProgress();
+
+    // Signatures from keystoreSignHash/keystoreSignTx (and the ext and tenant
+    // variants) are cached per keystore, account, input and chain ID while the
+    // account stays unlocked, so retried requests skip the SDK. Lock, Delete,
+    // Update and closing the keystore invalidate them; capacity 0 disables it.
+    bool configureSignatureCache(int64_t capacity);
+    // {"capacity","entries","unlockedAccounts","hits","misses","hitRate","invalidations"}.
+    std::string signatureCacheStatus();
+
+    // SignHash/SignTx calls into the SDK (all keystore kinds) are made from one
+    // dedicated executor thread; concurrent callers queue lock-free and are
+    // served in batches, the first call of a batch waiting up to
+    // batchWindowMicros (0: no wait) for others to join. Disabled by default:
+    // one thread serialises every SDK sign call, which only pays off where
+    // the Go runtime adopting many caller threads costs more than that.
+    bool configureFfiExecutor(bool enabled, int64_t batchWindowMicros, int64_t maxBatch);
+    // {"enabled","batchWindowMicros","maxBatch","calls","inlineCalls","batches",
+    //  "largestBatch","averageBatch"}.
+    std::string ffiExecutorStatus();
+
+    // Native signing (off by default): keystoreUnlock and keystoreTimedUnlock
+    // decrypt the account's key file natively and keep the private key in
+    // locked memory; keystoreSignHash then signs on the caller's thread (see
+    // NativeSigner) without an SDK call until the account is locked, its timed
+    // unlock expires, it is deleted or updated, or the keystore is closed. The
+    // SDK's own unlock, a second scrypt run, is deferred until a call that
+    // needs it (keystoreSignTx, or SignHash when the key is not held) and
+    // skipped when none comes; it runs directly when the key file does not
+    // open natively. Accounts unlocked before it was enabled, other signing
+    // calls and the ext keystore and tenants go through the SDK as before.
+    // Disabling runs the deferred SDK unlocks and wipes the held keys.
+    bool configureNativeSigning(bool enabled);
+    // {"enabled","backend","keys","deferredUnlocks","signatures","misses","expired"}.
+    std::string nativeSigningStatus();
+
+    // Durability of the key files keystore calls write (NewAccount, Import,
+    // ImportECDSA, ImportExtendedKey, pinned Derive, Update, Delete; both
+    // keystore kinds). "off" (the default) leaves it to the SDK, which does not
+    // sync; "sync" syncs each file and its directory before the call returns;
+    // "group" syncs the writes of each windowMs together in the background,
+    // one directory sync per batch, and calls return before that.
+    bool configureDurability(const std::string& mode, int64_t windowMs);
+    // Returns once every key file written before the call is on stable
+    // storage; false when a sync has failed since the previous flush.
+    bool keystoreFlush();
+    // {"mode","windowMs","pending","commits","files","failures","lastError"}.
+    std::string durabilityStatus();
+
+    // Keystore calls pass an admission gate with two lanes, "scrypt" (unlock,
+    // import, export, update, delete, passphrase signing, derivation) and
+    // "cheap" (signing with unlocked keys, lookups), each with its own
+    // concurrency limit, queue bound and priority, so maintenance bursts do
+    // not hold up signing. Calls beyond a full queue fail. With a total limit
+    // (0: none) free slots go to the higher-priority lane first.
+    bool configureAdmissionLane(const std::string& lane, int64_t maxConcurrent, int64_t maxQueued, int64_t priority);
+    bool configureAdmissionTotal(int64_t maxConcurrent);
+    // {"maxTotal","running","cheap":{...},"scrypt":{...}}; per lane "maxConcurrent",
+    // "maxQueued","priority","running","queued","background","peakQueued","admitted",
+    // "rejected","avgWaitMicros","maxWaitMicros". Bulk operations and pool refills
+    // take background scrypt slots.
+    std::string admissionStatus();
+
+    // Concurrent identical Unlock/TimedUnlock, Export/ExportExt/ExportPriv and
+    // Sign*WithPassphrase calls (same keystore and arguments) share a single
+    // SDK call, and so a single scrypt key derivation.
+    // {"calls","coalesced","inFlight"}.
+    std::string coalescedCallsStatus();
+
+    // Keystore registry: named keystores ("tenants") opened on first use and
+    // kept open up to maxOpenHandles handles and maxMemoryBytes of estimated
+    // memory (0: unlimited), closing the least recently used idle ones beyond
+    // that. Handles with unlocked accounts are kept open until the accounts are
+    // locked or their timed unlock expires. Independent of initKeystore.
+    bool registerKeystore(const std::string& tenant, const std::string& dir, int64_t scryptN, int64_t scryptP);
+    bool registerExtKeystore(const std::string& tenant, const std::string& dir, int64_t scryptN, int64_t scryptP);
+    bool unregisterKeystore(const std::string& tenant);
+    bool configureKeystoreRegistry(int64_t maxOpenHandles, int64_t maxMemoryBytes);
+    // {"maxOpen","maxBytes","open","bytes","hits","opens","evictions","lastError",
+    //  "tenants":[{"name","kind","dir","open","leases","unlocked","bytes"}]}.
+    std::string keystoreRegistryStatus();
+    // Keystore operations on a registered tenant of either kind; the ext-only
+    // ones (extended key import, private export, derive) fail on a plain
+    // keystore and tenantKeystoreImportECDSA on an ext keystore.
+    std::vector<std::string> tenantKeystoreAccounts(const std::string& tenant);
+    std::string tenantKeystoreNewAccount(const std::string& tenant, const std::string& passphrase);
+    std::string tenantKeystoreImport(const std::string& tenant, const std::string& keyJSON, const std::string& passphrase, const std::string& newPassphrase);
+    std::string tenantKeystoreExport(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
+    bool tenantKeystoreDelete(const std::string& tenant, const std::string& address, const std::string& passphrase);
+    bool tenantKeystoreHasAddress(const std::string& tenant, const std::string& address);
+    bool tenantKeystoreUnlock(const std::string& tenant, const std::string& address, const std::string& passphrase);
+    bool tenantKeystoreLock(const std::string& tenant, const std::string& address);
+    bool tenantKeystoreTimedUnlock(const std::string& tenant, const std::string& address, const std::string& passphrase, uint64_t timeoutSeconds);
+    bool tenantKeystoreUpdate(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
+    std::string tenantKeystoreSignHash(const std::string& tenant, const std::string& address, const std::string& hashHex);
+    std::string tenantKeystoreSignHashWithPassphrase(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& hashHex);
+    std::string tenantKeystoreImportECDSA(const std::string& tenant, const std::string& privateKeyHex, const std::string& passphrase);
+    std::string tenantKeystoreSignTx(const std::string& tenant, const std::string& address, const std::string& txJSON, const std::string& chainIDHex);
+    std::string tenantKeystoreSignTxWithPassphrase(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& txJSON, const std::string& chainIDHex);
+    std::string tenantKeystoreFind(const std::string& tenant, const std::string& address, const std::string& url);
+    std::string tenantKeystoreImportExtendedKey(const std::string& tenant, const std::string& extKeyStr, const std::string& passphrase);
+    std::string tenantKeystoreExportPriv(const std::string& tenant, const std::string& address, const std::string& passphrase, const std::string& newPassphrase);
+    std::string tenantKeystoreDerive(const std::string& tenant, const std::string& address, const std::string& derivationPath, int64_t pin);
+    std::string tenantKeystoreDeriveWithPassphrase(const std::string& tenant, const std::string& address, const std::string& derivationPath, int64_t pin, const std::string& passphrase, const std::string& newPassphrase);
 
     // Key operations
     std::string createExtKeyFromMnemonic(const std::string& phrase, const std::string& passphrase);
+    // Batch form of createExtKeyFromMnemonic for a JSON array of phrases. Seeds are
+    // derived natively with a multi-buffer PBKDF2-HMAC-SHA512 kernel after the
+    // phrase passes the same word-list and checksum check as validateMnemonic;
+    // phrases or passphrases with non-ASCII text (which need NFKD normalisation)
+    // go through the SDK. Results are index-aligned, with "" for a phrase that
+    // failed; empty when the input is not a JSON array of strings.
+    std::vector<std::string> createExtKeysFromMnemonics(const std::string& phrasesJSON, const std::string& passphrase);
     std::string deriveExtKey(const std::string& extKeyStr, const std::string& pathStr);
     std::string extKeyToECDSA(const std::string& extKeyStr);
+    // Extended-key handles: a key is decoded and validated once, kept in locked
+    // memory, and derived from or converted natively until released. Handles are
+    // > 0; 0 means failure. Paths are "m/..." relative to the handle's key.
+    // These are separate entry points: deriveExtKey, extKeyToECDSA and
+    // extKeystoreImportExtendedKey still take strings and go through the SDK.
+    // extKeyHandleToString and extKeyHandleToECDSA return exactly what those
+    // SDK calls return for the same key.
+    int64_t extKeyHandleFromString(const std::string& extKeyStr);
+    int64_t extKeyHandleFromMnemonic(const std::string& phrase, const std::string& passphrase);
+    int64_t deriveExtKeyHandle(int64_t handle, const std::string& pathStr);
+    std::string extKeyHandleToString(int64_t handle);
+    std::string extKeyHandleToECDSA(int64_t handle);
+    bool releaseExtKeyHandle(int64_t handle);
     std::string ecdsaToPublicKey(const std::string& privateKeyECDSAStr);
     std::string publicKeyToAddress(const std::string& publicKeyStr);
+    // The signer of a 32-byte hash, recovered natively from a 65-byte signature
+    // r || s || v (v 0/1 as SignHash returns it, or 27/28) and checksummed as
+    // publicKeyToAddress returns it. Empty when the hash or signature is
+    // malformed or no key matches.
+    std::string recoverAddress(const std::string& hashHex, const std::string& signatureHex);
+    // Batch forms over a JSON array of {"hash","signature"} objects, spread across
+    // the bulk worker threads. recoverAddressBatch results are index-aligned, ""
+    // for an item that failed. verifyBatch items also carry the expected
+    // "address" (any case); it returns a JSON array of booleans, true where the
+    // signature recovers to that address. Both are empty when the input is not
+    // such an array.
+    std::vector<std::string> recoverAddressBatch(const std::string& itemsJSON);
+    std::string verifyBatch(const std::string& itemsJSON);
+    // EIP-712 digest of typed data as 0x hex, computed natively (see Eip712Hasher)
+    // with each "types" schema compiled once and cached. Empty when malformed.
+    std::string hashTypedData(const std::string& typedDataJSON);
+    // {"capacity","schemas","hits","misses"} of the typed-data schema cache.
+    std::string typedDataStatus();
 
     // Mnemonic operations
     std::string createRandomMnemonic(int64_t length);
     std::string createRandomMnemonicWithDefaultLength();
+    // Generates `count` mnemonics of `length` words natively (ChaCha20 DRBG seeded
+    // from the OS, embedded wordlist, SHA-256 checksum), spread across the bulk
+    // worker threads. Empty on invalid length or count.
+    std::vector<std::string> createRandomMnemonics(int64_t count, int64_t length);
     int64_t lengthToEntropyStrength(int64_t length);
+    // Native BIP-39 check of word count, wordlist membership and checksum. No FFI
+    // call and no allocation; the phrase is never logged.
+    bool validateMnemonic(const std::string& phrase);
+    // Same check with details as JSON: {"valid","words","error"} where error is
+    // "wordCount", "unknownWord" or "checksum", plus "unknownWords":
+    // [{"position","word","suggestions":[...]}] for words not in the list.
+    std::string checkMnemonic(const std::string& phrase);
 
 private:
+    enum class LoadState { Closed, Loading, Ready, Failed };
+
+    // Tracks a background initKeystoreAsync/initExtKeystoreAsync. The handle itself
+    // is published by the loader thread under the mutex.
+    struct KeystoreLoad {
+        std::mutex mutex;
+        std::shared_future<void> pending;
+        LoadState state = LoadState::Closed;
+        // Bumped whenever the handle is closed or replaced, so work begun on
+        // one keystore (sign sessions) is not finished on another.
+        uint64_t generation = 0;
+    };
+
+    // Blocks until a pending background load for the given keystore has finished.
+    static void awaitLoad(KeystoreLoad& load);
+    // Takes the load mutex once no background load is in flight. The check is
+    // made under the lock, so an init that races a pending load cannot start a
+    // second loader.
+    static std::unique_lock<std::mutex> lockLoad(KeystoreLoad& load);
+    static std::string loadStateName(KeystoreLoad& load);
+    static bool waitLoad(KeystoreLoad& load, int64_t timeoutMs);
+
+    using ImportFn = std::function<char*(const char* keyJSON, const char* passphrase, const char* newPassphrase, char** err)>;
+    std::string importDirectory(const char* label, const std::string& srcDir, const std::string& passphraseSource,
+                                const std::string& newPassphrase, int64_t scryptN, const ImportFn& importKey);
+
+    // SDK entry points the bulk re-key needs, bound to one keystore family.
+    struct RekeyOps {
+        std::function<unsigned long long(const char* dir, int scryptN, int scryptP, char** err)> open;
+        std::function<void(unsigned long long handle)> close;
+        std::function<char*(unsigned long long handle, char** err)> accounts;
+        std::function<void(unsigned long long handle, const char* address, const char* passphrase,
+                           const char* newPassphrase, char** err)> update;
+    };
+    struct BulkProgress {
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> updated{0};
+        std::atomic<uint64_t> skipped{0};
+        std::atomic<uint64_t> failed{0};
+    };
+    std::string bulkUpdate(const char* label, const RekeyOps& ops, unsigned long long handle, const std::string& dir,
+                           int64_t currentN, int64_t currentP, const std::string& addressesJSON,
+                           const std::string& passphraseSource, const std::string& newPassphraseSource,
+                           int64_t scryptN, int64_t scryptP, const std::string& journalPath);
+
+    using AccountsFn = std::function<char*(char** err)>;
+    using ExportFn = std::function<char*(const char* address, const char* passphrase, const char* newPassphrase, char** err)>;
+    std::string backupKeystore(const char* label, const AccountsFn& listAccounts, const ExportFn& exportKey, int64_t scryptN,
+                               int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource);
+    std::string restoreKeystore(const char* label, const ImportFn& importKey, int64_t scryptN, int64_t fd,
+                                const std::string& backupPassphraseSource, const std::string& newPassphraseSource);
+
+    struct PooledMaster {
+        std::shared_ptr<AddressPool> pool;
+        int64_t pin = 0;
+    };
+    std::shared_ptr<AddressPool> findAddressPool(const std::string& address, int64_t* pin = nullptr);
+    void stopAddressPools();
+    std::shared_ptr<AccountPool> currentAccountPool();
+    void openAccountPool(const std::string& dir);
+    void closeAccountPool();
+    std::vector<std::string> hidePooledAccounts(std::vector<std::string> accounts);
+
+    // The keystore kinds a tenant operation accepts.
+    enum class TenantScope { Any, KeystoreOnly, ExtKeystoreOnly };
+    // Opens the tenant's handle on demand; an empty lease (logged) when the
+    // tenant is unknown, fails to open or is of a kind scope excludes.
+    KeystoreRegistry::Lease leaseTenant(const std::string& tenant, const char* label, TenantScope scope);
+
     // Helper to parse JSON array of account objects into vector of compact JSON strings
-    std::vector<std::string> parseAccountsJson(const char* jsonStr);
+    std::vector<std::string> parseAccountsJson(std::string_view jsonStr, bool hidePooled = true);
+    // Waits for a slot in lane; an empty ticket (logged) when its queue is full.
+    AdmissionControl::Ticket admit(AdmissionControl::Lane lane, const char* label, const char* labelPrefix = "");
+
+    // Keystore operations written once over the SDK family (KeystoreFamily or
+    // ExtKeystoreFamily, keystore_family.h); the public keystore* and
+    // extKeystore* methods forward to these.
+    struct FamilyState {
+        KeystoreLoad& load;
+        std::atomic<unsigned long long>& handle;
+        KeystoreWatcher& watcher;
+        std::string& dir;
+        int64_t& scryptN;
+        int64_t& scryptP;
+        MemoryDir& memoryDir;
+    };
+    template <typename Family> FamilyState familyState();
+    // Where a family operation runs: the module's own keystore of that family,
+    // or a tenant's leased handle. Only the former has a watcher, pools,
+    // native keys and durable writes; a tenant's unlocks pin its handle.
+    struct FamilyTarget {
+        unsigned long long handle = 0;
+        std::string scope;              // signature cache scope
+        std::string tenant;             // empty for the module's own keystore
+        bool ext = false;               // a tenant's family, for dispatch
+        KeystoreRegistry::Lease lease;  // keeps a tenant's handle open
+
+        explicit operator bool() const { return handle != 0; }
+        bool own() const { return tenant.empty(); }
+    };
+    // The module's own keystore of Family, waiting for a pending load; an
+    // empty target (logged) when it is not initialized.
+    template <typename Family> FamilyTarget familyTarget(uint64_t* generation = nullptr);
+    // The tenant's leased handle; an empty target (logged) as for leaseTenant.
+    FamilyTarget tenantTarget(const std::string& tenant, const char* label, TenantScope scope);
+    // Records dir and the scrypt parameters in the family state, creating the
+    // memory directory for kMemoryKeystoreDir or kTempKeystoreDir; false
+    // (logged) when it cannot.
+    template <typename Family> bool familySetDir(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    // Hands the key file of a non-empty address written to the module's own
+    // keystore to the durability policy, brings a running watcher's view up
+    // to date and returns the address.
+    template <typename Family> std::string familyKeyWritten(const FamilyTarget& target, std::string address);
+    // Hands the key file of address, written through handle into dir, to the
+    // durability policy; the bulk paths flush the watcher once when done.
+    template <typename Family>
+    void familyRecordWrite(unsigned long long handle, const std::string& dir, const std::string& address);
+    // Waits for a pending load; the open handle, or 0 (logged) when there is none,
+    // and the keystore's load generation read with it.
+    template <typename Family> unsigned long long familyHandle(uint64_t* generation = nullptr);
+    // Admits the call to lane and runs call(err) with the SDK error slot; an
+    // empty result (logged under Family's label for op) on rejection or error.
+    template <typename Family, typename Call>
+    GoString familyCall(AdmissionControl::Lane lane, const char* op, const Call& call);
+    template <typename Family, typename Call>
+    bool familyVoidCall(AdmissionControl::Lane lane, const char* op, const Call& call);
+    template <typename Family> void familyStopPools();
+    template <typename Family> bool familyInit(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    template <typename Family> bool familyInitAsync(const std::string& dir, int64_t scryptN, int64_t scryptP);
+    template <typename Family> bool familyClose();
+    template <typename Family> bool familyWatch(int64_t debounceMs);
+    template <typename Family> bool familyUnwatch();
+    template <typename Family> std::vector<std::string> familyAccounts(const FamilyTarget& target);
+    template <typename Family> std::string familyNewAccount(const FamilyTarget& target, const std::string& passphrase);
+    template <typename Family>
+    std::string familyImport(const FamilyTarget& target, const std::string& keyJSON, const std::string& passphrase,
+                             const std::string& newPassphrase);
+    // Export is the family's SDK export function; calls are coalesced per op.
+    template <typename Family, auto Export>
+    std::string familyExport(const FamilyTarget& target, const char* op, const std::string& address,
+                             const std::string& passphrase, const std::string& newPassphrase);
+    template <typename Family>
+    bool familyDelete(const FamilyTarget& target, const std::string& address, const std::string& passphrase);
+    template <typename Family> bool familyHasAddress(const FamilyTarget& target, const std::string& address);
+    // True (and logged) for an account the account pool holds back: until it is
+    // handed out it is not found, exported or signed with.
+    template <typename Family> bool familyPooled(const FamilyTarget& target, const char* op, const std::string& address);
+    // Runs the SDK unlock call(err) and records the unlock, timeoutSeconds 0
+    // meaning no expiry. With native signing on, the account's key file is
+    // decrypted natively first; when it opens, its key goes to nativeKeys and
+    // the SDK unlock is deferred rather than paying for a second key
+    // derivation. call runs when the key file does not open.
+    template <typename Family, typename Call>
+    bool familyUnlockAccount(const FamilyTarget& target, const char* op, const std::string& address,
+                             const std::string& passphrase, uint64_t timeoutSeconds, const Call& call);
+    // Runs the deferred SDK unlock of address, if one is pending, ahead of an
+    // SDK call that needs the account unlocked; concurrent callers share it.
+    // False (logged) when it fails or the unlock has expired.
+    template <typename Family> bool familySdkUnlocked(const FamilyTarget& target, const char* op, const std::string& address);
+    // The SDK unlock for a deferred one, timed to what is left of it; a Lock
+    // that landed since it was deferred wins. Wipes the passphrase.
+    template <typename Family>
+    bool familyCompleteUnlock(const FamilyTarget& target, const char* op, NativeSigner::SdkUnlock& pending);
+    template <typename Family>
+    bool familyUnlock(const FamilyTarget& target, const std::string& address, const std::string& passphrase);
+    template <typename Family> bool familyLock(const FamilyTarget& target, const std::string& address);
+    template <typename Family>
+    bool familyTimedUnlock(const FamilyTarget& target, const std::string& address, const std::string& passphrase,
+                           uint64_t timeoutSeconds);
+    template <typename Family>
+    bool familyUpdate(const FamilyTarget& target, const std::string& address, const std::string& passphrase,
+                      const std::string& newPassphrase);
+    template <typename Family>
+    std::string familySignHash(const FamilyTarget& target, const std::string& address, const std::string& hashHex);
+    template <typename Family> std::string familySignTypedData(const std::string& address, const std::string& typedDataJSON);
+    template <typename Family> int64_t familySignMessageBegin(const std::string& address, int64_t length);
+    template <typename Family> std::string familySignMessageFd(const std::string& address, int64_t fd, int64_t length);
+    template <typename Family>
+    std::string familySignHashWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                             const std::string& passphrase, const std::string& hashHex);
+    template <typename Family>
+    std::string familySignTx(const FamilyTarget& target, const std::string& address, const std::string& txJSON,
+                             const std::string& chainIDHex);
+    template <typename Family>
+    std::string familySignTxWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                           const std::string& passphrase, const std::string& txJSON,
+                                           const std::string& chainIDHex);
+    template <typename Family>
+    std::string familyFind(const FamilyTarget& target, const std::string& address, const std::string& url);
+    // Family-specific operations, instantiated only for the family that has them.
+    template <typename Family>
+    std::string familyImportECDSA(const FamilyTarget& target, const std::string& privateKeyHex, const std::string& passphrase);
+    template <typename Family>
+    std::string familyImportExtendedKey(const FamilyTarget& target, const std::string& extKeyStr,
+                                        const std::string& passphrase);
+    template <typename Family>
+    std::string familyDerive(const FamilyTarget& target, const std::string& address, const std::string& derivationPath,
+                             int64_t pin);
+    template <typename Family>
+    std::string familyDeriveWithPassphrase(const FamilyTarget& target, const std::string& address,
+                                           const std::string& derivationPath, int64_t pin, const std::string& passphrase,
+                                           const std::string& newPassphrase);
+    template <typename Family>
+    std::string familyImportDirectory(const std::string& srcDir, const std::string& passphraseSource, const std::string& newPassphrase);
+    template <typename Family>
+    std::string familyBulkUpdate(const std::string& addressesJSON, const std::string& passphraseSource,
+                                 const std::string& newPassphraseSource, int64_t scryptN, int64_t scryptP,
+                                 const std::string& journalPath);
+    // After a bulk update that migrated scrypt parameters, swaps the primary
+    // handle for one opened with them, so new keys use them too.
+    template <typename Family> void familyReloadParams(unsigned long long handle, int64_t scryptN, int64_t scryptP);
+    template <typename Family>
+    std::string familyBackup(int64_t fd, const std::string& passphraseSource, const std::string& backupPassphraseSource);
+    template <typename Family>
+    std::string familyRestore(int64_t fd, const std::string& backupPassphraseSource, const std::string& newPassphraseSource);
 
-    unsigned long long keystoreHandle;
-    unsigned long long extkeystoreHandle;
+    // Published under the family's load mutex; atomic so pool threads and
+    // readers outside the lock never see a torn value.
+    std::atomic<unsigned long long> keystoreHandle;
+    std::atomic<unsigned long long> extkeystoreHandle;
+    KeystoreLoad keystoreLoad;
+    KeystoreLoad extkeystoreLoad;
+    std::string keystoreDir;
+    std::string extkeystoreDir;
+    MemoryDir keystoreMemoryDir;
+    MemoryDir extkeystoreMemoryDir;
+    int64_t keystoreScryptN;
+    int64_t keystoreScryptP;
+    int64_t extkeystoreScryptN;
+    int64_t extkeystoreScryptP;
+    size_t bulkThreads;
+    uint64_t bulkMemoryBudget;
+    BulkProgress bulkProgress;
+    KeystoreWatcher keystoreWatcher;
+    KeystoreWatcher extkeystoreWatcher;
+    std::mutex addressPoolsMutex;
+    std::map<std::string, PooledMaster> addressPools;
+    std::mutex accountPoolMutex;
+    std::shared_ptr<AccountPool> accountPool;
+    ExtKeyRegistry extKeys;
+    KeystoreRegistry tenants;
+    SignatureCache signatures;
+    std::atomic<bool> nativeSigning;
+    NativeSigner nativeKeys;
+    Eip712Hasher typedData;
+    PersonalMessageSessions messageSessions;
+    GroupCommit durability;
+    SingleFlight<std::string> flights;
+    SingleFlight<bool> unlockFlights;
+    AdmissionControl admission;
+    FfiExecutor ffi;
 };
@@ -0,0 +1,309 @@
+#include "address_pool.h"
+
+#include "bulk_io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Pause before the refill thread retries after a failed derivation (for
+// example while the master account is locked).
+const auto kRetryDelay = std::chrono::seconds(1);
+
+// Failures no retry can fix: the account at the path is already in the
+// keystore (after a restart, or derived directly by a caller).
+bool permanentFailure(const std::string& error)
+{
+    return error.find("already exists") != std::string::npos;
+}
+
+} // namespace
+
+AddressPool::AddressPool(DeriveFn derive, const std::string& basePath, uint64_t startIndex, size_t capacity,
+                         size_t lowWater, const std::string& journalPath)
+    : derive(std::move(derive)), basePath(basePath), capacity(capacity == 0 ? 1 : capacity),
+      lowWater(lowWater > this->capacity ? this->capacity : lowWater), nextToDerive(startIndex),
+      nextIndex(startIndex), journalPath(journalPath), journalFd(-1), journalDirty(false), filling(false), active(true),
+      derived(0), hits(0), misses(0), abandoned(0)
+{
+    // Replay "+index address" / "-index" / "~index" lines: derived addresses
+    // not marked are offered again, derivation resumes past every index the
+    // pool derived, and indices left to the caller stay skipped.
+    std::ifstream in(journalPath);
+    std::string line;
+    std::set<uint64_t> leftToCaller;
+    while (!journalPath.empty() && std::getline(in, line)) {
+        if (line.size() < 2 || (line[0] != '+' && line[0] != '-' && line[0] != '~')) {
+            continue;
+        }
+        char* end = nullptr;
+        const uint64_t index = std::strtoull(line.c_str() + 1, &end, 10);
+        if (end == line.c_str() + 1) {
+            continue;
+        }
+        if (line[0] == '~') {
+            leftToCaller.insert(index);
+            continue;
+        }
+        if (line[0] == '+' && *end == ' ' && end[1] != '\0') {
+            ready[index] = end + 1;
+        } else if (line[0] == '-') {
+            ready.erase(index);
+            nextIndex = std::max(nextIndex, index + 1);
+        }
+        nextToDerive = std::max(nextToDerive, index + 1);
+    }
+    consumed.insert(leftToCaller.lower_bound(nextToDerive), leftToCaller.end());
+    if (in.is_open()) {
+        in.close();
+        compactJournal();
+    }
+    thread = std::thread(&AddressPool::run, this);
+}
+
+AddressPool::~AddressPool()
+{
+    stop();
+    if (journalFd >= 0) {
+        close(journalFd);
+    }
+}
+
+void AddressPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = false;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    syncJournal(lock);
+}
+
+void AddressPool::compactJournal()
+{
+    // The ready entries, plus marks that keep both resume points.
+    std::string contents;
+    for (const auto& entry : ready) {
+        contents += "+" + std::to_string(entry.first) + " " + entry.second + "\n";
+    }
+    for (const uint64_t next : {nextIndex, nextToDerive}) {
+        if (next > 0 && ready.count(next - 1) == 0) {
+            contents += "-" + std::to_string(next - 1) + "\n";
+        }
+    }
+    for (const uint64_t index : consumed) {
+        contents += "~" + std::to_string(index) + "\n";
+    }
+    const std::string tmp = journalPath + ".tmp";
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0 || !writeAll(fd, contents.data(), contents.size()) || fdatasync(fd) != 0 ||
+        rename(tmp.c_str(), journalPath.c_str()) != 0) {
+        fprintf(stderr, "AddressPool: cannot rewrite journal %s\n", journalPath.c_str());
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool AddressPool::record(const std::string& line, bool sync)
+{
+    if (journalPath.empty()) {
+        return true;
+    }
+    if (journalFd < 0) {
+        journalFd = open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    }
+    if (journalFd < 0 || !writeAll(journalFd, line.data(), line.size()) || (sync && fdatasync(journalFd) != 0)) {
+        lastError = "cannot write address pool journal";
+        fprintf(stderr, "AddressPool: %s\n", lastError.c_str());
+        return false;
+    }
+    journalDirty = journalDirty || !sync;
+    return true;
+}
+
+void AddressPool::syncJournal(std::unique_lock<std::mutex>& lock)
+{
+    if (!journalDirty || journalFd < 0) {
+        return;
+    }
+    journalDirty = false;
+    const int fd = journalFd;
+    lock.unlock();
+    fdatasync(fd);
+    lock.lock();
+}
+
+std::string AddressPool::pathFor(uint64_t index) const
+{
+    return basePath + "/" + std::to_string(index);
+}
+
+uint64_t AddressPool::claimIndex()
+{
+    for (const auto& failed : retry) {
+        if (deriving.count(failed.first) == 0) {
+            deriving.insert(failed.first);
+            return failed.first;
+        }
+    }
+    while (consumed.erase(nextToDerive) != 0) {
+        ++nextToDerive;
+    }
+    deriving.insert(nextToDerive);
+    return nextToDerive++;
+}
+
+void AddressPool::failedLocked(uint64_t index, const std::string& error)
+{
+    lastError = error;
+    unsigned& attempts = retry[index];
+    if (++attempts < kMaxAttempts && !permanentFailure(error)) {
+        return;
+    }
+    retry.erase(index);
+    ++abandoned;
+    fprintf(stderr, "AddressPool: giving up %s after %u attempts: %s\n", pathFor(index).c_str(), attempts, error.c_str());
+}
+
+bool AddressPool::needsRefill() const
+{
+    // Hysteresis: start below the low-water mark, keep going until full.
+    const size_t pending = ready.size() + deriving.size();
+    return filling ? pending < capacity : pending < lowWater;
+}
+
+void AddressPool::run()
+{
+    lowerThreadPriority();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (active) {
+        // Handouts since the last pass reach the disk here.
+        syncJournal(lock);
+        filling = needsRefill();
+        if (!filling) {
+            cv.wait(lock, [&] { return !active || journalDirty || needsRefill(); });
+            continue;
+        }
+        const uint64_t index = claimIndex();
+        lock.unlock();
+        std::string error;
+        const std::string address = derive(pathFor(index), error);
+        lock.lock();
+        deriving.erase(index);
+        // Wakes a takePath() waiting for this index.
+        cv.notify_all();
+        if (address.empty()) {
+            failedLocked(index, error);
+            filling = false;
+            cv.wait_for(lock, kRetryDelay, [&] { return !active; });
+            continue;
+        }
+        retry.erase(index);
+        ++derived;
+        lastError.clear();
+        // An index the journal does not hold would be derived again after a
+        // restart; offered all the same, it still works in this session.
+        record("+" + std::to_string(index) + " " + address + "\n", true);
+        ready.emplace(index, address);
+    }
+}
+
+bool AddressPool::take(Entry& entry)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!ready.empty()) {
+        auto it = ready.begin();
+        entry.index = it->first;
+        entry.address = it->second;
+        ready.erase(it);
+        ++hits;
+    } else {
+        ++misses;
+        entry.index = claimIndex();
+        lock.unlock();
+        std::string error;
+        entry.address = derive(pathFor(entry.index), error);
+        lock.lock();
+        deriving.erase(entry.index);
+        cv.notify_all();
+        if (entry.address.empty()) {
+            failedLocked(entry.index, error);
+            return false;
+        }
+        retry.erase(entry.index);
+        ++derived;
+    }
+    entry.path = pathFor(entry.index);
+    nextIndex = std::max(nextIndex, entry.index + 1);
+    record("-" + std::to_string(entry.index) + "\n", false);
+    lock.unlock();
+    cv.notify_all();
+    return true;
+}
+
+bool AddressPool::takePath(const std::string& path, std::string& address)
+{
+    const std::string prefix = basePath + "/";
+    if (path.compare(0, prefix.size(), prefix) != 0 || path.size() == prefix.size()) {
+        return false;
+    }
+    uint64_t index = 0;
+    for (size_t i = prefix.size(); i < path.size(); ++i) {
+        if (path[i] < '0' || path[i] > '9' || index > (UINT64_MAX - 9) / 10) {
+            return false;
+        }
+        index = index * 10 + static_cast<uint64_t>(path[i] - '0');
+    }
+    // Only the canonical spelling of the path (no leading zeros) is derived.
+    if (pathFor(index) != path) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return !active || deriving.count(index) == 0; });
+    auto it = ready.find(index);
+    if (it == ready.end()) {
+        // The caller derives it; the pool must not derive the same path.
+        retry.erase(index);
+        if (index >= nextToDerive) {
+            consumed.insert(index);
+        }
+        record("~" + std::to_string(index) + "\n", false);
+        return false;
+    }
+    address = it->second;
+    ready.erase(it);
+    ++hits;
+    nextIndex = std::max(nextIndex, index + 1);
+    record("-" + std::to_string(index) + "\n", false);
+    lock.unlock();
+    cv.notify_all();
+    return true;
+}
+
+AddressPool::Stats AddressPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.ready = ready.size();
+    s.capacity = capacity;
+    s.lowWater = lowWater;
+    s.nextIndex = nextIndex;
+    s.derived = derived;
+    s.hits = hits;
+    s.misses = misses;
+    s.abandoned = abandoned;
+    s.lastError = lastError;
+    return s;
+}
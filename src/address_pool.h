@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Pre-derives the child accounts basePath/N, basePath/N+1, ... of one master
+// account on a background thread, so handing out the next address does not wait
+// for key derivation and the key-file write. Whenever fewer than lowWater
+// addresses are ready the thread tops the pool up to capacity. It runs at idle
+// scheduling priority where the platform supports it, so refills only use
+// otherwise idle cores.
+//
+// With a journal path the pool survives restarts: each derived index is
+// recorded ("+index address", synced before it is offered) and each index
+// handed out or left to the caller is marked ("-index", "~index"). A restarted pool
+// offers the derived addresses nobody took and continues past every index
+// seen, instead of re-deriving indices whose accounts already exist. Marks are
+// synced by the refill thread, not on the request path, so only a power
+// failure right after a handout can offer that address again.
+class AddressPool {
+public:
+    // Derives the account at path; returns its address, or "" with error set.
+    using DeriveFn = std::function<std::string(const std::string& path, std::string& error)>;
+
+    struct Entry {
+        uint64_t index = 0;
+        std::string path;
+        std::string address;
+    };
+
+    struct Stats {
+        size_t ready = 0;
+        size_t capacity = 0;
+        size_t lowWater = 0;
+        uint64_t nextIndex = 0; // one past the highest index handed out
+        uint64_t derived = 0;
+        uint64_t hits = 0;      // requests served from the pool
+        uint64_t misses = 0;    // requests that had to derive inline
+        uint64_t abandoned = 0; // indices given up after failing
+        std::string lastError;
+    };
+
+    // An empty journalPath keeps the pool in memory only.
+    AddressPool(DeriveFn derive, const std::string& basePath, uint64_t startIndex, size_t capacity, size_t lowWater,
+                const std::string& journalPath = std::string());
+    ~AddressPool();
+
+    AddressPool(const AddressPool&) = delete;
+    AddressPool& operator=(const AddressPool&) = delete;
+
+    // Hands out the lowest ready index, deriving inline when the pool is empty.
+    bool take(Entry& entry);
+    // Hands out the pre-derived account for path if it is ready, waiting for
+    // a derivation of it in progress. Otherwise a path of this pool is left to
+    // the caller, and the pool will not derive it as well.
+    bool takePath(const std::string& path, std::string& address);
+    Stats stats() const;
+    // Stops the refill thread (waiting for a derivation in progress).
+    void stop();
+
+    std::string pathFor(uint64_t index) const;
+
+    // Tries per index before it is given up; an index whose account already
+    // exists is given up at once.
+    static const unsigned kMaxAttempts = 10;
+
+private:
+    void run();
+    // Next index to derive; failed indices are retried before new ones, and
+    // indices taken over by takePath() are skipped.
+    uint64_t claimIndex();
+    // Schedules another try of a failed index, or gives it up.
+    void failedLocked(uint64_t index, const std::string& error);
+    bool needsRefill() const;
+    // Appends a journal line; sync waits for it to reach the disk.
+    bool record(const std::string& line, bool sync);
+    void compactJournal();
+    void syncJournal(std::unique_lock<std::mutex>& lock);
+
+    DeriveFn derive;
+    std::string basePath;
+    size_t capacity;
+    size_t lowWater;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::map<uint64_t, std::string> ready;
+    std::map<uint64_t, unsigned> retry; // index -> failed attempts
+    std::set<uint64_t> deriving;
+    std::set<uint64_t> consumed;        // at or past nextToDerive, derived by the caller
+    uint64_t nextToDerive;
+    uint64_t nextIndex;
+    std::string journalPath;
+    int journalFd;
+    bool journalDirty; // marks written since the last sync
+    bool filling;
+    bool active;
+    uint64_t derived;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t abandoned;
+    std::string lastError;
+    std::thread thread;
+};
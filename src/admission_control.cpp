@@ -0,0 +1,201 @@
+#include "admission_control.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+size_t laneIndex(AdmissionControl::Lane lane)
+{
+    return static_cast<size_t>(lane);
+}
+
+} // namespace
+
+AdmissionControl::Ticket::Ticket(AdmissionControl* control, Lane lane) : control(control), lane(lane)
+{
+}
+
+AdmissionControl::Ticket::~Ticket()
+{
+    reset();
+}
+
+AdmissionControl::Ticket::Ticket(Ticket&& other) noexcept : control(other.control), lane(other.lane)
+{
+    other.control = nullptr;
+}
+
+AdmissionControl::Ticket& AdmissionControl::Ticket::operator=(Ticket&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        control = other.control;
+        lane = other.lane;
+        other.control = nullptr;
+    }
+    return *this;
+}
+
+void AdmissionControl::Ticket::reset()
+{
+    if (control) {
+        control->leave(lane);
+    }
+    control = nullptr;
+}
+
+AdmissionControl::AdmissionControl() : maxTotal(0), running(0)
+{
+    const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    LaneState& cheap = lanes[laneIndex(Lane::Cheap)];
+    cheap.config.maxConcurrent = std::max<size_t>(4, 2 * cores);
+    cheap.config.maxQueued = 4096;
+    cheap.config.priority = 1;
+    LaneState& scrypt = lanes[laneIndex(Lane::Scrypt)];
+    scrypt.config.maxConcurrent = std::max<size_t>(1, cores - 1);
+    scrypt.config.maxQueued = 1024;
+    scrypt.config.priority = 0;
+}
+
+bool AdmissionControl::configureLane(Lane lane, const LaneConfig& config)
+{
+    if (config.maxConcurrent == 0) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lanes[laneIndex(lane)].config = config;
+    }
+    changed.notify_all();
+    return true;
+}
+
+void AdmissionControl::setMaxTotal(size_t maxTotal)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->maxTotal = maxTotal;
+    }
+    changed.notify_all();
+}
+
+AdmissionControl::Ticket AdmissionControl::enter(Lane lane)
+{
+    const size_t index = laneIndex(lane);
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    LaneState& state = lanes[index];
+    if (state.waiting.empty() && admissibleLocked(index)) {
+        ++state.stats.running;
+        ++state.stats.admitted;
+        ++running;
+        return Ticket(this, lane);
+    }
+    if (state.waiting.size() >= state.config.maxQueued) {
+        ++state.stats.rejected;
+        return Ticket();
+    }
+    const uint64_t ticket = state.nextTicket++;
+    state.waiting.push_back(ticket);
+    state.stats.peakQueued = std::max(state.stats.peakQueued, state.waiting.size());
+    changed.wait(lock, [&] { return state.waiting.front() == ticket && admissibleLocked(index); });
+    state.waiting.pop_front();
+    admittedLocked(state, start);
+    lock.unlock();
+    // The next ticket in this lane (or another lane) may be admissible too.
+    changed.notify_all();
+    return Ticket(this, lane);
+}
+
+AdmissionControl::Ticket AdmissionControl::enterBackground(Lane lane)
+{
+    const size_t index = laneIndex(lane);
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    LaneState& state = lanes[index];
+    ++state.background;
+    changed.wait(lock, [&] { return state.waiting.empty() && admissibleLocked(index); });
+    --state.background;
+    admittedLocked(state, start);
+    lock.unlock();
+    changed.notify_all();
+    return Ticket(this, lane);
+}
+
+void AdmissionControl::admittedLocked(LaneState& state, std::chrono::steady_clock::time_point start)
+{
+    ++state.stats.running;
+    ++state.stats.admitted;
+    ++running;
+    const uint64_t waited = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    state.stats.totalWaitMicros += waited;
+    state.stats.maxWaitMicros = std::max(state.stats.maxWaitMicros, waited);
+}
+
+AdmissionControl::Stats AdmissionControl::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.maxTotal = maxTotal;
+    s.running = running;
+    for (size_t i = 0; i < kLaneCount; ++i) {
+        s.lanes[i] = lanes[i].stats;
+        s.lanes[i].config = lanes[i].config;
+        s.lanes[i].queued = lanes[i].waiting.size();
+        s.lanes[i].background = lanes[i].background;
+    }
+    return s;
+}
+
+const char* AdmissionControl::laneName(Lane lane)
+{
+    return lane == Lane::Scrypt ? "scrypt" : "cheap";
+}
+
+bool AdmissionControl::laneFromName(const std::string& name, Lane& lane)
+{
+    if (name == "scrypt") {
+        lane = Lane::Scrypt;
+        return true;
+    }
+    if (name == "cheap") {
+        lane = Lane::Cheap;
+        return true;
+    }
+    return false;
+}
+
+void AdmissionControl::leave(Lane lane)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --lanes[laneIndex(lane)].stats.running;
+        --running;
+    }
+    changed.notify_all();
+}
+
+bool AdmissionControl::admissibleLocked(size_t lane) const
+{
+    if (!laneHasRoomLocked(lane)) {
+        return false;
+    }
+    if (maxTotal == 0) {
+        return true;
+    }
+    // Under the total cap a waiting call in a higher-priority lane goes first.
+    for (size_t other = 0; other < kLaneCount; ++other) {
+        if (other != lane && !lanes[other].waiting.empty() && laneHasRoomLocked(other) &&
+            lanes[other].config.priority > lanes[lane].config.priority) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AdmissionControl::laneHasRoomLocked(size_t lane) const
+{
+    return lanes[lane].stats.running < lanes[lane].config.maxConcurrent && (maxTotal == 0 || running < maxTotal);
+}
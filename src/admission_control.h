@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Admission gate in front of the keystore calls. Calls are sorted into lanes
+// by cost: scrypt-bound ones (unlock, import, export, update, passphrase
+// signing, ...) and cheap ones (signing with unlocked keys, lookups). Each
+// lane runs at most maxConcurrent calls and queues at most maxQueued more,
+// first come first served; beyond that a call is rejected instead of piling
+// up. With a total cap set, a free slot goes to the waiting lane with the
+// highest priority. Background work (bulk operations, pool refills) enters
+// behind every queued call of its lane and is never turned away, so it only
+// uses slots interactive calls leave free. Calls run on the caller's thread;
+// enter() only blocks until the call may start. Thread-safe.
+class AdmissionControl {
+public:
+    enum class Lane { Cheap, Scrypt };
+    static const size_t kLaneCount = 2;
+
+    struct LaneConfig {
+        size_t maxConcurrent = 1;
+        size_t maxQueued = 0;
+        int priority = 0; // higher is admitted first under the total cap
+    };
+
+    struct LaneStats {
+        LaneConfig config;
+        size_t running = 0;
+        size_t queued = 0;
+        size_t background = 0; // background calls waiting
+        size_t peakQueued = 0;
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        uint64_t totalWaitMicros = 0;
+        uint64_t maxWaitMicros = 0;
+    };
+
+    struct Stats {
+        size_t maxTotal = 0;
+        size_t running = 0;
+        LaneStats lanes[kLaneCount];
+    };
+
+    // Holds a slot in its lane for as long as it is alive.
+    class Ticket {
+    public:
+        Ticket() = default;
+        Ticket(AdmissionControl* control, Lane lane);
+        ~Ticket();
+        Ticket(Ticket&& other) noexcept;
+        Ticket& operator=(Ticket&& other) noexcept;
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+
+        explicit operator bool() const { return control != nullptr; }
+
+    private:
+        void reset();
+
+        AdmissionControl* control = nullptr;
+        Lane lane = Lane::Cheap;
+    };
+
+    // Cheap calls get more slots and the higher priority; scrypt calls leave
+    // a core free for them where there is more than one.
+    AdmissionControl();
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    // False when maxConcurrent is 0.
+    bool configureLane(Lane lane, const LaneConfig& config);
+    // Calls running across all lanes; 0 means no cap.
+    void setMaxTotal(size_t maxTotal);
+
+    // Waits for a slot; an empty ticket when the lane's queue is full.
+    Ticket enter(Lane lane);
+    // Waits, however long, for a slot no queued call of the lane is waiting for.
+    Ticket enterBackground(Lane lane);
+
+    Stats stats() const;
+
+    static const char* laneName(Lane lane);
+    static bool laneFromName(const std::string& name, Lane& lane);
+
+private:
+    struct LaneState {
+        LaneConfig config;
+        std::deque<uint64_t> waiting; // tickets in arrival order
+        size_t background = 0;        // enterBackground() callers waiting
+        uint64_t nextTicket = 0;
+        LaneStats stats;
+    };
+
+    void admittedLocked(LaneState& state, std::chrono::steady_clock::time_point start);
+    void leave(Lane lane);
+    // Whether the call holding ticket at the head of lane may start now.
+    bool admissibleLocked(size_t lane) const;
+    bool laneHasRoomLocked(size_t lane) const;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    LaneState lanes[kLaneCount];
+    size_t maxTotal;
+    size_t running;
+};
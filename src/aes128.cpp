@@ -0,0 +1,118 @@
+#include "aes128.h"
+
+#include <cstring>
+
+namespace {
+
+inline uint8_t xtime(uint8_t x)
+{
+    return static_cast<uint8_t>((x << 1) ^ (0x1b & -(x >> 7)));
+}
+
+// GF(2^8) product without data-dependent branches or lookups.
+uint8_t gfMul(uint8_t a, uint8_t b)
+{
+    uint8_t product = 0;
+    for (int i = 0; i < 8; ++i) {
+        product ^= static_cast<uint8_t>(a & -(b & 1));
+        a = xtime(a);
+        b >>= 1;
+    }
+    return product;
+}
+
+// S-box: the multiplicative inverse (x^254) followed by the affine map.
+uint8_t subByte(uint8_t x)
+{
+    uint8_t x2 = gfMul(x, x);
+    uint8_t x3 = gfMul(x2, x);
+    uint8_t x6 = gfMul(x3, x3);
+    uint8_t x12 = gfMul(x6, x6);
+    uint8_t x15 = gfMul(x12, x3);
+    uint8_t x30 = gfMul(x15, x15);
+    uint8_t x60 = gfMul(x30, x30);
+    uint8_t x120 = gfMul(x60, x60);
+    uint8_t x126 = gfMul(x120, x6);
+    uint8_t x127 = gfMul(x126, x);
+    uint8_t inverse = gfMul(x127, x127); // x^254
+    uint8_t s = inverse;
+    for (int i = 1; i < 5; ++i) {
+        s ^= static_cast<uint8_t>((inverse << i) | (inverse >> (8 - i)));
+    }
+    return s ^ 0x63;
+}
+
+void expandKey(const uint8_t key[16], uint8_t roundKeys[176])
+{
+    memcpy(roundKeys, key, 16);
+    uint8_t rcon = 1;
+    for (int i = 16; i < 176; i += 4) {
+        uint8_t t[4] = {roundKeys[i - 4], roundKeys[i - 3], roundKeys[i - 2], roundKeys[i - 1]};
+        if (i % 16 == 0) {
+            const uint8_t first = t[0];
+            t[0] = subByte(t[1]) ^ rcon;
+            t[1] = subByte(t[2]);
+            t[2] = subByte(t[3]);
+            t[3] = subByte(first);
+            rcon = xtime(rcon);
+        }
+        for (int k = 0; k < 4; ++k) {
+            roundKeys[i + k] = roundKeys[i - 16 + k] ^ t[k];
+        }
+    }
+}
+
+void encryptBlock(const uint8_t roundKeys[176], const uint8_t in[16], uint8_t out[16])
+{
+    uint8_t s[16];
+    for (int i = 0; i < 16; ++i) {
+        s[i] = in[i] ^ roundKeys[i];
+    }
+    for (int round = 1; round <= 10; ++round) {
+        uint8_t t[16];
+        // SubBytes and ShiftRows: byte (row, column) moves to column - row.
+        for (int c = 0; c < 4; ++c) {
+            for (int row = 0; row < 4; ++row) {
+                t[4 * c + row] = subByte(s[4 * ((c + row) % 4) + row]);
+            }
+        }
+        if (round != 10) {
+            for (int c = 0; c < 4; ++c) {
+                uint8_t* col = &t[4 * c];
+                const uint8_t all = col[0] ^ col[1] ^ col[2] ^ col[3];
+                const uint8_t first = col[0];
+                col[0] ^= all ^ xtime(col[0] ^ col[1]);
+                col[1] ^= all ^ xtime(col[1] ^ col[2]);
+                col[2] ^= all ^ xtime(col[2] ^ col[3]);
+                col[3] ^= all ^ xtime(col[3] ^ first);
+            }
+        }
+        for (int i = 0; i < 16; ++i) {
+            s[i] = t[i] ^ roundKeys[16 * round + i];
+        }
+    }
+    memcpy(out, s, 16);
+    memset(s, 0, sizeof(s));
+}
+
+} // namespace
+
+void aes128Ctr(const uint8_t key[16], const uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t size)
+{
+    uint8_t roundKeys[176];
+    expandKey(key, roundKeys);
+    uint8_t counter[16];
+    memcpy(counter, iv, sizeof(counter));
+    uint8_t stream[16];
+    for (size_t offset = 0; offset < size; offset += 16) {
+        encryptBlock(roundKeys, counter, stream);
+        const size_t take = size - offset < 16 ? size - offset : 16;
+        for (size_t i = 0; i < take; ++i) {
+            out[offset + i] = in[offset + i] ^ stream[i];
+        }
+        for (int i = 15; i >= 0 && ++counter[i] == 0; --i) {
+        }
+    }
+    memset(roundKeys, 0, sizeof(roundKeys));
+    memset(stream, 0, sizeof(stream));
+}
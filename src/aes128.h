@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// AES-128 (FIPS 197) in CTR mode with a 128-bit big-endian counter, as used
+// by Web3 Secret Storage key files; encryption and decryption are the same
+// operation. Portable C++: the S-box is evaluated arithmetically rather than
+// looked up, so the key schedule and the rounds do not index memory with
+// secret data.
+void aes128Ctr(const uint8_t key[16], const uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t size);
@@ -0,0 +1,315 @@
+#include "bip39.h"
+
+#include "bip39_wordlist.h"
+#include "sha256.h"
+
+#include <algorithm>
+
+size_t bip39EntropyBytes(int words)
+{
+    if (words < 12 || words > 24 || words % 3 != 0) {
+        return 0;
+    }
+    // ENT = 32 * words / 3 bits; CS = ENT / 32.
+    return static_cast<size_t>(words) * 4 / 3;
+}
+
+std::string bip39MnemonicFromEntropy(const uint8_t* entropy, size_t size)
+{
+    if (size < 16 || size > 32 || size % 4 != 0) {
+        return {};
+    }
+    uint8_t checksum[Sha256::kDigestSize];
+    Sha256::hash(entropy, size, checksum);
+
+    const size_t words = size * 3 / 4;
+    std::string mnemonic;
+    mnemonic.reserve(words * 9);
+    // Walk the entropy||checksum bit string 11 bits at a time; the checksum
+    // contributes size/4 bits, all taken from its first byte.
+    size_t bit = 0;
+    for (size_t w = 0; w < words; ++w) {
+        uint32_t index = 0;
+        for (int i = 0; i < 11; ++i, ++bit) {
+            const size_t byte = bit / 8;
+            const uint8_t value = byte < size ? entropy[byte] : checksum[byte - size];
+            index = (index << 1) | ((value >> (7 - bit % 8)) & 1);
+        }
+        if (w > 0) {
+            mnemonic += ' ';
+        }
+        mnemonic += kBip39EnglishWords[index];
+    }
+    return mnemonic;
+}
+
+namespace {
+
+// Words are at most 8 letters, so each packs into one little-endian uint64_t
+// (zero padded); packed keys compare in a single fixed-width operation.
+constexpr uint64_t packWord(std::string_view word)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < word.size() && i < 8; ++i) {
+        key |= uint64_t(static_cast<unsigned char>(word[i])) << (8 * i);
+    }
+    return key;
+}
+
+constexpr uint64_t mix(uint64_t key, uint64_t seed)
+{
+    uint64_t x = key ^ (seed * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 32;
+    return x;
+}
+
+// Hash-and-displace perfect hash (CHD): a first hash picks one of kBuckets
+// buckets, and each bucket stores the seed that sends all of its words to
+// distinct slots of a quarter-full table. The sparse table keeps the search
+// short enough for the compilers' default constexpr evaluation limits.
+constexpr size_t kBuckets = 1024;
+constexpr size_t kSlots = 8192;
+constexpr size_t kWords = kBip39EnglishWords.size();
+
+struct PerfectHash {
+    std::array<uint64_t, kWords> keys{};
+    std::array<uint16_t, kBuckets> seeds{};
+    std::array<uint16_t, kSlots> slots{}; // word index for every slot
+    bool complete = false;
+};
+
+constexpr size_t bucketOf(uint64_t key)
+{
+    return static_cast<size_t>(mix(key, 0) >> 54) % kBuckets;
+}
+
+constexpr size_t slotOf(uint64_t key, uint64_t seed)
+{
+    return static_cast<size_t>(mix(key, seed + 1)) % kSlots;
+}
+
+constexpr PerfectHash buildPerfectHash()
+{
+    PerfectHash ph;
+    std::array<uint16_t, kBuckets + 1> start{};
+    std::array<uint16_t, kWords> order{};
+    for (size_t i = 0; i < kWords; ++i) {
+        ph.keys[i] = packWord(kBip39EnglishWords[i]);
+        ++start[bucketOf(ph.keys[i]) + 1];
+    }
+    size_t largest = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        largest = start[b + 1] > largest ? start[b + 1] : largest;
+        start[b + 1] += start[b];
+    }
+    std::array<uint16_t, kBuckets> fill{};
+    for (size_t i = 0; i < kWords; ++i) {
+        const size_t b = bucketOf(ph.keys[i]);
+        order[start[b] + fill[b]++] = static_cast<uint16_t>(i);
+    }
+
+    std::array<bool, kSlots> used{};
+    // stamp[slot] == trial marks slots taken by the bucket being placed.
+    std::array<uint32_t, kSlots> stamp{};
+    uint32_t trial = 0;
+    // Largest buckets first, while the table is emptiest.
+    for (size_t size = largest; size > 0; --size) {
+        for (size_t b = 0; b < kBuckets; ++b) {
+            if (static_cast<size_t>(start[b + 1] - start[b]) != size) {
+                continue;
+            }
+            bool placed = false;
+            for (uint16_t seed = 0; seed < 0xffff && !placed; ++seed) {
+                ++trial;
+                placed = true;
+                for (size_t i = start[b]; i < start[b + 1] && placed; ++i) {
+                    const size_t slot = slotOf(ph.keys[order[i]], seed);
+                    placed = !used[slot] && stamp[slot] != trial;
+                    stamp[slot] = trial;
+                }
+                if (placed) {
+                    ph.seeds[b] = seed;
+                    for (size_t i = start[b]; i < start[b + 1]; ++i) {
+                        const size_t slot = slotOf(ph.keys[order[i]], seed);
+                        used[slot] = true;
+                        ph.slots[slot] = order[i];
+                    }
+                }
+            }
+            if (!placed) {
+                return ph;
+            }
+        }
+    }
+    ph.complete = true;
+    return ph;
+}
+
+constexpr PerfectHash kWordHash = buildPerfectHash();
+static_assert(kWordHash.complete, "BIP-39 perfect hash construction failed");
+
+constexpr bool perfectHashResolvesEveryWord()
+{
+    for (size_t i = 0; i < kWords; ++i) {
+        const uint64_t key = kWordHash.keys[i];
+        if (kWordHash.slots[slotOf(key, kWordHash.seeds[bucketOf(key)])] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(perfectHashResolvesEveryWord(), "BIP-39 perfect hash is not collision-free");
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Restricted Damerau-Levenshtein distance between two short words, capped at
+// limit + 1. Inputs longer than kMaxSuggestInput are never suggested for.
+const size_t kMaxSuggestInput = 16;
+
+int editDistance(std::string_view a, std::string_view b, int limit)
+{
+    const int diff = static_cast<int>(a.size()) - static_cast<int>(b.size());
+    if (diff > limit || -diff > limit) {
+        return limit + 1;
+    }
+    int rows[3][kMaxSuggestInput + 1];
+    int* prev2 = rows[0];
+    int* prev = rows[1];
+    int* cur = rows[2];
+    for (size_t j = 0; j <= b.size(); ++j) {
+        prev[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= a.size(); ++i) {
+        cur[0] = static_cast<int>(i);
+        int best = cur[0];
+        for (size_t j = 1; j <= b.size(); ++j) {
+            const int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            int d = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                d = std::min(d, prev2[j - 2] + 1);
+            }
+            cur[j] = d;
+            best = std::min(best, d);
+        }
+        if (best > limit) {
+            return limit + 1;
+        }
+        int* spare = prev2;
+        prev2 = prev;
+        prev = cur;
+        cur = spare;
+    }
+    return std::min(prev[b.size()], limit + 1);
+}
+
+} // namespace
+
+int bip39WordIndex(std::string_view word)
+{
+    const uint64_t key = packWord(word);
+    const size_t index = kWordHash.slots[slotOf(key, kWordHash.seeds[bucketOf(key)])];
+    // Reject words longer than 8 letters (which would alias their 8-letter
+    // prefix) without branching on the comparison itself.
+    const uint64_t mismatch = (kWordHash.keys[index] ^ key) | uint64_t(word.size() > 8) | uint64_t(word.empty());
+    const int64_t found = -static_cast<int64_t>(mismatch == 0); // all ones when found
+    return static_cast<int>((static_cast<int64_t>(index) & found) | (~found & -1));
+}
+
+Bip39Check bip39Validate(std::string_view phrase)
+{
+    // 24 words * 11 bits = 264 bits; a 25th word is counted but not stored.
+    uint8_t bits[33] = {};
+    int words = 0;
+    int firstUnknown = -1;
+    size_t pos = 0;
+    while (pos < phrase.size()) {
+        while (pos < phrase.size() && isSpace(phrase[pos])) {
+            ++pos;
+        }
+        const size_t begin = pos;
+        while (pos < phrase.size() && !isSpace(phrase[pos])) {
+            ++pos;
+        }
+        if (pos == begin) {
+            break;
+        }
+        const int index = bip39WordIndex(phrase.substr(begin, pos - begin));
+        if (index < 0 && firstUnknown < 0) {
+            firstUnknown = words;
+        }
+        if (words < 24) {
+            const uint32_t value = static_cast<uint32_t>(index) & 0x7ff;
+            for (int i = 0; i < 11; ++i) {
+                const size_t bit = static_cast<size_t>(words) * 11 + i;
+                bits[bit / 8] |= static_cast<uint8_t>(((value >> (10 - i)) & 1) << (7 - bit % 8));
+            }
+        }
+        if (words < 25) {
+            ++words;
+        }
+    }
+
+    Bip39Check check{Bip39Status::Valid, words, firstUnknown};
+    const size_t entropy = bip39EntropyBytes(words);
+    if (entropy == 0) {
+        check.status = Bip39Status::BadWordCount;
+    } else {
+        uint8_t digest[Sha256::kDigestSize];
+        Sha256::hash(bits, entropy, digest);
+        // The checksum is the first entropy/4 bits of the digest, stored right
+        // after the entropy. It is checked even when a word was unknown, so the
+        // work done does not reveal which failure occurred.
+        const size_t checksumBits = entropy / 4;
+        const uint8_t mask = static_cast<uint8_t>(0xff << (8 - checksumBits));
+        const bool checksumOk = ((bits[entropy] ^ digest[0]) & mask) == 0;
+        if (firstUnknown >= 0) {
+            check.status = Bip39Status::UnknownWord;
+        } else if (!checksumOk) {
+            check.status = Bip39Status::BadChecksum;
+        }
+    }
+    volatile uint8_t* wipe = bits;
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        wipe[i] = 0;
+    }
+    return check;
+}
+
+size_t bip39Suggest(std::string_view word, int* out, size_t max)
+{
+    if (max == 0 || word.empty() || word.size() > kMaxSuggestInput) {
+        return 0;
+    }
+    size_t count = 0;
+    auto add = [&](int index) {
+        for (size_t i = 0; i < count; ++i) {
+            if (out[i] == index) {
+                return;
+            }
+        }
+        out[count++] = index;
+    };
+    // Every list word is identified by its first four letters.
+    if (word.size() >= 4) {
+        for (size_t i = 0; i < kWords && count < max; ++i) {
+            if (kBip39EnglishWords[i].substr(0, 4) == word.substr(0, 4)) {
+                add(static_cast<int>(i));
+            }
+        }
+    }
+    for (int distance = 1; distance <= 2 && count < max; ++distance) {
+        for (size_t i = 0; i < kWords && count < max; ++i) {
+            if (editDistance(word, kBip39EnglishWords[i], distance) == distance) {
+                add(static_cast<int>(i));
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// BIP-39 mnemonic encoding and validation over the embedded English wordlist.
+
+// Entropy bytes for a mnemonic of the given word count (12, 15, 18, 21 or 24);
+// 0 for any other count.
+size_t bip39EntropyBytes(int words);
+
+// Encodes 16..32 bytes of entropy (a multiple of 4) as a space-separated
+// mnemonic with the SHA-256 checksum appended. Empty on invalid size.
+std::string bip39MnemonicFromEntropy(const uint8_t* entropy, size_t size);
+
+// Wordlist index of word, or -1. Uses a compile-time perfect hash and a
+// fixed-width compare, so the work done does not depend on which word it is.
+int bip39WordIndex(std::string_view word);
+
+enum class Bip39Status { Valid, BadWordCount, UnknownWord, BadChecksum };
+
+struct Bip39Check {
+    Bip39Status status;
+    int words;        // words seen (counting stops at 25)
+    int firstUnknown; // position of the first word not in the list, or -1
+};
+
+// Checks word count, list membership and checksum of a whitespace-separated
+// phrase. Does not allocate; every word is looked up and the checksum compared
+// without early exits, so timing depends only on the phrase length.
+Bip39Check bip39Validate(std::string_view phrase);
+
+// Wordlist indices of up to `max` near misses for word, best first: words
+// sharing its first four letters, then words within edit distance 1, then 2
+// (adjacent transpositions count as one edit). Does not allocate. Meant for
+// words that already failed bip39WordIndex, so it is not constant-time.
+size_t bip39Suggest(std::string_view word, int* out, size_t max);
@@ -0,0 +1,282 @@
+#include "bulk_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+// Blocks SIGPIPE on the calling thread while it lives, so a write to a pipe or
+// socket whose reader has gone fails with EPIPE instead of killing the host
+// process. A SIGPIPE raised meanwhile is consumed before the old mask returns,
+// unless one was already pending before.
+class SigpipeBlock {
+public:
+    SigpipeBlock() : raised(false)
+    {
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        sigset_t pending;
+        sigpending(&pending);
+        wasPending = sigismember(&pending, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &pipeSet, &previous);
+    }
+
+    ~SigpipeBlock()
+    {
+        const int savedErrno = errno;
+        sigset_t pending;
+        if (raised && !wasPending && sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) == 1) {
+            int sig = 0;
+            sigwait(&pipeSet, &sig);
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        errno = savedErrno;
+    }
+
+    SigpipeBlock(const SigpipeBlock&) = delete;
+    SigpipeBlock& operator=(const SigpipeBlock&) = delete;
+
+    void brokenPipe() { raised = true; }
+
+private:
+    sigset_t pipeSet;
+    sigset_t previous;
+    bool wasPending;
+    bool raised;
+};
+
+} // namespace
+
+FileBuffer::FileBuffer(const std::string& path) : ok(false)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || static_cast<uint64_t>(st.st_size) > kMaxSize) {
+        close(fd);
+        return;
+    }
+    // Read to end of file rather than to st_size: the file may shrink or grow
+    // between the fstat and the reads.
+    contents.resize(std::max<size_t>(static_cast<size_t>(st.st_size), 4096));
+    size_t length = 0;
+    for (;;) {
+        if (length == contents.size()) {
+            if (contents.size() > kMaxSize) {
+                break; // grew past the limit since the fstat
+            }
+            contents.resize(std::min(contents.size() * 2, kMaxSize + 1));
+        }
+        ssize_t n = pread(fd, &contents[length], contents.size() - length, static_cast<off_t>(length));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        length += static_cast<size_t>(n);
+    }
+    close(fd);
+    contents.resize(ok ? length : 0);
+}
+
+MemoryBudget::MemoryBudget(uint64_t limitBytes) : limit(limitBytes), inFlight(0)
+{
+}
+
+void MemoryBudget::acquire(uint64_t bytes)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return inFlight == 0 || (inFlight <= limit && bytes <= limit - inFlight); });
+    inFlight += bytes;
+}
+
+void MemoryBudget::release(uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight -= std::min(bytes, inFlight);
+    }
+    cv.notify_all();
+}
+
+LineReader::LineReader(int fd, size_t maxLineSize) : fd(fd), maxLineSize(maxLineSize), offset(0), eof(false), error(false)
+{
+}
+
+bool LineReader::next(std::string& line)
+{
+    for (;;) {
+        const size_t newline = buffer.find('\n', offset);
+        const size_t end = newline != std::string::npos ? newline : buffer.size();
+        if (end - offset > maxLineSize) {
+            fprintf(stderr, "LineReader: line longer than %zu bytes\n", maxLineSize);
+            buffer.clear();
+            offset = 0;
+            error = true;
+            eof = true;
+            return false;
+        }
+        if (newline != std::string::npos) {
+            line.assign(buffer, offset, newline - offset);
+            offset = newline + 1;
+            return true;
+        }
+        if (eof) {
+            if (offset < buffer.size()) {
+                line.assign(buffer, offset, std::string::npos);
+                offset = buffer.size();
+                return true;
+            }
+            return false;
+        }
+        buffer.erase(0, offset);
+        offset = 0;
+        char chunk[64 * 1024];
+        const ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = true;
+            eof = true;
+        } else if (n == 0) {
+            eof = true;
+        } else {
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+    }
+}
+
+bool writeAll(int fd, const char* data, size_t size)
+{
+    SigpipeBlock block;
+    while (size > 0) {
+        const ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EPIPE) {
+                block.brokenPipe();
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void parallelFor(size_t count, size_t threads, const std::function<void(size_t)>& fn)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+    const size_t extra = std::min(std::max<size_t>(threads, 1), count) - (count > 0 ? 1 : 0);
+    std::vector<std::thread> pool;
+    pool.reserve(extra);
+    for (size_t t = 0; t < extra; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+void lowerThreadPriority()
+{
+#ifdef __linux__
+    sched_param param{};
+    if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
+        fprintf(stderr, "lowerThreadPriority: could not switch thread to SCHED_IDLE\n");
+    }
+#endif
+}
+
+uint64_t scryptMemoryCost(uint64_t n, uint64_t r)
+{
+    uint64_t cost = 0;
+    if (__builtin_mul_overflow(r, n, &cost) || __builtin_mul_overflow(cost, uint64_t(128), &cost)) {
+        return UINT64_MAX;
+    }
+    return cost;
+}
+
+uint64_t keyFileScryptCost(const char* data, size_t size)
+{
+    if (data == nullptr || size == 0) {
+        return 0;
+    }
+    auto doc = nlohmann::json::parse(data, data + size, nullptr, false);
+    if (!doc.is_object()) {
+        return 0;
+    }
+    try {
+        // Version 3 files use "crypto"; files written by older tooling use "Crypto".
+        const auto crypto = doc.contains("crypto") ? doc["crypto"] : doc.value("Crypto", nlohmann::json::object());
+        if (!crypto.is_object() || crypto.value("kdf", std::string()) != "scrypt") {
+            return 0;
+        }
+        const auto params = crypto.value("kdfparams", nlohmann::json::object());
+        return scryptMemoryCost(params.value("n", uint64_t(0)), params.value("r", uint64_t(0)));
+    } catch (const nlohmann::json::exception&) {
+        return 0;
+    }
+}
+
+bool resolvePassphraseSource(const std::string& source, std::string& passphrase)
+{
+    if (source.compare(0, 8, "literal:") == 0) {
+        passphrase = source.substr(8);
+        return true;
+    }
+    if (source.compare(0, 4, "env:") == 0) {
+        const char* value = getenv(source.c_str() + 4);
+        if (value == nullptr) {
+            fprintf(stderr, "resolvePassphraseSource: %s is not set\n", source.c_str() + 4);
+            return false;
+        }
+        passphrase = value;
+        return true;
+    }
+    if (source.compare(0, 5, "file:") == 0) {
+        std::ifstream in(source.substr(5), std::ios::binary);
+        if (!in) {
+            fprintf(stderr, "resolvePassphraseSource: cannot read %s\n", source.c_str() + 5);
+            return false;
+        }
+        passphrase.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        while (!passphrase.empty() && (passphrase.back() == '\n' || passphrase.back() == '\r')) {
+            passphrase.pop_back();
+        }
+        return true;
+    }
+    passphrase = source;
+    return true;
+}
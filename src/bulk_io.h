@@ -0,0 +1,150 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Helpers shared by the bulk keystore operations (directory import, re-keying,
+// backup/restore): whole-file reads, a byte budget for in-flight work and a
+// small parallel loop.
+
+// Contents of a whole file, read with pread() into an owned buffer. Key files
+// are small JSON documents that other processes may rewrite or truncate while a
+// bulk run reads them; a mapping would fault (SIGBUS) on a truncated page, a
+// copy only sees a short read. Files larger than kMaxSize are refused.
+class FileBuffer {
+public:
+    static constexpr size_t kMaxSize = 1 << 20;
+
+    explicit FileBuffer(const std::string& path);
+
+    bool valid() const { return ok; }
+    const char* data() const { return contents.data(); }
+    size_t size() const { return contents.size(); }
+    // NUL-terminated view for the C API.
+    const char* c_str() const { return contents.c_str(); }
+
+private:
+    std::string contents;
+    bool ok;
+};
+
+// Counts bytes reserved by running jobs and blocks new reservations that would
+// exceed the budget. A job larger than the whole budget still runs, alone.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(uint64_t limitBytes);
+
+    void acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t limit;
+    uint64_t inFlight;
+};
+
+// Fixed-capacity multi-producer/multi-consumer queue used to stream work
+// between a reader and the worker pool without buffering a whole archive.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity), closed(false) {}
+
+    // Blocks while the queue is full; false once the queue has been closed.
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; false when closed and drained.
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+};
+
+// Reads newline-terminated records from a file descriptor through a fixed
+// buffer. The descriptor is borrowed, not closed. A line longer than
+// maxLineSize ends the input as a read error, so a peer cannot make the
+// buffer grow without bound.
+class LineReader {
+public:
+    static const size_t kDefaultMaxLineSize = 1 << 20;
+
+    explicit LineReader(int fd, size_t maxLineSize = kDefaultMaxLineSize);
+
+    // False at end of input or on a read error (see failed()).
+    bool next(std::string& line);
+    bool failed() const { return error; }
+
+private:
+    int fd;
+    size_t maxLineSize;
+    std::string buffer;
+    size_t offset;
+    bool eof;
+    bool error;
+};
+
+// Writes the whole buffer, retrying on short writes and EINTR. SIGPIPE is
+// blocked for the call: a reader that has gone away is a false return.
+bool writeAll(int fd, const char* data, size_t size);
+
+// Runs fn(i) for every i in [0, count) on up to `threads` threads (the calling
+// thread included) and returns once all items are done.
+void parallelFor(size_t count, size_t threads, const std::function<void(size_t)>& fn);
+
+// Moves the calling thread to idle scheduling priority (SCHED_IDLE on Linux, a
+// no-op elsewhere) so background refills only use otherwise idle cores.
+void lowerThreadPriority();
+
+// Memory touched by one scrypt run with the given parameters (128 * r * N),
+// UINT64_MAX where that overflows (hostile key-file parameters).
+uint64_t scryptMemoryCost(uint64_t n, uint64_t r);
+
+// Peak scrypt memory needed to decrypt a Web3 Secret Storage key file; 0 when
+// the file cannot be parsed or uses another KDF.
+uint64_t keyFileScryptCost(const char* data, size_t size);
+
+// Resolves "env:NAME" and "file:/path" (trailing newline stripped) passphrase
+// sources. "literal:" takes the rest as the passphrase itself; it is required
+// for a passphrase that itself starts with "env:", "file:" or "literal:". Any
+// other value is taken as the passphrase unchanged.
+bool resolvePassphraseSource(const std::string& source, std::string& passphrase);
@@ -0,0 +1,160 @@
+#include "chacha20_drbg.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+
+namespace {
+
+inline uint32_t rotl(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+inline void quarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+    a += b; d ^= a; d = rotl(d, 16);
+    c += d; b ^= c; b = rotl(b, 12);
+    a += b; d ^= a; d = rotl(d, 8);
+    c += d; b ^= c; b = rotl(b, 7);
+}
+
+// Overwrites secrets in a way the optimiser may not drop.
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+bool osEntropy(uint8_t* out, size_t size)
+{
+#ifdef __linux__
+    while (size > 0) {
+        const ssize_t n = getrandom(out, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    if (size == 0) {
+        return true;
+    }
+#endif
+    // getentropy() is capped at 256 bytes per call; callers only ask for 32.
+    if (size <= 256 && getentropy(out, size) == 0) {
+        return true;
+    }
+    fprintf(stderr, "ChaCha20Drbg: OS entropy source failed\n");
+    return false;
+}
+
+} // namespace
+
+ChaCha20Drbg::ChaCha20Drbg() : key{}, batch{}, available(0), sinceReseed(0), ownerPid(0), seeded(false)
+{
+}
+
+ChaCha20Drbg::~ChaCha20Drbg()
+{
+    wipe(key, sizeof(key));
+    wipe(batch, sizeof(batch));
+}
+
+void ChaCha20Drbg::block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], uint8_t out[64])
+{
+    const uint32_t input[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+        counter, nonce[0], nonce[1], nonce[2],
+    };
+    uint32_t x[16];
+    memcpy(x, input, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        quarterRound(x[0], x[4], x[8], x[12]);
+        quarterRound(x[1], x[5], x[9], x[13]);
+        quarterRound(x[2], x[6], x[10], x[14]);
+        quarterRound(x[3], x[7], x[11], x[15]);
+        quarterRound(x[0], x[5], x[10], x[15]);
+        quarterRound(x[1], x[6], x[11], x[12]);
+        quarterRound(x[2], x[7], x[8], x[13]);
+        quarterRound(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        const uint32_t v = x[i] + input[i];
+        out[4 * i] = static_cast<uint8_t>(v);
+        out[4 * i + 1] = static_cast<uint8_t>(v >> 8);
+        out[4 * i + 2] = static_cast<uint8_t>(v >> 16);
+        out[4 * i + 3] = static_cast<uint8_t>(v >> 24);
+    }
+    wipe(x, sizeof(x));
+}
+
+bool ChaCha20Drbg::reseed()
+{
+    uint8_t fresh[32];
+    if (!osEntropy(fresh, sizeof(fresh))) {
+        return false;
+    }
+    // Mix rather than replace, so a weak reseed cannot lower the state's entropy.
+    for (int i = 0; i < 8; ++i) {
+        uint32_t word;
+        memcpy(&word, fresh + 4 * i, 4);
+        key[i] ^= word;
+    }
+    wipe(fresh, sizeof(fresh));
+    wipe(batch, sizeof(batch));
+    available = 0;
+    sinceReseed = 0;
+    ownerPid = static_cast<long>(getpid());
+    seeded = true;
+    return true;
+}
+
+void ChaCha20Drbg::refill()
+{
+    // Every batch uses a fresh key, so a constant nonce and counters 0..n are safe.
+    static const uint32_t nonce[3] = {0, 0, 0};
+    for (uint32_t i = 0; i < kBatchBlocks; ++i) {
+        block(key, i, nonce, batch + 64 * i);
+    }
+    memcpy(key, batch, sizeof(key));
+    wipe(batch, sizeof(key));
+    available = sizeof(batch) - sizeof(key);
+}
+
+bool ChaCha20Drbg::generate(uint8_t* out, size_t size)
+{
+    if (!seeded || sinceReseed >= kReseedInterval || ownerPid != static_cast<long>(getpid())) {
+        if (!reseed()) {
+            memset(out, 0, size);
+            return false;
+        }
+    }
+    sinceReseed += size;
+    while (size > 0) {
+        if (available == 0) {
+            refill();
+        }
+        const size_t take = size < available ? size : available;
+        uint8_t* src = batch + sizeof(batch) - available;
+        memcpy(out, src, take);
+        wipe(src, take);
+        available -= take;
+        out += take;
+        size -= take;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ChaCha20 keystream used as a deterministic random bit generator, in the
+// "fast key erasure" style: every refill produces a batch of blocks whose first
+// 32 bytes immediately replace the key, so earlier output cannot be recomputed
+// from a later state. The key is seeded from the OS (getrandom) and mixed with
+// fresh OS entropy every kReseedInterval bytes and after fork().
+//
+// An instance is not thread-safe; use one per thread.
+class ChaCha20Drbg {
+public:
+    static const size_t kReseedInterval = 1 << 20;
+
+    ChaCha20Drbg();
+    ~ChaCha20Drbg();
+
+    ChaCha20Drbg(const ChaCha20Drbg&) = delete;
+    ChaCha20Drbg& operator=(const ChaCha20Drbg&) = delete;
+
+    // Fills out with random bytes. Returns false only if the OS entropy source
+    // failed, in which case out is left zeroed.
+    bool generate(uint8_t* out, size_t size);
+
+    // Raw ChaCha20 block function (RFC 8439): 64 bytes of keystream for the
+    // given key, 32-bit block counter and 96-bit nonce.
+    static void block(const uint32_t key[8], uint32_t counter, const uint32_t nonce[3], uint8_t out[64]);
+
+private:
+    static const size_t kBatchBlocks = 16;
+
+    bool reseed();
+    void refill();
+
+    uint32_t key[8];
+    uint8_t batch[kBatchBlocks * 64];
+    size_t available;
+    size_t sinceReseed;
+    long ownerPid;
+    bool seeded;
+};
@@ -0,0 +1,82 @@
+#include "ecrecover.h"
+
+#include "keccak.h"
+#include "secp256k1_curve.h"
+
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+#include <secp256k1.h>
+#include <secp256k1_recovery.h>
+#endif
+
+namespace {
+
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+// Recovery needs no secrets, so one unrandomised context serves all threads.
+const secp256k1_context* verifyContext()
+{
+    static secp256k1_context* const context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+    return context;
+}
+#endif
+
+bool recoverPublicKey(const uint8_t hash[32], const uint8_t sig[64], int recoveryId, uint8_t pub[65])
+{
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+    secp256k1_ecdsa_recoverable_signature signature;
+    secp256k1_pubkey key;
+    if (!secp256k1_ecdsa_recoverable_signature_parse_compact(verifyContext(), &signature, sig, recoveryId) ||
+        !secp256k1_ecdsa_recover(verifyContext(), &key, &signature, hash)) {
+        return false;
+    }
+    size_t size = 65;
+    secp256k1_ec_pubkey_serialize(verifyContext(), pub, &size, &key, SECP256K1_EC_UNCOMPRESSED);
+    return true;
+#else
+    return curveRecover(hash, sig, recoveryId, pub);
+#endif
+}
+
+} // namespace
+
+void publicKeyAddress(const uint8_t pub[65], uint8_t out[kAddressSize])
+{
+    uint8_t digest[Keccak256::kDigestSize];
+    Keccak256::hash(pub + 1, 64, digest);
+    for (size_t i = 0; i < kAddressSize; ++i) {
+        out[i] = digest[sizeof(digest) - kAddressSize + i];
+    }
+}
+
+std::string addressChecksumHex(const uint8_t address[kAddressSize])
+{
+    static const char kHex[] = "0123456789abcdef";
+    char lower[2 * kAddressSize];
+    for (size_t i = 0; i < kAddressSize; ++i) {
+        lower[2 * i] = kHex[address[i] >> 4];
+        lower[2 * i + 1] = kHex[address[i] & 0x0f];
+    }
+    // A letter is upper case when its nibble of the hash of the lower-case hex is >= 8.
+    uint8_t digest[Keccak256::kDigestSize];
+    Keccak256::hash(reinterpret_cast<const uint8_t*>(lower), sizeof(lower), digest);
+    std::string result = "0x";
+    for (size_t i = 0; i < sizeof(lower); ++i) {
+        const int nibble = i % 2 == 0 ? digest[i / 2] >> 4 : digest[i / 2] & 0x0f;
+        result += lower[i] >= 'a' && nibble >= 8 ? static_cast<char>(lower[i] - 'a' + 'A') : lower[i];
+    }
+    return result;
+}
+
+bool ecrecover(const uint8_t hash[32], const uint8_t sig[kRecoverableSignatureSize], uint8_t address[kAddressSize])
+{
+    const int v = sig[64];
+    const int recoveryId = v >= 27 ? v - 27 : v;
+    if (recoveryId < 0 || recoveryId > 3) {
+        return false;
+    }
+    uint8_t pub[65];
+    if (!recoverPublicKey(hash, sig, recoveryId, pub)) {
+        return false;
+    }
+    publicKeyAddress(pub, address);
+    return true;
+}
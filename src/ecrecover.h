@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Ethereum signature recovery: the account that made a signature r || s || v
+// of a 32-byte hash, v being the recovery id (0..3, or 27..30 as Ethereum
+// writes it in messages). Any s in 1..n-1 is accepted, as by go-ethereum's
+// Ecrecover. Uses libsecp256k1 when the module is built with it
+// (ACCOUNTS_HAVE_LIBSECP256K1), the curve of secp256k1_curve.h otherwise.
+// Thread-safe with no shared state, so batches scale across threads.
+
+const size_t kAddressSize = 20;
+const size_t kRecoverableSignatureSize = 65;
+
+// The address of an uncompressed public key (0x04 || x || y): the last 20
+// bytes of the Keccak-256 of x || y.
+void publicKeyAddress(const uint8_t pub[65], uint8_t out[kAddressSize]);
+
+// "0x" and the EIP-55 mixed-case checksummed hex of an address, as the SDK's
+// PublicKeyToAddress formats it.
+std::string addressChecksumHex(const uint8_t address[kAddressSize]);
+
+// False when v is not a recovery id, r or s is out of range or no key
+// matches the signature.
+bool ecrecover(const uint8_t hash[32], const uint8_t sig[kRecoverableSignatureSize], uint8_t address[kAddressSize]);
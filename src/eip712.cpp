@@ -0,0 +1,685 @@
+#include "eip712.h"
+
+#include "keccak.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+typedef unsigned __int128 u128;
+
+// Nesting of structs and arrays a document may use; deeper values fail
+// rather than exhaust the stack.
+const int kMaxDepth = 64;
+
+enum class Kind : uint8_t { Uint, Int, Bool, Address, FixedBytes, Bytes, String, Struct, Array };
+
+// A parsed member type. size is the bit width of Uint and Int and the byte
+// count of FixedBytes; ref is the struct of a Struct and the element type of
+// an Array, whose length is -1 when dynamic.
+struct Type {
+    Kind kind;
+    uint32_t size;
+    int ref;
+    int64_t length;
+};
+
+struct Member {
+    std::string name;
+    int type;
+};
+
+struct StructType {
+    std::string name;
+    uint8_t typeHash[Keccak256::kDigestSize];
+    std::vector<Member> members;
+    std::vector<std::string> memberTypes; // as written, for encodeType
+};
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool parseWidth(std::string_view digits, uint32_t& out)
+{
+    if (digits.empty() || digits.size() > 3 || digits[0] == '0') {
+        return false;
+    }
+    out = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        out = out * 10 + static_cast<uint32_t>(c - '0');
+    }
+    return true;
+}
+
+// The value as hex digits without 0x; false unless a string of whole bytes.
+bool hexBody(const nlohmann::json& value, std::string_view& hex)
+{
+    if (!value.is_string()) {
+        return false;
+    }
+    hex = value.get_ref<const std::string&>();
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex.remove_prefix(2);
+    }
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    for (char c : hex) {
+        if (hexDigit(c) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t hexByte(std::string_view hex, size_t i)
+{
+    return static_cast<uint8_t>(hexDigit(hex[2 * i]) << 4 | hexDigit(hex[2 * i + 1]));
+}
+
+// The 256-bit two's-complement word of an integer given as a JSON number or a
+// decimal or 0x-hex string; false when it is not one or does not fit `bits`
+// bits of the type's signedness.
+bool encodeInteger(const nlohmann::json& value, bool isSigned, uint32_t bits, uint8_t word[32])
+{
+    uint64_t limbs[4] = {0, 0, 0, 0};
+    bool negative = false;
+    if (value.is_number_unsigned()) {
+        limbs[0] = value.get<uint64_t>();
+    } else if (value.is_number_integer()) {
+        const int64_t v = value.get<int64_t>();
+        negative = v < 0;
+        limbs[0] = negative ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+    } else if (value.is_string()) {
+        std::string_view text = value.get_ref<const std::string&>();
+        if (!text.empty() && text[0] == '-') {
+            negative = true;
+            text.remove_prefix(1);
+        }
+        uint64_t base = 10;
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            base = 16;
+            text.remove_prefix(2);
+        }
+        if (text.empty()) {
+            return false;
+        }
+        for (char c : text) {
+            const int digit = hexDigit(c);
+            if (digit < 0 || static_cast<uint64_t>(digit) >= base) {
+                return false;
+            }
+            uint64_t carry = static_cast<uint64_t>(digit);
+            for (uint64_t& limb : limbs) {
+                const u128 t = static_cast<u128>(limb) * base + carry;
+                limb = static_cast<uint64_t>(t);
+                carry = static_cast<uint64_t>(t >> 64);
+            }
+            if (carry != 0) {
+                return false;
+            }
+        }
+    } else {
+        return false;
+    }
+
+    uint32_t length = 0; // bit length of the magnitude
+    for (int i = 3; i >= 0; --i) {
+        if (limbs[i] != 0) {
+            length = 64 * static_cast<uint32_t>(i) + 64 - static_cast<uint32_t>(__builtin_clzll(limbs[i]));
+            break;
+        }
+    }
+    if (length == 0) {
+        negative = false;
+    }
+    if (negative && !isSigned) {
+        return false;
+    }
+    const uint32_t limit = isSigned ? bits - 1 : bits;
+    if (length > limit) {
+        // -2^(bits-1) is the one magnitude of that length a signed type holds.
+        const bool lowest = negative && length == limit + 1 &&
+                            (limbs[limit / 64] == uint64_t(1) << (limit % 64)) &&
+                            std::all_of(limbs, limbs + limit / 64, [](uint64_t l) { return l == 0; });
+        if (!lowest) {
+            return false;
+        }
+    }
+    if (negative) {
+        uint64_t carry = 1;
+        for (uint64_t& limb : limbs) {
+            limb = ~limb + carry;
+            carry = carry && limb == 0;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 8; ++b) {
+            word[31 - 8 * i - b] = static_cast<uint8_t>(limbs[i] >> (8 * b));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+struct Eip712Hasher::Schema {
+    std::vector<Type> types;
+    std::vector<StructType> structs;
+    std::unordered_map<std::string, int> byName;
+
+    // Parses a member type, adding it (and array element types) to types.
+    int parseType(std::string_view name, std::string& error)
+    {
+        Type type = {Kind::Uint, 0, -1, -1};
+        if (!name.empty() && name.back() == ']') {
+            const size_t open = name.rfind('[');
+            if (open == std::string_view::npos || open == 0) {
+                error = "malformed type " + std::string(name);
+                return -1;
+            }
+            const std::string_view length = name.substr(open + 1, name.size() - open - 2);
+            if (!length.empty()) {
+                uint32_t n = 0;
+                if (!parseWidth(length, n)) {
+                    error = "malformed array length in " + std::string(name);
+                    return -1;
+                }
+                type.length = n;
+            }
+            type.kind = Kind::Array;
+            type.ref = parseType(name.substr(0, open), error);
+            if (type.ref < 0) {
+                return -1;
+            }
+        } else if (byName.count(std::string(name)) != 0) {
+            type.kind = Kind::Struct;
+            type.ref = byName.at(std::string(name));
+        } else if (name == "address") {
+            type.kind = Kind::Address;
+        } else if (name == "bool") {
+            type.kind = Kind::Bool;
+        } else if (name == "string") {
+            type.kind = Kind::String;
+        } else if (name == "bytes") {
+            type.kind = Kind::Bytes;
+        } else if (name.compare(0, 5, "bytes") == 0) {
+            type.kind = Kind::FixedBytes;
+            if (!parseWidth(name.substr(5), type.size) || type.size > 32) {
+                error = "unknown type " + std::string(name);
+                return -1;
+            }
+        } else if (name == "uint" || name == "int") {
+            // Aliases of the 256-bit types, as in Solidity and go-ethereum;
+            // encodeType keeps the name as written.
+            type.kind = name == "int" ? Kind::Int : Kind::Uint;
+            type.size = 256;
+        } else if (name.compare(0, 4, "uint") == 0 || name.compare(0, 3, "int") == 0) {
+            const bool isSigned = name[0] == 'i';
+            type.kind = isSigned ? Kind::Int : Kind::Uint;
+            if (!parseWidth(name.substr(isSigned ? 3 : 4), type.size) || type.size % 8 != 0 || type.size > 256) {
+                error = "unknown type " + std::string(name);
+                return -1;
+            }
+        } else {
+            error = "unknown type " + std::string(name);
+            return -1;
+        }
+        types.push_back(type);
+        return static_cast<int>(types.size() - 1);
+    }
+
+    // The struct a type refers to once its array dimensions are stripped, or -1.
+    int baseStruct(int type) const
+    {
+        while (types[type].kind == Kind::Array) {
+            type = types[type].ref;
+        }
+        return types[type].kind == Kind::Struct ? types[type].ref : -1;
+    }
+
+    void collectDependencies(int index, std::set<std::string>& out) const
+    {
+        for (const Member& member : structs[index].members) {
+            const int ref = baseStruct(member.type);
+            if (ref >= 0 && out.insert(structs[ref].name).second) {
+                collectDependencies(ref, out);
+            }
+        }
+    }
+
+    void appendSignature(int index, std::string& out) const
+    {
+        const StructType& s = structs[index];
+        out += s.name;
+        out += '(';
+        for (size_t i = 0; i < s.members.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += s.memberTypes[i];
+            out += ' ';
+            out += s.members[i].name;
+        }
+        out += ')';
+    }
+
+    // The struct's signature followed by those of the structs it refers to,
+    // directly or not, sorted by name.
+    std::string encodeType(int index) const
+    {
+        std::set<std::string> dependencies;
+        collectDependencies(index, dependencies);
+        dependencies.erase(structs[index].name);
+        std::string out;
+        appendSignature(index, out);
+        for (const std::string& name : dependencies) {
+            appendSignature(byName.at(name), out);
+        }
+        return out;
+    }
+
+    // Keys of value the struct does not declare are an error, as in
+    // go-ethereum, unless ignoreExtra: its domain object keeps only the
+    // standard fields.
+    bool hashStruct(int index, const nlohmann::json& value, uint8_t out[32], std::string& error, int depth,
+                    bool ignoreExtra = false) const
+    {
+        const StructType& s = structs[index];
+        if (!value.is_object()) {
+            error = s.name + ": expected an object";
+            return false;
+        }
+        Keccak256 keccak;
+        keccak.update(s.typeHash, sizeof(s.typeHash));
+        uint8_t word[32];
+        for (const Member& member : s.members) {
+            auto it = value.find(member.name);
+            if (it == value.end()) {
+                error = s.name + "." + member.name + ": missing";
+                return false;
+            }
+            if (!encodeValue(member.type, *it, word, error, depth)) {
+                if (error.empty()) {
+                    error = s.name + "." + member.name + ": invalid value";
+                }
+                return false;
+            }
+            keccak.update(word, sizeof(word));
+        }
+        // Every declared member was found, so more keys mean undeclared ones.
+        if (!ignoreExtra && value.size() > s.members.size()) {
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                const bool declared = std::any_of(s.members.begin(), s.members.end(),
+                                                  [&](const Member& member) { return member.name == it.key(); });
+                if (!declared) {
+                    error = s.name + "." + it.key() + ": not declared in the type";
+                    break;
+                }
+            }
+            return false;
+        }
+        keccak.finish(out);
+        return true;
+    }
+
+    // The 32-byte encodeData word of a value: atomic values in place, dynamic
+    // ones, structs and arrays as the hash of their encoding. error is left
+    // empty for the caller to name the member unless set deeper down.
+    bool encodeValue(int typeIndex, const nlohmann::json& value, uint8_t word[32], std::string& error, int depth) const
+    {
+        if (depth > kMaxDepth) {
+            error = "typed data nested too deeply";
+            return false;
+        }
+        const Type& type = types[typeIndex];
+        std::string_view hex;
+        switch (type.kind) {
+        case Kind::Uint:
+        case Kind::Int:
+            return encodeInteger(value, type.kind == Kind::Int, type.size, word);
+        case Kind::Bool:
+            if (!value.is_boolean()) {
+                return false;
+            }
+            memset(word, 0, 32);
+            word[31] = value.get<bool>() ? 1 : 0;
+            return true;
+        case Kind::Address:
+            if (!hexBody(value, hex) || hex.size() != 40) {
+                return false;
+            }
+            memset(word, 0, 12);
+            for (size_t i = 0; i < 20; ++i) {
+                word[12 + i] = hexByte(hex, i);
+            }
+            return true;
+        case Kind::FixedBytes:
+            // Exactly N bytes, as go-ethereum requires; shorter values are not padded.
+            if (!hexBody(value, hex) || hex.size() / 2 != type.size) {
+                return false;
+            }
+            memset(word, 0, 32);
+            for (size_t i = 0; i < hex.size() / 2; ++i) {
+                word[i] = hexByte(hex, i);
+            }
+            return true;
+        case Kind::Bytes: {
+            if (!hexBody(value, hex)) {
+                return false;
+            }
+            Keccak256 keccak;
+            uint8_t chunk[64];
+            for (size_t i = 0; i < hex.size() / 2; i += sizeof(chunk)) {
+                const size_t n = std::min(sizeof(chunk), hex.size() / 2 - i);
+                for (size_t j = 0; j < n; ++j) {
+                    chunk[j] = hexByte(hex, i + j);
+                }
+                keccak.update(chunk, n);
+            }
+            keccak.finish(word);
+            return true;
+        }
+        case Kind::String: {
+            if (!value.is_string()) {
+                return false;
+            }
+            const std::string& text = value.get_ref<const std::string&>();
+            Keccak256::hash(reinterpret_cast<const uint8_t*>(text.data()), text.size(), word);
+            return true;
+        }
+        case Kind::Struct:
+            return hashStruct(type.ref, value, word, error, depth + 1);
+        case Kind::Array: {
+            if (!value.is_array() || (type.length >= 0 && value.size() != static_cast<size_t>(type.length))) {
+                return false;
+            }
+            Keccak256 keccak;
+            uint8_t element[32];
+            for (const auto& item : value) {
+                if (!encodeValue(type.ref, item, element, error, depth + 1)) {
+                    return false;
+                }
+                keccak.update(element, sizeof(element));
+            }
+            keccak.finish(word);
+            return true;
+        }
+        }
+        return false;
+    }
+};
+
+namespace {
+
+// Moves i past the string starting at json[i]; escaped notes a backslash.
+bool skipString(std::string_view json, size_t& i, bool& escaped)
+{
+    for (++i; i < json.size(); ++i) {
+        if (json[i] == '\\') {
+            escaped = true;
+            ++i;
+        } else if (json[i] == '"') {
+            ++i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves i past the value starting at json[i], in a document already parsed.
+bool skipValue(std::string_view json, size_t& i)
+{
+    bool escaped = false;
+    if (i >= json.size()) {
+        return false;
+    }
+    if (json[i] == '"') {
+        return skipString(json, i, escaped);
+    }
+    if (json[i] != '{' && json[i] != '[') {
+        while (i < json.size() && std::strchr(",}] \t\r\n", json[i]) == nullptr) {
+            ++i;
+        }
+        return true;
+    }
+    int depth = 0;
+    while (i < json.size()) {
+        const char c = json[i];
+        if (c == '"') {
+            if (!skipString(json, i, escaped)) {
+                return false;
+            }
+            continue;
+        }
+        ++i;
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The text of the document's top-level "types" member, so the schema cache is
+// keyed on a digest of it rather than on a re-serialisation. Empty when it is
+// not certainly the member the parser kept: "types" twice, or any top-level
+// key spelled with escapes.
+std::string_view rawTypes(std::string_view json)
+{
+    auto skipSpace = [&](size_t& i) {
+        while (i < json.size() && std::strchr(" \t\r\n", json[i]) != nullptr && json[i] != '\0') {
+            ++i;
+        }
+    };
+    size_t i = 0;
+    skipSpace(i);
+    if (i >= json.size() || json[i] != '{') {
+        return {};
+    }
+    ++i;
+    std::string_view found;
+    for (;;) {
+        skipSpace(i);
+        if (i < json.size() && json[i] == '}') {
+            return found;
+        }
+        if (i >= json.size() || json[i] != '"') {
+            return {};
+        }
+        const size_t keyStart = i + 1;
+        bool escaped = false;
+        if (!skipString(json, i, escaped) || escaped) {
+            return {};
+        }
+        const std::string_view key = json.substr(keyStart, i - 1 - keyStart);
+        skipSpace(i);
+        if (i >= json.size() || json[i] != ':') {
+            return {};
+        }
+        ++i;
+        skipSpace(i);
+        const size_t valueStart = i;
+        if (!skipValue(json, i)) {
+            return {};
+        }
+        if (key == "types") {
+            if (!found.empty()) {
+                return {};
+            }
+            found = json.substr(valueStart, i - valueStart);
+        }
+        skipSpace(i);
+        if (i < json.size() && json[i] == ',') {
+            ++i;
+        }
+    }
+}
+
+std::shared_ptr<const Eip712Hasher::Schema> compileSchema(const nlohmann::json& types, std::string& error)
+{
+    if (!types.is_object()) {
+        error = "types must be an object";
+        return nullptr;
+    }
+    auto schema = std::make_shared<Eip712Hasher::Schema>();
+    for (auto it = types.begin(); it != types.end(); ++it) {
+        schema->byName.emplace(it.key(), static_cast<int>(schema->structs.size()));
+        schema->structs.push_back(StructType{it.key(), {}, {}, {}});
+    }
+    int index = 0;
+    for (auto it = types.begin(); it != types.end(); ++it, ++index) {
+        if (!it.value().is_array()) {
+            error = "members of " + it.key() + " must be an array";
+            return nullptr;
+        }
+        for (const auto& entry : it.value()) {
+            auto name = entry.find("name");
+            auto type = entry.find("type");
+            if (!entry.is_object() || name == entry.end() || type == entry.end() || !name->is_string() ||
+                !type->is_string()) {
+                error = "members of " + it.key() + " must be {\"name\",\"type\"} objects";
+                return nullptr;
+            }
+            const int parsed = schema->parseType(type->get_ref<const std::string&>(), error);
+            if (parsed < 0) {
+                return nullptr;
+            }
+            schema->structs[index].members.push_back(Member{name->get<std::string>(), parsed});
+            schema->structs[index].memberTypes.push_back(type->get<std::string>());
+        }
+    }
+    for (size_t i = 0; i < schema->structs.size(); ++i) {
+        const std::string encoded = schema->encodeType(static_cast<int>(i));
+        Keccak256::hash(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), schema->structs[i].typeHash);
+    }
+    return schema;
+}
+
+} // namespace
+
+Eip712Hasher::Eip712Hasher(size_t capacity) : capacity(capacity), hits(0), misses(0) {}
+
+bool Eip712Hasher::hash(const std::string& typedDataJSON, uint8_t out[32], std::string& error)
+{
+    error.clear();
+    nlohmann::json document;
+    try {
+        document = nlohmann::json::parse(typedDataJSON);
+    } catch (const nlohmann::json::exception& e) {
+        error = std::string("invalid JSON: ") + e.what();
+        return false;
+    }
+    if (!document.is_object() || !document.contains("types") || !document.contains("primaryType") ||
+        !document["primaryType"].is_string() || !document.contains("domain")) {
+        error = "expected {\"types\",\"primaryType\",\"domain\",\"message\"}";
+        return false;
+    }
+
+    const nlohmann::json& types = document["types"];
+    const std::string_view raw = rawTypes(typedDataJSON);
+    uint8_t digest[Keccak256::kDigestSize];
+    if (raw.empty()) {
+        const std::string canonical = types.dump();
+        Keccak256::hash(reinterpret_cast<const uint8_t*>(canonical.data()), canonical.size(), digest);
+    } else {
+        Keccak256::hash(reinterpret_cast<const uint8_t*>(raw.data()), raw.size(), digest);
+    }
+    const std::string key(reinterpret_cast<const char*>(digest), sizeof(digest));
+    std::shared_ptr<const Schema> schema = find(key);
+    if (!schema) {
+        schema = compileSchema(types, error);
+        if (!schema) {
+            return false;
+        }
+        insert(key, schema);
+    }
+
+    auto domainType = schema->byName.find("EIP712Domain");
+    if (domainType == schema->byName.end()) {
+        error = "types has no EIP712Domain";
+        return false;
+    }
+    const std::string& primaryType = document["primaryType"].get_ref<const std::string&>();
+    auto primary = schema->byName.find(primaryType);
+    if (primary == schema->byName.end()) {
+        error = "unknown primaryType " + primaryType;
+        return false;
+    }
+
+    uint8_t preimage[2 + 2 * Keccak256::kDigestSize] = {0x19, 0x01};
+    if (!schema->hashStruct(domainType->second, document["domain"], preimage + 2, error, 0, true)) {
+        return false;
+    }
+    size_t size = 2 + Keccak256::kDigestSize;
+    if (primary->second != domainType->second) {
+        if (!document.contains("message") ||
+            !schema->hashStruct(primary->second, document["message"], preimage + size, error, 0)) {
+            if (error.empty()) {
+                error = "missing message";
+            }
+            return false;
+        }
+        size += Keccak256::kDigestSize;
+    }
+    Keccak256::hash(preimage, size, out);
+    return true;
+}
+
+Eip712Hasher::Stats Eip712Hasher::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.capacity = capacity;
+    s.schemas = schemas.size();
+    s.hits = hits;
+    s.misses = misses;
+    return s;
+}
+
+std::shared_ptr<const Eip712Hasher::Schema> Eip712Hasher::find(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = schemas.find(key);
+    if (it == schemas.end()) {
+        ++misses;
+        return nullptr;
+    }
+    ++hits;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->second;
+}
+
+void Eip712Hasher::insert(const std::string& key, std::shared_ptr<const Schema> schema)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (capacity == 0 || schemas.count(key) != 0) {
+        return;
+    }
+    lru.emplace_front(key, std::move(schema));
+    schemas[key] = lru.begin();
+    while (lru.size() > capacity) {
+        schemas.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// EIP-712 digests of typed structured data, as eth_signTypedData_v4 and
+// go-ethereum compute them: keccak256(0x19 0x01 || hashStruct(EIP712Domain,
+// domain) || hashStruct(primaryType, message)). Members may be structs,
+// fixed or dynamic arrays (nested too), strings, bytes, bytes1..32, address,
+// bool and int/uint of 8..256 bits (int and uint alone meaning 256); integers
+// are JSON numbers or decimal or 0x-hex strings, byte values 0x-hex strings,
+// of exactly N bytes for bytesN.
+//
+// Each "types" schema is compiled once (member types parsed, encodeType
+// strings built and hashed) and kept in an LRU cache under the Keccak-256 of
+// its raw text, so a document of known message types only walks its values.
+// Message objects with keys their type does not declare are rejected, as
+// go-ethereum does; the domain keeps only its declared fields. Struct
+// and array encodings stream into Keccak-256 word by word with no buffers.
+// Thread-safe.
+class Eip712Hasher {
+public:
+    static const size_t kDefaultCapacity = 256;
+
+    struct Stats {
+        size_t capacity = 0;
+        size_t schemas = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    explicit Eip712Hasher(size_t capacity = kDefaultCapacity);
+
+    Eip712Hasher(const Eip712Hasher&) = delete;
+    Eip712Hasher& operator=(const Eip712Hasher&) = delete;
+
+    // Digest of a document {"types","primaryType","domain","message"}; a
+    // primaryType of EIP712Domain hashes the domain alone. False with the
+    // reason in error when the document is malformed.
+    bool hash(const std::string& typedDataJSON, uint8_t out[32], std::string& error);
+
+    Stats stats() const;
+
+    struct Schema;
+
+private:
+    using Lru = std::list<std::pair<std::string, std::shared_ptr<const Schema>>>;
+
+    std::shared_ptr<const Schema> find(const std::string& key);
+    void insert(const std::string& key, std::shared_ptr<const Schema> schema);
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    Lru lru;
+    std::unordered_map<std::string, Lru::iterator> schemas;
+    uint64_t hits;
+    uint64_t misses;
+};
@@ -0,0 +1,314 @@
+#include "ext_key.h"
+
+#include "ripemd160.h"
+#include "secp256k1_curve.h"
+#include "sha256.h"
+#include "sha512.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char kBase58Alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+// Order of the secp256k1 group, big-endian.
+const uint8_t kCurveOrder[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+    0xba, 0xae, 0xdc, 0xe6, 0xaf, 0x48, 0xa0, 0x3b, 0xbf, 0xd2, 0x5e, 0x8c, 0xd0, 0x36, 0x41, 0x41,
+};
+
+const uint8_t kMainnetPrivateVersion[4] = {0x04, 0x88, 0xad, 0xe4};
+const uint8_t kMainnetPublicVersion[4] = {0x04, 0x88, 0xb2, 0x1e};
+const uint8_t kTestnetPrivateVersion[4] = {0x04, 0x35, 0x83, 0x94};
+const uint8_t kTestnetPublicVersion[4] = {0x04, 0x35, 0x87, 0xcf};
+
+const size_t kSerializedSize = 78;
+
+bool validPrivateKey(const uint8_t key[32])
+{
+    bool zero = true;
+    for (int i = 0; i < 32; ++i) {
+        zero = zero && key[i] == 0;
+    }
+    return !zero && memcmp(key, kCurveOrder, 32) < 0;
+}
+
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+void checksum(const uint8_t* data, size_t size, uint8_t out[4])
+{
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash(data, size, digest);
+    Sha256::hash(digest, sizeof(digest), digest);
+    memcpy(out, digest, 4);
+}
+
+void fingerprint(const uint8_t publicKey[33], uint8_t out[4])
+{
+    uint8_t sha[Sha256::kDigestSize];
+    uint8_t hash[20];
+    Sha256::hash(publicKey, 33, sha);
+    ripemd160(sha, sizeof(sha), hash);
+    memcpy(out, hash, 4);
+}
+
+// One CKD step into child, which must not alias parent.
+bool deriveChild(const ExtKey& parent, uint32_t index, ExtKey& child)
+{
+    const bool hardened = index >= kExtKeyHardened;
+    if (parent.depth == 0xff || (hardened && !parent.isPrivate())) {
+        return false;
+    }
+    uint8_t data[37];
+    memcpy(data, hardened ? parent.key : parent.publicKey, 33);
+    for (int i = 0; i < 4; ++i) {
+        data[33 + i] = static_cast<uint8_t>(index >> (24 - 8 * i));
+    }
+    uint8_t mac[Sha512::kDigestSize];
+    hmacSha512(parent.chainCode, sizeof(parent.chainCode), data, sizeof(data), mac);
+    wipe(data, sizeof(data));
+
+    bool ok;
+    if (parent.isPrivate()) {
+        child.key[0] = 0;
+        ok = curveScalarAdd(parent.key + 1, mac, child.key + 1) && curvePublicKey(child.key + 1, child.publicKey);
+    } else {
+        ok = curvePublicKeyTweakAdd(parent.publicKey, mac, child.publicKey);
+        memcpy(child.key, child.publicKey, 33);
+    }
+    memcpy(child.version, parent.version, 4);
+    child.depth = static_cast<uint8_t>(parent.depth + 1);
+    fingerprint(parent.publicKey, child.parentFingerprint);
+    child.childNumber = index;
+    memcpy(child.chainCode, mac + 32, 32);
+    wipe(mac, sizeof(mac));
+    return ok;
+}
+
+} // namespace
+
+ExtKey::~ExtKey()
+{
+    wipe(key, sizeof(key));
+    wipe(chainCode, sizeof(chainCode));
+}
+
+std::string base58CheckEncode(const uint8_t* data, size_t size)
+{
+    std::vector<uint8_t> payload(data, data + size);
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash(payload.data(), payload.size(), digest);
+    Sha256::hash(digest, sizeof(digest), digest);
+    payload.insert(payload.end(), digest, digest + 4);
+
+    size_t zeros = 0;
+    while (zeros < payload.size() && payload[zeros] == 0) {
+        ++zeros;
+    }
+    // Repeated division of the big-endian number by 58, least significant
+    // digit first; log(256)/log(58) < 1.37 digits per byte.
+    std::vector<uint8_t> digits((payload.size() - zeros) * 137 / 100 + 1);
+    size_t length = 0;
+    for (size_t i = zeros; i < payload.size(); ++i) {
+        int carry = payload[i];
+        size_t j = 0;
+        for (; j < length || carry != 0; ++j) {
+            carry += 256 * digits[j];
+            digits[j] = static_cast<uint8_t>(carry % 58);
+            carry /= 58;
+        }
+        length = j;
+    }
+    std::string out(zeros, '1');
+    for (size_t j = length; j > 0; --j) {
+        out += kBase58Alphabet[digits[j - 1]];
+    }
+    return out;
+}
+
+std::string extKeyFromSeed(const uint8_t* seed, size_t size)
+{
+    if (size < 16 || size > 64) {
+        return {};
+    }
+    static const char kSeedKey[] = "Bitcoin seed";
+    uint8_t master[Sha512::kDigestSize];
+    hmacSha512(reinterpret_cast<const uint8_t*>(kSeedKey), sizeof(kSeedKey) - 1, seed, size, master);
+    if (!validPrivateKey(master)) {
+        memset(master, 0, sizeof(master));
+        return {};
+    }
+
+    // version(4) depth(1) parent fingerprint(4) child number(4) chain code(32) 0x00 key(32)
+    uint8_t serialized[78] = {};
+    memcpy(serialized, kMainnetPrivateVersion, 4);
+    memcpy(serialized + 13, master + 32, 32);
+    memcpy(serialized + 46, master, 32);
+    std::string result = base58CheckEncode(serialized, sizeof(serialized));
+    memset(master, 0, sizeof(master));
+    memset(serialized, 0, sizeof(serialized));
+    return result;
+}
+
+bool base58CheckDecode(std::string_view text, std::vector<uint8_t>& out)
+{
+    size_t zeros = 0;
+    while (zeros < text.size() && text[zeros] == '1') {
+        ++zeros;
+    }
+    // Repeated multiplication by 58, least significant byte first;
+    // log(58)/log(256) < 0.74 bytes per digit.
+    std::vector<uint8_t> bytes((text.size() - zeros) * 74 / 100 + 1);
+    size_t length = 0;
+    for (size_t i = zeros; i < text.size(); ++i) {
+        const char* digit = strchr(kBase58Alphabet, text[i]);
+        if (text[i] == '\0' || digit == nullptr) {
+            return false;
+        }
+        int carry = static_cast<int>(digit - kBase58Alphabet);
+        size_t j = 0;
+        for (; j < length || carry != 0; ++j) {
+            carry += 58 * bytes[j];
+            bytes[j] = static_cast<uint8_t>(carry & 0xff);
+            carry >>= 8;
+        }
+        length = j;
+    }
+    std::vector<uint8_t> decoded(zeros, 0);
+    for (size_t j = length; j > 0; --j) {
+        decoded.push_back(bytes[j - 1]);
+    }
+    wipe(bytes.data(), bytes.size());
+    if (decoded.size() < 4) {
+        return false;
+    }
+    uint8_t expected[4];
+    checksum(decoded.data(), decoded.size() - 4, expected);
+    if (memcmp(expected, decoded.data() + decoded.size() - 4, 4) != 0) {
+        wipe(decoded.data(), decoded.size());
+        return false;
+    }
+    out.assign(decoded.begin(), decoded.end() - 4);
+    wipe(decoded.data(), decoded.size());
+    return true;
+}
+
+bool extKeyParse(std::string_view text, ExtKey& out)
+{
+    std::vector<uint8_t> raw;
+    if (!base58CheckDecode(text, raw)) {
+        return false;
+    }
+    bool ok = raw.size() == kSerializedSize;
+    bool isPrivateVersion = false;
+    if (ok) {
+        isPrivateVersion = memcmp(raw.data(), kMainnetPrivateVersion, 4) == 0 ||
+                           memcmp(raw.data(), kTestnetPrivateVersion, 4) == 0;
+        ok = isPrivateVersion || memcmp(raw.data(), kMainnetPublicVersion, 4) == 0 ||
+             memcmp(raw.data(), kTestnetPublicVersion, 4) == 0;
+    }
+    if (ok) {
+        memcpy(out.version, raw.data(), 4);
+        out.depth = raw[4];
+        memcpy(out.parentFingerprint, raw.data() + 5, 4);
+        out.childNumber = (uint32_t(raw[9]) << 24) | (uint32_t(raw[10]) << 16) | (uint32_t(raw[11]) << 8) | raw[12];
+        memcpy(out.chainCode, raw.data() + 13, 32);
+        memcpy(out.key, raw.data() + 45, 33);
+        const uint8_t noParent[4] = {};
+        ok = out.depth != 0 || (out.childNumber == 0 && memcmp(out.parentFingerprint, noParent, 4) == 0);
+    }
+    if (ok && isPrivateVersion) {
+        ok = out.key[0] == 0 && curvePublicKey(out.key + 1, out.publicKey);
+    } else if (ok) {
+        ok = curvePublicKeyValid(out.key);
+        memcpy(out.publicKey, out.key, 33);
+    }
+    wipe(raw.data(), raw.size());
+    return ok;
+}
+
+std::string extKeySerialize(const ExtKey& key)
+{
+    uint8_t serialized[kSerializedSize];
+    memcpy(serialized, key.version, 4);
+    serialized[4] = key.depth;
+    memcpy(serialized + 5, key.parentFingerprint, 4);
+    for (int i = 0; i < 4; ++i) {
+        serialized[9 + i] = static_cast<uint8_t>(key.childNumber >> (24 - 8 * i));
+    }
+    memcpy(serialized + 13, key.chainCode, 32);
+    memcpy(serialized + 45, key.key, 33);
+    std::string result = base58CheckEncode(serialized, sizeof(serialized));
+    wipe(serialized, sizeof(serialized));
+    return result;
+}
+
+bool extKeyMasterFromSeed(const uint8_t* seed, size_t size, ExtKey& out)
+{
+    if (size < 16 || size > 64) {
+        return false;
+    }
+    static const char kSeedKey[] = "Bitcoin seed";
+    uint8_t master[Sha512::kDigestSize];
+    hmacSha512(reinterpret_cast<const uint8_t*>(kSeedKey), sizeof(kSeedKey) - 1, seed, size, master);
+    out = ExtKey();
+    memcpy(out.version, kMainnetPrivateVersion, 4);
+    memcpy(out.chainCode, master + 32, 32);
+    memcpy(out.key + 1, master, 32);
+    wipe(master, sizeof(master));
+    return curvePublicKey(out.key + 1, out.publicKey);
+}
+
+bool extKeyParsePath(const std::string& path, std::vector<uint32_t>& out)
+{
+    out.clear();
+    if (path.empty() || path[0] != 'm') {
+        return false;
+    }
+    size_t pos = 1;
+    while (pos < path.size()) {
+        if (path[pos] != '/' || pos + 1 >= path.size()) {
+            return false;
+        }
+        ++pos;
+        uint64_t index = 0;
+        const size_t start = pos;
+        while (pos < path.size() && path[pos] >= '0' && path[pos] <= '9') {
+            index = index * 10 + static_cast<uint64_t>(path[pos] - '0');
+            if (index >= kExtKeyHardened) {
+                return false;
+            }
+            ++pos;
+        }
+        if (pos == start) {
+            return false;
+        }
+        if (pos < path.size() && path[pos] == '\'') {
+            index += kExtKeyHardened;
+            ++pos;
+        }
+        out.push_back(static_cast<uint32_t>(index));
+    }
+    return true;
+}
+
+bool extKeyDerive(const ExtKey& parent, const std::vector<uint32_t>& path, ExtKey& out)
+{
+    ExtKey current = parent;
+    for (uint32_t index : path) {
+        ExtKey child;
+        if (!deriveChild(current, index, child)) {
+            return false;
+        }
+        current = child;
+    }
+    out = current;
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A decoded BIP-32 extended key. A private key is stored as 0x00 || key in
+// `key`; `publicKey` always holds the compressed public key, computed once when
+// the key is parsed or derived. The destructor wipes the key material.
+struct ExtKey {
+    uint8_t version[4] = {};
+    uint8_t depth = 0;
+    uint8_t parentFingerprint[4] = {};
+    uint32_t childNumber = 0;
+    uint8_t chainCode[32] = {};
+    uint8_t key[33] = {};
+    uint8_t publicKey[33] = {};
+
+    ExtKey() = default;
+    ExtKey(const ExtKey&) = default;
+    ExtKey& operator=(const ExtKey&) = default;
+    ~ExtKey();
+
+    bool isPrivate() const { return key[0] == 0; }
+};
+
+// First index of the hardened range.
+const uint32_t kExtKeyHardened = 0x80000000u;
+
+// BIP-32 master extended private key for a BIP-39 seed, serialized the way the
+// SDK does (mainnet "xprv", depth 0, base58check). Empty when the seed length
+// is outside 16..64 bytes or yields an invalid secp256k1 scalar.
+std::string extKeyFromSeed(const uint8_t* seed, size_t size);
+
+// Base58 with a 4-byte double-SHA-256 checksum appended.
+std::string base58CheckEncode(const uint8_t* data, size_t size);
+
+// Decodes base58 and checks and strips the 4-byte checksum.
+bool base58CheckDecode(std::string_view text, std::vector<uint8_t>& out);
+
+// Parses an xprv/xpub (or tprv/tpub) string and validates the key: the private
+// scalar must be in range and the public point on the curve.
+bool extKeyParse(std::string_view text, ExtKey& out);
+std::string extKeySerialize(const ExtKey& key);
+// Same master key as extKeyFromSeed, without encoding it.
+bool extKeyMasterFromSeed(const uint8_t* seed, size_t size, ExtKey& out);
+
+// Parses "m" or "m/44'/60'/0'/0/0" into child indices (hardened ones offset by
+// kExtKeyHardened), applied relative to the key they are derived from.
+bool extKeyParsePath(const std::string& path, std::vector<uint32_t>& out);
+// BIP-32 child key derivation (CKDpriv, or CKDpub for public keys, which
+// cannot derive hardened children). Fails if any step yields an invalid key.
+bool extKeyDerive(const ExtKey& parent, const std::vector<uint32_t>& path, ExtKey& out);
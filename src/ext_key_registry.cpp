@@ -0,0 +1,69 @@
+#include "ext_key_registry.h"
+
+#include <cstdio>
+#include <new>
+
+ExtKeyRegistry::ExtKeyRegistry() : slab(sizeof(ExtKey)), nextHandle(1)
+{
+}
+
+ExtKeyRegistry::~ExtKeyRegistry()
+{
+    clear();
+}
+
+int64_t ExtKeyRegistry::add(const ExtKey& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (keys.size() >= kMaxKeys) {
+        fprintf(stderr, "ExtKeyRegistry: limit of %zu extended-key handles reached\n", kMaxKeys);
+        return 0;
+    }
+    void* slot = slab.allocate();
+    if (!slot) {
+        return 0;
+    }
+    const int64_t handle = nextHandle++;
+    keys[handle] = new (slot) ExtKey(key);
+    return handle;
+}
+
+bool ExtKeyRegistry::get(int64_t handle, ExtKey& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = keys.find(handle);
+    if (it == keys.end()) {
+        return false;
+    }
+    out = *it->second;
+    return true;
+}
+
+bool ExtKeyRegistry::release(int64_t handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = keys.find(handle);
+    if (it == keys.end()) {
+        return false;
+    }
+    it->second->~ExtKey();
+    slab.release(it->second);
+    keys.erase(it);
+    return true;
+}
+
+size_t ExtKeyRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return keys.size();
+}
+
+void ExtKeyRegistry::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : keys) {
+        entry.second->~ExtKey();
+        slab.release(entry.second);
+    }
+    keys.clear();
+}
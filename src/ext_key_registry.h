@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "ext_key.h"
+#include "locked_memory.h"
+
+// Decoded extended keys behind opaque handles, so a key can be derived from
+// or converted repeatedly without decoding and validating its base58 form each
+// time. Keys live in locked memory until released (or the registry is
+// destroyed); handles are never reused. Thread-safe.
+class ExtKeyRegistry {
+public:
+    static const size_t kMaxKeys = 65536;
+
+    ExtKeyRegistry();
+    ~ExtKeyRegistry();
+
+    ExtKeyRegistry(const ExtKeyRegistry&) = delete;
+    ExtKeyRegistry& operator=(const ExtKeyRegistry&) = delete;
+
+    // New handle (> 0) for a copy of key; 0 when kMaxKeys are held or no locked
+    // page could be mapped.
+    int64_t add(const ExtKey& key);
+    // Copies the key out; false for an unknown or released handle.
+    bool get(int64_t handle, ExtKey& out) const;
+    bool release(int64_t handle);
+    size_t size() const;
+    void clear();
+
+private:
+    LockedSlab slab;
+    mutable std::mutex mutex;
+    std::unordered_map<int64_t, ExtKey*> keys;
+    int64_t nextHandle;
+};
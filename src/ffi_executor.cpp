@@ -0,0 +1,175 @@
+#include "ffi_executor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+struct FfiExecutor::Node {
+    std::atomic<Node*> next{nullptr};
+    const std::function<void()>* call = nullptr;
+    std::promise<void> done;
+};
+
+FfiExecutor::FfiExecutor()
+    : stub(new Node), pending(0), enabled(false), parked(false), stopping(false), windowMicros(0),
+      maxBatch(kDefaultMaxBatch), calls(0), inlineCalls(0), batches(0), largestBatch(0)
+{
+    head.store(stub);
+    tail = stub;
+}
+
+FfiExecutor::~FfiExecutor()
+{
+    std::lock_guard<std::mutex> lock(configMutex);
+    stopThread();
+    delete stub;
+}
+
+void FfiExecutor::configure(bool enable, uint64_t window, size_t batch)
+{
+    std::lock_guard<std::mutex> lock(configMutex);
+    windowMicros = window;
+    maxBatch = std::max<size_t>(1, batch);
+    if (enable && !worker.joinable()) {
+        stopping = false;
+        worker = std::thread(&FfiExecutor::loop, this);
+        workerId = worker.get_id();
+        enabled = true;
+    } else if (!enable && worker.joinable()) {
+        stopThread();
+    }
+}
+
+void FfiExecutor::run(const std::function<void()>& call)
+{
+    // Counted before enabled is checked, so a stopping executor drains this
+    // call rather than exiting underneath it.
+    ++pending;
+    if (!enabled || std::this_thread::get_id() == workerId.load()) {
+        --pending;
+        ++inlineCalls;
+        call();
+        return;
+    }
+    Node node;
+    node.call = &call;
+    std::future<void> finished = node.done.get_future();
+    push(&node);
+    if (parked) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+    finished.wait();
+}
+
+FfiExecutor::Stats FfiExecutor::stats() const
+{
+    Stats s;
+    s.enabled = enabled;
+    s.windowMicros = windowMicros;
+    s.maxBatch = maxBatch;
+    s.calls = calls;
+    s.inlineCalls = inlineCalls;
+    s.batches = batches;
+    s.largestBatch = largestBatch;
+    return s;
+}
+
+void FfiExecutor::push(Node* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+FfiExecutor::Node* FfiExecutor::pop()
+{
+    // Vyukov's intrusive MPSC queue; nullptr also while a producer is between
+    // its exchange and its link, which the caller retries.
+    Node* first = tail;
+    Node* next = first->next.load(std::memory_order_acquire);
+    if (first == stub) {
+        if (next == nullptr) {
+            return nullptr;
+        }
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+    if (first != head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    push(stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
+
+void FfiExecutor::loop()
+{
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    for (;;) {
+        if (pending == 0) {
+            if (stopping) {
+                return;
+            }
+            lock.lock();
+            parked = true;
+            wake.wait(lock, [&] { return pending != 0 || stopping; });
+            parked = false;
+            lock.unlock();
+            continue;
+        }
+        const uint64_t window = windowMicros;
+        const size_t limit = maxBatch;
+        if (window != 0 && pending < limit && !stopping) {
+            // Give concurrent callers the window to join this batch.
+            lock.lock();
+            parked = true;
+            wake.wait_for(lock, std::chrono::microseconds(window), [&] { return pending >= limit || stopping; });
+            parked = false;
+            lock.unlock();
+        }
+        size_t batch = 0;
+        while (batch < limit && pending != 0) {
+            Node* node = pop();
+            if (node == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            (*node->call)();
+            --pending;
+            // Counted before the caller is released, so its stats include it.
+            ++calls;
+            if (++batch == 1) {
+                ++batches;
+            }
+            if (batch > largestBatch) {
+                largestBatch = batch;
+            }
+            node->done.set_value();
+        }
+    }
+}
+
+void FfiExecutor::stopThread()
+{
+    if (!worker.joinable()) {
+        return;
+    }
+    enabled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    workerId = std::thread::id();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// A dedicated thread that makes SDK calls on behalf of callers on other
+// threads, so the Go runtime serves them from one bound OS thread instead of
+// adopting every dispatcher thread that happens to call in. Callers push onto
+// a lock-free multi-producer, single-consumer queue and wait for their call
+// to finish; the executor drains the queue in batches, optionally holding
+// the first call of a batch for up to the batching window so that concurrent
+// callers share one wake-up. run() executes inline when the executor is
+// disabled or when called from the executor thread itself.
+class FfiExecutor {
+public:
+    struct Stats {
+        bool enabled = false;
+        uint64_t windowMicros = 0;
+        size_t maxBatch = 0;
+        uint64_t calls = 0;   // calls run on the executor thread
+        uint64_t inlineCalls = 0; // calls run on the caller's thread
+        uint64_t batches = 0;
+        size_t largestBatch = 0;
+    };
+
+    static const size_t kDefaultMaxBatch = 64;
+
+    FfiExecutor();
+    ~FfiExecutor();
+
+    FfiExecutor(const FfiExecutor&) = delete;
+    FfiExecutor& operator=(const FfiExecutor&) = delete;
+
+    // Starts or stops the executor thread; stopping finishes queued calls first.
+    void configure(bool enabled, uint64_t windowMicros, size_t maxBatch);
+
+    // Runs call on the executor thread and returns once it has finished.
+    void run(const std::function<void()>& call);
+
+    Stats stats() const;
+
+private:
+    struct Node;
+
+    void push(Node* node);
+    Node* pop();
+    void loop();
+    void stopThread();
+
+    // Producers swap themselves in at head; the consumer follows tail.
+    std::atomic<Node*> head;
+    Node* tail;
+    Node* stub;
+    std::atomic<size_t> pending;
+
+    std::atomic<bool> enabled;
+    std::atomic<bool> parked;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> windowMicros;
+    std::atomic<size_t> maxBatch;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::mutex configMutex;
+    std::thread worker;
+    std::atomic<std::thread::id> workerId;
+
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> inlineCalls;
+    std::atomic<uint64_t> batches;
+    std::atomic<size_t> largestBatch;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// The one place the SDK header is included: the header cgo generates has no
+// include guard.
+extern "C" {
+    #include "lib/libgowalletsdk.h"
+}
+
+// Owns a string allocated by the Go wallet SDK and frees it with
+// GoWSK_FreeCString when destroyed. The contents are read in place through
+// view(), so results that are parsed, hashed or logged need no intermediate
+// std::string; str() makes the one copy a caller that keeps the value needs.
+// Pass out() where the SDK takes a char** out-parameter such as its error.
+class GoString {
+public:
+    GoString() = default;
+    explicit GoString(char* str) : ptr(str) {}
+    ~GoString() { reset(); }
+
+    GoString(GoString&& other) noexcept : ptr(other.ptr), size(other.size)
+    {
+        other.ptr = nullptr;
+        other.size = npos;
+    }
+
+    GoString& operator=(GoString&& other) noexcept
+    {
+        if (this != &other) {
+            reset(other.ptr);
+            size = other.size;
+            other.ptr = nullptr;
+            other.size = npos;
+        }
+        return *this;
+    }
+
+    GoString(const GoString&) = delete;
+    GoString& operator=(const GoString&) = delete;
+
+    // Frees the current string and takes ownership of str.
+    void reset(char* str = nullptr)
+    {
+        if (ptr) {
+            GoWSK_FreeCString(ptr);
+        }
+        ptr = str;
+        size = npos;
+    }
+
+    // Frees the current string and hands the SDK a slot to store a new one in.
+    char** out()
+    {
+        reset();
+        return &ptr;
+    }
+
+    explicit operator bool() const { return ptr != nullptr; }
+
+    // Empty when no string is held.
+    const char* c_str() const { return ptr ? ptr : ""; }
+
+    std::string_view view() const
+    {
+        if (!ptr) {
+            return std::string_view();
+        }
+        if (size == npos) {
+            size = std::strlen(ptr);
+        }
+        return std::string_view(ptr, size);
+    }
+
+    std::string str() const { return std::string(view()); }
+
+    // Zeroes the contents in place, for key material that must not outlive
+    // its use in the Go heap either.
+    void wipe()
+    {
+        if (ptr) {
+            std::memset(ptr, 0, view().size());
+        }
+    }
+
+private:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    char* ptr = nullptr;
+    mutable size_t size = npos; // strlen(ptr), measured on first view()
+};
@@ -0,0 +1,240 @@
+#include "group_commit.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+std::string keyFileSuffix(const std::string& address)
+{
+    std::string hex = address;
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex = hex.substr(2);
+    }
+    std::transform(hex.begin(), hex.end(), hex.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return hex;
+}
+
+bool syncPath(const std::string& path, int flags)
+{
+    const int fd = open(path.c_str(), flags | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+} // namespace
+
+GroupCommit::GroupCommit()
+    : mode(Mode::Off), windowMillis(kDefaultWindowMillis), pendingWrites(0), recordedSeq(0), committedSeq(0),
+      urgent(false), stopping(false), commits(0), files(0), failures(0), reportedFailures(0)
+{
+}
+
+GroupCommit::~GroupCommit()
+{
+    std::lock_guard<std::mutex> config(configMutex);
+    stopThread();
+}
+
+void GroupCommit::configure(Mode newMode, uint64_t window)
+{
+    std::lock_guard<std::mutex> config(configMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mode = newMode;
+        windowMillis = window;
+        if (newMode == Mode::Group) {
+            if (!worker.joinable()) {
+                worker = std::thread(&GroupCommit::loop, this);
+            }
+            wake.notify_one();
+            return;
+        }
+    }
+    // Writes recorded from here on are no longer grouped; the thread commits
+    // the ones already pending before it exits.
+    stopThread();
+}
+
+bool GroupCommit::written(const std::string& dir, const std::string& address, const std::string& path)
+{
+    auto add = [&](DirBatch& entry) {
+        return path.empty() ? entry.suffixes.insert(keyFileSuffix(address)).second : entry.files.insert(path).second;
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (mode == Mode::Off) {
+            return true;
+        }
+        if (mode == Mode::Group) {
+            if (add(pending[dir])) {
+                ++pendingWrites;
+            }
+            ++recordedSeq;
+            wake.notify_one();
+            return true;
+        }
+    }
+    Batch batch;
+    add(batch[dir]);
+    return commit(batch);
+}
+
+bool GroupCommit::synchronous() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return mode == Mode::Sync;
+}
+
+bool GroupCommit::flush()
+{
+    drain();
+    std::lock_guard<std::mutex> lock(mutex);
+    const bool ok = failures == reportedFailures;
+    reportedFailures = failures;
+    return ok;
+}
+
+void GroupCommit::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    const uint64_t target = recordedSeq;
+    if (committedSeq >= target || !worker.joinable()) {
+        return;
+    }
+    urgent = true;
+    wake.notify_one();
+    committed.wait(lock, [&] { return committedSeq >= target; });
+}
+
+GroupCommit::Stats GroupCommit::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.mode = mode;
+    s.windowMillis = windowMillis;
+    s.pending = pendingWrites;
+    s.commits = commits;
+    s.files = files;
+    s.failures = failures;
+    s.lastError = lastError;
+    return s;
+}
+
+bool GroupCommit::commit(const Batch& batch)
+{
+    uint64_t synced = 0;
+    uint64_t dirs = 0;
+    std::string error;
+    for (const auto& entry : batch) {
+        const std::string& dir = entry.first;
+        for (const auto& path : entry.second.files) {
+            if (syncPath(path, O_RDONLY)) {
+                ++synced;
+            } else {
+                error = path + ": " + std::strerror(errno);
+            }
+        }
+        // Key files are named after their address ("UTC--<time>--<address>"),
+        // so one directory scan finds the rest of the batch.
+        std::set<size_t> lengths;
+        for (const auto& suffix : entry.second.suffixes) {
+            if (!suffix.empty()) {
+                lengths.insert(suffix.size());
+            }
+        }
+        if (!lengths.empty()) {
+            DIR* d = opendir(dir.c_str());
+            if (d == nullptr) {
+                error = dir + ": " + std::strerror(errno);
+                continue;
+            }
+            while (dirent* file = readdir(d)) {
+                if (file->d_name[0] == '.') {
+                    continue;
+                }
+                std::string name = keyFileSuffix(file->d_name);
+                for (size_t length : lengths) {
+                    if (name.size() >= length && entry.second.suffixes.count(name.substr(name.size() - length)) != 0) {
+                        if (syncPath(dir + "/" + file->d_name, O_RDONLY)) {
+                            ++synced;
+                        } else {
+                            error = dir + "/" + file->d_name + ": " + std::strerror(errno);
+                        }
+                        break;
+                    }
+                }
+            }
+            closedir(d);
+        }
+        // The directory sync makes the renames (and removals) durable.
+        if (syncPath(dir, O_RDONLY | O_DIRECTORY)) {
+            ++dirs;
+        } else {
+            error = dir + ": " + std::strerror(errno);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    commits += dirs;
+    files += synced;
+    if (!error.empty()) {
+        ++failures;
+        lastError = error;
+        return false;
+    }
+    return true;
+}
+
+void GroupCommit::loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return stopping || committedSeq != recordedSeq; });
+        if (committedSeq == recordedSeq) {
+            return;
+        }
+        if (windowMillis != 0 && !urgent && !stopping) {
+            // Let the writes of the next window join this commit.
+            wake.wait_for(lock, std::chrono::milliseconds(windowMillis), [&] { return urgent || stopping; });
+        }
+        Batch batch;
+        batch.swap(pending);
+        pendingWrites = 0;
+        const uint64_t end = recordedSeq;
+        urgent = false;
+        lock.unlock();
+        commit(batch);
+        lock.lock();
+        committedSeq = end;
+        committed.notify_all();
+    }
+}
+
+void GroupCommit::stopThread()
+{
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            return;
+        }
+        stopping = true;
+        stopped.swap(worker);
+    }
+    wake.notify_one();
+    stopped.join();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+}
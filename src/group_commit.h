@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// Makes key files written by the SDK durable. The SDK writes each key file as
+// a temporary file renamed into place and syncs neither the file nor its
+// directory, so a crash can lose an account that was already handed out.
+//
+//   Off    nothing is synced beyond what the SDK does (the default).
+//   Sync   each recorded write is synced (file, then directory) before the
+//          call that made it returns. Callers name the key file where they
+//          know it, so a write costs two fsyncs and no directory scan.
+//   Group  recorded writes are collected for up to the window and synced
+//          together by a background thread: one fsync per file and one per
+//          directory for the whole batch. A call returns before its write is
+//          durable; flush() waits until it is.
+//
+// Thread-safe.
+class GroupCommit {
+public:
+    enum class Mode { Off, Sync, Group };
+
+    struct Stats {
+        Mode mode = Mode::Off;
+        uint64_t windowMillis = 0;
+        size_t pending = 0;   // writes waiting for the next group commit
+        uint64_t commits = 0; // directory syncs
+        uint64_t files = 0;   // key-file syncs
+        uint64_t failures = 0;
+        std::string lastError;
+    };
+
+    static const uint64_t kDefaultWindowMillis = 10;
+
+    GroupCommit();
+    ~GroupCommit();
+
+    GroupCommit(const GroupCommit&) = delete;
+    GroupCommit& operator=(const GroupCommit&) = delete;
+
+    // Leaving Group mode commits the pending writes first.
+    void configure(Mode mode, uint64_t windowMillis);
+
+    // Records that the key file of address in dir was written; an empty
+    // address records a removal, for which only the directory is synced. The
+    // file is path when given and otherwise found by scanning dir. In Sync
+    // mode the sync happens here and false means it failed.
+    bool written(const std::string& dir, const std::string& address, const std::string& path = std::string());
+    // Whether writes are synced as they are recorded (Sync mode), so callers
+    // can look up the key file's path first.
+    bool synchronous() const;
+
+    // Blocks until every write recorded before the call is durable. False when
+    // a sync has failed since the previous flush().
+    bool flush();
+    // As flush(), without consuming the failure report; used on close.
+    void drain();
+
+    Stats stats() const;
+
+private:
+    struct DirBatch {
+        std::set<std::string> suffixes; // lower-case hex addresses without 0x; "" marks a removal
+        std::set<std::string> files;    // key files named by the caller
+    };
+    using Batch = std::map<std::string, DirBatch>;
+
+    bool commit(const Batch& batch);
+    void loop();
+    void stopThread();
+
+    std::mutex configMutex;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable committed;
+    Mode mode;
+    uint64_t windowMillis;
+    Batch pending;
+    size_t pendingWrites;
+    uint64_t recordedSeq;  // writes recorded in Group mode so far
+    uint64_t committedSeq; // of which committed
+    bool urgent;
+    bool stopping;
+    std::thread worker;
+
+    uint64_t commits;
+    uint64_t files;
+    uint64_t failures;
+    uint64_t reportedFailures;
+    std::string lastError;
+};
@@ -0,0 +1,92 @@
+#include "keccak.h"
+
+#include <cstring>
+
+namespace {
+
+const uint64_t kRoundConstant[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+// Rotation offsets and lane order of the combined rho and pi steps.
+const int kRotation[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+const int kLane[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+
+inline uint64_t rotl(uint64_t x, int n)
+{
+    return (x << n) | (x >> (64 - n));
+}
+
+void keccakF1600(uint64_t a[25])
+{
+    for (int round = 0; round < 24; ++round) {
+        uint64_t c[5];
+        for (int x = 0; x < 5; ++x) {
+            c[x] = a[x] ^ a[x + 5] ^ a[x + 10] ^ a[x + 15] ^ a[x + 20];
+        }
+        for (int x = 0; x < 5; ++x) {
+            const uint64_t d = c[(x + 4) % 5] ^ rotl(c[(x + 1) % 5], 1);
+            for (int y = 0; y < 25; y += 5) {
+                a[y + x] ^= d;
+            }
+        }
+        uint64_t carry = a[1];
+        for (int i = 0; i < 24; ++i) {
+            const int lane = kLane[i];
+            const uint64_t next = a[lane];
+            a[lane] = rotl(carry, kRotation[i]);
+            carry = next;
+        }
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; ++x) {
+                c[x] = a[y + x];
+            }
+            for (int x = 0; x < 5; ++x) {
+                a[y + x] = c[x] ^ (~c[(x + 1) % 5] & c[(x + 2) % 5]);
+            }
+        }
+        a[0] ^= kRoundConstant[round];
+    }
+}
+
+} // namespace
+
+Keccak256::Keccak256() : state{}, offset(0)
+{
+}
+
+void Keccak256::update(const uint8_t* data, size_t size)
+{
+    // Lanes are little-endian: byte i of the block goes to bits 8*(i%8) of lane i/8.
+    for (size_t i = 0; i < size; ++i) {
+        state[offset / 8] ^= uint64_t(data[i]) << (8 * (offset % 8));
+        if (++offset == kRate) {
+            keccakF1600(state);
+            offset = 0;
+        }
+    }
+}
+
+void Keccak256::finish(uint8_t out[kDigestSize])
+{
+    state[offset / 8] ^= uint64_t(0x01) << (8 * (offset % 8));
+    state[(kRate - 1) / 8] ^= uint64_t(0x80) << (8 * ((kRate - 1) % 8));
+    keccakF1600(state);
+    for (size_t i = 0; i < kDigestSize; ++i) {
+        out[i] = static_cast<uint8_t>(state[i / 8] >> (8 * (i % 8)));
+    }
+    memset(state, 0, sizeof(state));
+    offset = 0;
+}
+
+void Keccak256::hash(const uint8_t* data, size_t size, uint8_t out[kDigestSize])
+{
+    Keccak256 ctx;
+    ctx.update(data, size);
+    ctx.finish(out);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Keccak-256 as Ethereum uses it: the original Keccak padding (0x01), not the
+// SHA3-256 padding FIPS 202 standardised later. Portable C++.
+class Keccak256 {
+public:
+    static const size_t kDigestSize = 32;
+    static const size_t kRate = 136;
+
+    Keccak256();
+
+    void update(const uint8_t* data, size_t size);
+    void finish(uint8_t out[kDigestSize]);
+
+    static void hash(const uint8_t* data, size_t size, uint8_t out[kDigestSize]);
+
+private:
+    uint64_t state[25];
+    size_t offset; // bytes absorbed into the current block
+};
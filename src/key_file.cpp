@@ -0,0 +1,200 @@
+#include "key_file.h"
+
+#include "aes128.h"
+#include "keccak.h"
+#include "scrypt.h"
+#include "sha256.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include <dirent.h>
+
+namespace {
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool hexField(const nlohmann::json& object, const char* name, std::vector<uint8_t>& out)
+{
+    auto it = object.find(name);
+    if (it == object.end() || !it->is_string()) {
+        return false;
+    }
+    const std::string& hex = it->get_ref<const std::string&>();
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out.resize(hex.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        const int hi = hexValue(hex[2 * i]);
+        const int lo = hexValue(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+bool uintField(const nlohmann::json& object, const char* name, uint64_t& out)
+{
+    auto it = object.find(name);
+    if (it == object.end() || !it->is_number_unsigned()) {
+        return false;
+    }
+    out = it->get<uint64_t>();
+    return true;
+}
+
+// Compares without an early exit so timing does not reveal the matching prefix.
+bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t size)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < size; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+bool deriveKey(const nlohmann::json& crypto, std::string_view passphrase, std::vector<uint8_t>& derived, std::string& error)
+{
+    auto kdf = crypto.find("kdf");
+    auto params = crypto.find("kdfparams");
+    std::vector<uint8_t> salt;
+    uint64_t dklen = 0;
+    if (kdf == crypto.end() || !kdf->is_string() || params == crypto.end() || !params->is_object() ||
+        !hexField(*params, "salt", salt) || !uintField(*params, "dklen", dklen) || dklen < 32 || dklen > 1024) {
+        error = "invalid kdf parameters";
+        return false;
+    }
+    derived.assign(dklen, 0);
+    const uint8_t* password = reinterpret_cast<const uint8_t*>(passphrase.data());
+    const std::string& name = kdf->get_ref<const std::string&>();
+    if (name == "scrypt") {
+        uint64_t n = 0, r = 0, p = 0;
+        if (!uintField(*params, "n", n) || !uintField(*params, "r", r) || !uintField(*params, "p", p) ||
+            r > UINT32_MAX || p > UINT32_MAX ||
+            !scrypt(password, passphrase.size(), salt.data(), salt.size(), n, static_cast<uint32_t>(r),
+                    static_cast<uint32_t>(p), derived.data(), derived.size())) {
+            error = "invalid or unsupported scrypt parameters";
+            return false;
+        }
+        return true;
+    }
+    if (name == "pbkdf2") {
+        uint64_t c = 0;
+        auto prf = params->find("prf");
+        if (prf == params->end() || *prf != "hmac-sha256" || !uintField(*params, "c", c) || c == 0 || c > UINT32_MAX) {
+            error = "invalid or unsupported pbkdf2 parameters";
+            return false;
+        }
+        pbkdf2HmacSha256(password, passphrase.size(), salt.data(), salt.size(), static_cast<uint32_t>(c),
+                         derived.data(), derived.size());
+        return true;
+    }
+    error = "unsupported kdf " + name;
+    return false;
+}
+
+} // namespace
+
+bool keyFileDecrypt(std::string_view json, std::string_view passphrase, uint8_t key[32], std::string& error)
+{
+    auto doc = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+    if (!doc.is_object()) {
+        error = "key file is not a JSON object";
+        return false;
+    }
+    auto version = doc.find("version");
+    if (version == doc.end() || *version != 3) {
+        error = "unsupported key file version";
+        return false;
+    }
+    // Older writers capitalised the section name.
+    auto crypto = doc.find("crypto");
+    if (crypto == doc.end()) {
+        crypto = doc.find("Crypto");
+    }
+    if (crypto == doc.end() || !crypto->is_object()) {
+        error = "key file has no crypto section";
+        return false;
+    }
+    auto cipher = crypto->find("cipher");
+    auto cipherParams = crypto->find("cipherparams");
+    std::vector<uint8_t> iv;
+    std::vector<uint8_t> ciphertext;
+    std::vector<uint8_t> mac;
+    if (cipher == crypto->end() || *cipher != "aes-128-ctr") {
+        error = "unsupported cipher";
+        return false;
+    }
+    if (cipherParams == crypto->end() || !cipherParams->is_object() || !hexField(*cipherParams, "iv", iv) ||
+        iv.size() != 16 || !hexField(*crypto, "ciphertext", ciphertext) || ciphertext.size() != 32 ||
+        !hexField(*crypto, "mac", mac) || mac.size() != Keccak256::kDigestSize) {
+        error = "malformed crypto section";
+        return false;
+    }
+
+    std::vector<uint8_t> derived;
+    if (!deriveKey(*crypto, passphrase, derived, error)) {
+        return false;
+    }
+    uint8_t expected[Keccak256::kDigestSize];
+    Keccak256 hasher;
+    hasher.update(derived.data() + 16, 16);
+    hasher.update(ciphertext.data(), ciphertext.size());
+    hasher.finish(expected);
+    const bool match = constantTimeEqual(expected, mac.data(), sizeof(expected));
+    if (match) {
+        aes128Ctr(derived.data(), iv.data(), ciphertext.data(), key, ciphertext.size());
+    } else {
+        error = "could not decrypt key with given password";
+    }
+    std::fill(derived.begin(), derived.end(), 0);
+    return match;
+}
+
+std::string keyFileFind(const std::string& dir, std::string_view address)
+{
+    if (address.size() >= 2 && address[0] == '0' && (address[1] == 'x' || address[1] == 'X')) {
+        address.remove_prefix(2);
+    }
+    if (address.empty()) {
+        return {};
+    }
+    const auto sameChar = [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    };
+    std::string path;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            const std::string_view name(entry->d_name);
+            if (name[0] == '.' || name.size() < address.size() + 2) {
+                continue;
+            }
+            const std::string_view tail = name.substr(name.size() - address.size() - 2);
+            if (tail.compare(0, 2, "--") == 0 &&
+                std::equal(address.begin(), address.end(), tail.begin() + 2, sameChar)) {
+                path = dir + "/" + entry->d_name;
+                break;
+            }
+        }
+        closedir(d);
+    }
+    return path;
+}
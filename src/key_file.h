@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Native decryption of Web3 Secret Storage (version 3) key files, the format
+// the SDK's keystore writes: scrypt or PBKDF2-HMAC-SHA256 key derivation, a
+// Keccak-256 MAC over the second half of the derived key and the ciphertext,
+// and AES-128-CTR with the first half. Gives the same secret as the SDK for
+// the same file and passphrase.
+//
+// key receives the 32-byte secret key. False with the reason in error when
+// the file is malformed or uses an unsupported cipher or KDF, or when the MAC
+// does not match ("could not decrypt key with given password", as the SDK
+// puts it).
+bool keyFileDecrypt(std::string_view json, std::string_view passphrase, uint8_t key[32], std::string& error);
+
+// Path of the key file for address in dir, as the SDK names them
+// ("UTC--<time>--<address hex>"; the address with or without 0x, any case).
+// Empty when there is none.
+std::string keyFileFind(const std::string& dir, std::string_view address);
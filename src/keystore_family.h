@@ -0,0 +1,198 @@
+#pragma once
+
+#include "go_string.h"
+
+// Compile-time policies for the two SDK keystore families. Both expose the
+// same operations under different C names; AccountsModuleImpl writes each
+// operation once as a template over the family, so the keystore* and
+// extKeystore* methods share one call path and cross-cutting work (admission,
+// the FFI executor, caching) is hooked in one place. The functions are
+// trivial forwarders and inline away. The SDK's C signatures take char*,
+// hence the const_casts being collected here.
+struct KeystoreFamily {
+    static constexpr const char* kScope = "keystore";
+    // Prefixes the operation name in log labels ("SignHash", "ExtSignHash").
+    static constexpr const char* kLabelPrefix = "";
+    static constexpr const char* kName = "Keystore";
+    static constexpr const char* kNoun = "keystore";
+    // Only the plain keystore keeps a pool of pre-created accounts.
+    static constexpr bool kAccountPool = true;
+    // Its key files hold the bare secp256k1 key that keyFileDecrypt opens, so
+    // unlocked accounts can sign natively (NativeSigner).
+    static constexpr bool kNativeSigning = true;
+
+    static GoWSKHandle open(const char* dir, int scryptN, int scryptP, char** err)
+    {
+        return GoWSK_accounts_keystore_NewKeyStore(const_cast<char*>(dir), scryptN, scryptP, err);
+    }
+    static void close(GoWSKHandle handle) { GoWSK_accounts_keystore_CloseKeyStore(handle); }
+    static char* accounts(GoWSKHandle handle, char** err) { return GoWSK_accounts_keystore_Accounts(handle, err); }
+    static char* newAccount(GoWSKHandle handle, const char* passphrase, char** err)
+    {
+        return GoWSK_accounts_keystore_NewAccount(handle, const_cast<char*>(passphrase), err);
+    }
+    static char* import(GoWSKHandle handle, const char* keyJSON, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_keystore_Import(handle, const_cast<char*>(keyJSON), const_cast<char*>(passphrase),
+                                              const_cast<char*>(newPassphrase), err);
+    }
+    // The export that import() takes back, used by backups.
+    static char* exportKey(GoWSKHandle handle, const char* address, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_keystore_Export(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                              const_cast<char*>(newPassphrase), err);
+    }
+    static char* importECDSA(GoWSKHandle handle, const char* privateKeyHex, const char* passphrase, char** err)
+    {
+        return GoWSK_accounts_keystore_ImportECDSA(handle, const_cast<char*>(privateKeyHex), const_cast<char*>(passphrase), err);
+    }
+    static void remove(GoWSKHandle handle, const char* address, const char* passphrase, char** err)
+    {
+        GoWSK_accounts_keystore_Delete(handle, const_cast<char*>(address), const_cast<char*>(passphrase), err);
+    }
+    static int hasAddress(GoWSKHandle handle, const char* address, char** err)
+    {
+        return GoWSK_accounts_keystore_HasAddress(handle, const_cast<char*>(address), err);
+    }
+    static void unlock(GoWSKHandle handle, const char* address, const char* passphrase, char** err)
+    {
+        GoWSK_accounts_keystore_Unlock(handle, const_cast<char*>(address), const_cast<char*>(passphrase), err);
+    }
+    static void lock(GoWSKHandle handle, const char* address, char** err)
+    {
+        GoWSK_accounts_keystore_Lock(handle, const_cast<char*>(address), err);
+    }
+    static void timedUnlock(GoWSKHandle handle, const char* address, const char* passphrase, unsigned long timeoutSeconds, char** err)
+    {
+        GoWSK_accounts_keystore_TimedUnlock(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                            timeoutSeconds, err);
+    }
+    static void update(GoWSKHandle handle, const char* address, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        GoWSK_accounts_keystore_Update(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                       const_cast<char*>(newPassphrase), err);
+    }
+    static char* signHash(GoWSKHandle handle, const char* address, const char* hashHex, char** err)
+    {
+        return GoWSK_accounts_keystore_SignHash(handle, const_cast<char*>(address), const_cast<char*>(hashHex), err);
+    }
+    static char* signHashWithPassphrase(GoWSKHandle handle, const char* address, const char* passphrase, const char* hashHex, char** err)
+    {
+        return GoWSK_accounts_keystore_SignHashWithPassphrase(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                              const_cast<char*>(hashHex), err);
+    }
+    static char* signTx(GoWSKHandle handle, const char* address, const char* txJSON, const char* chainIDHex, char** err)
+    {
+        return GoWSK_accounts_keystore_SignTx(handle, const_cast<char*>(address), const_cast<char*>(txJSON),
+                                              const_cast<char*>(chainIDHex), err);
+    }
+    static char* signTxWithPassphrase(GoWSKHandle handle, const char* address, const char* passphrase, const char* txJSON,
+                                      const char* chainIDHex, char** err)
+    {
+        return GoWSK_accounts_keystore_SignTxWithPassphrase(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                            const_cast<char*>(txJSON), const_cast<char*>(chainIDHex), err);
+    }
+    static char* find(GoWSKHandle handle, const char* address, const char* url, char** err)
+    {
+        return GoWSK_accounts_keystore_Find(handle, const_cast<char*>(address), const_cast<char*>(url), err);
+    }
+};
+
+struct ExtKeystoreFamily {
+    static constexpr const char* kScope = "extkeystore";
+    static constexpr const char* kLabelPrefix = "Ext";
+    static constexpr const char* kName = "Ext keystore";
+    static constexpr const char* kNoun = "ext keystore";
+    static constexpr bool kAccountPool = false;
+    static constexpr bool kNativeSigning = false;
+
+    static GoWSKHandle open(const char* dir, int scryptN, int scryptP, char** err)
+    {
+        return GoWSK_accounts_extkeystore_NewKeyStore(const_cast<char*>(dir), scryptN, scryptP, err);
+    }
+    static void close(GoWSKHandle handle) { GoWSK_accounts_extkeystore_CloseKeyStore(handle); }
+    static char* accounts(GoWSKHandle handle, char** err) { return GoWSK_accounts_extkeystore_Accounts(handle, err); }
+    static char* newAccount(GoWSKHandle handle, const char* passphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_NewAccount(handle, const_cast<char*>(passphrase), err);
+    }
+    static char* import(GoWSKHandle handle, const char* keyJSON, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_Import(handle, const_cast<char*>(keyJSON), const_cast<char*>(passphrase),
+                                                 const_cast<char*>(newPassphrase), err);
+    }
+    static char* exportKey(GoWSKHandle handle, const char* address, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_ExportExt(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                    const_cast<char*>(newPassphrase), err);
+    }
+    static char* exportPriv(GoWSKHandle handle, const char* address, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_ExportPriv(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                     const_cast<char*>(newPassphrase), err);
+    }
+    static char* importExtendedKey(GoWSKHandle handle, const char* extKey, const char* passphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_ImportExtendedKey(handle, const_cast<char*>(extKey), const_cast<char*>(passphrase), err);
+    }
+    static void remove(GoWSKHandle handle, const char* address, const char* passphrase, char** err)
+    {
+        GoWSK_accounts_extkeystore_Delete(handle, const_cast<char*>(address), const_cast<char*>(passphrase), err);
+    }
+    static int hasAddress(GoWSKHandle handle, const char* address, char** err)
+    {
+        return GoWSK_accounts_extkeystore_HasAddress(handle, const_cast<char*>(address), err);
+    }
+    static void unlock(GoWSKHandle handle, const char* address, const char* passphrase, char** err)
+    {
+        GoWSK_accounts_extkeystore_Unlock(handle, const_cast<char*>(address), const_cast<char*>(passphrase), err);
+    }
+    static void lock(GoWSKHandle handle, const char* address, char** err)
+    {
+        GoWSK_accounts_extkeystore_Lock(handle, const_cast<char*>(address), err);
+    }
+    static void timedUnlock(GoWSKHandle handle, const char* address, const char* passphrase, unsigned long timeoutSeconds, char** err)
+    {
+        GoWSK_accounts_extkeystore_TimedUnlock(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                               timeoutSeconds, err);
+    }
+    static void update(GoWSKHandle handle, const char* address, const char* passphrase, const char* newPassphrase, char** err)
+    {
+        GoWSK_accounts_extkeystore_Update(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                          const_cast<char*>(newPassphrase), err);
+    }
+    static char* signHash(GoWSKHandle handle, const char* address, const char* hashHex, char** err)
+    {
+        return GoWSK_accounts_extkeystore_SignHash(handle, const_cast<char*>(address), const_cast<char*>(hashHex), err);
+    }
+    static char* signHashWithPassphrase(GoWSKHandle handle, const char* address, const char* passphrase, const char* hashHex, char** err)
+    {
+        return GoWSK_accounts_extkeystore_SignHashWithPassphrase(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                                 const_cast<char*>(hashHex), err);
+    }
+    static char* signTx(GoWSKHandle handle, const char* address, const char* txJSON, const char* chainIDHex, char** err)
+    {
+        return GoWSK_accounts_extkeystore_SignTx(handle, const_cast<char*>(address), const_cast<char*>(txJSON),
+                                                 const_cast<char*>(chainIDHex), err);
+    }
+    static char* signTxWithPassphrase(GoWSKHandle handle, const char* address, const char* passphrase, const char* txJSON,
+                                      const char* chainIDHex, char** err)
+    {
+        return GoWSK_accounts_extkeystore_SignTxWithPassphrase(handle, const_cast<char*>(address), const_cast<char*>(passphrase),
+                                                               const_cast<char*>(txJSON), const_cast<char*>(chainIDHex), err);
+    }
+    static char* find(GoWSKHandle handle, const char* address, const char* url, char** err)
+    {
+        return GoWSK_accounts_extkeystore_Find(handle, const_cast<char*>(address), const_cast<char*>(url), err);
+    }
+    static char* derive(GoWSKHandle handle, const char* address, const char* path, int pin, char** err)
+    {
+        return GoWSK_accounts_extkeystore_Derive(handle, const_cast<char*>(address), const_cast<char*>(path), pin, err);
+    }
+    static char* deriveWithPassphrase(GoWSKHandle handle, const char* address, const char* path, int pin,
+                                      const char* passphrase, const char* newPassphrase, char** err)
+    {
+        return GoWSK_accounts_extkeystore_DeriveWithPassphrase(handle, const_cast<char*>(address), const_cast<char*>(path), pin,
+                                                               const_cast<char*>(passphrase), const_cast<char*>(newPassphrase), err);
+    }
+};
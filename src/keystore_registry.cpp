@@ -0,0 +1,356 @@
+#include "keystore_registry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+struct KeystoreRegistry::Entry {
+    std::string name;
+    Config config;
+    unsigned long long handle = 0;
+    bool opening = false;
+    bool removed = false;
+    bool closeOnRelease = false;
+    size_t leases = 0;
+    uint64_t lastUse = 0;
+    uint64_t bytes = 0;
+    // Unlocked address -> expiry.
+    std::map<std::string, std::chrono::steady_clock::time_point> unlocked;
+
+    bool pinned(std::chrono::steady_clock::time_point now)
+    {
+        for (auto it = unlocked.begin(); it != unlocked.end();) {
+            if (it->second <= now) {
+                it = unlocked.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return !unlocked.empty();
+    }
+};
+
+namespace {
+
+std::string normalizeAddress(const std::string& address)
+{
+    std::string lower = address;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower;
+}
+
+} // namespace
+
+KeystoreRegistry::Lease::Lease(KeystoreRegistry* registry, std::shared_ptr<Entry> entry, unsigned long long handle)
+    : registry(registry), entry(std::move(entry)), handle(handle)
+{
+}
+
+KeystoreRegistry::Lease::~Lease()
+{
+    reset();
+}
+
+KeystoreRegistry::Lease::Lease(Lease&& other) noexcept
+    : registry(other.registry), entry(std::move(other.entry)), handle(other.handle)
+{
+    other.registry = nullptr;
+    other.handle = 0;
+}
+
+KeystoreRegistry::Lease& KeystoreRegistry::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        registry = other.registry;
+        entry = std::move(other.entry);
+        handle = other.handle;
+        other.registry = nullptr;
+        other.handle = 0;
+    }
+    return *this;
+}
+
+KeystoreRegistry::Kind KeystoreRegistry::Lease::kind() const
+{
+    return entry ? entry->config.kind : Kind::Keystore;
+}
+
+void KeystoreRegistry::Lease::reset()
+{
+    if (registry && entry) {
+        registry->release(entry);
+    }
+    registry = nullptr;
+    entry.reset();
+    handle = 0;
+}
+
+KeystoreRegistry::KeystoreRegistry(Ops ops)
+    : ops(std::move(ops)), maxOpen(kDefaultMaxOpen), maxBytes(0), clock(0), hits(0), opens(0), evictions(0)
+{
+}
+
+KeystoreRegistry::~KeystoreRegistry()
+{
+    closeAll();
+}
+
+bool KeystoreRegistry::add(const std::string& name, const Config& config)
+{
+    if (name.empty() || config.dir.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        const Config& current = it->second->config;
+        return current.kind == config.kind && current.dir == config.dir && current.scryptN == config.scryptN &&
+               current.scryptP == config.scryptP;
+    }
+    auto entry = std::make_shared<Entry>();
+    entry->name = name;
+    entry->config = config;
+    entries[name] = entry;
+    return true;
+}
+
+bool KeystoreRegistry::remove(const std::string& name)
+{
+    std::vector<Victim> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            return false;
+        }
+        std::shared_ptr<Entry> entry = it->second;
+        entries.erase(it);
+        entry->removed = true;
+        if (entry->leases == 0 && entry->handle != 0) {
+            victims.emplace_back(entry->config, entry->handle);
+            entry->handle = 0;
+            entry->bytes = 0;
+        }
+    }
+    closeVictims(victims);
+    return true;
+}
+
+void KeystoreRegistry::setLimits(size_t maxOpen, uint64_t maxBytes)
+{
+    std::vector<Victim> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->maxOpen = maxOpen;
+        this->maxBytes = maxBytes;
+        victims = evictLocked(nullptr);
+    }
+    closeVictims(victims);
+}
+
+KeystoreRegistry::Lease KeystoreRegistry::acquire(const std::string& name, std::string& error)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            error = "unknown keystore tenant: " + name;
+            return Lease();
+        }
+        entry = it->second;
+        opened.wait(lock, [&] { return !entry->opening; });
+        if (entry->removed) {
+            error = "keystore tenant removed: " + name;
+            return Lease();
+        }
+        entry->lastUse = ++clock;
+        if (entry->handle != 0) {
+            ++entry->leases;
+            ++hits;
+            return Lease(this, entry, entry->handle);
+        }
+        entry->opening = true;
+    }
+
+    // Opening scans the keystore directory, so other tenants are not held up.
+    std::string openError;
+    const unsigned long long handle = ops.open(entry->config, openError);
+    const uint64_t bytes = handle != 0 && ops.footprint ? ops.footprint(entry->config) : 0;
+
+    std::vector<Victim> victims;
+    Lease lease;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entry->opening = false;
+        if (handle == 0) {
+            lastError = name + ": " + openError;
+            error = openError.empty() ? "cannot open keystore" : openError;
+        } else if (entry->removed) {
+            victims.emplace_back(entry->config, handle);
+            error = "keystore tenant removed: " + name;
+        } else {
+            entry->handle = handle;
+            entry->bytes = bytes;
+            ++entry->leases;
+            ++opens;
+            victims = evictLocked(entry.get());
+            lease = Lease(this, entry, handle);
+        }
+    }
+    opened.notify_all();
+    closeVictims(victims);
+    return lease;
+}
+
+void KeystoreRegistry::pin(const std::string& name, const std::string& address,
+                           std::chrono::steady_clock::time_point until)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        it->second->unlocked[normalizeAddress(address)] = until;
+    }
+}
+
+void KeystoreRegistry::unpin(const std::string& name, const std::string& address)
+{
+    std::vector<Victim> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            return;
+        }
+        it->second->unlocked.erase(normalizeAddress(address));
+        victims = evictLocked(nullptr);
+    }
+    closeVictims(victims);
+}
+
+KeystoreRegistry::Stats KeystoreRegistry::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.maxOpen = maxOpen;
+    s.maxBytes = maxBytes;
+    s.open = openCountLocked();
+    s.bytes = openBytesLocked();
+    s.hits = hits;
+    s.opens = opens;
+    s.evictions = evictions;
+    s.lastError = lastError;
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& item : entries) {
+        const Entry& entry = *item.second;
+        TenantStats tenant;
+        tenant.name = item.first;
+        tenant.config = entry.config;
+        tenant.open = entry.handle != 0;
+        tenant.leases = entry.leases;
+        tenant.bytes = entry.bytes;
+        for (const auto& unlocked : entry.unlocked) {
+            tenant.unlocked += unlocked.second > now ? 1 : 0;
+        }
+        s.tenants.push_back(tenant);
+    }
+    return s;
+}
+
+void KeystoreRegistry::closeAll()
+{
+    std::vector<Victim> victims;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (auto& item : entries) {
+            Entry& entry = *item.second;
+            opened.wait(lock, [&] { return !entry.opening; });
+            if (entry.handle != 0) {
+                // Leased handles close on release rather than under the caller.
+                if (entry.leases == 0) {
+                    victims.emplace_back(entry.config, entry.handle);
+                    entry.handle = 0;
+                    entry.bytes = 0;
+                } else {
+                    entry.closeOnRelease = true;
+                }
+            }
+            entry.unlocked.clear();
+        }
+    }
+    closeVictims(victims);
+}
+
+void KeystoreRegistry::release(const std::shared_ptr<Entry>& entry)
+{
+    std::vector<Victim> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entry->leases > 0) {
+            --entry->leases;
+        }
+        if ((entry->removed || entry->closeOnRelease) && entry->leases == 0 && entry->handle != 0) {
+            victims.emplace_back(entry->config, entry->handle);
+            entry->handle = 0;
+            entry->bytes = 0;
+            entry->closeOnRelease = false;
+        } else {
+            // Handles that were busy when the caps were last enforced may go now.
+            victims = evictLocked(nullptr);
+        }
+    }
+    closeVictims(victims);
+}
+
+std::vector<KeystoreRegistry::Victim> KeystoreRegistry::evictLocked(const Entry* keep)
+{
+    std::vector<Victim> victims;
+    const auto now = std::chrono::steady_clock::now();
+    while ((maxOpen != 0 && openCountLocked() > maxOpen) || (maxBytes != 0 && openBytesLocked() > maxBytes)) {
+        Entry* oldest = nullptr;
+        for (auto& item : entries) {
+            Entry* entry = item.second.get();
+            if (entry == keep || entry->handle == 0 || entry->leases != 0 || entry->pinned(now)) {
+                continue;
+            }
+            if (!oldest || entry->lastUse < oldest->lastUse) {
+                oldest = entry;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        victims.emplace_back(oldest->config, oldest->handle);
+        oldest->handle = 0;
+        oldest->bytes = 0;
+        ++evictions;
+    }
+    return victims;
+}
+
+void KeystoreRegistry::closeVictims(const std::vector<Victim>& victims)
+{
+    for (const auto& victim : victims) {
+        fprintf(stderr, "KeystoreRegistry: closing %s\n", victim.first.dir.c_str());
+        ops.close(victim.first, victim.second);
+    }
+}
+
+size_t KeystoreRegistry::openCountLocked() const
+{
+    size_t count = 0;
+    for (const auto& item : entries) {
+        count += item.second->handle != 0 ? 1 : 0;
+    }
+    return count;
+}
+
+uint64_t KeystoreRegistry::openBytesLocked() const
+{
+    uint64_t bytes = 0;
+    for (const auto& item : entries) {
+        bytes += item.second->bytes;
+    }
+    return bytes;
+}
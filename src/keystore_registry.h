@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Named keystores (one per tenant) whose SDK handles are opened on first use
+// and closed again, least recently used first, when more than maxOpen handles
+// or more than maxBytes of estimated memory are open. A handle is never closed
+// while a Lease on it is alive, nor while it holds unlocked accounts (those
+// only live inside the open handle), so the caps are soft: they can be
+// exceeded while every open handle is busy or pinned. Thread-safe.
+class KeystoreRegistry {
+public:
+    enum class Kind { Keystore, ExtKeystore };
+
+    struct Config {
+        Kind kind = Kind::Keystore;
+        std::string dir;
+        int64_t scryptN = 0;
+        int64_t scryptP = 0;
+    };
+
+    struct Ops {
+        // Returns the SDK handle, or 0 with error set.
+        std::function<unsigned long long(const Config& config, std::string& error)> open;
+        std::function<void(const Config& config, unsigned long long handle)> close;
+        // Estimated resident size of an open handle, in bytes.
+        std::function<uint64_t(const Config& config)> footprint;
+    };
+
+    struct TenantStats {
+        std::string name;
+        Config config;
+        bool open = false;
+        size_t leases = 0;
+        size_t unlocked = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct Stats {
+        size_t maxOpen = 0;
+        uint64_t maxBytes = 0;
+        size_t open = 0;
+        uint64_t bytes = 0;
+        uint64_t hits = 0;      // acquires served by an already open handle
+        uint64_t opens = 0;
+        uint64_t evictions = 0;
+        std::string lastError;
+        std::vector<TenantStats> tenants;
+    };
+
+    struct Entry;
+
+    // Keeps a tenant's handle open for as long as it is alive.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(KeystoreRegistry* registry, std::shared_ptr<Entry> entry, unsigned long long handle);
+        ~Lease();
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        explicit operator bool() const { return handle != 0; }
+        unsigned long long sdkHandle() const { return handle; }
+        Kind kind() const;
+
+    private:
+        void reset();
+
+        KeystoreRegistry* registry = nullptr;
+        std::shared_ptr<Entry> entry;
+        unsigned long long handle = 0;
+    };
+
+    static const size_t kDefaultMaxOpen = 8;
+
+    explicit KeystoreRegistry(Ops ops);
+    ~KeystoreRegistry();
+
+    KeystoreRegistry(const KeystoreRegistry&) = delete;
+    KeystoreRegistry& operator=(const KeystoreRegistry&) = delete;
+
+    // Registers a tenant without opening it. Re-registering the same
+    // configuration is a no-op; a different one needs remove() first.
+    bool add(const std::string& name, const Config& config);
+    // Forgets a tenant; its handle closes now, or when the last lease ends.
+    bool remove(const std::string& name);
+    // maxOpen 0 and maxBytes 0 mean unlimited.
+    void setLimits(size_t maxOpen, uint64_t maxBytes);
+    // Opens the tenant's handle if needed (evicting idle ones over the caps).
+    // An empty lease, with error set, when the tenant is unknown or opening fails.
+    Lease acquire(const std::string& name, std::string& error);
+
+    // Records that address is unlocked in the tenant's handle until `until`
+    // (time_point::max() for an indefinite unlock), which keeps it open.
+    void pin(const std::string& name, const std::string& address, std::chrono::steady_clock::time_point until);
+    void unpin(const std::string& name, const std::string& address);
+
+    Stats stats() const;
+    // Closes every handle; tenants stay registered.
+    void closeAll();
+
+private:
+    using Victim = std::pair<Config, unsigned long long>;
+
+    void release(const std::shared_ptr<Entry>& entry);
+    // Picks idle, unpinned handles to close until the caps hold.
+    std::vector<Victim> evictLocked(const Entry* keep);
+    void closeVictims(const std::vector<Victim>& victims);
+    size_t openCountLocked() const;
+    uint64_t openBytesLocked() const;
+
+    Ops ops;
+    mutable std::mutex mutex;
+    std::condition_variable opened;
+    std::map<std::string, std::shared_ptr<Entry>> entries;
+    size_t maxOpen;
+    uint64_t maxBytes;
+    uint64_t clock;
+    uint64_t hits;
+    uint64_t opens;
+    uint64_t evictions;
+    std::string lastError;
+};
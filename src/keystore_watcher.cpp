@@ -0,0 +1,359 @@
+#include "keystore_watcher.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <nlohmann/json.hpp>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+// Lower-case 0x-prefixed form used for the address index.
+std::string normalizeAddress(const std::string& address)
+{
+    std::string hex = address;
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex = hex.substr(2);
+    }
+    std::transform(hex.begin(), hex.end(), hex.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return "0x" + hex;
+}
+
+// Same filter as the SDK's account cache: skip hidden, temporary and backup files.
+bool isKeyFileName(const std::string& name)
+{
+    return !name.empty() && name[0] != '.' && name.back() != '~';
+}
+
+} // namespace
+
+KeystoreWatcher::KeystoreWatcher()
+    : inotifyFd(-1), wakeFd(-1), active(false), appliedGeneration(0), flushRequests(0), flushesDone(0)
+{
+}
+
+KeystoreWatcher::~KeystoreWatcher()
+{
+    stop();
+}
+
+bool KeystoreWatcher::start(const std::string& watchDir, int64_t debounceMs)
+{
+#ifdef __linux__
+    stop();
+    // The SDK keeps filepath.Abs(dir): absolute and cleaned, symlinks kept.
+    std::error_code ec;
+    dir = std::filesystem::absolute(watchDir, ec).lexically_normal().string();
+    if (ec) {
+        dir = watchDir;
+    }
+    while (dir.size() > 1 && dir.back() == '/') {
+        dir.pop_back();
+    }
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        fprintf(stderr, "KeystoreWatcher: inotify_init1 failed\n");
+        return false;
+    }
+    const uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE |
+                          IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotifyFd, dir.c_str(), mask) < 0) {
+        fprintf(stderr, "KeystoreWatcher: cannot watch %s\n", dir.c_str());
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    // Watch first, then scan, so files written in between are not missed.
+    rescan();
+    active = true;
+    thread = std::thread(&KeystoreWatcher::run, this, std::max<int64_t>(debounceMs, 0));
+    fprintf(stderr, "KeystoreWatcher: watching %s (debounce %lld ms)\n", dir.c_str(), (long long)debounceMs);
+    return true;
+#else
+    (void)watchDir;
+    (void)debounceMs;
+    fprintf(stderr, "KeystoreWatcher: inotify is not available on this platform\n");
+    return false;
+#endif
+}
+
+void KeystoreWatcher::stop()
+{
+    {
+        // Under the lock, so a flush() either sees the watcher stopped or has
+        // already signalled wakeFd, which stays open until the thread is gone.
+        std::lock_guard<std::mutex> lock(mutex);
+        active = false;
+    }
+    flushed.notify_all();
+#ifdef __linux__
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+        thread.join();
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+        wakeFd = -1;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(mutex);
+    files.clear();
+    addressIndex.clear();
+}
+
+bool KeystoreWatcher::running() const
+{
+    return active;
+}
+
+void KeystoreWatcher::flush()
+{
+#ifdef __linux__
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!active) {
+        return;
+    }
+    const uint64_t ticket = ++flushRequests;
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+    flushed.wait(lock, [&] { return !active || flushesDone >= ticket; });
+#endif
+}
+
+std::vector<std::string> KeystoreWatcher::accounts() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    result.reserve(files.size());
+    // files is keyed by name inside a single directory, so name order is URL order.
+    for (const auto& file : files) {
+        result.push_back(file.second.json);
+    }
+    return result;
+}
+
+bool KeystoreWatcher::hasAddress(const std::string& address) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return addressIndex.count(normalizeAddress(address)) != 0;
+}
+
+uint64_t KeystoreWatcher::generation() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return appliedGeneration;
+}
+
+bool KeystoreWatcher::readEntry(const std::string& name, Entry& entry) const
+{
+    const std::string path = dir + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    auto doc = nlohmann::json::parse(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(),
+                                     nullptr, false);
+    if (!doc.is_object() || !doc.contains("address") || !doc["address"].is_string()) {
+        return false;
+    }
+    entry.address = normalizeAddress(doc["address"].get<std::string>());
+    if (entry.address.size() != 42) {
+        return false;
+    }
+    nlohmann::json account;
+    account["address"] = entry.address;
+    account["url"] = "keystore://" + path;
+    entry.json = account.dump();
+    return true;
+}
+
+void KeystoreWatcher::rescan()
+{
+    std::vector<std::string> names;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (struct dirent* ent = readdir(d)) {
+            if (isKeyFileName(ent->d_name)) {
+                names.emplace_back(ent->d_name);
+            }
+        }
+        closedir(d);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        files.clear();
+        addressIndex.clear();
+    }
+    refresh(names);
+}
+
+void KeystoreWatcher::refresh(const std::vector<std::string>& names)
+{
+    // Parse outside the lock; readers only wait for the final swap of each entry.
+    std::vector<std::pair<std::string, Entry>> updates;
+    std::vector<std::string> removals;
+    for (const auto& name : names) {
+        Entry entry;
+        if (readEntry(name, entry)) {
+            updates.emplace_back(name, std::move(entry));
+        } else {
+            removals.push_back(name);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto unindex = [this](const std::string& name) {
+        auto it = files.find(name);
+        if (it == files.end()) {
+            return;
+        }
+        auto idx = addressIndex.find(it->second.address);
+        if (idx != addressIndex.end() && --idx->second == 0) {
+            addressIndex.erase(idx);
+        }
+        files.erase(it);
+    };
+    for (const auto& name : removals) {
+        unindex(name);
+    }
+    for (auto& update : updates) {
+        unindex(update.first);
+        ++addressIndex[update.second.address];
+        files.emplace(update.first, std::move(update.second));
+    }
+    ++appliedGeneration;
+}
+
+void KeystoreWatcher::run(int64_t debounceMs)
+{
+#ifdef __linux__
+    using Clock = std::chrono::steady_clock;
+    // Under a continuous stream of events, flush at least this often anyway.
+    const auto maxDelay = std::chrono::milliseconds(std::max<int64_t>(debounceMs * 10, 1000));
+    const auto debounce = std::chrono::milliseconds(debounceMs);
+
+    std::set<std::string> pending;
+    bool overflow = false;
+    bool gone = false;
+    Clock::time_point firstEvent;
+    Clock::time_point lastEvent;
+    alignas(struct inotify_event) char buf[16 * 1024];
+
+    while (active) {
+        int timeoutMs = -1;
+        if (!pending.empty() || overflow) {
+            auto deadline = std::min(lastEvent + debounce, firstEvent + maxDelay);
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            timeoutMs = static_cast<int>(std::max<int64_t>(left, 0));
+        }
+
+        struct pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        int ready = poll(fds, 2, timeoutMs);
+        if (!active) {
+            break;
+        }
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            uint64_t count = 0;
+            ssize_t n = read(wakeFd, &count, sizeof(count));
+            (void)n;
+        }
+        // Taken before draining: the events of every write a flush() waits
+        // for are queued by now.
+        uint64_t requested = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requested = flushRequests;
+        }
+        const bool flushing = requested != flushesDone;
+        if ((ready > 0 && (fds[0].revents & POLLIN)) || flushing) {
+            const bool wasIdle = pending.empty() && !overflow;
+            ssize_t len;
+            while ((len = read(inotifyFd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len;) {
+                    auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                    p += sizeof(struct inotify_event) + ev->len;
+                    if (ev->mask & IN_Q_OVERFLOW) {
+                        overflow = true;
+                    } else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                        gone = true;
+                    } else if (ev->len > 0 && isKeyFileName(ev->name)) {
+                        pending.insert(ev->name);
+                    }
+                }
+            }
+            lastEvent = Clock::now();
+            if (wasIdle) {
+                firstEvent = lastEvent;
+            }
+        }
+        if (gone) {
+            // The watch no longer follows the keystore directory: stop serving
+            // the view, so reads go back to the SDK until watched again.
+            fprintf(stderr, "KeystoreWatcher: %s went away, no longer watching\n", dir.c_str());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active = false;
+                files.clear();
+                addressIndex.clear();
+            }
+            flushed.notify_all();
+            break;
+        }
+
+        if (!pending.empty() || overflow) {
+            const auto now = Clock::now();
+            if (!flushing && now < lastEvent + debounce && now < firstEvent + maxDelay) {
+                continue;
+            }
+            if (overflow) {
+                fprintf(stderr, "KeystoreWatcher: event queue overflow, rescanning %s\n", dir.c_str());
+                rescan();
+            } else {
+                refresh(std::vector<std::string>(pending.begin(), pending.end()));
+            }
+            pending.clear();
+            overflow = false;
+        }
+        if (flushing) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                flushesDone = requested;
+            }
+            flushed.notify_all();
+        }
+    }
+#else
+    (void)debounceMs;
+#endif
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Keeps an in-memory view of the key files in a keystore directory, updated
+// incrementally from inotify events instead of rescanning on every query.
+// Bursts of events (bulk copies, restores) are coalesced: changed file names are
+// collected until the directory has been quiet for the debounce interval, then
+// only those files are re-read. flush() applies what is queued at once, so
+// writers of the directory can read their own writes. If the directory itself
+// is deleted or moved the watcher stops, and running() turns false.
+class KeystoreWatcher {
+public:
+    KeystoreWatcher();
+    ~KeystoreWatcher();
+
+    KeystoreWatcher(const KeystoreWatcher&) = delete;
+    KeystoreWatcher& operator=(const KeystoreWatcher&) = delete;
+
+    // Scans dir once and starts watching it. A relative dir is made absolute,
+    // as the SDK does, so URLs match its Accounts(). Returns false if the
+    // directory cannot be watched (or inotify is unavailable on this platform).
+    bool start(const std::string& dir, int64_t debounceMs);
+    void stop();
+    bool running() const;
+    // Applies every change made to the directory before the call, without
+    // waiting for the debounce interval; returns at once when not running.
+    void flush();
+
+    // Compact account JSON objects ({"address","url"}) sorted by URL, matching
+    // the SDK's Accounts() ordering.
+    std::vector<std::string> accounts() const;
+    bool hasAddress(const std::string& address) const;
+    // Incremented each time a batch of changes has been applied to the view.
+    uint64_t generation() const;
+
+private:
+    struct Entry {
+        std::string address;
+        std::string json;
+    };
+
+    void run(int64_t debounceMs);
+    void rescan();
+    void refresh(const std::vector<std::string>& names);
+    bool readEntry(const std::string& name, Entry& entry) const;
+
+    std::string dir;
+    int inotifyFd;
+    int wakeFd;
+    std::thread thread;
+    std::atomic<bool> active;
+
+    mutable std::mutex mutex;
+    std::condition_variable flushed;
+    std::map<std::string, Entry> files;
+    std::map<std::string, int> addressIndex;
+    uint64_t appliedGeneration;
+    uint64_t flushRequests;
+    uint64_t flushesDone;
+};
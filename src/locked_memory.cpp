@@ -0,0 +1,89 @@
+#include "locked_memory.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+} // namespace
+
+LockedSlab::LockedSlab(size_t slotSize)
+    : slotSize((slotSize + 15) & ~size_t(15)), pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))), allLocked(true)
+{
+    if (this->slotSize > pageSize) {
+        pageSize = (this->slotSize + pageSize - 1) / pageSize * pageSize;
+    }
+}
+
+LockedSlab::~LockedSlab()
+{
+    for (void* page : pages) {
+        wipe(page, pageSize);
+        munlock(page, pageSize);
+        munmap(page, pageSize);
+    }
+}
+
+void LockedSlab::addPage()
+{
+    void* page = mmap(nullptr, pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        fprintf(stderr, "LockedSlab: mmap failed: %s\n", strerror(errno));
+        return;
+    }
+    if (mlock(page, pageSize) != 0 && allLocked) {
+        allLocked = false;
+        fprintf(stderr, "LockedSlab: mlock failed, key material may be swapped: %s\n", strerror(errno));
+    }
+#ifdef MADV_DONTDUMP
+    madvise(page, pageSize, MADV_DONTDUMP);
+#endif
+    pages.push_back(page);
+    uint8_t* base = static_cast<uint8_t*>(page);
+    for (size_t offset = pageSize / slotSize * slotSize; offset >= slotSize; offset -= slotSize) {
+        freeSlots.push_back(base + offset - slotSize);
+    }
+}
+
+void* LockedSlab::allocate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeSlots.empty()) {
+        addPage();
+        if (freeSlots.empty()) {
+            return nullptr;
+        }
+    }
+    void* slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+void LockedSlab::release(void* slot)
+{
+    if (!slot) {
+        return;
+    }
+    wipe(slot, slotSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    freeSlots.push_back(slot);
+}
+
+bool LockedSlab::locked() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return allLocked;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Fixed-size slots for key material, carved from pages that are mlock()ed so
+// they never reach swap and, on Linux, excluded from core dumps. Slots are
+// wiped when released and the pages wiped before they are unmapped.
+// Thread-safe.
+class LockedSlab {
+public:
+    explicit LockedSlab(size_t slotSize);
+    ~LockedSlab();
+
+    LockedSlab(const LockedSlab&) = delete;
+    LockedSlab& operator=(const LockedSlab&) = delete;
+
+    // Zero-filled slot, or nullptr when no page could be mapped.
+    void* allocate();
+    void release(void* slot);
+
+    // False once mlock() has failed (usually RLIMIT_MEMLOCK); slots stay usable
+    // but may be swapped.
+    bool locked() const;
+
+private:
+    void addPage();
+
+    size_t slotSize;
+    size_t pageSize;
+    mutable std::mutex mutex;
+    std::vector<void*> pages;
+    std::vector<void*> freeSlots;
+    bool allLocked;
+};
@@ -0,0 +1,132 @@
+#include "memory_dir.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Removes path and, for a directory, its contents; symlinks are removed, never followed.
+void removeTree(const std::string& path)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        if (DIR* d = opendir(path.c_str())) {
+            while (dirent* entry = readdir(d)) {
+                if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                    removeTree(path + "/" + entry->d_name);
+                }
+            }
+            closedir(d);
+        }
+        rmdir(path.c_str());
+    } else {
+        unlink(path.c_str());
+    }
+}
+
+} // namespace
+
+std::string MemoryDir::root(Backing backing)
+{
+    struct stat st;
+    if (stat("/dev/shm", &st) == 0 && S_ISDIR(st.st_mode) && access("/dev/shm", W_OK | X_OK) == 0) {
+        return "/dev/shm";
+    }
+    if (backing == Backing::Memory) {
+        return std::string();
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    return tmp && *tmp ? tmp : "/tmp";
+}
+
+bool MemoryDir::create(const std::string& prefix, Backing backing)
+{
+    release();
+    const std::string base = root(backing);
+    if (base.empty()) {
+        fprintf(stderr, "MemoryDir: /dev/shm unavailable, not creating a disk-backed directory\n");
+        return false;
+    }
+    if (base != "/dev/shm") {
+        fprintf(stderr, "MemoryDir: /dev/shm unavailable, using %s\n", base.c_str());
+    }
+    std::vector<char> name(base.begin(), base.end());
+    const std::string suffix = "/" + prefix + std::to_string(getpid()) + "-XXXXXX";
+    name.insert(name.end(), suffix.begin(), suffix.end());
+    name.push_back('\0');
+    // mkdtemp creates the directory with mode 0700.
+    if (mkdtemp(name.data()) == nullptr) {
+        fprintf(stderr, "MemoryDir: cannot create directory under %s: %s\n", base.c_str(), std::strerror(errno));
+        return false;
+    }
+    dirPath = name.data();
+    return true;
+}
+
+void MemoryDir::sweep(const std::string& prefix)
+{
+    // /dev/shm, and the disk fallback a directory may have been made in
+    // while /dev/shm was unavailable.
+    std::vector<std::string> roots;
+    const std::string memory = root(Backing::Memory);
+    if (!memory.empty()) {
+        roots.push_back(memory);
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string disk = tmp && *tmp ? tmp : "/tmp";
+    if (disk != memory) {
+        roots.push_back(disk);
+    }
+    for (const auto& base : roots) {
+        DIR* d = opendir(base.c_str());
+        if (!d) {
+            continue;
+        }
+        std::vector<std::string> stale;
+        while (dirent* entry = readdir(d)) {
+            const std::string name = entry->d_name;
+            if (name.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            // prefix, then the decimal pid, then '-' and the random suffix.
+            char* end = nullptr;
+            const long pid = std::strtol(name.c_str() + prefix.size(), &end, 10);
+            if (end == name.c_str() + prefix.size() || *end != '-' || pid <= 0 || pid == getpid()) {
+                continue;
+            }
+            struct stat st;
+            const std::string path = base + "/" + name;
+            if (lstat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid()) {
+                continue;
+            }
+            if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) {
+                stale.push_back(path);
+            }
+        }
+        closedir(d);
+        for (const auto& path : stale) {
+            fprintf(stderr, "MemoryDir: removing %s, left by a process that has exited\n", path.c_str());
+            removeTree(path);
+        }
+    }
+}
+
+void MemoryDir::release()
+{
+    if (dirPath.empty()) {
+        return;
+    }
+    removeTree(dirPath);
+    dirPath.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+// A private directory on a memory-backed filesystem, for keystores whose keys
+// are thrown away with the process. The SDK still reads and writes key files
+// there, but on tmpfs nothing reaches a disk and fsync returns at once. The
+// directory and everything in it are removed by release() or the destructor.
+// Directory names carry the creating process id, so directories left behind by
+// a process that died can be found and removed by sweep().
+class MemoryDir {
+public:
+    // Memory: /dev/shm or nothing. MemoryOrDisk: falls back to $TMPDIR (or
+    // /tmp), which may be disk-backed, where /dev/shm is unavailable.
+    enum class Backing { Memory, MemoryOrDisk };
+
+    MemoryDir() = default;
+    ~MemoryDir() { release(); }
+
+    MemoryDir(const MemoryDir&) = delete;
+    MemoryDir& operator=(const MemoryDir&) = delete;
+
+    // Creates a fresh mode-0700 directory named prefix, the process id and a
+    // random suffix, releasing the previous one; false (logged) when none can
+    // be made, including when backing is Memory and /dev/shm is unavailable.
+    bool create(const std::string& prefix, Backing backing = Backing::Memory);
+    void release();
+
+    bool active() const { return !dirPath.empty(); }
+    const std::string& path() const { return dirPath; }
+
+    // Where create() puts directories for backing; "" when it cannot.
+    static std::string root(Backing backing = Backing::Memory);
+    // Removes this user's directories named prefix whose creating process is
+    // no longer running, under every root create() may use.
+    static void sweep(const std::string& prefix);
+
+private:
+    std::string dirPath;
+};
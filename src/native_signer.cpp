@@ -0,0 +1,325 @@
+#include "native_signer.h"
+
+#include "ecrecover.h"
+#include "secp256k1_curve.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+#include "chacha20_drbg.h"
+
+#include <cstdio>
+#include <secp256k1.h>
+#include <secp256k1_recovery.h>
+#endif
+
+namespace {
+
+std::string addressHex(const std::string& address)
+{
+    std::string hex = address;
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex.erase(0, 2);
+    }
+    std::transform(hex.begin(), hex.end(), hex.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return hex;
+}
+
+// The account address of a key, as lowercase hex.
+bool keyAddress(const uint8_t key[32], std::string& out)
+{
+    uint8_t pub[65];
+    if (!curvePublicKeyUncompressed(key, pub)) {
+        return false;
+    }
+    uint8_t address[kAddressSize];
+    publicKeyAddress(pub, address);
+    static const char kHex[] = "0123456789abcdef";
+    out.clear();
+    for (uint8_t byte : address) {
+        out += kHex[byte >> 4];
+        out += kHex[byte & 0x0f];
+    }
+    return true;
+}
+
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+// Randomised once against side channels, then only read, so all threads share it.
+const secp256k1_context* signingContext()
+{
+    static secp256k1_context* const context = [] {
+        secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+        uint8_t seed[32];
+        ChaCha20Drbg drbg;
+        if (drbg.generate(seed, sizeof(seed)) && !secp256k1_context_randomize(ctx, seed)) {
+            fprintf(stderr, "NativeSigner: could not randomise the secp256k1 context\n");
+        }
+        wipe(seed, sizeof(seed));
+        return ctx;
+    }();
+    return context;
+}
+#endif
+
+bool signHash(const uint8_t key[32], const uint8_t hash[32], uint8_t out[NativeSigner::kSignatureSize])
+{
+    int recoveryId = 0;
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+    secp256k1_ecdsa_recoverable_signature signature;
+    if (!secp256k1_ecdsa_sign_recoverable(signingContext(), &signature, hash, key, nullptr, nullptr)) {
+        return false;
+    }
+    secp256k1_ecdsa_recoverable_signature_serialize_compact(signingContext(), out, &recoveryId, &signature);
+#else
+    if (!curveSign(key, hash, out, recoveryId)) {
+        return false;
+    }
+#endif
+    out[64] = static_cast<uint8_t>(recoveryId);
+    return true;
+}
+
+} // namespace
+
+NativeSigner::NativeSigner()
+    : slab(32), passphrases(kMaxDeferredPassphrase + 1), clearGeneration(0), nextGeneration(0), signatures(0), misses(0), expired(0) {}
+
+NativeSigner::~NativeSigner()
+{
+    clear();
+}
+
+const char* NativeSigner::backend()
+{
+#ifdef ACCOUNTS_HAVE_LIBSECP256K1
+    return "libsecp256k1";
+#else
+    return "builtin";
+#endif
+}
+
+uint64_t NativeSigner::generation(const std::string& scope, const std::string& address) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return generationLocked(accountKey(scope, address));
+}
+
+bool NativeSigner::unlocked(const std::string& scope, const std::string& address, const uint8_t key[32],
+                            std::chrono::steady_clock::time_point until, uint64_t generation,
+                            const std::string* sdkPassphrase)
+{
+    if (sdkPassphrase && sdkPassphrase->size() > kMaxDeferredPassphrase) {
+        return false;
+    }
+    std::string derived;
+    if (!keyAddress(key, derived) || derived != addressHex(address)) {
+        return false;
+    }
+    const std::string account = accountKey(scope, address);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (generationLocked(account) != generation) {
+        return false;
+    }
+    auto it = keys.find(account);
+    if (it == keys.end()) {
+        uint8_t* secret = static_cast<uint8_t*>(slab.allocate());
+        if (!secret) {
+            return false;
+        }
+        it = keys.emplace(account, Key{secret, until, nullptr, std::string()}).first;
+    } else if (it->second.until != std::chrono::steady_clock::time_point::max()) {
+        it->second.until = until;
+    }
+    Key& held = it->second;
+    if (sdkPassphrase) {
+        if (!held.sdkPassphrase) {
+            held.sdkPassphrase = static_cast<uint8_t*>(passphrases.allocate());
+            if (!held.sdkPassphrase) {
+                eraseLocked(it);
+                return false;
+            }
+        }
+        held.sdkPassphrase[0] = static_cast<uint8_t>(sdkPassphrase->size());
+        memcpy(held.sdkPassphrase + 1, sdkPassphrase->data(), sdkPassphrase->size());
+        held.sdkAddress = address;
+    } else if (held.sdkPassphrase) {
+        passphrases.release(held.sdkPassphrase);
+        held.sdkPassphrase = nullptr;
+    }
+    memcpy(held.secret, key, 32);
+    return true;
+}
+
+bool NativeSigner::takeSdkUnlock(const std::string& scope, const std::string& address, SdkUnlock& out)
+{
+    const std::string account = accountKey(scope, address);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = keys.find(account);
+        if (it == keys.end() || !it->second.sdkPassphrase) {
+            return false;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = keys.find(account);
+    if (it == keys.end() || !it->second.sdkPassphrase || std::chrono::steady_clock::now() >= it->second.until) {
+        return false;
+    }
+    takeLocked(account, it->second, out);
+    return true;
+}
+
+std::vector<NativeSigner::SdkUnlock> NativeSigner::takeSdkUnlocks(const std::string& scope)
+{
+    const std::string prefix = scope + '\n';
+    std::vector<SdkUnlock> result;
+    const auto now = std::chrono::steady_clock::now();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto it = keys.lower_bound(prefix); it != keys.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (it->second.sdkPassphrase && now < it->second.until) {
+            result.emplace_back();
+            takeLocked(it->first, it->second, result.back());
+        }
+    }
+    return result;
+}
+
+void NativeSigner::invalidate(const std::string& scope, const std::string& address)
+{
+    const std::string account = accountKey(scope, address);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    accountGenerations[account] = ++nextGeneration;
+    auto it = keys.find(account);
+    if (it != keys.end()) {
+        eraseLocked(it);
+    }
+}
+
+void NativeSigner::invalidateScope(const std::string& scope)
+{
+    const std::string prefix = scope + '\n';
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    scopeGenerations[scope] = ++nextGeneration;
+    // The scope's generation is now the newest of its accounts.
+    for (auto g = accountGenerations.lower_bound(prefix);
+         g != accountGenerations.end() && g->first.compare(0, prefix.size(), prefix) == 0;) {
+        g = accountGenerations.erase(g);
+    }
+    auto it = keys.lower_bound(prefix);
+    while (it != keys.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        auto next = std::next(it);
+        eraseLocked(it);
+        it = next;
+    }
+}
+
+void NativeSigner::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    clearGeneration = ++nextGeneration;
+    accountGenerations.clear();
+    scopeGenerations.clear();
+    while (!keys.empty()) {
+        eraseLocked(keys.begin());
+    }
+}
+
+bool NativeSigner::sign(const std::string& scope, const std::string& address, const uint8_t hash[32],
+                        uint8_t out[kSignatureSize])
+{
+    const std::string account = accountKey(scope, address);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = keys.find(account);
+        if (it == keys.end()) {
+            ++misses;
+            return false;
+        }
+        if (std::chrono::steady_clock::now() < it->second.until) {
+            if (!signHash(it->second.secret, hash, out)) {
+                return false;
+            }
+            ++signatures;
+            return true;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = keys.find(account);
+    if (it != keys.end() && std::chrono::steady_clock::now() >= it->second.until) {
+        eraseLocked(it);
+        ++expired;
+    }
+    ++misses;
+    return false;
+}
+
+NativeSigner::Stats NativeSigner::stats() const
+{
+    Stats s;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        s.keys = keys.size();
+        for (const auto& entry : keys) {
+            s.deferredUnlocks += entry.second.sdkPassphrase != nullptr;
+        }
+    }
+    s.signatures = signatures;
+    s.misses = misses;
+    s.expired = expired;
+    return s;
+}
+
+std::string NativeSigner::accountKey(const std::string& scope, const std::string& address)
+{
+    return scope + '\n' + addressHex(address);
+}
+
+std::string NativeSigner::scopeOf(const std::string& account)
+{
+    return account.substr(0, account.find('\n'));
+}
+
+uint64_t NativeSigner::generationLocked(const std::string& account) const
+{
+    uint64_t generation = clearGeneration;
+    auto a = accountGenerations.find(account);
+    if (a != accountGenerations.end()) {
+        generation = std::max(generation, a->second);
+    }
+    auto s = scopeGenerations.find(scopeOf(account));
+    if (s != scopeGenerations.end()) {
+        generation = std::max(generation, s->second);
+    }
+    return generation;
+}
+
+void NativeSigner::eraseLocked(Keys::iterator it)
+{
+    slab.release(it->second.secret);
+    if (it->second.sdkPassphrase) {
+        passphrases.release(it->second.sdkPassphrase);
+    }
+    keys.erase(it);
+}
+
+void NativeSigner::takeLocked(const std::string& account, Key& key, SdkUnlock& out)
+{
+    out.address = key.sdkAddress;
+    out.passphrase.assign(reinterpret_cast<const char*>(key.sdkPassphrase + 1), key.sdkPassphrase[0]);
+    out.until = key.until;
+    out.generation = generationLocked(account);
+    passphrases.release(key.sdkPassphrase);
+    key.sdkPassphrase = nullptr;
+}
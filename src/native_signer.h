@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "locked_memory.h"
+
+// Private keys of unlocked accounts, kept in locked memory so SignHash can be
+// answered without the SDK. Signatures are what the SDK returns for the same
+// key and hash: ECDSA over secp256k1 with an RFC 6979 nonce and low S, as
+// r || s || v with v the recovery id. They are made with libsecp256k1 when the
+// module is built with it (ACCOUNTS_HAVE_LIBSECP256K1), with the constant-time
+// curve of secp256k1_curve.h otherwise.
+//
+// Keys are held per keystore scope and address until the expiry of their
+// unlock, and wiped when that has passed, when invalidated or when the signer
+// is destroyed. sign() only takes a shared lock, so threads sign in parallel.
+// A key can carry the passphrase of an SDK unlock that was put off (so its
+// key derivation only runs if an SDK call needs the account unlocked); it is
+// kept in locked memory too and handed out once by takeSdkUnlock.
+// Thread-safe.
+class NativeSigner {
+public:
+    static const size_t kSignatureSize = 65;
+    // Longest passphrase held for a deferred SDK unlock.
+    static const size_t kMaxDeferredPassphrase = 255;
+
+    // A deferred SDK unlock: the account as passed to unlocked(), the
+    // passphrase, the expiry of the unlock and the account's generation when
+    // it was handed out.
+    struct SdkUnlock {
+        std::string address;
+        std::string passphrase;
+        std::chrono::steady_clock::time_point until;
+        uint64_t generation = 0;
+    };
+
+    struct Stats {
+        size_t keys = 0;
+        size_t deferredUnlocks = 0; // keys still carrying a deferred SDK unlock
+        uint64_t signatures = 0;
+        uint64_t misses = 0; // sign() calls for an account with no live key
+        uint64_t expired = 0;
+    };
+
+    NativeSigner();
+    ~NativeSigner();
+
+    NativeSigner(const NativeSigner&) = delete;
+    NativeSigner& operator=(const NativeSigner&) = delete;
+
+    // "libsecp256k1" or "builtin".
+    static const char* backend();
+
+    // Changes whenever the account's key is invalidated (directly, with its
+    // scope or by clear()). Taken before the SDK unlock so a Lock that lands
+    // between that unlock and unlocked() is not undone.
+    uint64_t generation(const std::string& scope, const std::string& address) const;
+    // Holds a copy of key until `until` (time_point::max() for an unlock
+    // without timeout); as in the SDK, a timed unlock does not shorten an
+    // indefinite one. False when key is not the key of address, the account
+    // was invalidated since generation was taken or no locked slot could be
+    // mapped. With sdkPassphrase the SDK's unlock is deferred: the passphrase
+    // (at most kMaxDeferredPassphrase bytes, false otherwise) is held with the
+    // key for takeSdkUnlock. Without it, a deferred unlock still held for the
+    // account is dropped, the SDK having been unlocked directly.
+    bool unlocked(const std::string& scope, const std::string& address, const uint8_t key[32],
+                  std::chrono::steady_clock::time_point until, uint64_t generation,
+                  const std::string* sdkPassphrase = nullptr);
+    // Hands out the deferred SDK unlock of the account, once; false when there
+    // is none or its key has expired. The caller wipes out.passphrase.
+    bool takeSdkUnlock(const std::string& scope, const std::string& address, SdkUnlock& out);
+    // Hands out every deferred SDK unlock of scope, for instance before the
+    // keys are cleared.
+    std::vector<SdkUnlock> takeSdkUnlocks(const std::string& scope);
+    void invalidate(const std::string& scope, const std::string& address);
+    // Wipes the keys of a keystore that was closed or reopened.
+    void invalidateScope(const std::string& scope);
+    void clear();
+
+    // Signs a 32-byte hash with the account's key; false when no unexpired
+    // key is held for it.
+    bool sign(const std::string& scope, const std::string& address, const uint8_t hash[32], uint8_t out[kSignatureSize]);
+
+    Stats stats() const;
+
+private:
+    struct Key {
+        uint8_t* secret;
+        std::chrono::steady_clock::time_point until;
+        // Length byte and passphrase of a deferred SDK unlock, or nullptr.
+        uint8_t* sdkPassphrase;
+        std::string sdkAddress;
+    };
+    using Keys = std::map<std::string, Key>;
+
+    static std::string accountKey(const std::string& scope, const std::string& address);
+    static std::string scopeOf(const std::string& account);
+    void eraseLocked(Keys::iterator it);
+    void takeLocked(const std::string& account, Key& key, SdkUnlock& out);
+    uint64_t generationLocked(const std::string& account) const;
+
+    LockedSlab slab;
+    LockedSlab passphrases;
+    mutable std::shared_mutex mutex;
+    Keys keys;
+    // Generations of invalidated accounts and scopes, from one counter so
+    // the later invalidation of either wins; clearGeneration covers clear().
+    std::map<std::string, uint64_t> accountGenerations;
+    std::map<std::string, uint64_t> scopeGenerations;
+    uint64_t clearGeneration;
+    uint64_t nextGeneration;
+    std::atomic<uint64_t> signatures;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> expired;
+};
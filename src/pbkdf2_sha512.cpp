@@ -0,0 +1,272 @@
+#include "pbkdf2_sha512.h"
+
+#include "sha512.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ACCOUNTS_PBKDF2_X86 1
+#endif
+
+namespace {
+
+const size_t kMaxLanes = 8;
+
+// Per-job state handed to the lane kernels: HMAC pad states, the running U
+// value and the XOR accumulator, all as host-order SHA-512 words.
+struct LaneState {
+    uint64_t inner[8];
+    uint64_t outer[8];
+    uint64_t u[8];
+    uint64_t acc[8];
+};
+
+// A macro rather than a function so 256/512-bit lane types are never passed
+// by value outside the target-specific callers.
+#define ACCOUNTS_ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+// Sha512::compress written against a lane type: uint64_t for the portable path,
+// a GCC/Clang vector of 4 or 8 words for the SIMD paths.
+template <typename V>
+__attribute__((always_inline)) inline void compressLanes(V state[8], const V block[16])
+{
+    V w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = block[i];
+    }
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 80; ++i) {
+        // Rolling 16-word message schedule.
+        V wi;
+        if (i < 16) {
+            wi = w[i];
+        } else {
+            const V w15 = w[(i - 15) & 15];
+            const V w2 = w[(i - 2) & 15];
+            const V s0 = ACCOUNTS_ROTR64(w15, 1) ^ ACCOUNTS_ROTR64(w15, 8) ^ (w15 >> 7);
+            const V s1 = ACCOUNTS_ROTR64(w2, 19) ^ ACCOUNTS_ROTR64(w2, 61) ^ (w2 >> 6);
+            wi = w[i & 15] + s0 + w[(i - 7) & 15] + s1;
+            w[i & 15] = wi;
+        }
+        const V t1 = h + (ACCOUNTS_ROTR64(e, 14) ^ ACCOUNTS_ROTR64(e, 18) ^ ACCOUNTS_ROTR64(e, 41)) + ((e & f) ^ (~e & g)) + Sha512::kRound[i] + wi;
+        const V t2 = (ACCOUNTS_ROTR64(a, 28) ^ ACCOUNTS_ROTR64(a, 34) ^ ACCOUNTS_ROTR64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+template <typename V>
+__attribute__((always_inline)) inline uint64_t lane(const V& v, size_t l)
+{
+    return v[l];
+}
+
+template <>
+__attribute__((always_inline)) inline uint64_t lane(const uint64_t& v, size_t)
+{
+    return v;
+}
+
+template <typename V>
+__attribute__((always_inline)) inline void setLane(V& v, size_t l, uint64_t x)
+{
+    v[l] = x;
+}
+
+template <>
+__attribute__((always_inline)) inline void setLane(uint64_t& v, size_t, uint64_t x)
+{
+    v = x;
+}
+
+// Runs iterations 2..n for N jobs side by side. Each iteration hashes the
+// 64-byte U value as one padded block (message length 128 + 64 bytes) under
+// the inner pad state, then the inner digest under the outer pad state.
+template <typename V, size_t N>
+__attribute__((always_inline)) inline void iterateLanes(LaneState* jobs, uint32_t iterations)
+{
+    V inner[8], outer[8], u[8], acc[8];
+    for (int k = 0; k < 8; ++k) {
+        for (size_t l = 0; l < N; ++l) {
+            setLane(inner[k], l, jobs[l].inner[k]);
+            setLane(outer[k], l, jobs[l].outer[k]);
+            setLane(u[k], l, jobs[l].u[k]);
+            setLane(acc[k], l, jobs[l].acc[k]);
+        }
+    }
+    V block[16];
+    for (int k = 8; k < 16; ++k) {
+        block[k] = V{};
+    }
+    block[8] += 0x8000000000000000ULL;
+    block[15] += (Sha512::kBlockSize + Sha512::kDigestSize) * 8;
+
+    for (uint32_t it = 1; it < iterations; ++it) {
+        V state[8];
+        for (int k = 0; k < 8; ++k) {
+            block[k] = u[k];
+            state[k] = inner[k];
+        }
+        compressLanes(state, block);
+        for (int k = 0; k < 8; ++k) {
+            block[k] = state[k];
+            state[k] = outer[k];
+        }
+        compressLanes(state, block);
+        for (int k = 0; k < 8; ++k) {
+            u[k] = state[k];
+            acc[k] ^= state[k];
+        }
+    }
+    for (int k = 0; k < 8; ++k) {
+        for (size_t l = 0; l < N; ++l) {
+            jobs[l].acc[k] = lane(acc[k], l);
+        }
+    }
+}
+
+void iterateScalar(LaneState* jobs, uint32_t iterations)
+{
+    iterateLanes<uint64_t, 1>(jobs, iterations);
+}
+
+#ifdef ACCOUNTS_PBKDF2_X86
+
+typedef uint64_t U64x4 __attribute__((vector_size(32)));
+typedef uint64_t U64x8 __attribute__((vector_size(64)));
+
+__attribute__((target("avx2")))
+void iterateAvx2(LaneState* jobs, uint32_t iterations)
+{
+    iterateLanes<U64x4, 4>(jobs, iterations);
+}
+
+__attribute__((target("avx512f")))
+void iterateAvx512(LaneState* jobs, uint32_t iterations)
+{
+    iterateLanes<U64x8, 8>(jobs, iterations);
+}
+
+#endif
+
+struct Kernel {
+    void (*iterate)(LaneState*, uint32_t);
+    size_t lanes;
+    const char* name;
+};
+
+Kernel selectKernel()
+{
+#ifdef ACCOUNTS_PBKDF2_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {iterateAvx512, 8, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {iterateAvx2, 4, "avx2"};
+    }
+#endif
+    return {iterateScalar, 1, "scalar"};
+}
+
+const Kernel kernel = selectKernel();
+
+// HMAC pad states and U1 = HMAC(password, salt || INT(1)) for one job. The
+// pad states are captured after the 128-byte keyed block, before the message.
+void prepare(const Pbkdf2Sha512Job& job, LaneState& lane)
+{
+    uint8_t key[Sha512::kBlockSize] = {};
+    if (job.passwordSize > Sha512::kBlockSize) {
+        Sha512::hash(job.password, job.passwordSize, key);
+    } else if (job.passwordSize > 0) {
+        memcpy(key, job.password, job.passwordSize);
+    }
+    uint8_t keyed[Sha512::kBlockSize];
+    static const uint8_t blockIndex[4] = {0, 0, 0, 1};
+
+    for (size_t i = 0; i < sizeof(keyed); ++i) {
+        keyed[i] = key[i] ^ 0x36;
+    }
+    Sha512 inner;
+    inner.update(keyed, sizeof(keyed));
+    inner.stateWords(lane.inner);
+    inner.update(job.salt, job.saltSize);
+    inner.update(blockIndex, sizeof(blockIndex));
+    uint8_t digest[Sha512::kDigestSize];
+    inner.finish(digest);
+
+    for (size_t i = 0; i < sizeof(keyed); ++i) {
+        keyed[i] = key[i] ^ 0x5c;
+    }
+    Sha512 outer;
+    outer.update(keyed, sizeof(keyed));
+    outer.stateWords(lane.outer);
+    outer.update(digest, sizeof(digest));
+    outer.finish(digest);
+
+    for (int k = 0; k < 8; ++k) {
+        uint64_t v = 0;
+        for (int j = 0; j < 8; ++j) {
+            v = (v << 8) | digest[8 * k + j];
+        }
+        lane.u[k] = v;
+        lane.acc[k] = v;
+    }
+    memset(key, 0, sizeof(key));
+    memset(keyed, 0, sizeof(keyed));
+    memset(digest, 0, sizeof(digest));
+}
+
+#undef ACCOUNTS_ROTR64
+
+} // namespace
+
+void pbkdf2HmacSha512Batch(const Pbkdf2Sha512Job* jobs, size_t count, uint32_t iterations)
+{
+    LaneState lanes[kMaxLanes];
+    for (size_t first = 0; first < count; first += kernel.lanes) {
+        const size_t used = count - first < kernel.lanes ? count - first : kernel.lanes;
+        for (size_t l = 0; l < used; ++l) {
+            prepare(jobs[first + l], lanes[l]);
+        }
+        // Idle lanes repeat the last job; their results are discarded.
+        for (size_t l = used; l < kernel.lanes; ++l) {
+            lanes[l] = lanes[used - 1];
+        }
+        kernel.iterate(lanes, iterations);
+        for (size_t l = 0; l < used; ++l) {
+            uint8_t* out = jobs[first + l].out;
+            for (int k = 0; k < 8; ++k) {
+                for (int j = 0; j < 8; ++j) {
+                    out[8 * k + j] = static_cast<uint8_t>(lanes[l].acc[k] >> (56 - 8 * j));
+                }
+            }
+        }
+    }
+    memset(lanes, 0, sizeof(lanes));
+}
+
+size_t pbkdf2Sha512Lanes()
+{
+    return kernel.lanes;
+}
+
+const char* pbkdf2Sha512Kernel()
+{
+    return kernel.name;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// PBKDF2-HMAC-SHA512 (RFC 8018) for many passwords at once, producing one
+// 64-byte output block per job (the BIP-39 seed size). After the first
+// iteration every HMAC input is a single fixed-shape block, so the remaining
+// iterations run as a multi-buffer kernel: 8 jobs per AVX-512 register, 4 per
+// AVX2 register, or one at a time on the portable path. The kernel is picked
+// once at startup from the CPU features.
+struct Pbkdf2Sha512Job {
+    const uint8_t* password;
+    size_t passwordSize;
+    const uint8_t* salt;
+    size_t saltSize;
+    uint8_t* out; // 64 bytes
+};
+
+void pbkdf2HmacSha512Batch(const Pbkdf2Sha512Job* jobs, size_t count, uint32_t iterations);
+
+// Jobs processed together by the selected kernel; batches that are a multiple
+// of this keep every lane busy.
+size_t pbkdf2Sha512Lanes();
+// "avx512", "avx2" or "scalar".
+const char* pbkdf2Sha512Kernel();
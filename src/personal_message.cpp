@@ -0,0 +1,141 @@
+#include "personal_message.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+PersonalMessageHasher::PersonalMessageHasher(uint64_t length) : left(length)
+{
+    const std::string prefix = "\x19" "Ethereum Signed Message:\n" + std::to_string(length);
+    keccak.update(reinterpret_cast<const uint8_t*>(prefix.data()), prefix.size());
+}
+
+bool PersonalMessageHasher::update(const uint8_t* data, size_t size)
+{
+    if (size > left) {
+        return false;
+    }
+    keccak.update(data, size);
+    left -= size;
+    return true;
+}
+
+bool PersonalMessageHasher::finish(uint8_t out[Keccak256::kDigestSize])
+{
+    if (left != 0) {
+        return false;
+    }
+    keccak.finish(out);
+    return true;
+}
+
+bool personalMessageHashFd(int fd, int64_t length, uint8_t out[Keccak256::kDigestSize], std::string& error)
+{
+    if (length < 0) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            error = "length is required unless fd is a regular file";
+            return false;
+        }
+        const off_t offset = std::max<off_t>(lseek(fd, 0, SEEK_CUR), 0);
+        length = offset < st.st_size ? st.st_size - offset : 0;
+    }
+    PersonalMessageHasher hasher(static_cast<uint64_t>(length));
+    uint8_t buffer[64 * 1024];
+    while (hasher.remaining() > 0) {
+        const size_t want = hasher.remaining() < sizeof(buffer) ? static_cast<size_t>(hasher.remaining()) : sizeof(buffer);
+        const ssize_t n = read(fd, buffer, want);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("read failed: ") + strerror(errno);
+            return false;
+        }
+        if (n == 0) {
+            error = "input ended " + std::to_string(hasher.remaining()) + " bytes short";
+            return false;
+        }
+        hasher.update(buffer, static_cast<size_t>(n));
+    }
+    return hasher.finish(out);
+}
+
+PersonalMessageSessions::PersonalMessageSessions() : nextId(1) {}
+
+int64_t PersonalMessageSessions::begin(const std::string& scope, const std::string& address, uint64_t keystoreGeneration,
+                                       uint64_t length)
+{
+    auto session = std::make_shared<Session>(scope, address, keystoreGeneration, length);
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        std::unique_lock<std::mutex> busy(it->second->mutex, std::try_to_lock);
+        if (busy.owns_lock() && now - it->second->lastUse >= kIdleTimeout) {
+            busy.unlock();
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (sessions.size() >= kMaxSessions) {
+        return 0;
+    }
+    const int64_t id = nextId++;
+    sessions.emplace(id, std::move(session));
+    return id;
+}
+
+bool PersonalMessageSessions::update(int64_t id, const uint8_t* data, size_t size)
+{
+    std::shared_ptr<Session> session = find(id);
+    if (!session) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->lastUse = std::chrono::steady_clock::now();
+    return session->hasher.update(data, size);
+}
+
+bool PersonalMessageSessions::finish(int64_t id, std::string& scope, std::string& address, uint64_t& keystoreGeneration,
+                                     uint8_t digest[Keccak256::kDigestSize])
+{
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sessions.find(id);
+        if (it == sessions.end()) {
+            return false;
+        }
+        session = std::move(it->second);
+        sessions.erase(it);
+    }
+    // Waits for an update still running on another thread.
+    std::lock_guard<std::mutex> lock(session->mutex);
+    scope = session->scope;
+    address = session->address;
+    keystoreGeneration = session->keystoreGeneration;
+    return session->hasher.finish(digest);
+}
+
+bool PersonalMessageSessions::abort(int64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.erase(id) > 0;
+}
+
+size_t PersonalMessageSessions::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+std::shared_ptr<PersonalMessageSessions::Session> PersonalMessageSessions::find(int64_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessions.find(id);
+    return it == sessions.end() ? nullptr : it->second;
+}
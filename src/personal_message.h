@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "keccak.h"
+
+// EIP-191 personal-message digests (version 0x45, what personal_sign and
+// eth_sign hash): keccak256("\x19Ethereum Signed Message:\n" || decimal
+// length || message), computed incrementally so a large message is never
+// held whole. The length is part of the prefix, so it is declared up front
+// and the digest is only produced once exactly that many bytes were added.
+class PersonalMessageHasher {
+public:
+    explicit PersonalMessageHasher(uint64_t length);
+
+    // False, adding nothing, when data would go past the declared length.
+    bool update(const uint8_t* data, size_t size);
+    uint64_t remaining() const { return left; }
+    // False unless the whole message was added.
+    bool finish(uint8_t out[Keccak256::kDigestSize]);
+
+private:
+    Keccak256 keccak;
+    uint64_t left;
+};
+
+// Reads `length` bytes from fd (all of a regular file from its current
+// offset when length < 0) into a personal-message digest, through a fixed
+// buffer. The descriptor is borrowed, not closed. False with the reason in
+// error on a read error or short input.
+bool personalMessageHashFd(int fd, int64_t length, uint8_t out[Keccak256::kDigestSize], std::string& error);
+
+// Open streaming sign requests: a digest in progress with the keystore scope,
+// the generation of the keystore it was begun on and the account it is for,
+// behind ids that are never reused. Sessions idle for
+// kIdleTimeout are dropped when the next one begins. Updates to different
+// sessions run in parallel. Thread-safe.
+class PersonalMessageSessions {
+public:
+    static const size_t kMaxSessions = 1024;
+    static constexpr std::chrono::minutes kIdleTimeout{10};
+
+    PersonalMessageSessions();
+
+    PersonalMessageSessions(const PersonalMessageSessions&) = delete;
+    PersonalMessageSessions& operator=(const PersonalMessageSessions&) = delete;
+
+    // New id (> 0); 0 when kMaxSessions are open.
+    int64_t begin(const std::string& scope, const std::string& address, uint64_t keystoreGeneration, uint64_t length);
+    // False for an unknown id or data past the declared length; the session
+    // stays open either way.
+    bool update(int64_t id, const uint8_t* data, size_t size);
+    // Closes the session; false for an unknown id or an incomplete message.
+    bool finish(int64_t id, std::string& scope, std::string& address, uint64_t& keystoreGeneration,
+                uint8_t digest[Keccak256::kDigestSize]);
+    bool abort(int64_t id);
+    size_t size() const;
+
+private:
+    struct Session {
+        std::mutex mutex;
+        std::string scope;
+        std::string address;
+        uint64_t keystoreGeneration;
+        PersonalMessageHasher hasher;
+        std::chrono::steady_clock::time_point lastUse;
+
+        Session(const std::string& scope, const std::string& address, uint64_t keystoreGeneration, uint64_t length)
+            : scope(scope), address(address), keystoreGeneration(keystoreGeneration), hasher(length),
+              lastUse(std::chrono::steady_clock::now())
+        {
+        }
+    };
+
+    std::shared_ptr<Session> find(int64_t id) const;
+
+    mutable std::mutex mutex;
+    std::unordered_map<int64_t, std::shared_ptr<Session>> sessions;
+    int64_t nextId;
+};
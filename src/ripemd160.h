@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// RIPEMD-160, one-shot. Only used for BIP-32 key fingerprints
+// (RIPEMD-160 of SHA-256 of the compressed public key).
+void ripemd160(const uint8_t* data, size_t size, uint8_t out[20]);
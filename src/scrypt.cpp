@@ -0,0 +1,334 @@
+#include "scrypt.h"
+
+#include "sha256.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ACCOUNTS_SCRYPT_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Lanes running at once share this much ROMix memory; one lane always runs.
+const uint64_t kMemoryBudget = uint64_t(1) << 30;
+
+// Overwrites secrets in a way the optimiser may not drop, even right before
+// the memory is freed. V is up to kScryptMaxLaneBytes, so glibc's
+// explicit_bzero is used where it exists rather than a byte-wise loop.
+void wipe(void* p, size_t size)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+    explicit_bzero(p, size);
+#else
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+#endif
+}
+
+inline uint32_t load32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32(uint8_t* p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint32_t rotl(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+// Portable kernel: words in their natural order.
+
+void salsa208(uint32_t b[16])
+{
+    uint32_t x[16];
+    memcpy(x, b, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        x[4] ^= rotl(x[0] + x[12], 7);   x[8] ^= rotl(x[4] + x[0], 9);
+        x[12] ^= rotl(x[8] + x[4], 13);  x[0] ^= rotl(x[12] + x[8], 18);
+        x[9] ^= rotl(x[5] + x[1], 7);    x[13] ^= rotl(x[9] + x[5], 9);
+        x[1] ^= rotl(x[13] + x[9], 13);  x[5] ^= rotl(x[1] + x[13], 18);
+        x[14] ^= rotl(x[10] + x[6], 7);  x[2] ^= rotl(x[14] + x[10], 9);
+        x[6] ^= rotl(x[2] + x[14], 13);  x[10] ^= rotl(x[6] + x[2], 18);
+        x[3] ^= rotl(x[15] + x[11], 7);  x[7] ^= rotl(x[3] + x[15], 9);
+        x[11] ^= rotl(x[7] + x[3], 13);  x[15] ^= rotl(x[11] + x[7], 18);
+
+        x[1] ^= rotl(x[0] + x[3], 7);    x[2] ^= rotl(x[1] + x[0], 9);
+        x[3] ^= rotl(x[2] + x[1], 13);   x[0] ^= rotl(x[3] + x[2], 18);
+        x[6] ^= rotl(x[5] + x[4], 7);    x[7] ^= rotl(x[6] + x[5], 9);
+        x[4] ^= rotl(x[7] + x[6], 13);   x[5] ^= rotl(x[4] + x[7], 18);
+        x[11] ^= rotl(x[10] + x[9], 7);  x[8] ^= rotl(x[11] + x[10], 9);
+        x[9] ^= rotl(x[8] + x[11], 13);  x[10] ^= rotl(x[9] + x[8], 18);
+        x[12] ^= rotl(x[15] + x[14], 7); x[13] ^= rotl(x[12] + x[15], 9);
+        x[14] ^= rotl(x[13] + x[12], 13); x[15] ^= rotl(x[14] + x[13], 18);
+    }
+    for (int i = 0; i < 16; ++i) {
+        b[i] += x[i];
+    }
+}
+
+// out = BlockMix(in): even-numbered 64-byte outputs first, then the odd ones.
+void blockMixScalar(const uint32_t* in, uint32_t* out, size_t r)
+{
+    uint32_t x[16];
+    memcpy(x, &in[(2 * r - 1) * 16], sizeof(x));
+    for (size_t i = 0; i < 2 * r; ++i) {
+        for (int k = 0; k < 16; ++k) {
+            x[k] ^= in[i * 16 + k];
+        }
+        salsa208(x);
+        memcpy(&out[((i & 1) * r + i / 2) * 16], x, sizeof(x));
+    }
+}
+
+void smixScalar(uint8_t* b, size_t r, uint64_t n, void* vMemory, void* xyMemory)
+{
+    const size_t words = 32 * r;
+    uint32_t* v = static_cast<uint32_t*>(vMemory);
+    uint32_t* x = static_cast<uint32_t*>(xyMemory);
+    uint32_t* y = x + words;
+    for (size_t k = 0; k < words; ++k) {
+        x[k] = load32(&b[4 * k]);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        memcpy(&v[i * words], x, words * 4);
+        blockMixScalar(x, y, r);
+        std::swap(x, y);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t j = (uint64_t(x[(2 * r - 1) * 16 + 1]) << 32 | x[(2 * r - 1) * 16]) & (n - 1);
+        for (size_t k = 0; k < words; ++k) {
+            x[k] ^= v[j * words + k];
+        }
+        blockMixScalar(x, y, r);
+        std::swap(x, y);
+    }
+    for (size_t k = 0; k < words; ++k) {
+        store32(&b[4 * k], x[k]);
+    }
+}
+
+#ifdef ACCOUNTS_SCRYPT_X86
+
+// SSE2 kernel. Each 64-byte Salsa20 block is held as four 128-bit rows whose
+// words are stored in diagonal order (position i holds word 5i mod 16), so the
+// column and row rounds are lane-wise vector operations separated by word
+// rotations within the rows. V and the working blocks stay in that order
+// throughout ROMix; only the input and output are permuted.
+
+#define ACCOUNTS_SALSA_ROUND(a, b, c, d)                                              \
+    t = _mm_add_epi32(a, d);                                                          \
+    b = _mm_xor_si128(b, _mm_xor_si128(_mm_slli_epi32(t, 7), _mm_srli_epi32(t, 25))); \
+    t = _mm_add_epi32(b, a);                                                          \
+    c = _mm_xor_si128(c, _mm_xor_si128(_mm_slli_epi32(t, 9), _mm_srli_epi32(t, 23))); \
+    t = _mm_add_epi32(c, b);                                                          \
+    d = _mm_xor_si128(d, _mm_xor_si128(_mm_slli_epi32(t, 13), _mm_srli_epi32(t, 19))); \
+    t = _mm_add_epi32(d, c);                                                          \
+    a = _mm_xor_si128(a, _mm_xor_si128(_mm_slli_epi32(t, 18), _mm_srli_epi32(t, 14)));
+
+__attribute__((target("sse2")))
+inline void salsa208Sse2(__m128i b[4])
+{
+    __m128i x0 = b[0], x1 = b[1], x2 = b[2], x3 = b[3], t;
+    for (int i = 0; i < 8; i += 2) {
+        ACCOUNTS_SALSA_ROUND(x0, x1, x2, x3)
+        x1 = _mm_shuffle_epi32(x1, 0x93);
+        x2 = _mm_shuffle_epi32(x2, 0x4E);
+        x3 = _mm_shuffle_epi32(x3, 0x39);
+        ACCOUNTS_SALSA_ROUND(x0, x3, x2, x1)
+        x1 = _mm_shuffle_epi32(x1, 0x39);
+        x2 = _mm_shuffle_epi32(x2, 0x4E);
+        x3 = _mm_shuffle_epi32(x3, 0x93);
+    }
+    b[0] = _mm_add_epi32(b[0], x0);
+    b[1] = _mm_add_epi32(b[1], x1);
+    b[2] = _mm_add_epi32(b[2], x2);
+    b[3] = _mm_add_epi32(b[3], x3);
+}
+
+#undef ACCOUNTS_SALSA_ROUND
+
+__attribute__((target("sse2")))
+inline void xor64Sse2(__m128i x[4], const __m128i* in)
+{
+    x[0] = _mm_xor_si128(x[0], _mm_loadu_si128(&in[0]));
+    x[1] = _mm_xor_si128(x[1], _mm_loadu_si128(&in[1]));
+    x[2] = _mm_xor_si128(x[2], _mm_loadu_si128(&in[2]));
+    x[3] = _mm_xor_si128(x[3], _mm_loadu_si128(&in[3]));
+}
+
+__attribute__((target("sse2")))
+inline void store64Sse2(__m128i* out, const __m128i x[4])
+{
+    _mm_storeu_si128(&out[0], x[0]);
+    _mm_storeu_si128(&out[1], x[1]);
+    _mm_storeu_si128(&out[2], x[2]);
+    _mm_storeu_si128(&out[3], x[3]);
+}
+
+__attribute__((target("sse2")))
+void blockMixSse2(const __m128i* in, __m128i* out, size_t r)
+{
+    __m128i x[4];
+    for (int k = 0; k < 4; ++k) {
+        x[k] = _mm_loadu_si128(&in[(2 * r - 1) * 4 + k]);
+    }
+    for (size_t i = 0; i < r; ++i) {
+        xor64Sse2(x, &in[i * 8]);
+        salsa208Sse2(x);
+        store64Sse2(&out[i * 4], x);
+        xor64Sse2(x, &in[i * 8 + 4]);
+        salsa208Sse2(x);
+        store64Sse2(&out[(r + i) * 4], x);
+    }
+}
+
+// dst = src or dst ^= src over 128 * r bytes, 16 bytes at a time.
+__attribute__((target("sse2")))
+void copyBlocksSse2(void* dst, const void* src, size_t r)
+{
+    __m128i* d = static_cast<__m128i*>(dst);
+    const __m128i* s = static_cast<const __m128i*>(src);
+    for (size_t i = 0; i < 8 * r; ++i) {
+        _mm_storeu_si128(&d[i], _mm_loadu_si128(&s[i]));
+    }
+}
+
+__attribute__((target("sse2")))
+void xorBlocksSse2(void* dst, const void* src, size_t r)
+{
+    __m128i* d = static_cast<__m128i*>(dst);
+    const __m128i* s = static_cast<const __m128i*>(src);
+    for (size_t i = 0; i < 8 * r; ++i) {
+        _mm_storeu_si128(&d[i], _mm_xor_si128(_mm_loadu_si128(&d[i]), _mm_loadu_si128(&s[i])));
+    }
+}
+
+__attribute__((target("sse2")))
+void smixSse2(uint8_t* b, size_t r, uint64_t n, void* vMemory, void* xyMemory)
+{
+    const size_t words = 32 * r;
+    uint32_t* v = static_cast<uint32_t*>(vMemory);
+    uint32_t* x = static_cast<uint32_t*>(xyMemory);
+    uint32_t* y = x + words;
+    for (size_t k = 0; k < 2 * r; ++k) {
+        for (size_t i = 0; i < 16; ++i) {
+            x[k * 16 + i] = load32(&b[(k * 16 + i * 5 % 16) * 4]);
+        }
+    }
+    for (uint64_t i = 0; i < n; i += 2) {
+        copyBlocksSse2(&v[i * words], x, r);
+        blockMixSse2(reinterpret_cast<const __m128i*>(x), reinterpret_cast<__m128i*>(y), r);
+        copyBlocksSse2(&v[(i + 1) * words], y, r);
+        blockMixSse2(reinterpret_cast<const __m128i*>(y), reinterpret_cast<__m128i*>(x), r);
+    }
+    // Word 0 of the last block sits at position 0 and word 1 at position 13.
+    const size_t last = (2 * r - 1) * 16;
+    for (uint64_t i = 0; i < n; i += 2) {
+        uint64_t j = (uint64_t(x[last + 13]) << 32 | x[last]) & (n - 1);
+        xorBlocksSse2(x, &v[j * words], r);
+        blockMixSse2(reinterpret_cast<const __m128i*>(x), reinterpret_cast<__m128i*>(y), r);
+        j = (uint64_t(y[last + 13]) << 32 | y[last]) & (n - 1);
+        xorBlocksSse2(y, &v[j * words], r);
+        blockMixSse2(reinterpret_cast<const __m128i*>(y), reinterpret_cast<__m128i*>(x), r);
+    }
+    for (size_t k = 0; k < 2 * r; ++k) {
+        for (size_t i = 0; i < 16; ++i) {
+            store32(&b[(k * 16 + i * 5 % 16) * 4], x[k * 16 + i]);
+        }
+    }
+}
+
+#endif
+
+struct Kernel {
+    void (*smix)(uint8_t* b, size_t r, uint64_t n, void* v, void* xy);
+    const char* name;
+};
+
+Kernel selectKernel()
+{
+#ifdef ACCOUNTS_SCRYPT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return {smixSse2, "sse2"};
+    }
+#endif
+    return {smixScalar, "scalar"};
+}
+
+const Kernel kernel = selectKernel();
+
+// Runs ROMix on lanes first, first + step, ... with one V allocation.
+bool runLanes(uint8_t* b, size_t r, uint64_t n, uint32_t p, uint32_t first, uint32_t step)
+{
+    const size_t laneBytes = 128 * r * static_cast<size_t>(n);
+    void* v = std::aligned_alloc(64, laneBytes);
+    void* xy = std::aligned_alloc(64, 256 * r);
+    const bool ok = v != nullptr && xy != nullptr;
+    if (ok) {
+        for (uint32_t lane = first; lane < p; lane += step) {
+            kernel.smix(&b[lane * 128 * r], r, n, v, xy);
+        }
+        // V holds every intermediate state of the lanes.
+        wipe(v, laneBytes);
+        wipe(xy, 256 * r);
+    }
+    std::free(v);
+    std::free(xy);
+    return ok;
+}
+
+} // namespace
+
+bool scrypt(const uint8_t* password, size_t passwordSize, const uint8_t* salt, size_t saltSize,
+            uint64_t n, uint32_t r, uint32_t p, uint8_t* out, size_t outSize)
+{
+    if (n < 2 || (n & (n - 1)) != 0 || r == 0 || p == 0 || uint64_t(r) * p >= (uint64_t(1) << 30)) {
+        return false;
+    }
+    if (n > kScryptMaxLaneBytes / 128 / r) {
+        return false;
+    }
+    const uint64_t laneBytes = 128 * uint64_t(r) * n;
+    std::vector<uint8_t> b(size_t(p) * 128 * r);
+    pbkdf2HmacSha256(password, passwordSize, salt, saltSize, 1, b.data(), b.size());
+
+    const uint64_t fit = std::max<uint64_t>(1, kMemoryBudget / laneBytes);
+    const uint32_t threads = static_cast<uint32_t>(
+        std::min<uint64_t>({p, fit, std::max(1u, std::thread::hardware_concurrency())}));
+    std::vector<char> ok(threads, 0);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t] { ok[t] = runLanes(b.data(), r, n, p, t, threads); });
+    }
+    ok[0] = runLanes(b.data(), r, n, p, 0, threads);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const bool done = std::all_of(ok.begin(), ok.end(), [](char lane) { return lane != 0; });
+    if (done) {
+        pbkdf2HmacSha256(password, passwordSize, b.data(), b.size(), 1, out, outSize);
+    }
+    wipe(b.data(), b.size());
+    return done;
+}
+
+const char* scryptKernel()
+{
+    return kernel.name;
+}
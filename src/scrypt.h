@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// scrypt (RFC 7914), as used by Web3 Secret Storage key files. ROMix runs on
+// an SSE2 kernel when the CPU has it (Salsa20/8 on 128-bit rows with the
+// state kept in diagonal order, vector block copies and XORs), portable C++
+// otherwise; the kernel is picked once at startup. The p independent ROMix
+// lanes run on parallel threads, as many as fit the memory budget.
+//
+// False when the parameters are invalid (n not a power of two above 1, r or p
+// zero, r * p >= 2^30), a lane would need more than kScryptMaxLaneBytes, or
+// its memory cannot be allocated.
+bool scrypt(const uint8_t* password, size_t passwordSize, const uint8_t* salt, size_t saltSize,
+            uint64_t n, uint32_t r, uint32_t p, uint8_t* out, size_t outSize);
+
+// 128 * r * n bytes per lane; the SDK's standard parameters need 256 MiB.
+const uint64_t kScryptMaxLaneBytes = uint64_t(1) << 30;
+
+// "sse2" or "scalar".
+const char* scryptKernel();
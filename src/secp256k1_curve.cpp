@@ -0,0 +1,843 @@
+#include "secp256k1_curve.h"
+
+#include "sha256.h"
+
+#include <cstring>
+
+namespace {
+
+typedef unsigned __int128 u128;
+
+// Field elements are four little-endian 64-bit limbs, always fully reduced.
+struct Fe {
+    uint64_t v[4];
+};
+
+struct Affine {
+    Fe x, y;
+};
+
+// Jacobian coordinates (X/Z^2, Y/Z^3); Z == 0 is the point at infinity.
+struct Jacobian {
+    Fe x, y, z;
+};
+
+// 2^256 - p, p = 2^256 - 2^32 - 977.
+const uint64_t kFieldC = 0x1000003D1ULL;
+const uint64_t kFieldComplement[4] = {kFieldC, 0, 0, 0};
+const uint64_t kFieldPMinus2[4] = {0xFFFFFFFEFFFFFC2DULL, ~0ULL, ~0ULL, ~0ULL};
+const uint64_t kFieldSqrtExponent[4] = {0xFFFFFFFFBFFFFF0CULL, ~0ULL, ~0ULL, 0x3FFFFFFFFFFFFFFFULL};
+
+const uint64_t kOrder[4] = {0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, ~0ULL};
+// 2^256 - n.
+const uint64_t kOrderComplement[4] = {0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 1, 0};
+const uint64_t kOrderMinus2[4] = {0xBFD25E8CD036413FULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, ~0ULL};
+// (n - 1) / 2: the largest low-S value.
+const uint64_t kHalfOrder[4] = {0xDFE92F46681B20A0ULL, 0x5D576E7357A4501DULL, 0xFFFFFFFFFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL};
+
+const Affine kGenerator = {
+    {{0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL}},
+    {{0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL}},
+};
+
+void wipe(void* p, size_t size)
+{
+    volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+    while (size--) {
+        *v++ = 0;
+    }
+}
+
+void load(const uint8_t in[32], uint64_t out[4])
+{
+    for (int i = 0; i < 4; ++i) {
+        uint64_t limb = 0;
+        for (int j = 0; j < 8; ++j) {
+            limb = (limb << 8) | in[32 - 8 * (i + 1) + j];
+        }
+        out[i] = limb;
+    }
+}
+
+void store(const uint64_t in[4], uint8_t out[32])
+{
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            out[32 - 8 * (i + 1) + j] = static_cast<uint8_t>(in[i] >> (56 - 8 * j));
+        }
+    }
+}
+
+uint64_t add4(uint64_t r[4], const uint64_t a[4], const uint64_t b[4])
+{
+    u128 acc = 0;
+    for (int i = 0; i < 4; ++i) {
+        acc += static_cast<u128>(a[i]) + b[i];
+        r[i] = static_cast<uint64_t>(acc);
+        acc >>= 64;
+    }
+    return static_cast<uint64_t>(acc);
+}
+
+uint64_t sub4(uint64_t r[4], const uint64_t a[4], const uint64_t b[4])
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        const u128 d = static_cast<u128>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<uint64_t>(d);
+        borrow = static_cast<uint64_t>(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+// r = mask ? a : b, for mask all-ones or zero.
+void select4(uint64_t r[4], const uint64_t a[4], const uint64_t b[4], uint64_t mask)
+{
+    for (int i = 0; i < 4; ++i) {
+        r[i] = (a[i] & mask) | (b[i] & ~mask);
+    }
+}
+
+uint64_t zeroMask4(const uint64_t a[4])
+{
+    const uint64_t x = a[0] | a[1] | a[2] | a[3];
+    return ((x | (0 - x)) >> 63) - 1;
+}
+
+uint64_t equalMask(uint64_t a, uint64_t b)
+{
+    return 0 - (((a ^ b) - 1) >> 63);
+}
+
+// True when a < m, i.e. subtracting m borrows.
+bool lessThan(const uint64_t a[4], const uint64_t m[4])
+{
+    uint64_t t[4];
+    return sub4(t, a, m) != 0;
+}
+
+void feAdd(Fe& r, const Fe& a, const Fe& b)
+{
+    uint64_t t[4], s[4];
+    const uint64_t carry = add4(t, a.v, b.v);
+    const uint64_t wrap = add4(s, t, kFieldComplement);
+    select4(r.v, s, t, 0 - (carry | wrap));
+}
+
+void feSub(Fe& r, const Fe& a, const Fe& b)
+{
+    uint64_t t[4];
+    const uint64_t borrow = sub4(t, a.v, b.v);
+    // On borrow t = a - b + 2^256; adding p is subtracting 2^256 - p.
+    const uint64_t fix[4] = {kFieldC & (0 - borrow), 0, 0, 0};
+    sub4(r.v, t, fix);
+}
+
+void feMul(Fe& r, const Fe& a, const Fe& b)
+{
+    uint64_t t[8] = {};
+    for (int i = 0; i < 4; ++i) {
+        u128 carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            carry += static_cast<u128>(a.v[i]) * b.v[j] + t[i + j];
+            t[i + j] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+        t[i + 4] = static_cast<uint64_t>(carry);
+    }
+
+    // 2^256 == 2^32 + 977 (mod p): fold the high half in twice.
+    uint64_t lo[4];
+    u128 acc = 0;
+    for (int i = 0; i < 4; ++i) {
+        acc += static_cast<u128>(t[4 + i]) * kFieldC + t[i];
+        lo[i] = static_cast<uint64_t>(acc);
+        acc >>= 64;
+    }
+    acc = static_cast<u128>(static_cast<uint64_t>(acc)) * kFieldC;
+    for (int i = 0; i < 4; ++i) {
+        acc += lo[i];
+        lo[i] = static_cast<uint64_t>(acc);
+        acc >>= 64;
+    }
+    // A carry here leaves lo below 2^68, so adding 2^256 - p once more cannot carry.
+    const uint64_t fold[4] = {kFieldC & (0 - static_cast<uint64_t>(acc)), 0, 0, 0};
+    add4(lo, lo, fold);
+
+    uint64_t s[4];
+    const uint64_t wrap = add4(s, lo, kFieldComplement);
+    select4(r.v, s, lo, 0 - wrap);
+}
+
+void feSqr(Fe& r, const Fe& a)
+{
+    feMul(r, a, a);
+}
+
+// a^e four exponent bits at a time. Exponents are public constants, so
+// indexing the table with their digits is fine.
+void fePow(Fe& r, const Fe& a, const uint64_t exponent[4])
+{
+    Fe table[16];
+    table[0] = Fe{{1, 0, 0, 0}};
+    table[1] = a;
+    for (int d = 2; d < 16; ++d) {
+        feMul(table[d], table[d - 1], a);
+    }
+    Fe result = table[exponent[3] >> 60];
+    for (int w = 62; w >= 0; --w) {
+        for (int i = 0; i < 4; ++i) {
+            feSqr(result, result);
+        }
+        const uint64_t digit = (exponent[w / 16] >> (4 * (w % 16))) & 15;
+        if (digit != 0) {
+            feMul(result, result, table[digit]);
+        }
+    }
+    r = result;
+}
+
+void feInv(Fe& r, const Fe& a)
+{
+    fePow(r, a, kFieldPMinus2);
+}
+
+bool feEqual(const Fe& a, const Fe& b)
+{
+    return memcmp(a.v, b.v, sizeof(a.v)) == 0;
+}
+
+void pointDouble(Jacobian& r, const Jacobian& p)
+{
+    Fe a, b, c, d, e, f, t;
+    feSqr(a, p.x);
+    feSqr(b, p.y);
+    feSqr(c, b);
+    feAdd(t, p.x, b);
+    feSqr(d, t);
+    feSub(d, d, a);
+    feSub(d, d, c);
+    feAdd(d, d, d);
+    feAdd(e, a, a);
+    feAdd(e, e, a);
+    feSqr(f, e);
+
+    Fe z3;
+    feMul(z3, p.y, p.z);
+    feAdd(z3, z3, z3);
+    Fe x3;
+    feSub(x3, f, d);
+    feSub(x3, x3, d);
+    Fe y3;
+    feSub(t, d, x3);
+    feMul(y3, e, t);
+    feAdd(c, c, c);
+    feAdd(c, c, c);
+    feAdd(c, c, c);
+    feSub(y3, y3, c);
+
+    r.x = x3;
+    r.y = y3;
+    r.z = z3;
+}
+
+// p + q for p not at infinity and p != +-q.
+void pointAddAffine(Jacobian& r, const Jacobian& p, const Affine& q)
+{
+    Fe z1z1, u2, s2, h, hh, i, j, rr, v, t;
+    feSqr(z1z1, p.z);
+    feMul(u2, q.x, z1z1);
+    feMul(s2, q.y, p.z);
+    feMul(s2, s2, z1z1);
+    feSub(h, u2, p.x);
+    feSqr(hh, h);
+    feAdd(i, hh, hh);
+    feAdd(i, i, i);
+    feMul(j, h, i);
+    feSub(rr, s2, p.y);
+    feAdd(rr, rr, rr);
+    feMul(v, p.x, i);
+
+    Fe x3;
+    feSqr(x3, rr);
+    feSub(x3, x3, j);
+    feSub(x3, x3, v);
+    feSub(x3, x3, v);
+    Fe y3;
+    feSub(t, v, x3);
+    feMul(y3, rr, t);
+    feMul(t, p.y, j);
+    feAdd(t, t, t);
+    feSub(y3, y3, t);
+    Fe z3;
+    feAdd(z3, p.z, h);
+    feSqr(z3, z3);
+    feSub(z3, z3, z1z1);
+    feSub(z3, z3, hh);
+
+    r.x = x3;
+    r.y = y3;
+    r.z = z3;
+}
+
+void toAffine(Affine& r, const Jacobian& p)
+{
+    Fe zi, zi2, zi3;
+    feInv(zi, p.z);
+    feSqr(zi2, zi);
+    feMul(zi3, zi2, zi);
+    feMul(r.x, p.x, zi2);
+    feMul(r.y, p.y, zi3);
+}
+
+Jacobian fromAffine(const Affine& a)
+{
+    return Jacobian{a.x, a.y, {{1, 0, 0, 0}}};
+}
+
+// Converts count points (none at infinity) with one shared inversion.
+void toAffineBatch(Affine* out, const Jacobian* in, int count)
+{
+    // prefix[i] = z0 * ... * zi.
+    Fe prefix[16];
+    prefix[0] = in[0].z;
+    for (int i = 1; i < count; ++i) {
+        feMul(prefix[i], prefix[i - 1], in[i].z);
+    }
+    Fe inverse;
+    feInv(inverse, prefix[count - 1]);
+    for (int i = count - 1; i >= 0; --i) {
+        Fe zi = inverse;
+        if (i > 0) {
+            feMul(zi, inverse, prefix[i - 1]);
+            feMul(inverse, inverse, in[i].z);
+        }
+        Fe zi2, zi3;
+        feSqr(zi2, zi);
+        feMul(zi3, zi2, zi);
+        feMul(out[i].x, in[i].x, zi2);
+        feMul(out[i].y, in[i].y, zi3);
+    }
+}
+
+// multiple[d] = d * p for d = 1..15 in affine coordinates.
+void multiplesOf(const Affine& p, Affine multiple[16])
+{
+    Jacobian jacobian[16];
+    jacobian[1] = fromAffine(p);
+    pointDouble(jacobian[2], jacobian[1]);
+    for (int d = 3; d < 16; ++d) {
+        pointAddAffine(jacobian[d], jacobian[d - 1], p);
+    }
+    toAffineBatch(multiple + 1, jacobian + 1, 15);
+    multiple[0] = multiple[1];
+}
+
+// entry[w][d] = d * 16^w * G for every 4-bit window w of a scalar, so k * G is
+// a sum of 64 table entries with no doublings. Built once on first use, with
+// one shared inversion per window.
+struct GeneratorTable {
+    static const int kWindows = 64;
+    Affine entry[kWindows][16];
+
+    GeneratorTable()
+    {
+        Affine base = kGenerator;
+        for (int w = 0; w < kWindows; ++w) {
+            multiplesOf(base, entry[w]);
+            Jacobian next = fromAffine(entry[w][8]);
+            pointDouble(next, next);
+            toAffine(base, next);
+        }
+    }
+};
+
+const GeneratorTable& generatorTable()
+{
+    static const GeneratorTable table;
+    return table;
+}
+
+// k * G as the sum of one table entry per window, scanning all 16 entries of a
+// window so the access pattern does not depend on k. With k < n the running
+// sum (k mod 16^w) * G is never +-(the addend) once non-zero, so the
+// incomplete addition formula is safe; an infinite sum and zero digits are
+// handled by masked selection.
+void multiplyGenerator(Jacobian& r, const uint64_t k[4])
+{
+    const GeneratorTable& table = generatorTable();
+    Jacobian acc = {{{0, 0, 0, 0}}, {{1, 0, 0, 0}}, {{0, 0, 0, 0}}};
+    const uint64_t one[4] = {1, 0, 0, 0};
+    for (int w = 0; w < GeneratorTable::kWindows; ++w) {
+        const uint64_t digit = (k[w / 16] >> (4 * (w % 16))) & 15;
+        Affine addend = table.entry[w][0];
+        for (uint64_t i = 1; i < 16; ++i) {
+            const uint64_t mask = equalMask(i, digit);
+            select4(addend.x.v, table.entry[w][i].x.v, addend.x.v, mask);
+            select4(addend.y.v, table.entry[w][i].y.v, addend.y.v, mask);
+        }
+        Jacobian sum;
+        pointAddAffine(sum, acc, addend);
+
+        const uint64_t zeroDigit = equalMask(digit, 0);
+        const uint64_t takeAddend = zeroMask4(acc.z.v) & ~zeroDigit;
+        select4(sum.x.v, acc.x.v, sum.x.v, zeroDigit);
+        select4(sum.y.v, acc.y.v, sum.y.v, zeroDigit);
+        select4(sum.z.v, acc.z.v, sum.z.v, zeroDigit);
+        select4(acc.x.v, addend.x.v, sum.x.v, takeAddend);
+        select4(acc.y.v, addend.y.v, sum.y.v, takeAddend);
+        select4(acc.z.v, one, sum.z.v, takeAddend);
+        wipe(&addend, sizeof(addend));
+    }
+    r = acc;
+    wipe(&acc, sizeof(acc));
+}
+
+// acc += q for any acc, including infinity and +-q. Not constant time: for
+// public points only.
+void pointAddPublic(Jacobian& acc, const Affine& q)
+{
+    if (zeroMask4(acc.z.v)) {
+        acc = fromAffine(q);
+        return;
+    }
+    Fe z1z1, u2;
+    feSqr(z1z1, acc.z);
+    feMul(u2, q.x, z1z1);
+    if (feEqual(u2, acc.x)) {
+        Fe s2;
+        feMul(s2, q.y, acc.z);
+        feMul(s2, s2, z1z1);
+        if (feEqual(s2, acc.y)) {
+            pointDouble(acc, acc);
+        } else {
+            acc.z = Fe{{0, 0, 0, 0}};
+        }
+        return;
+    }
+    pointAddAffine(acc, acc, q);
+}
+
+// k * p, four bits at a time from the top over the multiples 1p..15p. Not
+// constant time: for a public k and p only.
+void multiplyPoint(Jacobian& r, const Affine& p, const uint64_t k[4])
+{
+    Affine multiple[16];
+    multiplesOf(p, multiple);
+    r = {{{0, 0, 0, 0}}, {{1, 0, 0, 0}}, {{0, 0, 0, 0}}};
+    for (int w = 63; w >= 0; --w) {
+        for (int i = 0; i < 4; ++i) {
+            pointDouble(r, r);
+        }
+        const uint64_t digit = (k[w / 16] >> (4 * (w % 16))) & 15;
+        if (digit != 0) {
+            pointAddPublic(r, multiple[digit]);
+        }
+    }
+}
+
+// acc += k * G with the generator table, reading only the entries k selects.
+// For a public k only.
+void addGeneratorMultiple(Jacobian& acc, const uint64_t k[4])
+{
+    const GeneratorTable& table = generatorTable();
+    for (int w = 0; w < GeneratorTable::kWindows; ++w) {
+        const uint64_t digit = (k[w / 16] >> (4 * (w % 16))) & 15;
+        if (digit != 0) {
+            pointAddPublic(acc, table.entry[w][digit]);
+        }
+    }
+}
+
+void compress(const Affine& p, uint8_t out[33])
+{
+    out[0] = static_cast<uint8_t>(0x02 | (p.y.v[0] & 1));
+    store(p.x.v, out + 1);
+}
+
+bool decompress(const uint8_t in[33], Affine& p)
+{
+    if (in[0] != 0x02 && in[0] != 0x03) {
+        return false;
+    }
+    load(in + 1, p.x.v);
+    uint64_t t[4];
+    if (add4(t, p.x.v, kFieldComplement) != 0) {
+        return false; // x >= p
+    }
+    Fe rhs, y;
+    feSqr(rhs, p.x);
+    feMul(rhs, rhs, p.x);
+    const Fe seven = {{7, 0, 0, 0}};
+    feAdd(rhs, rhs, seven);
+    fePow(y, rhs, kFieldSqrtExponent);
+    Fe check;
+    feSqr(check, y);
+    if (!feEqual(check, rhs)) {
+        return false;
+    }
+    if ((y.v[0] & 1) != (in[0] & 1)) {
+        const Fe zero = {{0, 0, 0, 0}};
+        feSub(y, zero, y);
+    }
+    p.y = y;
+    return true;
+}
+
+// Scalars mod n, fully reduced.
+
+// out = lo + hi * (2^256 - n) over OutLimbs limbs; the callers' bounds keep
+// the sum within them.
+template <int OutLimbs, int HiLimbs>
+void foldOrder(uint64_t (&out)[OutLimbs], const uint64_t lo[4], const uint64_t* hi)
+{
+    for (int i = 0; i < OutLimbs; ++i) {
+        out[i] = i < 4 ? lo[i] : 0;
+    }
+    for (int i = 0; i < HiLimbs; ++i) {
+        u128 carry = 0;
+        for (int j = 0; j < 3; ++j) {
+            carry += static_cast<u128>(hi[i]) * kOrderComplement[j] + out[i + j];
+            out[i + j] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+        for (int j = i + 3; j < OutLimbs; ++j) {
+            carry += out[j];
+            out[j] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+    }
+}
+
+// r = t mod n for a 512-bit t: 2^256 == 2^256 - n (mod n), a 129-bit value,
+// so each fold shrinks the high part until one conditional subtraction is left.
+void scReduce(uint64_t r[4], const uint64_t t[8])
+{
+    uint64_t m[7];
+    foldOrder<7, 4>(m, t, t + 4); // < 2^386
+    uint64_t q[5];
+    foldOrder<5, 3>(q, m, m + 4); // < 2^260
+    uint64_t s[5];
+    foldOrder<5, 1>(s, q, q + 4); // < 2^256 + 2^134
+    // A carry out leaves s below 2^134, so adding 2^256 - n once more cannot carry.
+    const uint64_t carry = 0 - s[4];
+    const uint64_t fix[4] = {kOrderComplement[0] & carry, kOrderComplement[1] & carry, kOrderComplement[2] & carry, 0};
+    add4(s, s, fix);
+    uint64_t d[4];
+    const uint64_t borrow = sub4(d, s, kOrder);
+    select4(r, s, d, 0 - borrow);
+}
+
+void scMul(uint64_t r[4], const uint64_t a[4], const uint64_t b[4])
+{
+    uint64_t t[8] = {};
+    for (int i = 0; i < 4; ++i) {
+        u128 carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            carry += static_cast<u128>(a[i]) * b[j] + t[i + j];
+            t[i + j] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+        t[i + 4] = static_cast<uint64_t>(carry);
+    }
+    scReduce(r, t);
+}
+
+void scAdd(uint64_t r[4], const uint64_t a[4], const uint64_t b[4])
+{
+    uint64_t t[4], s[4];
+    const uint64_t carry = add4(t, a, b);
+    const uint64_t wrap = add4(s, t, kOrderComplement);
+    select4(r, s, t, 0 - (carry | wrap));
+}
+
+// a^(n-2), windowed as in fePow. Runs in constant time: the exponent is public.
+void scInv(uint64_t r[4], const uint64_t a[4])
+{
+    uint64_t table[16][4] = {{1, 0, 0, 0}};
+    memcpy(table[1], a, sizeof(table[1]));
+    for (int d = 2; d < 16; ++d) {
+        scMul(table[d], table[d - 1], a);
+    }
+    uint64_t result[4];
+    memcpy(result, table[kOrderMinus2[3] >> 60], sizeof(result));
+    for (int w = 62; w >= 0; --w) {
+        for (int i = 0; i < 4; ++i) {
+            scMul(result, result, result);
+        }
+        const uint64_t digit = (kOrderMinus2[w / 16] >> (4 * (w % 16))) & 15;
+        if (digit != 0) {
+            scMul(result, result, table[digit]);
+        }
+    }
+    memcpy(r, result, sizeof(result));
+    wipe(table, sizeof(table));
+    wipe(result, sizeof(result));
+}
+
+// RFC 6979 section 3.2 with HMAC-SHA256: the nonce candidates for one key and
+// (reduced) hash.
+class Rfc6979 {
+public:
+    Rfc6979(const uint8_t key[32], const uint8_t hash[32]) : retry(false)
+    {
+        memset(v, 0x01, sizeof(v));
+        memset(k, 0x00, sizeof(k));
+        uint8_t seed[32 + 1 + 32 + 32];
+        memcpy(seed + 33, key, 32);
+        memcpy(seed + 65, hash, 32);
+        for (uint8_t round = 0; round < 2; ++round) {
+            memcpy(seed, v, 32);
+            seed[32] = round;
+            hmacSha256(k, sizeof(k), seed, sizeof(seed), k);
+            hmacSha256(k, sizeof(k), v, sizeof(v), v);
+        }
+        wipe(seed, sizeof(seed));
+    }
+
+    ~Rfc6979()
+    {
+        wipe(v, sizeof(v));
+        wipe(k, sizeof(k));
+    }
+
+    void next(uint8_t out[32])
+    {
+        if (retry) {
+            uint8_t data[33];
+            memcpy(data, v, 32);
+            data[32] = 0x00;
+            hmacSha256(k, sizeof(k), data, sizeof(data), k);
+            hmacSha256(k, sizeof(k), v, sizeof(v), v);
+        }
+        hmacSha256(k, sizeof(k), v, sizeof(v), v);
+        memcpy(out, v, 32);
+        retry = true;
+    }
+
+private:
+    uint8_t v[32];
+    uint8_t k[32];
+    bool retry;
+};
+
+} // namespace
+
+bool curveScalarValid(const uint8_t key[32])
+{
+    uint64_t k[4];
+    load(key, k);
+    const bool valid = !zeroMask4(k) && lessThan(k, kOrder);
+    wipe(k, sizeof(k));
+    return valid;
+}
+
+bool curveScalarAdd(const uint8_t a[32], const uint8_t b[32], uint8_t out[32])
+{
+    uint64_t x[4], y[4], t[4], s[4];
+    load(a, x);
+    load(b, y);
+    bool ok = lessThan(y, kOrder);
+    const uint64_t carry = add4(t, x, y);
+    const uint64_t wrap = add4(s, t, kOrderComplement);
+    select4(t, s, t, 0 - (carry | wrap));
+    ok = ok && !zeroMask4(t);
+    store(t, out);
+    wipe(x, sizeof(x));
+    wipe(y, sizeof(y));
+    wipe(t, sizeof(t));
+    wipe(s, sizeof(s));
+    return ok;
+}
+
+bool curvePublicKey(const uint8_t key[32], uint8_t out[33])
+{
+    if (!curveScalarValid(key)) {
+        return false;
+    }
+    uint64_t k[4];
+    load(key, k);
+    Jacobian p;
+    multiplyGenerator(p, k);
+    wipe(k, sizeof(k));
+    Affine a;
+    toAffine(a, p);
+    compress(a, out);
+    return true;
+}
+
+bool curvePublicKeyValid(const uint8_t pub[33])
+{
+    Affine p;
+    return decompress(pub, p);
+}
+
+bool curvePublicKeyTweakAdd(const uint8_t pub[33], const uint8_t tweak[32], uint8_t out[33])
+{
+    Affine p;
+    if (!decompress(pub, p)) {
+        return false;
+    }
+    uint64_t t[4];
+    load(tweak, t);
+    if (!lessThan(t, kOrder)) {
+        return false;
+    }
+    if (zeroMask4(t)) {
+        memcpy(out, pub, 33);
+        return true;
+    }
+    Jacobian q;
+    multiplyGenerator(q, t);
+    Affine qa;
+    toAffine(qa, q);
+
+    Jacobian sum = fromAffine(p);
+    if (feEqual(p.x, qa.x)) {
+        if (!feEqual(p.y, qa.y)) {
+            return false;
+        }
+        pointDouble(sum, sum);
+    } else {
+        pointAddAffine(sum, sum, qa);
+    }
+    Affine r;
+    toAffine(r, sum);
+    compress(r, out);
+    return true;
+}
+
+bool curvePublicKeyUncompressed(const uint8_t key[32], uint8_t out[65])
+{
+    if (!curveScalarValid(key)) {
+        return false;
+    }
+    uint64_t k[4];
+    load(key, k);
+    Jacobian p;
+    multiplyGenerator(p, k);
+    wipe(k, sizeof(k));
+    Affine a;
+    toAffine(a, p);
+    out[0] = 0x04;
+    store(a.x.v, out + 1);
+    store(a.y.v, out + 33);
+    return true;
+}
+
+bool curveSign(const uint8_t key[32], const uint8_t hash[32], uint8_t sig[64], int& recoveryId)
+{
+    if (!curveScalarValid(key)) {
+        return false;
+    }
+    uint64_t d[4], z[4], t[4];
+    load(key, d);
+    load(hash, z);
+    // The hash is below 2^256 < 2n: one subtraction reduces it.
+    const uint64_t below = sub4(t, z, kOrder);
+    select4(z, z, t, 0 - below);
+    uint8_t reduced[32];
+    store(z, reduced);
+    Rfc6979 nonce(key, reduced);
+
+    uint64_t k[4], r[4], s[4];
+    uint8_t candidate[32];
+    for (;;) {
+        // Candidates outside 1..n-1, a zero r or a zero s come up with
+        // negligible probability; the retry reveals nothing about the key.
+        nonce.next(candidate);
+        load(candidate, k);
+        if (zeroMask4(k) || !lessThan(k, kOrder)) {
+            continue;
+        }
+        Jacobian p;
+        multiplyGenerator(p, k);
+        Affine point;
+        toAffine(point, p);
+        const uint64_t overflow = 1 - sub4(t, point.x.v, kOrder);
+        select4(r, t, point.x.v, 0 - overflow);
+        int id = static_cast<int>((point.y.v[0] & 1) | (overflow << 1));
+        if (zeroMask4(r)) {
+            continue;
+        }
+        // s = (z + r * d) / k
+        scMul(s, r, d);
+        scAdd(s, s, z);
+        scInv(t, k);
+        scMul(s, s, t);
+        if (zeroMask4(s)) {
+            continue;
+        }
+        // Low S: s > n/2 becomes n - s, which negates the nonce point.
+        const uint64_t high = static_cast<uint64_t>(lessThan(kHalfOrder, s));
+        uint64_t negated[4];
+        sub4(negated, kOrder, s);
+        select4(s, negated, s, 0 - high);
+        id ^= static_cast<int>(high);
+        store(r, sig);
+        store(s, sig + 32);
+        recoveryId = id;
+        wipe(&point, sizeof(point));
+        wipe(&p, sizeof(p));
+        break;
+    }
+    wipe(d, sizeof(d));
+    wipe(k, sizeof(k));
+    wipe(t, sizeof(t));
+    wipe(candidate, sizeof(candidate));
+    return true;
+}
+
+bool curveRecover(const uint8_t hash[32], const uint8_t sig[64], int recoveryId, uint8_t out[65])
+{
+    if (recoveryId < 0 || recoveryId > 3) {
+        return false;
+    }
+    uint64_t r[4], s[4], z[4], t[4];
+    load(sig, r);
+    load(sig + 32, s);
+    if (zeroMask4(r) || !lessThan(r, kOrder) || zeroMask4(s) || !lessThan(s, kOrder)) {
+        return false;
+    }
+    load(hash, z);
+    if (!sub4(t, z, kOrder)) {
+        memcpy(z, t, sizeof(z));
+    }
+
+    // The nonce point R: x is r, or r + n for ids 2 and 3, y has the id's parity.
+    uint8_t nonce[33];
+    nonce[0] = static_cast<uint8_t>(0x02 | (recoveryId & 1));
+    if (recoveryId & 2) {
+        if (add4(t, r, kOrder) != 0) {
+            return false;
+        }
+        store(t, nonce + 1);
+    } else {
+        store(r, nonce + 1);
+    }
+    Affine point;
+    if (!decompress(nonce, point)) {
+        return false;
+    }
+
+    // Q = r^-1 (s R - z G) = u2 R + u1 G.
+    uint64_t rInverse[4], u1[4], u2[4];
+    scInv(rInverse, r);
+    scMul(u2, s, rInverse);
+    scMul(u1, z, rInverse);
+    if (!zeroMask4(u1)) {
+        sub4(u1, kOrder, u1);
+    }
+    Jacobian q;
+    multiplyPoint(q, point, u2);
+    addGeneratorMultiple(q, u1);
+    if (zeroMask4(q.z.v)) {
+        return false;
+    }
+    Affine qa;
+    toAffine(qa, q);
+    out[0] = 0x04;
+    store(qa.x.v, out + 1);
+    store(qa.y.v, out + 33);
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// secp256k1 arithmetic for BIP-32 derivation and ECDSA signing. Scalars and
+// field elements are 32-byte big-endian; public keys are 33-byte compressed
+// SEC1 points unless noted.
+//
+// Operations on secret scalars (curvePublicKey, curveScalarAdd, curveSign) run
+// in time independent of the scalar's value: the base-point table is read in
+// full and results are selected with masks. Tweaking a public key is not
+// constant time, nor is recovering one from a signature; their inputs are
+// public.
+
+// True when 0 < key < n.
+bool curveScalarValid(const uint8_t key[32]);
+
+// out = (a + b) mod n. False when b >= n or the sum is zero.
+bool curveScalarAdd(const uint8_t a[32], const uint8_t b[32], uint8_t out[32]);
+
+// Compressed key * G. False when the key is not a valid scalar.
+bool curvePublicKey(const uint8_t key[32], uint8_t out[33]);
+
+// Uncompressed key * G (0x04 || x || y). False when the key is not a valid
+// scalar.
+bool curvePublicKeyUncompressed(const uint8_t key[32], uint8_t out[65]);
+
+// Decompresses and checks a compressed point.
+bool curvePublicKeyValid(const uint8_t pub[33]);
+
+// out = pub + tweak * G. False when tweak >= n, pub is not on the curve or the
+// sum is the point at infinity.
+bool curvePublicKeyTweakAdd(const uint8_t pub[33], const uint8_t tweak[32], uint8_t out[33]);
+
+// ECDSA signature r || s of a 32-byte hash with a deterministic RFC 6979 nonce
+// (HMAC-SHA256) and s normalised to the lower half of the order, as Ethereum
+// and libsecp256k1 produce it; recoveryId (0..3) selects the public key when
+// recovering it from the signature. False when the key is not a valid scalar.
+bool curveSign(const uint8_t key[32], const uint8_t hash[32], uint8_t sig[64], int& recoveryId);
+
+// Recovers the uncompressed public key (0x04 || x || y) that made signature
+// r || s of a 32-byte hash, selected by recoveryId (0..3). Any s in 1..n-1 is
+// accepted, as by libsecp256k1's recovery. False when r or s is out of range
+// or no key matches.
+bool curveRecover(const uint8_t hash[32], const uint8_t sig[64], int recoveryId, uint8_t out[65]);
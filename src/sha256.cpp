@@ -0,0 +1,286 @@
+#include "sha256.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ACCOUNTS_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t kRound[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+void compressPortable(uint32_t state[8], const uint8_t* data, size_t blocks)
+{
+    uint32_t w[64];
+    while (blocks--) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+                   (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+        data += Sha256::kBlockSize;
+    }
+}
+
+#ifdef ACCOUNTS_SHA256_X86
+
+__attribute__((target("sha,sse4.1")))
+void compressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The SHA-NI round instructions keep the state as ABEF / CDGH.
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i w[4];
+        for (int i = 0; i < 16; ++i) {
+            __m128i& cur = w[i & 3];
+            if (i < 4) {
+                cur = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+            } else {
+                // w[i] = msg2(msg1(w[i-4], w[i-3]) + w[i-2..i-1] shifted by one word, w[i-1])
+                const __m128i& w1 = w[(i - 1) & 3];
+                const __m128i& w2 = w[(i - 2) & 3];
+                const __m128i& w3 = w[(i - 3) & 3];
+                cur = _mm_sha256msg1_epu32(cur, w3);
+                cur = _mm_add_epi32(cur, _mm_alignr_epi8(w1, w2, 4));
+                cur = _mm_sha256msg2_epu32(cur, w1);
+            }
+            __m128i msg = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kRound[4 * i])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        data += Sha256::kBlockSize;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+bool cpuHasShaNi()
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSSE3) || !(c & bit_SSE4_1)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return false;
+    }
+    return (b & (1u << 29)) != 0;
+}
+
+#endif
+
+using CompressFn = void (*)(uint32_t*, const uint8_t*, size_t);
+
+CompressFn selectCompress()
+{
+#ifdef ACCOUNTS_SHA256_X86
+    if (cpuHasShaNi()) {
+        return compressShaNi;
+    }
+#endif
+    return compressPortable;
+}
+
+const CompressFn compress = selectCompress();
+
+} // namespace
+
+Sha256::Sha256()
+    : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+      buffered(0), length(0)
+{
+}
+
+void Sha256::update(const uint8_t* data, size_t size)
+{
+    length += size;
+    if (buffered > 0) {
+        const size_t take = size < kBlockSize - buffered ? size : kBlockSize - buffered;
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        size -= take;
+        if (buffered < kBlockSize) {
+            return;
+        }
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+    if (size >= kBlockSize) {
+        compress(state, data, size / kBlockSize);
+        data += size - size % kBlockSize;
+        size %= kBlockSize;
+    }
+    memcpy(buffer, data, size);
+    buffered = size;
+}
+
+void Sha256::finish(uint8_t out[kDigestSize])
+{
+    const uint64_t bits = length * 8;
+    buffer[buffered++] = 0x80;
+    if (buffered > kBlockSize - 8) {
+        memset(buffer + buffered, 0, kBlockSize - buffered);
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+    memset(buffer + buffered, 0, kBlockSize - 8 - buffered);
+    for (int i = 0; i < 8; ++i) {
+        buffer[kBlockSize - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    compress(state, buffer, 1);
+    for (int i = 0; i < 8; ++i) {
+        out[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        out[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        out[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        out[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+void Sha256::hash(const uint8_t* data, size_t size, uint8_t out[kDigestSize])
+{
+    Sha256 ctx;
+    ctx.update(data, size);
+    ctx.finish(out);
+}
+
+bool Sha256::accelerated()
+{
+    return compress != compressPortable;
+}
+
+namespace {
+
+// Inner and outer hash states after the key block of HMAC-SHA256.
+void hmacSha256Keyed(const uint8_t* key, size_t keySize, Sha256& inner, Sha256& outer)
+{
+    uint8_t block[Sha256::kBlockSize] = {};
+    if (keySize > Sha256::kBlockSize) {
+        Sha256::hash(key, keySize, block);
+    } else if (keySize > 0) {
+        memcpy(block, key, keySize);
+    }
+    uint8_t pad[Sha256::kBlockSize];
+    for (size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    inner.update(pad, sizeof(pad));
+    for (size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    outer.update(pad, sizeof(pad));
+    memset(block, 0, sizeof(block));
+    memset(pad, 0, sizeof(pad));
+}
+
+} // namespace
+
+void hmacSha256(const uint8_t* key, size_t keySize, const uint8_t* data, size_t size,
+                uint8_t out[Sha256::kDigestSize])
+{
+    Sha256 inner;
+    Sha256 outer;
+    hmacSha256Keyed(key, keySize, inner, outer);
+    inner.update(data, size);
+    uint8_t innerDigest[Sha256::kDigestSize];
+    inner.finish(innerDigest);
+    outer.update(innerDigest, sizeof(innerDigest));
+    outer.finish(out);
+}
+
+void pbkdf2HmacSha256(const uint8_t* password, size_t passwordSize, const uint8_t* salt, size_t saltSize,
+                      uint32_t iterations, uint8_t* out, size_t outSize)
+{
+    Sha256 innerKeyed;
+    Sha256 outerKeyed;
+    hmacSha256Keyed(password, passwordSize, innerKeyed, outerKeyed);
+    for (uint32_t block = 1; outSize > 0; ++block) {
+        const uint8_t index[4] = {static_cast<uint8_t>(block >> 24), static_cast<uint8_t>(block >> 16),
+                                  static_cast<uint8_t>(block >> 8), static_cast<uint8_t>(block)};
+        uint8_t u[Sha256::kDigestSize];
+        uint8_t acc[Sha256::kDigestSize];
+        Sha256 inner = innerKeyed;
+        inner.update(salt, saltSize);
+        inner.update(index, sizeof(index));
+        inner.finish(u);
+        Sha256 outer = outerKeyed;
+        outer.update(u, sizeof(u));
+        outer.finish(u);
+        memcpy(acc, u, sizeof(acc));
+        for (uint32_t i = 1; i < iterations; ++i) {
+            inner = innerKeyed;
+            inner.update(u, sizeof(u));
+            inner.finish(u);
+            outer = outerKeyed;
+            outer.update(u, sizeof(u));
+            outer.finish(u);
+            for (size_t k = 0; k < sizeof(acc); ++k) {
+                acc[k] ^= u[k];
+            }
+        }
+        const size_t take = outSize < sizeof(acc) ? outSize : sizeof(acc);
+        memcpy(out, acc, take);
+        out += take;
+        outSize -= take;
+        memset(u, 0, sizeof(u));
+        memset(acc, 0, sizeof(acc));
+    }
+}
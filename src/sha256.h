@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SHA-256 (FIPS 180-4), HMAC-SHA256 and PBKDF2-HMAC-SHA256. The block
+// function is picked once at startup: the x86 SHA extensions (SHA-NI) when the
+// CPU has them, portable C++ otherwise.
+class Sha256 {
+public:
+    static const size_t kDigestSize = 32;
+    static const size_t kBlockSize = 64;
+
+    Sha256();
+
+    void update(const uint8_t* data, size_t size);
+    void finish(uint8_t out[kDigestSize]);
+
+    // One-shot helper.
+    static void hash(const uint8_t* data, size_t size, uint8_t out[kDigestSize]);
+    // True when the SHA-NI block function is in use.
+    static bool accelerated();
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[kBlockSize];
+    size_t buffered;
+    uint64_t length;
+};
+
+void hmacSha256(const uint8_t* key, size_t keySize, const uint8_t* data, size_t size,
+                uint8_t out[Sha256::kDigestSize]);
+
+// PBKDF2-HMAC-SHA256 (RFC 8018) with any output length. The keyed pad states
+// are computed once and copied for every iteration.
+void pbkdf2HmacSha256(const uint8_t* password, size_t passwordSize, const uint8_t* salt, size_t saltSize,
+                      uint32_t iterations, uint8_t* out, size_t outSize);
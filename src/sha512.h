@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SHA-512 (FIPS 180-4) and HMAC-SHA512 (RFC 2104), portable C++. The
+// multi-buffer kernel used for PBKDF2 lives in pbkdf2_sha512.cpp and shares the
+// round constants and initial state exported here.
+class Sha512 {
+public:
+    static const size_t kDigestSize = 64;
+    static const size_t kBlockSize = 128;
+    static const uint64_t kRound[80];
+    static const uint64_t kInitialState[8];
+
+    Sha512();
+
+    void update(const uint8_t* data, size_t size);
+    void finish(uint8_t out[kDigestSize]);
+
+    // Internal state after whole blocks only; used to precompute HMAC pads.
+    void stateWords(uint64_t out[8]) const;
+
+    static void hash(const uint8_t* data, size_t size, uint8_t out[kDigestSize]);
+    // Single-block compression on a host-order message schedule.
+    static void compress(uint64_t state[8], const uint64_t block[16]);
+
+private:
+    uint64_t state[8];
+    uint8_t buffer[kBlockSize];
+    size_t buffered;
+    uint64_t length;
+};
+
+void hmacSha512(const uint8_t* key, size_t keySize, const uint8_t* data, size_t size,
+                uint8_t out[Sha512::kDigestSize]);
@@ -0,0 +1,190 @@
+#include "signature_cache.h"
+
+#include "sha256.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+std::string lower(const std::string& value)
+{
+    std::string out = value;
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return std::tolower(c); });
+    return out;
+}
+
+} // namespace
+
+SignatureCache::SignatureCache(size_t capacity)
+    : capacity(capacity), nextEpoch(1), hits(0), misses(0), invalidations(0)
+{
+}
+
+void SignatureCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->capacity = capacity;
+    while (lru.size() > capacity) {
+        entries.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+void SignatureCache::unlocked(const std::string& scope, const std::string& address,
+                              std::chrono::steady_clock::time_point until)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string account = accountKey(scope, address);
+    auto it = unlocks.find(account);
+    if (it != unlocks.end() && it->second.until > std::chrono::steady_clock::now()) {
+        if (it->second.until != std::chrono::steady_clock::time_point::max()) {
+            it->second.until = until;
+        }
+        return;
+    }
+    unlocks[account] = Unlock{until, nextEpoch++};
+}
+
+void SignatureCache::invalidate(const std::string& scope, const std::string& address)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string account = accountKey(scope, address);
+    unlocks.erase(account);
+    eraseLocked(account);
+    ++invalidations;
+}
+
+void SignatureCache::invalidateScope(const std::string& scope)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string prefix = scope + '\n';
+    for (auto it = unlocks.begin(); it != unlocks.end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? unlocks.erase(it) : std::next(it);
+    }
+    eraseLocked(prefix);
+    ++invalidations;
+}
+
+bool SignatureCache::lookup(const std::string& scope, const std::string& address, const std::string& kind,
+                            const std::string& input, const std::string& chainID, std::string& signature,
+                            uint64_t& epoch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    epoch = 0;
+    if (capacity == 0) {
+        return false;
+    }
+    const std::string account = accountKey(scope, address);
+    const Unlock* unlock = unlockLocked(account);
+    if (!unlock) {
+        // Not known to be unlocked: the SDK decides, and nothing is cached.
+        ++misses;
+        return false;
+    }
+    epoch = unlock->epoch;
+    auto it = entries.find(entryKey(account, kind, input, chainID));
+    if (it == entries.end()) {
+        ++misses;
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    signature = it->second->second;
+    ++hits;
+    return true;
+}
+
+void SignatureCache::store(const std::string& scope, const std::string& address, const std::string& kind,
+                           const std::string& input, const std::string& chainID, const std::string& signature,
+                           uint64_t epoch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (capacity == 0 || epoch == 0) {
+        return;
+    }
+    const std::string account = accountKey(scope, address);
+    const Unlock* unlock = unlockLocked(account);
+    if (!unlock || unlock->epoch != epoch) {
+        return;
+    }
+    const std::string key = entryKey(account, kind, input, chainID);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->second->second = signature;
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+    lru.emplace_front(key, signature);
+    entries[key] = lru.begin();
+    while (lru.size() > capacity) {
+        entries.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+SignatureCache::Stats SignatureCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s;
+    s.capacity = capacity;
+    s.entries = lru.size();
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& item : unlocks) {
+        s.unlockedAccounts += item.second.until > now ? 1 : 0;
+    }
+    s.hits = hits;
+    s.misses = misses;
+    s.invalidations = invalidations;
+    return s;
+}
+
+std::string SignatureCache::accountKey(const std::string& scope, const std::string& address)
+{
+    std::string account = lower(address);
+    if (account.compare(0, 2, "0x") == 0) {
+        account.erase(0, 2);
+    }
+    return scope + '\n' + account + '\n';
+}
+
+std::string SignatureCache::entryKey(const std::string& account, const std::string& kind, const std::string& input,
+                                     const std::string& chainID)
+{
+    // Only a digest of the input is kept, however large the transaction.
+    Sha256 sha;
+    sha.update(reinterpret_cast<const uint8_t*>(kind.data()), kind.size());
+    sha.update(reinterpret_cast<const uint8_t*>("\n"), 1);
+    sha.update(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    sha.update(reinterpret_cast<const uint8_t*>("\n"), 1);
+    sha.update(reinterpret_cast<const uint8_t*>(chainID.data()), chainID.size());
+    uint8_t digest[Sha256::kDigestSize];
+    sha.finish(digest);
+    return account + std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+void SignatureCache::eraseLocked(const std::string& prefix)
+{
+    for (auto it = lru.begin(); it != lru.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            entries.erase(it->first);
+            it = lru.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+const SignatureCache::Unlock* SignatureCache::unlockLocked(const std::string& account)
+{
+    auto it = unlocks.find(account);
+    if (it == unlocks.end()) {
+        return nullptr;
+    }
+    if (it->second.until <= std::chrono::steady_clock::now()) {
+        // The timed unlock ran out and the SDK has locked the account again.
+        unlocks.erase(it);
+        eraseLocked(account);
+        return nullptr;
+    }
+    return &it->second;
+}
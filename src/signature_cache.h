@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Signatures made with unlocked accounts, so a retried SignHash or SignTx with
+// the same input is answered without another SDK call (the SDK signs
+// deterministically, RFC 6979). Entries are keyed by keystore scope, address
+// and a SHA-256 digest of the signed input and chain ID, and evicted least
+// recently used beyond capacity. A cached signature is only returned while
+// the account is known to be unlocked: unlocked() records each Unlock and
+// TimedUnlock with its expiry, and invalidate() (Lock, Delete, Update) drops
+// the record together with the account's entries. Thread-safe.
+class SignatureCache {
+public:
+    static const size_t kDefaultCapacity = 4096;
+
+    struct Stats {
+        size_t capacity = 0;
+        size_t entries = 0;
+        size_t unlockedAccounts = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t invalidations = 0;
+    };
+
+    explicit SignatureCache(size_t capacity = kDefaultCapacity);
+
+    SignatureCache(const SignatureCache&) = delete;
+    SignatureCache& operator=(const SignatureCache&) = delete;
+
+    // 0 disables the cache and drops every entry.
+    void setCapacity(size_t capacity);
+
+    // `until` is time_point::max() for an unlock without timeout. As in the
+    // SDK, a timed unlock does not shorten an indefinite one.
+    void unlocked(const std::string& scope, const std::string& address, std::chrono::steady_clock::time_point until);
+    void invalidate(const std::string& scope, const std::string& address);
+    // Forgets everything about a keystore that was closed or reopened.
+    void invalidateScope(const std::string& scope);
+
+    // kind separates the signed input types ("hash", "tx"); chainID is empty
+    // where it does not apply. On a miss, epoch is set for the matching store().
+    bool lookup(const std::string& scope, const std::string& address, const std::string& kind,
+                const std::string& input, const std::string& chainID, std::string& signature, uint64_t& epoch);
+    // Ignored unless the account has stayed unlocked since the lookup that
+    // returned epoch.
+    void store(const std::string& scope, const std::string& address, const std::string& kind,
+               const std::string& input, const std::string& chainID, const std::string& signature, uint64_t epoch);
+
+    Stats stats() const;
+
+private:
+    struct Unlock {
+        std::chrono::steady_clock::time_point until;
+        uint64_t epoch;
+    };
+    using Lru = std::list<std::pair<std::string, std::string>>;
+
+    static std::string accountKey(const std::string& scope, const std::string& address);
+    static std::string entryKey(const std::string& account, const std::string& kind, const std::string& input,
+                                const std::string& chainID);
+    // Drops entries whose key starts with prefix.
+    void eraseLocked(const std::string& prefix);
+    const Unlock* unlockLocked(const std::string& account);
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    Lru lru;
+    std::unordered_map<std::string, Lru::iterator> entries;
+    std::map<std::string, Unlock> unlocks;
+    uint64_t nextEpoch;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+};
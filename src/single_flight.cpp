@@ -0,0 +1,17 @@
+#include "single_flight.h"
+
+#include "sha256.h"
+
+std::string singleFlightKey(std::initializer_list<std::string> parts)
+{
+    Sha256 sha;
+    for (const std::string& part : parts) {
+        // Length-prefixed, so ("ab", "c") and ("a", "bc") differ.
+        const uint64_t size = part.size();
+        sha.update(reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+        sha.update(reinterpret_cast<const uint8_t*>(part.data()), part.size());
+    }
+    uint8_t digest[Sha256::kDigestSize];
+    sha.finish(digest);
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Digest of a call's identifying arguments (operation, keystore, address,
+// passphrases, ...), so that passphrases are not kept as map keys.
+std::string singleFlightKey(std::initializer_list<std::string> parts);
+
+// Runs at most one call per key at a time: callers that arrive while a call
+// with the same key is running wait for it and get its result instead of
+// running their own. Meant for scrypt-bound keystore calls, where a burst of
+// identical requests (clients unlocking the same account after a restart)
+// would otherwise each pay for a full key derivation. A call that throws
+// rethrows in every caller that shared it. Thread-safe.
+template <typename T>
+class SingleFlight {
+public:
+    struct Stats {
+        uint64_t calls = 0;     // calls that ran
+        uint64_t coalesced = 0; // callers that shared a running call's result
+        size_t inFlight = 0;
+    };
+
+    T run(const std::string& key, const std::function<T()>& call)
+    {
+        std::promise<T> promise;
+        std::shared_future<T> running;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = flights.find(key);
+            if (it != flights.end()) {
+                running = it->second;
+                ++coalesced;
+            } else {
+                flights[key] = promise.get_future().share();
+                ++calls;
+            }
+        }
+        if (running.valid()) {
+            return running.get();
+        }
+        T result;
+        try {
+            result = call();
+        } catch (...) {
+            // Waiters get the same exception; later callers start afresh.
+            finish(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        finish(key);
+        promise.set_value(result);
+        return result;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats s;
+        s.calls = calls;
+        s.coalesced = coalesced;
+        s.inFlight = flights.size();
+        return s;
+    }
+
+private:
+    void finish(const std::string& key)
+    {
+        // Callers from here on start a new call rather than reuse a result
+        // that may already be stale (a lock right after an unlock).
+        std::lock_guard<std::mutex> lock(mutex);
+        flights.erase(key);
+    }
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_future<T>> flights;
+    uint64_t calls = 0;
+    uint64_t coalesced = 0;
+};
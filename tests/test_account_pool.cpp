@@ -0,0 +1,197 @@
+// Unit tests for the pre-generated account pool. AccountPool is driven with
+// in-process operations against a journal in a temporary directory; the
+// AccountsModuleImpl test uses the SDK mock with a refill rate low enough that
+// the background thread is idle while the test calls into the mock.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "account_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+std::string makeTempDir()
+{
+    char tmpl[] = "/tmp/logos-accounts-pool-XXXXXX";
+    const char* dir = mkdtemp(tmpl);
+    return dir ? std::string(dir) : std::string();
+}
+
+template <typename Cond>
+bool eventually(Cond cond)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+// Accounts "created" by the fake ops, with the passphrase each was encrypted with.
+struct FakeKeystore {
+    std::mutex mutex;
+    std::map<std::string, std::string> accounts;
+    int next = 0;
+
+    AccountPool::Ops ops()
+    {
+        AccountPool::Ops ops;
+        ops.create = [this](const std::string& passphrase, std::string&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::string address = "0xA" + std::to_string(next++);
+            accounts[address] = passphrase;
+            return address;
+        };
+        ops.verify = [this](const std::string& address, const std::string& passphrase) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = accounts.find(address);
+            return it != accounts.end() && it->second == passphrase;
+        };
+        ops.remove = [this](const std::string& address, const std::string& passphrase) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = accounts.find(address);
+            if (it == accounts.end() || it->second != passphrase) {
+                return false;
+            }
+            accounts.erase(it);
+            return true;
+        };
+        return ops;
+    }
+};
+
+} // namespace
+
+LOGOS_TEST(accountPool_hands_out_pregenerated_accounts_once) {
+    const std::string dir = makeTempDir();
+    FakeKeystore keystore;
+    std::string first;
+    {
+        AccountPool pool(keystore.ops(), dir + "/.account-pool");
+        LOGOS_ASSERT(pool.configure("secret", 3, 0));
+        LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+        LOGOS_ASSERT(pool.reserved("0xa0"));
+
+        std::string address;
+        LOGOS_ASSERT_FALSE(pool.take("other", address));
+        LOGOS_ASSERT(pool.take("secret", first));
+        LOGOS_ASSERT_EQ(first, std::string("0xA0"));
+        LOGOS_ASSERT_FALSE(pool.reserved(first));
+        LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+        LOGOS_ASSERT_EQ(pool.stats().hits, uint64_t(1));
+    }
+
+    // A new session picks the stock up from the journal, re-verifies it and
+    // never offers the account that was already handed out.
+    AccountPool pool(keystore.ops(), dir + "/.account-pool");
+    LOGOS_ASSERT(pool.reserved("0xA1"));
+    LOGOS_ASSERT_FALSE(pool.reserved(first));
+    LOGOS_ASSERT_EQ(pool.stats().pendingVerification, size_t(3));
+    LOGOS_ASSERT(pool.configure("secret", 3, 0));
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+    std::set<std::string> handed;
+    for (int i = 0; i < 3; ++i) {
+        std::string address;
+        LOGOS_ASSERT(pool.take("secret", address));
+        handed.insert(address);
+    }
+    LOGOS_ASSERT_FALSE(handed.count(first));
+    LOGOS_ASSERT_EQ(pool.stats().generated, uint64_t(0));
+    pool.stop();
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(accountPool_releases_accounts_with_another_passphrase) {
+    const std::string dir = makeTempDir();
+    FakeKeystore keystore;
+    {
+        AccountPool pool(keystore.ops(), dir + "/.account-pool");
+        pool.configure("old", 2, 0);
+        LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 2; }));
+    }
+    AccountPool pool(keystore.ops(), dir + "/.account-pool");
+    pool.configure("new", 1, 0);
+    LOGOS_ASSERT(eventually([&] { return pool.stats().pendingVerification == 0 && pool.stats().ready == 1; }));
+    LOGOS_ASSERT_FALSE(pool.reserved("0xA0"));
+    LOGOS_ASSERT_FALSE(pool.reserved("0xA1"));
+    LOGOS_ASSERT_FALSE(pool.stats().lastError.empty());
+    pool.stop();
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(accountPool_disable_deletes_unused_accounts_and_rate_limits) {
+    const std::string dir = makeTempDir();
+    FakeKeystore keystore;
+    AccountPool pool(keystore.ops(), dir + "/.account-pool");
+    pool.configure("secret", 5, 60);
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // One account a second: the second is not due yet.
+    LOGOS_ASSERT_EQ(pool.stats().ready, size_t(1));
+
+    LOGOS_ASSERT(pool.configure("", 0, 0));
+    LOGOS_ASSERT_FALSE(pool.stats().enabled);
+    LOGOS_ASSERT(keystore.accounts.empty());
+    std::string address;
+    LOGOS_ASSERT_FALSE(pool.take("secret", address));
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreNewAccount_uses_account_pool_and_hides_stock) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_NewAccount").returns("0xPOOLED");
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts")
+        .returns("[{\"address\":\"0xpooled\",\"url\":\"keystore:///k/a\"},{\"address\":\"0xOTHER\",\"url\":\"keystore:///k/b\"}]");
+    const std::string dir = makeTempDir();
+
+    AccountsModuleImpl impl;
+    impl.initKeystore(dir, 4096, 6);
+    LOGOS_ASSERT_FALSE(impl.keystoreConfigureAccountPool("secret", -1, 0));
+    LOGOS_ASSERT(impl.keystoreConfigureAccountPool("secret", 1, 1));
+    LOGOS_ASSERT(eventually([&] {
+        return nlohmann::json::parse(impl.keystoreAccountPoolStatus())["ready"].get<int>() == 1;
+    }));
+
+    auto accounts = impl.keystoreAccounts();
+    LOGOS_ASSERT_EQ(accounts.size(), size_t(1));
+    LOGOS_ASSERT(accounts[0].find("0xOTHER") != std::string::npos);
+    LOGOS_ASSERT_FALSE(impl.keystoreHasAddress("0xPOOLED"));
+    // Nor is it found, exported or signed with before it is handed out.
+    t.mockCFunction("GoWSK_accounts_keystore_Find").returns("{\"address\":\"0xpooled\",\"url\":\"keystore:///k/a\"}");
+    t.mockCFunction("GoWSK_accounts_keystore_Export").returns("{}");
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+    LOGOS_ASSERT(impl.keystoreFind("0xPOOLED", "").empty());
+    LOGOS_ASSERT(impl.keystoreFind("", "keystore:///k/a").empty());
+    LOGOS_ASSERT(impl.keystoreExport("0xPOOLED", "secret", "new").empty());
+    LOGOS_ASSERT(impl.keystoreSignHash("0xPOOLED", "0x01").empty());
+    LOGOS_ASSERT(impl.keystoreSignTx("0xPOOLED", "{}", "0x1").empty());
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_Export"), 0);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 0);
+
+    const int created = t.cFunctionCallCount("GoWSK_accounts_keystore_NewAccount");
+    LOGOS_ASSERT_EQ(impl.keystoreNewAccount("secret"), std::string("0xPOOLED"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewAccount"), created);
+    LOGOS_ASSERT_EQ(impl.keystoreAccounts().size(), size_t(2));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xPOOLED", "0x01"), std::string("0xSIG"));
+
+    // Another passphrase, or an empty pool, goes to the SDK.
+    LOGOS_ASSERT_EQ(impl.keystoreNewAccount("different"), std::string("0xPOOLED"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewAccount"), created + 1);
+    auto status = nlohmann::json::parse(impl.keystoreAccountPoolStatus());
+    LOGOS_ASSERT_EQ(status["hits"].get<int>(), 1);
+    impl.closeKeystore("");
+    std::filesystem::remove_all(dir);
+}
@@ -6,11 +6,23 @@
 
 #include <logos_test.h>
 #include "accounts_module_impl.h"
+#include "key_file.h"
+#include "personal_message.h"
+#include "scrypt.h"
 
 #include <QDir>
 #include <QTemporaryDir>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 LOGOS_TEST(integration_keystore_new_account) {
     QTemporaryDir dir(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
@@ -35,3 +47,341 @@ LOGOS_TEST(integration_mnemonic_default_length) {
     LOGOS_ASSERT_FALSE(phrase.empty());
     LOGOS_ASSERT_TRUE(phrase.find(' ') != std::string::npos);
 }
+
+// Cross-checks the native batch seed derivation against the SDK and reports the
+// throughput of both paths.
+LOGOS_TEST(integration_batch_ext_keys_match_sdk) {
+    AccountsModuleImpl impl;
+    const auto phrases = impl.createRandomMnemonics(32, 12);
+    LOGOS_ASSERT_EQ(static_cast<int>(phrases.size()), 32);
+
+    const auto sdkStart = std::chrono::steady_clock::now();
+    std::vector<std::string> expected;
+    for (const auto& phrase : phrases) {
+        expected.push_back(impl.createExtKeyFromMnemonic(phrase, "integration"));
+    }
+    const auto sdkEnd = std::chrono::steady_clock::now();
+    const auto keys = impl.createExtKeysFromMnemonics(nlohmann::json(phrases).dump(), "integration");
+    const auto nativeEnd = std::chrono::steady_clock::now();
+
+    LOGOS_ASSERT_EQ(static_cast<int>(keys.size()), 32);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        LOGOS_ASSERT_FALSE(expected[i].empty());
+        LOGOS_ASSERT_EQ(keys[i], expected[i]);
+    }
+    const double sdkMs = std::chrono::duration<double, std::milli>(sdkEnd - sdkStart).count();
+    const double nativeMs = std::chrono::duration<double, std::milli>(nativeEnd - sdkEnd).count();
+    fprintf(stderr, "mnemonic -> ext key, 32 phrases: sdk %.1f ms, native batch %.1f ms\n", sdkMs, nativeMs);
+}
+
+// Phrases the SDK refuses (bad checksum, unknown word, wrong length) must not
+// get a key from the native batch path either.
+LOGOS_TEST(integration_batch_ext_keys_reject_what_sdk_rejects) {
+    AccountsModuleImpl impl;
+    const std::string prefix = "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon ";
+    const std::vector<std::string> phrases = {
+        prefix + "abandon",
+        prefix + "abandonx",
+        "abandon abandon about",
+        prefix + "about",
+    };
+    const auto keys = impl.createExtKeysFromMnemonics(nlohmann::json(phrases).dump(), "integration");
+    LOGOS_ASSERT_EQ(keys.size(), phrases.size());
+    for (size_t i = 0; i < phrases.size(); ++i) {
+        const std::string expected = impl.createExtKeyFromMnemonic(phrases[i], "integration");
+        LOGOS_ASSERT_EQ(keys[i], expected);
+    }
+    LOGOS_ASSERT_FALSE(keys.back().empty());
+}
+
+// Native handle derivation and ECDSA export must agree with the SDK's string
+// API; also reports how much repeated decoding the handles save.
+LOGOS_TEST(integration_ext_key_handles_match_sdk) {
+    AccountsModuleImpl impl;
+    const std::string root = impl.createExtKeyFromMnemonic(impl.createRandomMnemonic(12), "integration");
+    LOGOS_ASSERT_FALSE(root.empty());
+    const std::string account = impl.deriveExtKey(root, "m/44'/60'/0'/0");
+    const int64_t accountHandle = impl.deriveExtKeyHandle(impl.extKeyHandleFromString(root), "m/44'/60'/0'/0");
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(accountHandle), account);
+
+    const auto sdkStart = std::chrono::steady_clock::now();
+    std::vector<std::string> expected;
+    for (int i = 0; i < 64; ++i) {
+        expected.push_back(impl.extKeyToECDSA(impl.deriveExtKey(account, "m/" + std::to_string(i))));
+    }
+    const auto sdkEnd = std::chrono::steady_clock::now();
+    std::vector<std::string> native;
+    for (int i = 0; i < 64; ++i) {
+        const int64_t child = impl.deriveExtKeyHandle(accountHandle, "m/" + std::to_string(i));
+        native.push_back(impl.extKeyHandleToECDSA(child));
+        impl.releaseExtKeyHandle(child);
+    }
+    const auto nativeEnd = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        LOGOS_ASSERT_FALSE(expected[i].empty());
+        LOGOS_ASSERT_EQ(native[i], expected[i]);
+    }
+    const double sdkMs = std::chrono::duration<double, std::milli>(sdkEnd - sdkStart).count();
+    const double nativeMs = std::chrono::duration<double, std::milli>(nativeEnd - sdkEnd).count();
+    fprintf(stderr, "derive + ECDSA, 64 children: sdk strings %.1f ms, handles %.1f ms\n", sdkMs, nativeMs);
+}
+
+// Handle results must be the SDK's strings, byte for byte, for a BIP-32 test
+// vector as well as random keys: serialization of private and public keys,
+// ECDSA export (prefix and case), mnemonic seeds, and the same refusals.
+LOGOS_TEST(integration_ext_key_handle_formats_match_sdk) {
+    AccountsModuleImpl impl;
+    const std::string vector1 =
+        "xprv9s21ZrQH143K3QTDL4LXw2F7HEK3wJUD2nW2nRk4stbPy6cq3jPPqjiChkVvvNKmPGJxWUtg6LnF5kejMRNNU3TGtRBeJgk33yuGBxrMPHi";
+    const std::string phrase = impl.createRandomMnemonic(24);
+    const std::vector<std::string> roots = {vector1, impl.createExtKeyFromMnemonic(phrase, "integration")};
+
+    const int64_t fromMnemonic = impl.extKeyHandleFromMnemonic(phrase, "integration");
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(fromMnemonic), roots[1]);
+    impl.releaseExtKeyHandle(fromMnemonic);
+
+    for (const std::string& root : roots) {
+        LOGOS_ASSERT_FALSE(root.empty());
+        const int64_t handle = impl.extKeyHandleFromString(root);
+        LOGOS_ASSERT_EQ(impl.extKeyHandleToString(handle), root);
+        LOGOS_ASSERT_EQ(impl.extKeyHandleToECDSA(handle), impl.extKeyToECDSA(root));
+        for (const std::string path : {"m/0'", "m/44'/60'/0'/0/7", "m/1'/2'/3"}) {
+            const int64_t child = impl.deriveExtKeyHandle(handle, path);
+            const std::string expected = impl.deriveExtKey(root, path);
+            LOGOS_ASSERT_FALSE(expected.empty());
+            LOGOS_ASSERT_EQ(impl.extKeyHandleToString(child), expected);
+            LOGOS_ASSERT_EQ(impl.extKeyHandleToECDSA(child), impl.extKeyToECDSA(expected));
+            impl.releaseExtKeyHandle(child);
+        }
+        impl.releaseExtKeyHandle(handle);
+    }
+
+    // Public keys: no ECDSA export, no hardened children, same non-hardened children.
+    const std::string xpub =
+        "xpub68Gmy5EdvgibQVfPdqkBBCHxA5htiqg55crXYuXoQRKfDBFA1WEjWgP6LHhwBZeNK1VTsfTFUHCdrfp1bgwQ9xv5ski8PX9rL2dZXvgGDnw";
+    const int64_t publicHandle = impl.extKeyHandleFromString(xpub);
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(publicHandle), xpub);
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToECDSA(publicHandle), impl.extKeyToECDSA(xpub));
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(impl.deriveExtKeyHandle(publicHandle, "m/1/2")), impl.deriveExtKey(xpub, "m/1/2"));
+    LOGOS_ASSERT_EQ(impl.deriveExtKeyHandle(publicHandle, "m/0'") == 0, impl.deriveExtKey(xpub, "m/0'").empty());
+}
+
+// The native key-file decryptor must recover exactly the key the SDK
+// encrypted, for light and standard scrypt parameters; also reports the time
+// an SDK unlock and a native decryption take on the same standard-cost file.
+LOGOS_TEST(integration_native_key_file_decrypt_matches_sdk) {
+    AccountsModuleImpl impl;
+    const std::string root = impl.createExtKeyFromMnemonic(impl.createRandomMnemonic(12), "integration");
+    std::vector<std::string> keys;
+    for (int i = 0; i < 4; ++i) {
+        std::string key = impl.extKeyToECDSA(impl.deriveExtKey(root, "m/44'/60'/0'/0/" + std::to_string(i)));
+        if (key.rfind("0x", 0) == 0) {
+            key = key.substr(2);
+        }
+        keys.push_back(key);
+    }
+
+    const auto checkDir = [&](const std::string& dir, size_t expected) {
+        std::vector<std::string> files;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* entry = readdir(d)) {
+                if (entry->d_name[0] != '.') {
+                    files.push_back(entry->d_name);
+                }
+            }
+            closedir(d);
+        }
+        LOGOS_ASSERT_EQ(files.size(), expected);
+        for (const std::string& name : files) {
+            FILE* f = std::fopen((dir + "/" + name).c_str(), "rb");
+            LOGOS_ASSERT_TRUE(f != nullptr);
+            std::string json;
+            char chunk[4096];
+            size_t got = 0;
+            while ((got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+                json.append(chunk, got);
+            }
+            std::fclose(f);
+            uint8_t key[32];
+            std::string error;
+            LOGOS_ASSERT_TRUE(keyFileDecrypt(json, "integration-pass", key, error));
+            static const char digits[] = "0123456789abcdef";
+            std::string hex;
+            for (uint8_t b : key) {
+                hex += digits[b >> 4];
+                hex += digits[b & 0xf];
+            }
+            LOGOS_ASSERT_TRUE(std::find(keys.begin(), keys.end(), hex) != keys.end());
+            LOGOS_ASSERT_FALSE(keyFileDecrypt(json, "wrong-pass", key, error));
+        }
+    };
+
+    QTemporaryDir light(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(light.isValid());
+    LOGOS_ASSERT_TRUE(impl.initKeystore(light.path().toStdString(), 4096, 6));
+    for (const std::string& key : keys) {
+        LOGOS_ASSERT_FALSE(impl.keystoreImportECDSA(key, "integration-pass").empty());
+    }
+    checkDir(light.path().toStdString(), keys.size());
+
+    QTemporaryDir standard(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(standard.isValid());
+    LOGOS_ASSERT_TRUE(impl.initKeystore(standard.path().toStdString(), 262144, 1));
+    const std::string address = impl.keystoreImportECDSA(keys[0], "integration-pass");
+    LOGOS_ASSERT_FALSE(address.empty());
+    const auto sdkStart = std::chrono::steady_clock::now();
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+    const auto sdkEnd = std::chrono::steady_clock::now();
+    checkDir(standard.path().toStdString(), 1);
+    const auto nativeEnd = std::chrono::steady_clock::now();
+    impl.keystoreLock(address);
+
+    const double sdkMs = std::chrono::duration<double, std::milli>(sdkEnd - sdkStart).count();
+    const double nativeMs = std::chrono::duration<double, std::milli>(nativeEnd - sdkEnd).count();
+    fprintf(stderr, "key file, scrypt n=262144 r=8 p=1: sdk unlock %.1f ms, native decrypt (%s, twice) %.1f ms\n",
+            sdkMs, scryptKernel(), nativeMs);
+}
+
+// Native signatures of an unlocked account must be the SDK's, byte for byte;
+// also reports the SignHash latency of both paths.
+LOGOS_TEST(integration_native_signing_matches_sdk) {
+    QTemporaryDir dir(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(dir.isValid());
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystore(dir.path().toStdString(), 4096, 6));
+    LOGOS_ASSERT_TRUE(impl.configureSignatureCache(0));
+    const std::string address = impl.keystoreNewAccount("integration-pass");
+    LOGOS_ASSERT_FALSE(address.empty());
+
+    const int count = 200;
+    std::vector<std::string> hashes;
+    for (int i = 0; i < count; ++i) {
+        char hash[67];
+        snprintf(hash, sizeof(hash), "0x%064x", i * 7919 + 1);
+        hashes.push_back(hash);
+    }
+
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+    std::vector<std::string> expected;
+    const auto sdkStart = std::chrono::steady_clock::now();
+    for (const std::string& hash : hashes) {
+        expected.push_back(impl.keystoreSignHash(address, hash));
+    }
+    const auto sdkEnd = std::chrono::steady_clock::now();
+
+    LOGOS_ASSERT_TRUE(impl.configureNativeSigning(true));
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+    const auto nativeStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        LOGOS_ASSERT_FALSE(expected[i].empty());
+        LOGOS_ASSERT_EQ(impl.keystoreSignHash(address, hashes[i]), expected[i]);
+    }
+    const auto nativeEnd = std::chrono::steady_clock::now();
+    auto status = nlohmann::json::parse(impl.nativeSigningStatus());
+    LOGOS_ASSERT_EQ(status["signatures"].get<int>(), count);
+
+    LOGOS_ASSERT_TRUE(impl.keystoreLock(address));
+    LOGOS_ASSERT_TRUE(impl.keystoreSignHash(address, hashes[0]).empty());
+
+    const double sdkUs = std::chrono::duration<double, std::micro>(sdkEnd - sdkStart).count() / count;
+    const double nativeUs = std::chrono::duration<double, std::micro>(nativeEnd - nativeStart).count() / count;
+    fprintf(stderr, "SignHash, one thread: sdk %.1f us, native (%s) %.1f us\n", sdkUs,
+            status["backend"].get<std::string>().c_str(), nativeUs);
+}
+
+// Recovered signers must be the addresses the SDK derives and formats itself;
+// also reports the batch throughput.
+LOGOS_TEST(integration_recover_address_matches_sdk) {
+    QTemporaryDir dir(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(dir.isValid());
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystore(dir.path().toStdString(), 4096, 6));
+    LOGOS_ASSERT_TRUE(impl.configureSignatureCache(0));
+    const std::string key = "0x7a28b5ba57c53603b0b07b56bba752f7784bf506fa95edc395f5cf6c7514fe9d";
+    const std::string expected = impl.publicKeyToAddress(impl.ecdsaToPublicKey(key));
+    LOGOS_ASSERT_FALSE(expected.empty());
+    const std::string address = impl.keystoreImportECDSA(key, "integration-pass");
+    LOGOS_ASSERT_EQ(address, expected);
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+
+    const int count = 1000;
+    nlohmann::json items = nlohmann::json::array();
+    for (int i = 0; i < count; ++i) {
+        char hash[67];
+        snprintf(hash, sizeof(hash), "0x%064x", i * 104729 + 3);
+        const std::string signature = impl.keystoreSignHash(address, hash);
+        LOGOS_ASSERT_FALSE(signature.empty());
+        items.push_back({{"hash", hash}, {"signature", signature}, {"address", address}});
+    }
+    LOGOS_ASSERT_EQ(impl.recoverAddress(items[0]["hash"], items[0]["signature"]), expected);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<std::string> recovered = impl.recoverAddressBatch(items.dump());
+    const auto end = std::chrono::steady_clock::now();
+    LOGOS_ASSERT_EQ(recovered.size(), size_t(count));
+    for (const std::string& r : recovered) {
+        LOGOS_ASSERT_EQ(r, expected);
+    }
+    const auto verified = nlohmann::json::parse(impl.verifyBatch(items.dump()));
+    LOGOS_ASSERT_EQ(std::count(verified.begin(), verified.end(), true), count);
+
+    const double us = std::chrono::duration<double, std::micro>(end - start).count() / count;
+    fprintf(stderr, "recoverAddressBatch, %d signatures: %.1f us each\n", count, us);
+}
+
+// Typed data signed by the SDK over the native EIP-712 digest recovers to the
+// signing account.
+LOGOS_TEST(integration_sign_typed_data_recovers_signer) {
+    QTemporaryDir dir(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(dir.isValid());
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystore(dir.path().toStdString(), 4096, 6));
+    const std::string address = impl.keystoreNewAccount("integration-pass");
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+
+    const std::string typedData = R"({"types":{"EIP712Domain":[{"name":"name","type":"string"},{"name":"chainId","type":"uint256"}],
+        "Transfer":[{"name":"to","type":"address"},{"name":"amounts","type":"uint256[]"}]},
+        "primaryType":"Transfer","domain":{"name":"integration","chainId":1},
+        "message":{"to":"0xbBbBBBBbbBBBbbbBbbBbbbbBBbBbbbbBbBbbBBbB","amounts":["1000000000000000000",2]}})";
+    const std::string signature = impl.keystoreSignTypedData(address, typedData);
+    LOGOS_ASSERT_FALSE(signature.empty());
+    LOGOS_ASSERT_EQ(impl.recoverAddress(impl.hashTypedData(typedData), signature), address);
+}
+
+LOGOS_TEST(integration_sign_message_fd_recovers_signer) {
+    QTemporaryDir dir(QDir::tempPath() + "/logos-accounts-integration-XXXXXX");
+    LOGOS_ASSERT_TRUE(dir.isValid());
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystore(dir.path().toStdString(), 4096, 6));
+    const std::string address = impl.keystoreNewAccount("integration-pass");
+    LOGOS_ASSERT_TRUE(impl.keystoreUnlock(address, "integration-pass"));
+
+    // A 4 MiB payload goes to SignHash as its 32-byte digest only.
+    const std::string path = dir.path().toStdString() + "/payload.bin";
+    FILE* f = std::fopen(path.c_str(), "wb");
+    LOGOS_ASSERT_TRUE(f != nullptr);
+    const std::string block(1 << 20, 'x');
+    for (int i = 0; i < 4; ++i) {
+        std::fwrite(block.data(), 1, block.size(), f);
+    }
+    std::fclose(f);
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    LOGOS_ASSERT_TRUE(fd >= 0);
+    const std::string signature = impl.keystoreSignMessageFd(address, fd, -1);
+    LOGOS_ASSERT_FALSE(signature.empty());
+    LOGOS_ASSERT_TRUE(lseek(fd, 0, SEEK_SET) == 0);
+    uint8_t digest[Keccak256::kDigestSize];
+    std::string error;
+    LOGOS_ASSERT_TRUE(personalMessageHashFd(fd, -1, digest, error));
+    close(fd);
+
+    static const char kHex[] = "0123456789abcdef";
+    std::string digestHex = "0x";
+    for (uint8_t byte : digest) {
+        digestHex += kHex[byte >> 4];
+        digestHex += kHex[byte & 0x0f];
+    }
+    LOGOS_ASSERT_EQ(impl.recoverAddress(digestHex, signature), address);
+}
@@ -0,0 +1,228 @@
+// Unit tests for the pre-derived address pool. AddressPool is driven with an
+// in-process derive function; the AccountsModuleImpl tests use the SDK mock and
+// wait for the pool to fill before touching it, so the refill thread and the
+// test never call into the mock at the same time.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "address_pool.h"
+#include "memory_dir.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+// Polls cond for up to two seconds.
+template <typename Cond>
+bool eventually(Cond cond)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+std::string fakeAddress(const std::string& path)
+{
+    return "0x" + path.substr(path.rfind('/') + 1);
+}
+
+} // namespace
+
+LOGOS_TEST(addressPool_prefills_and_hands_out_in_order) {
+    AddressPool pool([](const std::string& path, std::string&) { return fakeAddress(path); },
+                     "m/44'/60'/0'/0", 5, 4, 2);
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 4; }));
+
+    AddressPool::Entry entry;
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(5));
+    LOGOS_ASSERT_EQ(entry.path, std::string("m/44'/60'/0'/0/5"));
+    LOGOS_ASSERT_EQ(entry.address, std::string("0x5"));
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(6));
+
+    std::string address;
+    LOGOS_ASSERT(pool.takePath("m/44'/60'/0'/0/8", address));
+    LOGOS_ASSERT_EQ(address, std::string("0x8"));
+    LOGOS_ASSERT_FALSE(pool.takePath("m/44'/60'/0'/0/08", address));
+    LOGOS_ASSERT_FALSE(pool.takePath("m/44'/60'/0'/1/7", address));
+
+    // One left is below the low-water mark: the pool refills to capacity.
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 4; }));
+    const auto stats = pool.stats();
+    LOGOS_ASSERT_EQ(stats.hits, uint64_t(3));
+    LOGOS_ASSERT_EQ(stats.misses, uint64_t(0));
+    LOGOS_ASSERT_EQ(stats.nextIndex, uint64_t(9));
+}
+
+LOGOS_TEST(addressPool_retries_failed_indices) {
+    std::atomic<bool> locked(true);
+    AddressPool pool(
+        [&](const std::string& path, std::string& error) {
+            if (locked) {
+                error = "account is locked";
+                return std::string();
+            }
+            return fakeAddress(path);
+        },
+        "m/0", 0, 2, 1);
+    LOGOS_ASSERT(eventually([&] { return !pool.stats().lastError.empty(); }));
+    AddressPool::Entry entry;
+    LOGOS_ASSERT_FALSE(pool.take(entry));
+
+    locked = false;
+    LOGOS_ASSERT(pool.take(entry));
+    // The failed index 0 is retried before new indices are used.
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(0));
+    LOGOS_ASSERT_EQ(pool.stats().misses, uint64_t(2));
+}
+
+LOGOS_TEST(addressPool_gives_up_indices_that_keep_failing) {
+    // Index 1 exists already (a restart); index 2 fails every time.
+    std::atomic<int> attempts2(0);
+    AddressPool pool(
+        [&](const std::string& path, std::string& error) {
+            if (path == "m/0/1") {
+                error = "account already exists";
+                return std::string();
+            }
+            if (path == "m/0/2") {
+                ++attempts2;
+                error = "derivation failed";
+                return std::string();
+            }
+            return fakeAddress(path);
+        },
+        "m/0", 0, 1, 0); // no low-water mark: every take derives inline
+    AddressPool::Entry entry;
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(0));
+    LOGOS_ASSERT_FALSE(pool.take(entry));
+    LOGOS_ASSERT_EQ(pool.stats().abandoned, uint64_t(1));
+    for (unsigned i = 0; i < AddressPool::kMaxAttempts; ++i) {
+        LOGOS_ASSERT_FALSE(pool.take(entry));
+    }
+    LOGOS_ASSERT_EQ(attempts2.load(), int(AddressPool::kMaxAttempts));
+    LOGOS_ASSERT_EQ(pool.stats().abandoned, uint64_t(2));
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(3));
+}
+
+LOGOS_TEST(addressPool_leaves_paths_taken_directly_to_the_caller) {
+    std::atomic<bool> release(false);
+    std::atomic<int> derivations(0);
+    AddressPool pool(
+        [&](const std::string& path, std::string&) {
+            ++derivations;
+            while (path == "m/0/0" && !release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return fakeAddress(path);
+        },
+        "m/0", 0, 1, 1);
+    LOGOS_ASSERT(eventually([&] { return derivations.load() == 1; }));
+
+    // A path in flight is waited for and handed out from the pool...
+    std::string address;
+    std::thread taker([&] { pool.takePath("m/0/0", address); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+    taker.join();
+    LOGOS_ASSERT_EQ(address, std::string("0x0"));
+
+    // ...one not derived yet is left to the caller and skipped by the pool.
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 1; }));
+    LOGOS_ASSERT_FALSE(pool.takePath("m/0/2", address));
+    AddressPool::Entry entry;
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(1));
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 1; }));
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(3));
+}
+
+LOGOS_TEST(addressPool_journal_survives_a_restart) {
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    const std::string journal = dir.path() + "/.address-pool";
+    std::atomic<int> derivations(0);
+    auto derive = [&](const std::string& path, std::string&) {
+        ++derivations;
+        return fakeAddress(path);
+    };
+    {
+        AddressPool pool(derive, "m/0", 0, 3, 3, journal);
+        LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+        AddressPool::Entry entry;
+        LOGOS_ASSERT(pool.take(entry));
+        LOGOS_ASSERT_EQ(entry.index, uint64_t(0));
+        std::string address;
+        LOGOS_ASSERT_FALSE(pool.takePath("m/0/5", address));
+        LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+    }
+    // Indices 1..3 were derived and not handed out; 5 was left to the caller.
+    const int before = derivations.load();
+    AddressPool pool(derive, "m/0", 0, 3, 1, journal);
+    AddressPool::Entry entry;
+    for (uint64_t index : {1, 2, 3}) {
+        LOGOS_ASSERT(pool.take(entry));
+        LOGOS_ASSERT_EQ(entry.index, index);
+        LOGOS_ASSERT_EQ(entry.address, fakeAddress(entry.path));
+    }
+    LOGOS_ASSERT(eventually([&] { return pool.stats().ready == 3; }));
+    pool.stop();
+    LOGOS_ASSERT_EQ(pool.stats().nextIndex, uint64_t(4));
+    // Nothing was derived twice, and the refill went on past 5.
+    LOGOS_ASSERT_EQ(derivations.load(), before + 3);
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(4));
+    LOGOS_ASSERT(pool.take(entry));
+    LOGOS_ASSERT_EQ(entry.index, uint64_t(6));
+}
+
+LOGOS_TEST(extKeystoreAddressPool_serves_next_address_and_derive) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_Derive").returns("0xDERIVED");
+
+    AccountsModuleImpl impl;
+    impl.initExtKeystore("/tmp/ext-ks", 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.extKeystoreStartAddressPool("0xABC", "m/44'/60'/0'/0", 0, 3, 1, 1));
+    LOGOS_ASSERT(eventually([&] {
+        auto status = impl.extKeystoreAddressPoolStatus("0xabc");
+        return !status.empty() && nlohmann::json::parse(status)["ready"].get<int>() == 3;
+    }));
+    const int derivedCalls = t.cFunctionCallCount("GoWSK_accounts_extkeystore_Derive");
+
+    auto next = nlohmann::json::parse(impl.extKeystoreNextAddress("0xABC"));
+    LOGOS_ASSERT_EQ(next["address"].get<std::string>(), std::string("0xDERIVED"));
+    LOGOS_ASSERT_EQ(next["path"].get<std::string>(), std::string("m/44'/60'/0'/0/0"));
+    LOGOS_ASSERT_EQ(impl.extKeystoreDerive("0xABC", "m/44'/60'/0'/0/1", 1), std::string("0xDERIVED"));
+    // Both answers came from the pool, not the SDK.
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_Derive"), derivedCalls);
+
+    auto status = nlohmann::json::parse(impl.extKeystoreAddressPoolStatus("0xABC"));
+    LOGOS_ASSERT_EQ(status["hits"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["nextIndex"].get<int>(), 2);
+    LOGOS_ASSERT_TRUE(impl.extKeystoreStopAddressPool("0xABC"));
+    LOGOS_ASSERT(impl.extKeystoreNextAddress("0xABC").empty());
+}
+
+LOGOS_TEST(extKeystoreAddressPool_requires_keystore_and_valid_arguments) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_FALSE(impl.extKeystoreStartAddressPool("0xABC", "m/0", 0, 3, 1, 0));
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(1);
+    impl.initExtKeystore("/tmp/ext-ks", 4096, 6);
+    LOGOS_ASSERT_FALSE(impl.extKeystoreStartAddressPool("0xABC", "m/0/", 0, 3, 1, 0));
+    LOGOS_ASSERT_FALSE(impl.extKeystoreStartAddressPool("0xABC", "m/0", 0, 0, 1, 0));
+    LOGOS_ASSERT_FALSE(impl.extKeystoreStopAddressPool("0xABC"));
+}
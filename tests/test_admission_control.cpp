@@ -0,0 +1,184 @@
+// Unit tests for the admission gate in front of keystore calls. Tickets are
+// held by the test to saturate a lane; waiting callers run on threads and are
+// observed through the queue statistics.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "admission_control.h"
+#include "memory_dir.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+using Lane = AdmissionControl::Lane;
+
+template <typename Cond>
+bool eventually(Cond cond)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+AdmissionControl::LaneStats laneStats(const AdmissionControl& control, Lane lane)
+{
+    return control.stats().lanes[static_cast<size_t>(lane)];
+}
+
+AdmissionControl::LaneConfig laneConfig(size_t maxConcurrent, size_t maxQueued, int priority)
+{
+    AdmissionControl::LaneConfig config;
+    config.maxConcurrent = maxConcurrent;
+    config.maxQueued = maxQueued;
+    config.priority = priority;
+    return config;
+}
+
+} // namespace
+
+LOGOS_TEST(admissionControl_bounds_scrypt_lane_without_blocking_cheap_lane) {
+    AdmissionControl control;
+    LOGOS_ASSERT_FALSE(control.configureLane(Lane::Scrypt, laneConfig(0, 1, 0)));
+    LOGOS_ASSERT(control.configureLane(Lane::Scrypt, laneConfig(1, 1, 0)));
+
+    AdmissionControl::Ticket held = control.enter(Lane::Scrypt);
+    LOGOS_ASSERT(held);
+    std::atomic<bool> admitted(false);
+    std::thread waiter([&] {
+        AdmissionControl::Ticket ticket = control.enter(Lane::Scrypt);
+        admitted = static_cast<bool>(ticket);
+    });
+    LOGOS_ASSERT(eventually([&] { return laneStats(control, Lane::Scrypt).queued == 1; }));
+
+    // The queue is full: a third scrypt call is turned away, cheap calls are not held up.
+    LOGOS_ASSERT_FALSE(control.enter(Lane::Scrypt));
+    LOGOS_ASSERT(control.enter(Lane::Cheap));
+    LOGOS_ASSERT_FALSE(admitted.load());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    held = AdmissionControl::Ticket();
+    waiter.join();
+    LOGOS_ASSERT(admitted.load());
+
+    AdmissionControl::LaneStats scrypt = laneStats(control, Lane::Scrypt);
+    LOGOS_ASSERT_EQ(scrypt.admitted, uint64_t(2));
+    LOGOS_ASSERT_EQ(scrypt.rejected, uint64_t(1));
+    LOGOS_ASSERT_EQ(scrypt.peakQueued, size_t(1));
+    LOGOS_ASSERT_EQ(scrypt.running, size_t(0));
+    LOGOS_ASSERT(scrypt.maxWaitMicros >= 5000);
+    LOGOS_ASSERT_EQ(laneStats(control, Lane::Cheap).maxWaitMicros, uint64_t(0));
+}
+
+LOGOS_TEST(admissionControl_gives_free_slots_to_higher_priority_lane) {
+    AdmissionControl control;
+    control.setMaxTotal(1);
+    AdmissionControl::Ticket held = control.enter(Lane::Scrypt);
+    LOGOS_ASSERT(held);
+
+    std::atomic<int> order(0);
+    std::atomic<int> scryptOrder(0);
+    std::atomic<int> cheapOrder(0);
+    std::thread scrypt([&] {
+        AdmissionControl::Ticket ticket = control.enter(Lane::Scrypt);
+        scryptOrder = ++order;
+    });
+    LOGOS_ASSERT(eventually([&] { return laneStats(control, Lane::Scrypt).queued == 1; }));
+    std::thread cheap([&] {
+        AdmissionControl::Ticket ticket = control.enter(Lane::Cheap);
+        cheapOrder = ++order;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+    LOGOS_ASSERT(eventually([&] { return laneStats(control, Lane::Cheap).queued == 1; }));
+
+    // The scrypt call queued first, but the cheap lane has the higher priority.
+    held = AdmissionControl::Ticket();
+    cheap.join();
+    scrypt.join();
+    LOGOS_ASSERT_EQ(cheapOrder.load(), 1);
+    LOGOS_ASSERT_EQ(scryptOrder.load(), 2);
+    LOGOS_ASSERT_EQ(control.stats().running, size_t(0));
+}
+
+LOGOS_TEST(admissionControl_background_calls_wait_behind_queued_calls) {
+    AdmissionControl control;
+    LOGOS_ASSERT(control.configureLane(Lane::Scrypt, laneConfig(1, 1, 0)));
+    AdmissionControl::Ticket held = control.enter(Lane::Scrypt);
+    LOGOS_ASSERT(held);
+
+    std::atomic<int> order(0);
+    std::atomic<int> backgroundOrder(0);
+    std::atomic<int> foregroundOrder(0);
+    std::thread background([&] {
+        AdmissionControl::Ticket ticket = control.enterBackground(Lane::Scrypt);
+        backgroundOrder = ++order;
+    });
+    LOGOS_ASSERT(eventually([&] { return laneStats(control, Lane::Scrypt).background == 1; }));
+    std::thread foreground([&] {
+        AdmissionControl::Ticket ticket = control.enter(Lane::Scrypt);
+        foregroundOrder = ++order;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+    LOGOS_ASSERT(eventually([&] { return laneStats(control, Lane::Scrypt).queued == 1; }));
+    // Background callers do not take queue places, and are not turned away.
+    LOGOS_ASSERT_FALSE(control.enter(Lane::Scrypt));
+
+    // The background call arrived first, but the queued call goes first.
+    held = AdmissionControl::Ticket();
+    foreground.join();
+    background.join();
+    LOGOS_ASSERT_EQ(foregroundOrder.load(), 1);
+    LOGOS_ASSERT_EQ(backgroundOrder.load(), 2);
+    AdmissionControl::LaneStats scrypt = laneStats(control, Lane::Scrypt);
+    LOGOS_ASSERT_EQ(scrypt.background, size_t(0));
+    LOGOS_ASSERT_EQ(scrypt.admitted, uint64_t(3));
+    LOGOS_ASSERT_EQ(scrypt.running, size_t(0));
+}
+
+LOGOS_TEST(keystore_calls_are_admitted_by_lane) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_FALSE(impl.configureAdmissionLane("bulk", 1, 1, 0));
+    LOGOS_ASSERT_FALSE(impl.configureAdmissionLane("scrypt", 0, 1, 0));
+    LOGOS_ASSERT_FALSE(impl.configureAdmissionTotal(-1));
+    LOGOS_ASSERT(impl.configureAdmissionLane("scrypt", 2, 8, 0));
+
+    impl.keystoreUnlock("0xABC", "pw");
+    impl.keystoreUpdate("0xABC", "pw", "new");
+    impl.keystoreSignHash("0xDEF", "0x01");
+    impl.keystoreHasAddress("0xABC");
+
+    auto status = nlohmann::json::parse(impl.admissionStatus());
+    LOGOS_ASSERT_EQ(status["scrypt"]["admitted"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["scrypt"]["maxConcurrent"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["cheap"]["admitted"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["running"].get<int>(), 0);
+
+    // Bulk work takes a background scrypt slot per SDK call.
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0xIMPORTED");
+    MemoryDir src;
+    LOGOS_ASSERT(src.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    for (const char* name : {"/a.json", "/b.json"}) {
+        FILE* f = std::fopen((src.path() + name).c_str(), "w");
+        std::fputs("{}", f);
+        std::fclose(f);
+    }
+    LOGOS_ASSERT(!impl.keystoreImportDirectory(src.path(), "pw", "pw").empty());
+    status = nlohmann::json::parse(impl.admissionStatus());
+    LOGOS_ASSERT_EQ(status["scrypt"]["admitted"].get<int>(), 4);
+    LOGOS_ASSERT_EQ(status["scrypt"]["background"].get<int>(), 0);
+    impl.closeKeystore("");
+}
@@ -0,0 +1,307 @@
+// Unit tests for bulk keystore operations (directory import, ...).
+// Source files live in a real temporary directory; SDK calls are mocked and the
+// bulk pipeline is pinned to one thread so mock bookkeeping stays sequential.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "bulk_io.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+std::string makeTempDir()
+{
+    char tmpl[] = "/tmp/logos-accounts-bulk-XXXXXX";
+    const char* dir = mkdtemp(tmpl);
+    return dir ? std::string(dir) : std::string();
+}
+
+void writeFile(const std::string& path, const std::string& contents)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+}
+
+const char* kKeyFile =
+    "{\"address\":\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\",\"crypto\":{\"kdf\":\"scrypt\","
+    "\"kdfparams\":{\"n\":4096,\"r\":8,\"p\":1,\"dklen\":32}},\"version\":3}";
+
+} // namespace
+
+LOGOS_TEST(keystoreImportDirectory_imports_every_key_file) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0x1111");
+    const std::string src = makeTempDir();
+    writeFile(src + "/key-a", kKeyFile);
+    writeFile(src + "/key-b", kKeyFile);
+    writeFile(src + "/.ignored", kKeyFile);
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    auto report = nlohmann::json::parse(impl.keystoreImportDirectory(src, "old", "new"));
+    LOGOS_ASSERT_EQ(report["imported"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(report["failed"].get<int>(), 0);
+    LOGOS_ASSERT_EQ(report["results"][0]["file"].get<std::string>(), std::string("key-a"));
+    LOGOS_ASSERT_EQ(report["results"][1]["address"].get<std::string>(), std::string("0x1111"));
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keystore_Import"));
+    std::filesystem::remove_all(src);
+}
+
+LOGOS_TEST(keystoreImportDirectory_reads_passphrase_from_env) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0x1111");
+    const std::string src = makeTempDir();
+    writeFile(src + "/key-a", kKeyFile);
+    setenv("LOGOS_ACCOUNTS_TEST_PASS", "secret", 1);
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    LOGOS_ASSERT_FALSE(impl.keystoreImportDirectory(src, "env:LOGOS_ACCOUNTS_TEST_PASS", "new").empty());
+    LOGOS_ASSERT_TRUE(impl.keystoreImportDirectory(src, "env:LOGOS_ACCOUNTS_TEST_UNSET", "new").empty());
+    unsetenv("LOGOS_ACCOUNTS_TEST_PASS");
+    std::filesystem::remove_all(src);
+}
+
+LOGOS_TEST(resolvePassphraseSource_needs_literal_prefix_for_prefixed_passphrases) {
+    std::string passphrase;
+    setenv("LOGOS_ACCOUNTS_TEST_PASS", "secret", 1);
+    LOGOS_ASSERT_TRUE(resolvePassphraseSource("env:LOGOS_ACCOUNTS_TEST_PASS", passphrase));
+    LOGOS_ASSERT_EQ(passphrase, std::string("secret"));
+    LOGOS_ASSERT_TRUE(resolvePassphraseSource("literal:env:LOGOS_ACCOUNTS_TEST_PASS", passphrase));
+    LOGOS_ASSERT_EQ(passphrase, std::string("env:LOGOS_ACCOUNTS_TEST_PASS"));
+    LOGOS_ASSERT_TRUE(resolvePassphraseSource("literal:file:/etc/hostname", passphrase));
+    LOGOS_ASSERT_EQ(passphrase, std::string("file:/etc/hostname"));
+    LOGOS_ASSERT_TRUE(resolvePassphraseSource("literal:literal:x", passphrase));
+    LOGOS_ASSERT_EQ(passphrase, std::string("literal:x"));
+    LOGOS_ASSERT_TRUE(resolvePassphraseSource("plain pass", passphrase));
+    LOGOS_ASSERT_EQ(passphrase, std::string("plain pass"));
+    unsetenv("LOGOS_ACCOUNTS_TEST_PASS");
+}
+
+LOGOS_TEST(fileBuffer_reads_whole_files_and_refuses_oversized_ones) {
+    const std::string dir = makeTempDir();
+    writeFile(dir + "/small", kKeyFile);
+    FileBuffer small(dir + "/small");
+    LOGOS_ASSERT_TRUE(small.valid());
+    LOGOS_ASSERT_EQ(std::string(small.c_str()), std::string(kKeyFile));
+
+    writeFile(dir + "/large", std::string(FileBuffer::kMaxSize + 1, 'x'));
+    FileBuffer large(dir + "/large");
+    LOGOS_ASSERT_FALSE(large.valid());
+    LOGOS_ASSERT_EQ(large.size(), size_t(0));
+
+    LOGOS_ASSERT_FALSE(FileBuffer(dir + "/missing").valid());
+    LOGOS_ASSERT_FALSE(FileBuffer(dir).valid());
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreImportDirectory_fails_for_missing_dir_or_without_init) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.keystoreImportDirectory("/tmp", "pass", "new").empty());
+
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.keystoreImportDirectory("/nonexistent/logos-accounts", "pass", "new").empty());
+}
+
+// ── Bulk re-key ─────────────────────────────────────────────────────────────
+
+namespace {
+
+const char* kTwoAccounts =
+    "[{\"address\":\"0xaaa\",\"url\":\"keystore:///nonexistent/key-a\"},"
+    "{\"address\":\"0xbbb\",\"url\":\"keystore:///nonexistent/key-b\"}]";
+
+} // namespace
+
+LOGOS_TEST(scryptMemoryCost_saturates_on_hostile_parameters) {
+    LOGOS_ASSERT_EQ(scryptMemoryCost(4096, 8), uint64_t(4) << 20);
+    LOGOS_ASSERT_EQ(scryptMemoryCost(uint64_t(1) << 60, 8), UINT64_MAX);
+    LOGOS_ASSERT_EQ(scryptMemoryCost(uint64_t(1) << 32, uint64_t(1) << 32), UINT64_MAX);
+    const std::string hostile = "{\"crypto\":{\"kdf\":\"scrypt\",\"kdfparams\":"
+                                "{\"n\":18446744073709551615,\"r\":3,\"p\":1,\"dklen\":32}},\"version\":3}";
+    LOGOS_ASSERT_EQ(keyFileScryptCost(hostile.data(), hostile.size()), UINT64_MAX);
+
+    // Alone, an oversized cost is still admitted instead of waiting forever.
+    MemoryBudget budget(uint64_t(64) << 20);
+    budget.acquire(UINT64_MAX);
+    budget.release(UINT64_MAX);
+    budget.acquire(uint64_t(32) << 20);
+    budget.release(uint64_t(32) << 20);
+}
+
+LOGOS_TEST(bulkPipes_survive_closed_readers_and_bound_lines) {
+    // A write to a pipe nobody reads any more fails instead of raising SIGPIPE.
+    int fds[2];
+    LOGOS_ASSERT(pipe(fds) == 0);
+    close(fds[0]);
+    LOGOS_ASSERT_FALSE(writeAll(fds[1], "record\n", 7));
+    close(fds[1]);
+
+    LOGOS_ASSERT(pipe(fds) == 0);
+    const std::string input = "short\n" + std::string(100, 'x') + "\nnever read\n";
+    LOGOS_ASSERT(writeAll(fds[1], input.data(), input.size()));
+    close(fds[1]);
+    LineReader reader(fds[0], 64);
+    std::string line;
+    LOGOS_ASSERT(reader.next(line));
+    LOGOS_ASSERT_EQ(line, std::string("short"));
+    LOGOS_ASSERT_FALSE(reader.next(line));
+    LOGOS_ASSERT(reader.failed());
+    close(fds[0]);
+}
+
+LOGOS_TEST(keystoreBulkUpdate_updates_every_account) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns(kTwoAccounts);
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    auto report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 0, 0, ""));
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(report["failed"].get<int>(), 0);
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keystore_Update"));
+
+    auto progress = nlohmann::json::parse(impl.bulkUpdateProgress());
+    LOGOS_ASSERT_FALSE(progress["running"].get<bool>());
+    LOGOS_ASSERT_EQ(progress["updated"].get<int>(), 2);
+}
+
+LOGOS_TEST(keystoreBulkUpdate_honours_address_filter) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns(kTwoAccounts);
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    auto report = nlohmann::json::parse(impl.keystoreBulkUpdate("[\"0xBBB\"]", "old", "new", 8192, 1, ""));
+    LOGOS_ASSERT_EQ(report["total"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 1);
+    LOGOS_ASSERT_TRUE(impl.keystoreBulkUpdate("not json", "old", "new", 0, 0, "").empty());
+}
+
+LOGOS_TEST(keystoreBulkUpdate_resumes_from_journal) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns(kTwoAccounts);
+    const std::string dir = makeTempDir();
+    const std::string journal = dir + "/rekey.journal";
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    auto report = nlohmann::json::parse(impl.keystoreBulkUpdate("[\"0xAAA\"]", "old", "new", 0, 0, journal));
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 1);
+    report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 0, 0, journal));
+    LOGOS_ASSERT_EQ(report["skipped"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 1);
+
+    // The job is done: running it again from the same journal would skip
+    // every account, so it is refused (the same parameters spelled out count
+    // as the same job).
+    LOGOS_ASSERT_TRUE(impl.keystoreBulkUpdate("", "old", "new", 0, 0, journal).empty());
+    LOGOS_ASSERT_TRUE(impl.keystoreBulkUpdate("", "old", "new", 4096, 6, journal).empty());
+
+    // Entries only count for the job that wrote them: other scrypt parameters,
+    // another directory.
+    report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 8192, 1, journal));
+    LOGOS_ASSERT_EQ(report["skipped"].get<int>(), 0);
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 2);
+    impl.closeKeystore("");
+    impl.initKeystore("/tmp/ks-other", 4096, 6);
+    report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 0, 0, journal));
+    LOGOS_ASSERT_EQ(report["skipped"].get<int>(), 0);
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 2);
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreBulkUpdate_migration_reopens_the_keystore) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns(kTwoAccounts);
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+    auto report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 8192, 1, ""));
+    LOGOS_ASSERT_EQ(report["updated"].get<int>(), 2);
+    // Init, the migration handle, then the primary handle reopened with the
+    // new parameters; the migration handle and the old primary are closed.
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewKeyStore"), 3);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_CloseKeyStore"), 2);
+
+    // The parameters now in force are not a migration.
+    report = nlohmann::json::parse(impl.keystoreBulkUpdate("", "old", "new", 8192, 1, ""));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewKeyStore"), 3);
+}
+
+// ── Backup / restore ────────────────────────────────────────────────────────
+
+LOGOS_TEST(keystoreBackup_round_trips_through_restore) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns(kTwoAccounts);
+    t.mockCFunction("GoWSK_accounts_keystore_Export").returns("{\"address\":\"aaa\",\"crypto\":{}}");
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0xaaa");
+    const std::string dir = makeTempDir();
+    const std::string archive = dir + "/backup.jsonl";
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+
+    FILE* f = fopen(archive.c_str(), "w+");
+    auto backup = nlohmann::json::parse(impl.keystoreBackup(fileno(f), "pass", "backup-pass"));
+    LOGOS_ASSERT_EQ(backup["exported"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(backup["failed"].get<int>(), 0);
+
+    fseek(f, 0, SEEK_SET);
+    auto restore = nlohmann::json::parse(impl.keystoreRestore(fileno(f), "backup-pass", "new-pass"));
+    fclose(f);
+    LOGOS_ASSERT_EQ(restore["restored"].get<int>(), 2);
+    LOGOS_ASSERT_TRUE(restore["complete"].get<bool>());
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keystore_Import"));
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreRestore_flags_truncated_archive) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0xaaa");
+    const std::string dir = makeTempDir();
+    writeFile(dir + "/truncated.jsonl",
+              "{\"format\":\"logos-keystore-backup\",\"version\":1}\n{\"address\":\"aaa\",\"crypto\":{}}\n");
+    writeFile(dir + "/garbage.jsonl", "not an archive\n");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    impl.configureBulkOperations(1, 0);
+
+    FILE* f = fopen((dir + "/truncated.jsonl").c_str(), "r");
+    auto restore = nlohmann::json::parse(impl.keystoreRestore(fileno(f), "backup-pass", "new-pass"));
+    fclose(f);
+    LOGOS_ASSERT_EQ(restore["restored"].get<int>(), 1);
+    LOGOS_ASSERT_FALSE(restore["complete"].get<bool>());
+
+    f = fopen((dir + "/garbage.jsonl").c_str(), "r");
+    LOGOS_ASSERT_TRUE(impl.keystoreRestore(fileno(f), "backup-pass", "new-pass").empty());
+    fclose(f);
+    std::filesystem::remove_all(dir);
+}
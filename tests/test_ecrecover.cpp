@@ -0,0 +1,128 @@
+// Tests for native signature recovery: EIP-55 checksums against the vectors of
+// the EIP, recovery of published and natively made signatures in all the
+// forms Ethereum writes them, and the batch recover and verify calls, which
+// make no SDK call.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "ecrecover.h"
+
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+int hexValue(char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+void fromHex(const std::string& hex, uint8_t* out)
+{
+    for (size_t i = 0; i < hex.size() / 2; ++i) {
+        out[i] = static_cast<uint8_t>(hexValue(hex[2 * i]) << 4 | hexValue(hex[2 * i + 1]));
+    }
+}
+
+std::string checksumHex(const std::string& lowerHex)
+{
+    uint8_t address[kAddressSize];
+    fromHex(lowerHex, address);
+    return addressChecksumHex(address);
+}
+
+// Key 1 and SHA-256("Satoshi Nakamoto"), the RFC 6979 vector, signed as in test_native_signer.cpp.
+const char* kOneAddress = "0x7E5F4552091A69125d5DfCb7b8C2659029395Bdf";
+const char* kOneHash = "0xa0dc65ffca799873cbea0ac274015b9526505daaaed385155425f7337704883e";
+const char* kOneSignature = "0x934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+                            "2442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e501";
+// The same signature with v = 27 + id, and with s replaced by n - s (which flips the id).
+const char* kOneSignature28 = "0x934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+                              "2442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e51c";
+const char* kOneSignatureHighS = "0x934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+                                 "dbbd3162d46e9f9bef7feb87c16dc13b4f6568a87f4e83f728e2443ba586675c00";
+// The Web3 Secret Storage test key, as in test_native_signer.cpp.
+const char* kSpecAddress = "0x008AeEda4D805471dF9b2A5B0f38A0C3bCBA786b";
+const char* kSpecHash = "0xc5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470";
+const char* kSpecSignature = "0xba27af25810139fa7590c7eb492dd6ebbb5df0a64859d709451d5f7121911426"
+                             "2f20708e9ae00496b2bdfbbf8824258695659aa71a94e21a3480e9eebd89915e00";
+
+} // namespace
+
+LOGOS_TEST(addressChecksumHex_matches_eip55_vectors) {
+    LOGOS_ASSERT_EQ(checksumHex("5aaeb6053f3e94c9b9a09f33669435e7ef1beaed"),
+                    std::string("0x5aAeb6053F3E94C9b9A09f33669435E7Ef1BeAed"));
+    LOGOS_ASSERT_EQ(checksumHex("fb6916095ca1df60bb79ce92ce3ea74c37c5d359"),
+                    std::string("0xfB6916095ca1df60bB79Ce92cE3Ea74c37c5d359"));
+    LOGOS_ASSERT_EQ(checksumHex("dbf03b407c01e7cd3cbea99509d93f8dddc8c6fb"),
+                    std::string("0xdbF03B407c01E7cD3CBea99509d93f8DDDC8C6FB"));
+    LOGOS_ASSERT_EQ(checksumHex("d1220a0cf47c7b9be7a2e6ba89f429762e7b9adb"),
+                    std::string("0xD1220A0cf47c7B9Be7A2E6BA89F429762e7b9aDb"));
+    // All digits: no letter to case.
+    LOGOS_ASSERT_EQ(checksumHex("52908400098527886e0f7030069857d2e4169ee7").substr(0, 4), std::string("0x52"));
+}
+
+LOGOS_TEST(recoverAddress_accepts_every_form_of_a_signature) {
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_EQ(impl.recoverAddress(kOneHash, kOneSignature), std::string(kOneAddress));
+    LOGOS_ASSERT_EQ(impl.recoverAddress(kOneHash, kOneSignature28), std::string(kOneAddress));
+    LOGOS_ASSERT_EQ(impl.recoverAddress(kOneHash, kOneSignatureHighS), std::string(kOneAddress));
+    LOGOS_ASSERT_EQ(impl.recoverAddress(kSpecHash, kSpecSignature), std::string(kSpecAddress));
+    // Without 0x and in upper case.
+    LOGOS_ASSERT_EQ(impl.recoverAddress(std::string(kSpecHash).substr(2), "0X" + std::string(kSpecSignature).substr(2)),
+                    std::string(kSpecAddress));
+
+    // Another hash or recovery id recovers some other key.
+    std::string otherId = kSpecSignature;
+    otherId.back() = '1';
+    LOGOS_ASSERT(!impl.recoverAddress(kSpecHash, otherId).empty());
+    LOGOS_ASSERT(impl.recoverAddress(kSpecHash, otherId) != kSpecAddress);
+    LOGOS_ASSERT(impl.recoverAddress(kOneHash, kSpecSignature) != kSpecAddress);
+
+    // v outside 0..3 / 27..30, r = 0, s = n, short input and non-hex fail.
+    std::string badV = kSpecSignature;
+    badV.replace(badV.size() - 2, 2, "1f");
+    LOGOS_ASSERT(impl.recoverAddress(kSpecHash, badV).empty());
+    std::string zeroR = kSpecSignature;
+    zeroR.replace(2, 64, std::string(64, '0'));
+    LOGOS_ASSERT(impl.recoverAddress(kSpecHash, zeroR).empty());
+    std::string orderS = kSpecSignature;
+    orderS.replace(66, 64, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141");
+    LOGOS_ASSERT(impl.recoverAddress(kSpecHash, orderS).empty());
+    LOGOS_ASSERT(impl.recoverAddress(kSpecHash, std::string(kSpecSignature).substr(0, 130)).empty());
+    LOGOS_ASSERT(impl.recoverAddress("0xzz" + std::string(kSpecHash).substr(4), kSpecSignature).empty());
+}
+
+LOGOS_TEST(batch_recovery_and_verification_are_index_aligned) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.configureBulkOperations(4, 0));
+
+    nlohmann::json items = nlohmann::json::array();
+    for (int i = 0; i < 40; ++i) {
+        items.push_back({{"hash", i % 2 ? kOneHash : kSpecHash}, {"signature", i % 2 ? kOneSignature : kSpecSignature}});
+    }
+    items[7]["signature"] = "0x1234";
+    const std::vector<std::string> recovered = impl.recoverAddressBatch(items.dump());
+    LOGOS_ASSERT_EQ(recovered.size(), size_t(40));
+    LOGOS_ASSERT_EQ(recovered[0], std::string(kSpecAddress));
+    LOGOS_ASSERT_EQ(recovered[1], std::string(kOneAddress));
+    LOGOS_ASSERT_EQ(recovered[7], std::string());
+    LOGOS_ASSERT_EQ(recovered[39], std::string(kOneAddress));
+
+    nlohmann::json checks = nlohmann::json::array({
+        {{"hash", kSpecHash}, {"signature", kSpecSignature}, {"address", "0x008aeeda4d805471df9b2a5b0f38a0c3bcba786b"}},
+        {{"hash", kOneHash}, {"signature", kOneSignature}, {"address", kSpecAddress}},
+        {{"hash", kOneHash}, {"signature", kOneSignatureHighS}, {"address", "7E5F4552091A69125D5DFCB7B8C2659029395BDF"}},
+        {{"hash", kOneHash}, {"signature", "0x"}, {"address", kOneAddress}},
+        {{"hash", kOneHash}, {"signature", kOneSignature}, {"address", "0x7e5f"}},
+    });
+    LOGOS_ASSERT_EQ(impl.verifyBatch(checks.dump()), std::string("[true,false,true,false,false]"));
+    LOGOS_ASSERT_EQ(impl.verifyBatch("[]"), std::string("[]"));
+
+    // Malformed input fails as a whole; nothing goes to the SDK.
+    LOGOS_ASSERT(impl.recoverAddressBatch("not json").empty());
+    LOGOS_ASSERT(impl.recoverAddressBatch(R"([{"hash":"0x00"}])").empty());
+    LOGOS_ASSERT(impl.verifyBatch(R"({"hash":"0x00"})").empty());
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keys_PublicKeyToAddress"), 0);
+}
@@ -0,0 +1,262 @@
+// Tests for native EIP-712 hashing: the example of the EIP (digest and
+// signature), encodings of arrays, integers and bytes against hand-built
+// preimages, malformed documents, the schema cache, and typed data signed
+// through the keystore's SignHash path.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "eip712.h"
+#include "keccak.h"
+#include "memory_dir.h"
+#include "secp256k1_curve.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+int hexValue(char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+void fromHex(const std::string& hex, uint8_t* out)
+{
+    for (size_t i = 0; i < hex.size() / 2; ++i) {
+        out[i] = static_cast<uint8_t>(hexValue(hex[2 * i]) << 4 | hexValue(hex[2 * i + 1]));
+    }
+}
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += kHex[data[i] >> 4];
+        hex += kHex[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+std::string keccak(const std::string& data)
+{
+    uint8_t digest[Keccak256::kDigestSize];
+    Keccak256::hash(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+// 32-byte words, written as hex, concatenated as raw bytes.
+std::string words(std::initializer_list<std::string> hexWords)
+{
+    std::string out;
+    for (const std::string& hex : hexWords) {
+        uint8_t word[32];
+        fromHex(hex, word);
+        out.append(reinterpret_cast<const char*>(word), sizeof(word));
+    }
+    return out;
+}
+
+std::string digestHex(const std::string& domainHash, const std::string& messageHash)
+{
+    const std::string digest = keccak("\x19\x01" + domainHash + messageHash);
+    return "0x" + toHex(reinterpret_cast<const uint8_t*>(digest.data()), digest.size());
+}
+
+const std::string kDomainType = R"("EIP712Domain":[{"name":"name","type":"string"},{"name":"version","type":"string"},
+    {"name":"chainId","type":"uint256"},{"name":"verifyingContract","type":"address"}])";
+const std::string kDomain = R"({"name":"Ether Mail","version":"1","chainId":1,
+    "verifyingContract":"0xCcCCccccCCCCcCCCCCCcCcCccCcCCCcCcccccccC"})";
+
+// The example of the EIP, signed with keccak256("cow").
+const std::string kMail = R"({"types":{)" + kDomainType + R"(,
+    "Person":[{"name":"name","type":"string"},{"name":"wallet","type":"address"}],
+    "Mail":[{"name":"from","type":"Person"},{"name":"to","type":"Person"},{"name":"contents","type":"string"}]},
+    "primaryType":"Mail","domain":)" + kDomain + R"(,
+    "message":{"from":{"name":"Cow","wallet":"0xCD2a3d9F938E13CD947Ec05AbC7FE734Df8DD826"},
+               "to":{"name":"Bob","wallet":"0xbBbBBBBbbBBBbbbBbbBbbbbBBbBbbbbBbBbbBBbB"},
+               "contents":"Hello, Bob!"}})";
+const char* kMailDigest = "0xbe609aee343fb3c4b28e1df9e632fca64fcfaede20f02e86244efddf30957bd2";
+const char* kMailDomainSeparator = "f2cee375fa42b42143804025fc449deafd50cc031ca257e0b194a650a912090f";
+const char* kCowKey = "c85ef7d79691fe79573b1a7064c19c1a9819ebdbd1faaab1a8ec92344438aaf4";
+const char* kMailSignature = "4355c47d63924e8a72e509b65029052eb6c299d53a04e167c5775fd466751c9d"
+                             "07299936d304c153f6443dfa05f40ff007d72911b6f72307f996231605b9156201";
+
+// The Web3 Secret Storage test key file (PBKDF2), as in test_native_signer.cpp.
+const char* kSpecKey = "7a28b5ba57c53603b0b07b56bba752f7784bf506fa95edc395f5cf6c7514fe9d";
+const char* kSpecAddress = "0x008aeeda4d805471df9b2a5b0f38a0c3bcba786b";
+const char* kKeyFile = R"({"crypto":{"cipher":"aes-128-ctr","cipherparams":{"iv":"6087dab2f9fdbbfaddc31a909735c1e6"},
+    "ciphertext":"5318b4d5bcd28de64ee5559e671353e16f075ecae9f99c7a79a38af5f869aa46","kdf":"pbkdf2",
+    "kdfparams":{"c":262144,"dklen":32,"prf":"hmac-sha256","salt":"ae3cd4e7013836a3df6bd7241b12db061dbe2c6785853cce422d148a624ce0bd"},
+    "mac":"517ead924a9d0dc3124507e3393d175ce3ff7c1e96529c6c555ce9e51205e9b2"},
+    "id":"3198bc9c-6672-5ab3-d995-4942343ae5b6","version":3})";
+
+std::string hashDocument(Eip712Hasher& hasher, const std::string& json)
+{
+    uint8_t digest[32];
+    std::string error;
+    if (!hasher.hash(json, digest, error)) {
+        return "error: " + error;
+    }
+    return "0x" + toHex(digest, sizeof(digest));
+}
+
+} // namespace
+
+LOGOS_TEST(eip712_matches_the_example_of_the_eip) {
+    Eip712Hasher hasher;
+    LOGOS_ASSERT_EQ(hashDocument(hasher, kMail), std::string(kMailDigest));
+
+    uint8_t key[32], digest[32], sig[64];
+    fromHex(kCowKey, key);
+    fromHex(std::string(kMailDigest).substr(2), digest);
+    int recoveryId = -1;
+    LOGOS_ASSERT(curveSign(key, digest, sig, recoveryId));
+    LOGOS_ASSERT_EQ(toHex(sig, sizeof(sig)) + (recoveryId == 1 ? "01" : "00"), std::string(kMailSignature));
+
+    // A primaryType of EIP712Domain signs the domain alone.
+    uint8_t separator[32];
+    fromHex(kMailDomainSeparator, separator);
+    const std::string domainOnly = R"({"types":{)" + kDomainType + R"(},"primaryType":"EIP712Domain","domain":)" + kDomain + "}";
+    LOGOS_ASSERT_EQ(hashDocument(hasher, domainOnly),
+                    digestHex(std::string(reinterpret_cast<const char*>(separator), 32), ""));
+}
+
+LOGOS_TEST(eip712_encodes_arrays_integers_and_bytes) {
+    Eip712Hasher hasher;
+    const std::string doc = R"({"types":{"EIP712Domain":[{"name":"chainId","type":"uint256"}],
+        "Item":[{"name":"id","type":"uint8"},{"name":"tag","type":"bytes4"}],
+        "Order":[{"name":"items","type":"Item[]"},{"name":"grid","type":"int16[2][]"},{"name":"delta","type":"int256"},
+                 {"name":"data","type":"bytes"},{"name":"ok","type":"bool"}]},
+        "primaryType":"Order","domain":{"chainId":"0x2a"},
+        "message":{"items":[{"id":255,"tag":"0xdeadbeef"},{"id":"7","tag":"0x01000000"}],
+                   "grid":[[1,-1],["-32768","0x7fff"]],"delta":"-2","data":"0x0102","ok":true}})";
+
+    const std::string itemType = keccak("Item(uint8 id,bytes4 tag)");
+    const std::string orderType = keccak("Order(Item[] items,int16[2][] grid,int256 delta,bytes data,bool ok)Item(uint8 id,bytes4 tag)");
+    const std::string ones = std::string(62, 'f');
+    const std::string item0 = keccak(itemType + words({std::string(62, '0') + "ff", "deadbeef" + std::string(56, '0')}));
+    const std::string item1 = keccak(itemType + words({std::string(62, '0') + "07", "01" + std::string(62, '0')}));
+    const std::string row0 = keccak(words({std::string(63, '0') + "1", ones + "ff"}));
+    const std::string row1 = keccak(words({std::string(60, 'f') + "8000", std::string(60, '0') + "7fff"}));
+    const std::string order = keccak(orderType + keccak(item0 + item1) + keccak(row0 + row1) + words({ones + "fe"}) +
+                                     keccak("\x01\x02") + words({std::string(63, '0') + "1"}));
+    const std::string domain = keccak(keccak("EIP712Domain(uint256 chainId)") + words({std::string(62, '0') + "2a"}));
+    LOGOS_ASSERT_EQ(hashDocument(hasher, doc), digestHex(domain, order));
+
+    // Out-of-range and malformed values are rejected with the member named.
+    auto withMessage = [&](const std::string& from, const std::string& to) {
+        std::string changed = doc;
+        changed.replace(changed.find(from), from.size(), to);
+        return hashDocument(hasher, changed);
+    };
+    LOGOS_ASSERT_EQ(withMessage(R"("id":255)", R"("id":256)"), std::string("error: Item.id: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"("id":255)", R"("id":-1)"), std::string("error: Item.id: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"("-32768")", R"("-32769")"), std::string("error: Order.grid: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"([1,-1])", R"([1,-1,0])"), std::string("error: Order.grid: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"("0xdeadbeef")", R"("0xdeadbeef00")"), std::string("error: Item.tag: invalid value"));
+    // As in go-ethereum, a bytesN value shorter than N is not right-padded.
+    LOGOS_ASSERT_EQ(withMessage(R"("0xdeadbeef")", R"("0xdead")"), std::string("error: Item.tag: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"("ok":true)", R"("ok":"true")"), std::string("error: Order.ok: invalid value"));
+    LOGOS_ASSERT_EQ(withMessage(R"(,"ok":true)", ""), std::string("error: Order.ok: missing"));
+    // Keys the type does not declare are rejected, as go-ethereum does, in
+    // nested structs too; the domain keeps its declared fields only.
+    LOGOS_ASSERT_EQ(withMessage(R"("ok":true)", R"("ok":true,"extra":1)"), std::string("error: Order.extra: not declared in the type"));
+    LOGOS_ASSERT_EQ(withMessage(R"("id":255,)", R"("id":255,"x":0,)"), std::string("error: Item.x: not declared in the type"));
+    LOGOS_ASSERT_EQ(withMessage(R"({"chainId":"0x2a"})", R"({"chainId":"0x2a","name":"x"})"), digestHex(domain, order));
+    LOGOS_ASSERT_EQ(withMessage(R"("type":"bytes4")", R"("type":"bytes33")"), std::string("error: unknown type bytes33"));
+    LOGOS_ASSERT_EQ(withMessage(R"("primaryType":"Order")", R"("primaryType":"Nope")"),
+                    std::string("error: unknown primaryType Nope"));
+    LOGOS_ASSERT(hashDocument(hasher, "{").compare(0, 20, "error: invalid JSON:") == 0);
+
+    // uint and int alone are the 256-bit types, named as written in encodeType.
+    std::string aliased = doc;
+    aliased.replace(aliased.find(R"("type":"uint8")"), 14, R"("type":"uint")");
+    aliased.replace(aliased.find(R"("type":"int256")"), 15, R"("type":"int")");
+    const std::string aliasItemType = keccak("Item(uint id,bytes4 tag)");
+    const std::string aliasOrderType = keccak("Order(Item[] items,int16[2][] grid,int delta,bytes data,bool ok)Item(uint id,bytes4 tag)");
+    const std::string aliasItem0 = keccak(aliasItemType + words({std::string(62, '0') + "ff", "deadbeef" + std::string(56, '0')}));
+    const std::string aliasItem1 = keccak(aliasItemType + words({std::string(62, '0') + "07", "01" + std::string(62, '0')}));
+    const std::string aliasOrder = keccak(aliasOrderType + keccak(aliasItem0 + aliasItem1) + keccak(row0 + row1) + words({ones + "fe"}) +
+                                          keccak("\x01\x02") + words({std::string(63, '0') + "1"}));
+    LOGOS_ASSERT_EQ(hashDocument(hasher, aliased), digestHex(domain, aliasOrder));
+    aliased.replace(aliased.find(R"("id":255)"), 8, R"("id":256)");
+    LOGOS_ASSERT(hashDocument(hasher, aliased).compare(0, 6, "error:") != 0);
+}
+
+LOGOS_TEST(eip712_compiles_each_schema_once) {
+    Eip712Hasher hasher(2);
+    LOGOS_ASSERT_EQ(hashDocument(hasher, kMail), std::string(kMailDigest));
+    std::string other = kMail;
+    other.replace(other.find("Hello, Bob!"), 11, "Hello, Cow!");
+    LOGOS_ASSERT(hashDocument(hasher, other) != kMailDigest);
+    Eip712Hasher::Stats stats = hasher.stats();
+    LOGOS_ASSERT_EQ(stats.schemas, size_t(1));
+    LOGOS_ASSERT_EQ(stats.misses, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.hits, uint64_t(1));
+
+    // Beyond capacity the least recently used schema goes.
+    const std::string domainOnly = R"({"types":{)" + kDomainType + R"(},"primaryType":"EIP712Domain","domain":)" + kDomain + "}";
+    const std::string bare = R"({"types":{"EIP712Domain":[]},"primaryType":"EIP712Domain","domain":{}})";
+    LOGOS_ASSERT(hashDocument(hasher, domainOnly).compare(0, 2, "0x") == 0);
+    LOGOS_ASSERT(hashDocument(hasher, bare).compare(0, 2, "0x") == 0);
+    LOGOS_ASSERT_EQ(hasher.stats().schemas, size_t(2));
+    LOGOS_ASSERT_EQ(hashDocument(hasher, kMail), std::string(kMailDigest));
+    stats = hasher.stats();
+    LOGOS_ASSERT_EQ(stats.misses, uint64_t(4));
+    LOGOS_ASSERT_EQ(stats.hits, uint64_t(1));
+
+    // Schemas are keyed on the raw "types" text. Where that is ambiguous (a
+    // key spelled with escapes, "types" twice) the parsed value is used, so
+    // a schema is never cached under another document's types.
+    std::string escaped = kMail;
+    escaped.replace(escaped.find(R"("types")"), 7, R"("typ\u0065s")");
+    LOGOS_ASSERT_EQ(hashDocument(hasher, escaped), std::string(kMailDigest));
+    const std::string twice = R"({"types":{"EIP712Domain":[]},)" + std::string(kMail).substr(1);
+    Eip712Hasher uncached(0);
+    LOGOS_ASSERT_EQ(hashDocument(hasher, twice), hashDocument(uncached, twice));
+    LOGOS_ASSERT_EQ(hashDocument(hasher, bare), hashDocument(uncached, bare));
+}
+
+LOGOS_TEST(keystoreSignTypedData_signs_the_digest) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(2);
+    t.mockCFunction("GoWSK_accounts_extkeystore_SignHash").returns("0xEXTSIG");
+
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    FILE* f = std::fopen((dir.path() + "/UTC--2016-01-01T00-00-00.000000000Z--008aeeda4d805471df9b2a5b0f38a0c3bcba786b").c_str(), "w");
+    std::fputs(kKeyFile, f);
+    std::fclose(f);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.initKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT(impl.configureNativeSigning(true));
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+
+    // Signed natively, so the signature shows which hash was signed.
+    uint8_t key[32], digest[32], sig[64];
+    fromHex(kSpecKey, key);
+    fromHex(std::string(kMailDigest).substr(2), digest);
+    int recoveryId = -1;
+    LOGOS_ASSERT(curveSign(key, digest, sig, recoveryId));
+    LOGOS_ASSERT_EQ(impl.keystoreSignTypedData(kSpecAddress, kMail),
+                    "0x" + toHex(sig, sizeof(sig)) + (recoveryId == 1 ? "01" : "00"));
+    LOGOS_ASSERT_EQ(impl.hashTypedData(kMail), std::string(kMailDigest));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 0);
+
+    LOGOS_ASSERT(impl.initExtKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT_EQ(impl.extKeystoreSignTypedData(kSpecAddress, kMail), std::string("0xEXTSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_SignHash"), 1);
+    // A malformed document never reaches the SDK.
+    LOGOS_ASSERT(impl.extKeystoreSignTypedData(kSpecAddress, R"({"types":{}})").empty());
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_SignHash"), 1);
+
+    auto status = nlohmann::json::parse(impl.typedDataStatus());
+    LOGOS_ASSERT_EQ(status["schemas"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(status["hits"].get<int>(), 2);
+    impl.closeKeystore("");
+}
@@ -0,0 +1,169 @@
+// Unit tests for extended-key handles: native BIP-32 parsing, derivation and
+// serialization against the BIP-32 test vectors, and handle lifetime.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "ext_key.h"
+#include "locked_memory.h"
+#include "ripemd160.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+// BIP-32 test vector 1 (seed 000102030405060708090a0b0c0d0e0f).
+const char kVector1Master[] =
+    "xprv9s21ZrQH143K3QTDL4LXw2F7HEK3wJUD2nW2nRk4stbPy6cq3jPPqjiChkVvvNKmPGJxWUtg6LnF5kejMRNNU3TGtRBeJgk33yuGBxrMPHi";
+const char kVector1Hardened[] =
+    "xprv9uHRZZhk6KAJC1avXpDAp4MDc3sQKNxDiPvvkX8Br5ngLNv1TxvUxt4cV1rGL5hj6KCesnDYUhd7oWgT11eZG7XnxHrnYeSvkzY7d2bhkJ7";
+const char kVector1HardenedPublic[] =
+    "xpub68Gmy5EdvgibQVfPdqkBBCHxA5htiqg55crXYuXoQRKfDBFA1WEjWgP6LHhwBZeNK1VTsfTFUHCdrfp1bgwQ9xv5ski8PX9rL2dZXvgGDnw";
+const char kVector1Child[] =
+    "xprv9wTYmMFdV23N2TdNG573QoEsfRrWKQgWeibmLntzniatZvR9BmLnvSxqu53Kw1UmYPxLgboyZQaXwTCg8MSY3H2EU4pWcQDnRnrVA1xe8fs";
+const char kVector1ChildPublic[] =
+    "xpub6ASuArnXKPbfEwhqN6e3mwBcDTgzisQN1wXN9BJcM47sSikHjJf3UFHKkNAWbWMiGj7Wf5uMash7SyYq527Hqck2AxYysAA7xmALppuCkwQ";
+const char kVector1Deep[] =
+    "xprvA41z7zogVVwxVSgdKUHDy1SKmdb533PjDz7J6N6mV6uS3ze1ai8FHa8kmHScGpWmj4WggLyQjgPie1rFSruoUihUZREPSL39UNdE3BBDu76";
+
+std::string hex(const uint8_t* data, size_t size)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < size; ++i) {
+        out += kHex[data[i] >> 4];
+        out += kHex[data[i] & 0x0f];
+    }
+    return out;
+}
+
+} // namespace
+
+LOGOS_TEST(ripemd160_matches_reference_vectors) {
+    uint8_t out[20];
+    ripemd160(reinterpret_cast<const uint8_t*>(""), 0, out);
+    LOGOS_ASSERT_EQ(hex(out, 20), std::string("9c1185a5c5e9fc54612808977ee8f548b2258d31"));
+    const std::string digits =
+        "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+    ripemd160(reinterpret_cast<const uint8_t*>(digits.data()), digits.size(), out);
+    LOGOS_ASSERT_EQ(hex(out, 20), std::string("9b752e45573d4b39f4dbd3323cab82bf63326bfb"));
+}
+
+LOGOS_TEST(extKey_derivation_matches_bip32_vectors) {
+    ExtKey master;
+    LOGOS_ASSERT(extKeyParse(kVector1Master, master));
+    LOGOS_ASSERT(master.isPrivate());
+    LOGOS_ASSERT_EQ(extKeySerialize(master), std::string(kVector1Master));
+
+    std::vector<uint32_t> path;
+    LOGOS_ASSERT(extKeyParsePath("m/0'/1/2'/2/1000000000", path));
+    ExtKey deep;
+    LOGOS_ASSERT(extKeyDerive(master, path, deep));
+    LOGOS_ASSERT_EQ(extKeySerialize(deep), std::string(kVector1Deep));
+
+    // CKDpub from the public parent gives the public half of CKDpriv.
+    ExtKey parentPublic;
+    LOGOS_ASSERT(extKeyParse(kVector1HardenedPublic, parentPublic));
+    LOGOS_ASSERT_FALSE(parentPublic.isPrivate());
+    ExtKey childPublic;
+    LOGOS_ASSERT(extKeyDerive(parentPublic, {1}, childPublic));
+    LOGOS_ASSERT_EQ(extKeySerialize(childPublic), std::string(kVector1ChildPublic));
+    LOGOS_ASSERT_FALSE(extKeyDerive(parentPublic, {kExtKeyHardened}, childPublic));
+}
+
+LOGOS_TEST(extKey_parse_rejects_malformed_input) {
+    ExtKey key;
+    std::string corrupted = kVector1Master;
+    corrupted[20] = corrupted[20] == 'a' ? 'b' : 'a';
+    LOGOS_ASSERT_FALSE(extKeyParse(corrupted, key));
+    LOGOS_ASSERT_FALSE(extKeyParse("xprv0OIl", key));
+    LOGOS_ASSERT_FALSE(extKeyParse("", key));
+
+    std::vector<uint32_t> path;
+    LOGOS_ASSERT(extKeyParsePath("m", path));
+    LOGOS_ASSERT(path.empty());
+    LOGOS_ASSERT_FALSE(extKeyParsePath("44'/60'", path));
+    LOGOS_ASSERT_FALSE(extKeyParsePath("m/", path));
+    LOGOS_ASSERT_FALSE(extKeyParsePath("m/x", path));
+    LOGOS_ASSERT_FALSE(extKeyParsePath("m/2147483648", path));
+}
+
+LOGOS_TEST(lockedSlab_reuses_wiped_slots) {
+    LockedSlab slab(100);
+    uint8_t* first = static_cast<uint8_t*>(slab.allocate());
+    LOGOS_ASSERT(first != nullptr);
+    memset(first, 0xab, 100);
+    slab.release(first);
+    uint8_t* again = static_cast<uint8_t*>(slab.allocate());
+    LOGOS_ASSERT(again == first);
+    for (int i = 0; i < 100; ++i) {
+        LOGOS_ASSERT_EQ(int(again[i]), 0);
+    }
+    slab.release(again);
+}
+
+LOGOS_TEST(extKeyHandles_derive_and_convert_natively) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+
+    const int64_t master = impl.extKeyHandleFromString(kVector1Master);
+    LOGOS_ASSERT(master > 0);
+    const int64_t hardened = impl.deriveExtKeyHandle(master, "m/0'");
+    const int64_t child = impl.deriveExtKeyHandle(hardened, "m/1");
+    LOGOS_ASSERT(hardened > 0 && child > 0);
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(hardened), std::string(kVector1Hardened));
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(child), std::string(kVector1Child));
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToECDSA(master),
+                    std::string("0xe8f32e723decf4051aefac8e2c93c9c5b214313817cdb01a1494b917c8436b35"));
+
+    const int64_t publicKey = impl.extKeyHandleFromString(kVector1HardenedPublic);
+    LOGOS_ASSERT(publicKey > 0);
+    LOGOS_ASSERT(impl.extKeyHandleToECDSA(publicKey).empty());
+    LOGOS_ASSERT_EQ(impl.deriveExtKeyHandle(publicKey, "m/0'"), int64_t(0));
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(impl.deriveExtKeyHandle(publicKey, "m/1")),
+                    std::string(kVector1ChildPublic));
+
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keys_DeriveExtKey"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keys_ExtKeyToECDSA"));
+}
+
+LOGOS_TEST(extKeyHandles_are_invalid_after_release) {
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_EQ(impl.extKeyHandleFromString("not a key"), int64_t(0));
+    const int64_t handle = impl.extKeyHandleFromString(kVector1Master);
+    LOGOS_ASSERT(impl.releaseExtKeyHandle(handle));
+    LOGOS_ASSERT_FALSE(impl.releaseExtKeyHandle(handle));
+    LOGOS_ASSERT(impl.extKeyHandleToString(handle).empty());
+    LOGOS_ASSERT_EQ(impl.deriveExtKeyHandle(handle, "m/0"), int64_t(0));
+    // Handles are not reused.
+    LOGOS_ASSERT(impl.extKeyHandleFromString(kVector1Master) != handle);
+}
+
+LOGOS_TEST(extKeyHandleFromMnemonic_derives_seed_natively) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    const int64_t handle = impl.extKeyHandleFromMnemonic(
+        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about", "TREZOR");
+    LOGOS_ASSERT(handle > 0);
+    LOGOS_ASSERT_EQ(impl.extKeyHandleToString(handle),
+                    std::string("xprv9s21ZrQH143K3h3fDYiay8mocZ3afhfULfb5GX8kCBdno77K4HiA15Tg23wpbeF1pLfs1c5SPmYHrEpTuuRhxMwvKDwqdKiGJS9XFKzUsAF"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keys_CreateExtKeyFromMnemonic"));
+
+    LOGOS_ASSERT_EQ(impl.extKeyHandleFromMnemonic(
+                        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon", ""),
+                    int64_t(0));
+    LOGOS_ASSERT_EQ(impl.extKeyHandleFromMnemonic("not a mnemonic", ""), int64_t(0));
+}
+
+LOGOS_TEST(extKeystoreImportExtendedKeyHandle_imports_through_sdk) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_ImportExtendedKey").returns("0xIMPORTED");
+
+    AccountsModuleImpl impl;
+    impl.initExtKeystore("/tmp/ext-ks", 4096, 6);
+    LOGOS_ASSERT(impl.extKeystoreImportExtendedKeyHandle(12345, "pass").empty());
+    const int64_t handle = impl.extKeyHandleFromString(kVector1Master);
+    LOGOS_ASSERT_EQ(impl.extKeystoreImportExtendedKeyHandle(handle, "pass"), std::string("0xIMPORTED"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_ImportExtendedKey"), 1);
+}
@@ -0,0 +1,88 @@
+// Unit tests for the FFI executor: calls run on its thread, concurrent callers
+// share batches within the window, and disabled or nested use runs inline.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "ffi_executor.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+LOGOS_TEST(ffiExecutor_runs_calls_on_its_own_thread) {
+    FfiExecutor executor;
+    std::thread::id ranOn;
+    executor.run([&] { ranOn = std::this_thread::get_id(); });
+    LOGOS_ASSERT(ranOn == std::this_thread::get_id());
+    LOGOS_ASSERT_EQ(executor.stats().inlineCalls, uint64_t(1));
+
+    executor.configure(true, 0, 8);
+    executor.run([&] { ranOn = std::this_thread::get_id(); });
+    LOGOS_ASSERT(ranOn != std::this_thread::get_id());
+    const std::thread::id worker = ranOn;
+    executor.run([&] { ranOn = std::this_thread::get_id(); });
+    LOGOS_ASSERT(ranOn == worker);
+
+    // A call made from the executor thread runs inline instead of deadlocking.
+    bool nested = false;
+    executor.run([&] { executor.run([&] { nested = true; }); });
+    LOGOS_ASSERT(nested);
+
+    FfiExecutor::Stats stats = executor.stats();
+    LOGOS_ASSERT(stats.enabled);
+    LOGOS_ASSERT_EQ(stats.calls, uint64_t(3));
+    LOGOS_ASSERT_EQ(stats.inlineCalls, uint64_t(2));
+
+    executor.configure(false, 0, 8);
+    executor.run([&] { ranOn = std::this_thread::get_id(); });
+    LOGOS_ASSERT(ranOn == std::this_thread::get_id());
+}
+
+LOGOS_TEST(ffiExecutor_batches_concurrent_callers_within_window) {
+    FfiExecutor executor;
+    executor.configure(true, 50000, 8);
+    std::atomic<int> done(0);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 6; ++i) {
+        callers.emplace_back([&] {
+            for (int j = 0; j < 20; ++j) {
+                executor.run([&] { ++done; });
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    LOGOS_ASSERT_EQ(done.load(), 120);
+    FfiExecutor::Stats stats = executor.stats();
+    LOGOS_ASSERT_EQ(stats.calls, uint64_t(120));
+    LOGOS_ASSERT(stats.largestBatch >= 2);
+    LOGOS_ASSERT(stats.largestBatch <= 8);
+    LOGOS_ASSERT(stats.batches < 120);
+}
+
+LOGOS_TEST(keystoreSignHash_goes_through_ffi_executor) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_FALSE(nlohmann::json::parse(impl.ffiExecutorStatus())["enabled"].get<bool>());
+    LOGOS_ASSERT(impl.configureFfiExecutor(true, 0, 8));
+    LOGOS_ASSERT_FALSE(impl.configureFfiExecutor(true, -1, 8));
+    LOGOS_ASSERT_FALSE(impl.configureFfiExecutor(true, 0, 0));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xABC", "0x01"), std::string("0xSIG"));
+    auto status = nlohmann::json::parse(impl.ffiExecutorStatus());
+    LOGOS_ASSERT(status["enabled"].get<bool>());
+    LOGOS_ASSERT_EQ(status["calls"].get<int>(), 1);
+
+    LOGOS_ASSERT(impl.configureFfiExecutor(false, 0, 8));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xABC", "0x02"), std::string("0xSIG"));
+    status = nlohmann::json::parse(impl.ffiExecutorStatus());
+    LOGOS_ASSERT_EQ(status["inlineCalls"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 2);
+    impl.closeKeystore("");
+}
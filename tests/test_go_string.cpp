@@ -0,0 +1,56 @@
+// Unit tests for GoString, the owner of strings returned by the SDK: contents
+// are read in place and each string is freed exactly once.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "go_string.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+LOGOS_TEST(goString_frees_once_and_transfers_ownership_on_move) {
+    auto t = LogosTestContext("accounts_module");
+    {
+        GoString empty;
+        LOGOS_ASSERT_FALSE(static_cast<bool>(empty));
+        LOGOS_ASSERT(empty.view().empty());
+        LOGOS_ASSERT_EQ(std::string(empty.c_str()), std::string());
+
+        GoString owned(strdup("0xSIGNATURE"));
+        LOGOS_ASSERT(static_cast<bool>(owned));
+        LOGOS_ASSERT(owned.view() == "0xSIGNATURE");
+        LOGOS_ASSERT_EQ(owned.view().size(), size_t(11));
+        LOGOS_ASSERT_EQ(owned.str(), std::string("0xSIGNATURE"));
+
+        GoString moved(std::move(owned));
+        LOGOS_ASSERT_FALSE(static_cast<bool>(owned));
+        LOGOS_ASSERT(moved.view() == "0xSIGNATURE");
+        LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_FreeCString"), 0);
+
+        // out() frees the held string before the SDK stores a new one.
+        char** slot = moved.out();
+        LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_FreeCString"), 1);
+        LOGOS_ASSERT(*slot == nullptr);
+        *slot = strdup("error");
+        LOGOS_ASSERT(moved.view() == "error");
+
+        moved.wipe();
+        LOGOS_ASSERT(moved.view() == std::string(5, '\0'));
+    }
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_FreeCString"), 2);
+}
+
+LOGOS_TEST(keystore_results_are_freed_after_use) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns("[{\"address\":\"0xABC\"},{\"address\":\"0xDEF\"}]");
+    t.mockCFunction("GoWSK_accounts_keystore_Export").returns("{\"address\":\"abc\"}");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_EQ(impl.keystoreAccounts().size(), size_t(2));
+    LOGOS_ASSERT_EQ(impl.keystoreExport("0xABC", "pw", "new"), std::string("{\"address\":\"abc\"}"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_FreeCString"), 2);
+    impl.closeKeystore("");
+}
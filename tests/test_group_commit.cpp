@@ -0,0 +1,145 @@
+// Tests for the key-file durability modes. Key files are plain files named as
+// the SDK names them, in a scratch directory; syncs are observed through the
+// commit statistics.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "group_commit.h"
+#include "memory_dir.h"
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+const char* kAddressA = "0x1111111111111111111111111111111111111111";
+const char* kAddressB = "0xAbCdEf0000000000000000000000000000000002";
+const char* kAddressC = "0x3333333333333333333333333333333333333333";
+
+void writeKeyFile(const std::string& dir, const std::string& address)
+{
+    std::string hex = address.substr(2);
+    for (char& c : hex) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    FILE* f = std::fopen((dir + "/UTC--2024-01-01T00-00-00.000000000Z--" + hex).c_str(), "w");
+    std::fputs("{}", f);
+    std::fclose(f);
+}
+
+} // namespace
+
+LOGOS_TEST(groupCommit_syncs_a_window_of_writes_together) {
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    writeKeyFile(dir.path(), kAddressA);
+    writeKeyFile(dir.path(), kAddressB);
+    writeKeyFile(dir.path(), kAddressC);
+
+    GroupCommit commits;
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressA));
+    LOGOS_ASSERT_EQ(commits.stats().commits, uint64_t(0));
+
+    commits.configure(GroupCommit::Mode::Group, 60000);
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressA));
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressB));
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressC));
+    LOGOS_ASSERT(commits.written(dir.path(), ""));
+    LOGOS_ASSERT_EQ(commits.stats().pending, size_t(4));
+    // flush() cuts the window short.
+    LOGOS_ASSERT(commits.flush());
+    GroupCommit::Stats stats = commits.stats();
+    LOGOS_ASSERT_EQ(stats.pending, size_t(0));
+    LOGOS_ASSERT_EQ(stats.commits, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.files, uint64_t(3));
+
+    commits.configure(GroupCommit::Mode::Sync, 0);
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressB));
+    stats = commits.stats();
+    LOGOS_ASSERT_EQ(stats.commits, uint64_t(2));
+    LOGOS_ASSERT_EQ(stats.files, uint64_t(4));
+    LOGOS_ASSERT(commits.flush());
+}
+
+LOGOS_TEST(groupCommit_syncs_named_key_files_without_a_scan) {
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    // Not named after the address, so only the given path can find it.
+    FILE* f = std::fopen((dir.path() + "/key").c_str(), "w");
+    std::fputs("{}", f);
+    std::fclose(f);
+
+    GroupCommit commits;
+    commits.configure(GroupCommit::Mode::Sync, 0);
+    LOGOS_ASSERT(commits.synchronous());
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressA, dir.path() + "/key"));
+    GroupCommit::Stats stats = commits.stats();
+    LOGOS_ASSERT_EQ(stats.files, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.commits, uint64_t(1));
+    LOGOS_ASSERT_FALSE(commits.written(dir.path(), kAddressA, dir.path() + "/missing"));
+    LOGOS_ASSERT_FALSE(commits.flush());
+
+    commits.configure(GroupCommit::Mode::Group, 60000);
+    LOGOS_ASSERT_FALSE(commits.synchronous());
+    LOGOS_ASSERT(commits.written(dir.path(), kAddressA, dir.path() + "/key"));
+    LOGOS_ASSERT(commits.flush());
+    LOGOS_ASSERT_EQ(commits.stats().files, uint64_t(2));
+}
+
+LOGOS_TEST(groupCommit_reports_failed_syncs_once) {
+    GroupCommit commits;
+    commits.configure(GroupCommit::Mode::Sync, 0);
+    LOGOS_ASSERT_FALSE(commits.written("/nonexistent/keystore", kAddressA));
+    LOGOS_ASSERT_FALSE(commits.flush());
+    LOGOS_ASSERT(commits.flush());
+
+    commits.configure(GroupCommit::Mode::Group, 0);
+    LOGOS_ASSERT(commits.written("/nonexistent/keystore", kAddressA));
+    LOGOS_ASSERT_FALSE(commits.flush());
+    GroupCommit::Stats stats = commits.stats();
+    LOGOS_ASSERT_EQ(stats.failures, uint64_t(2));
+    LOGOS_ASSERT_FALSE(stats.lastError.empty());
+}
+
+LOGOS_TEST(keystoreFlush_makes_new_accounts_durable) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_NewAccount").returns(kAddressA);
+
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    writeKeyFile(dir.path(), kAddressA);
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_FALSE(impl.configureDurability("always", 0));
+    LOGOS_ASSERT_FALSE(impl.configureDurability("group", -1));
+    LOGOS_ASSERT(impl.initKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT(impl.configureDurability("group", 60000));
+
+    LOGOS_ASSERT_EQ(impl.keystoreNewAccount("pw"), std::string(kAddressA));
+    auto status = nlohmann::json::parse(impl.durabilityStatus());
+    LOGOS_ASSERT_EQ(status["mode"].get<std::string>(), std::string("group"));
+    LOGOS_ASSERT_EQ(status["pending"].get<int>(), 1);
+    LOGOS_ASSERT(impl.keystoreFlush());
+    status = nlohmann::json::parse(impl.durabilityStatus());
+    LOGOS_ASSERT_EQ(status["pending"].get<int>(), 0);
+    LOGOS_ASSERT_EQ(status["files"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(status["commits"].get<int>(), 1);
+
+    // Bulk imports record their key files too.
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns(kAddressB);
+    writeKeyFile(dir.path(), kAddressB);
+    MemoryDir src;
+    LOGOS_ASSERT(src.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    FILE* f = std::fopen((src.path() + "/key.json").c_str(), "w");
+    std::fputs("{}", f);
+    std::fclose(f);
+    LOGOS_ASSERT(!impl.keystoreImportDirectory(src.path(), "pw", "pw").empty());
+    status = nlohmann::json::parse(impl.durabilityStatus());
+    LOGOS_ASSERT_EQ(status["pending"].get<int>(), 1);
+    LOGOS_ASSERT(impl.keystoreFlush());
+    status = nlohmann::json::parse(impl.durabilityStatus());
+    LOGOS_ASSERT_EQ(status["files"].get<int>(), 2);
+    impl.closeKeystore("");
+}
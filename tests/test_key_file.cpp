@@ -0,0 +1,125 @@
+// Unit tests for native key-file decryption: Keccak-256, AES-128-CTR,
+// PBKDF2-HMAC-SHA256 and scrypt against published vectors, and the test
+// vectors of the Web3 Secret Storage definition for both key derivations.
+
+#include <logos_test.h>
+#include "aes128.h"
+#include "keccak.h"
+#include "key_file.h"
+#include "scrypt.h"
+#include "sha256.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < size; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0xf];
+    }
+    return out;
+}
+
+std::string keccakHex(const std::string& data)
+{
+    uint8_t digest[Keccak256::kDigestSize];
+    Keccak256::hash(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+    return toHex(digest, sizeof(digest));
+}
+
+std::string scryptHex(const std::string& password, const std::string& salt, uint64_t n, uint32_t r, uint32_t p)
+{
+    uint8_t out[64];
+    if (!scrypt(reinterpret_cast<const uint8_t*>(password.data()), password.size(),
+                reinterpret_cast<const uint8_t*>(salt.data()), salt.size(), n, r, p, out, sizeof(out))) {
+        return "failed";
+    }
+    return toHex(out, sizeof(out));
+}
+
+// Both use the password "testpassword" and hold the same key.
+const char* kPbkdf2KeyFile = R"({"crypto":{"cipher":"aes-128-ctr","cipherparams":{"iv":"6087dab2f9fdbbfaddc31a909735c1e6"},
+    "ciphertext":"5318b4d5bcd28de64ee5559e671353e16f075ecae9f99c7a79a38af5f869aa46","kdf":"pbkdf2",
+    "kdfparams":{"c":262144,"dklen":32,"prf":"hmac-sha256","salt":"ae3cd4e7013836a3df6bd7241b12db061dbe2c6785853cce422d148a624ce0bd"},
+    "mac":"517ead924a9d0dc3124507e3393d175ce3ff7c1e96529c6c555ce9e51205e9b2"},
+    "id":"3198bc9c-6672-5ab3-d995-4942343ae5b6","version":3})";
+const char* kScryptKeyFile = R"({"crypto":{"cipher":"aes-128-ctr","cipherparams":{"iv":"83dbcc02d8ccb40e466191a123791e0e"},
+    "ciphertext":"d172bf743a674da9cdad04534d56926ef8358534d458fffccd4e6ad2fbde479c","kdf":"scrypt",
+    "kdfparams":{"dklen":32,"n":262144,"p":8,"r":1,"salt":"ab0c7876052600dd703518d6fc3fe8984592145b591fc8fb5c6d43190334ba19"},
+    "mac":"2103ac29920d71da29f15d75b4a16dbe95cfd7ff8faea1056c33131d846e3097"},
+    "id":"3198bc9c-6672-5ab3-d995-4942343ae5b6","version":3})";
+const char* kSpecKey = "7a28b5ba57c53603b0b07b56bba752f7784bf506fa95edc395f5cf6c7514fe9d";
+
+} // namespace
+
+LOGOS_TEST(keyFile_primitives_match_published_vectors) {
+    LOGOS_ASSERT_EQ(keccakHex(""), std::string("c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"));
+    LOGOS_ASSERT_EQ(keccakHex("abc"), std::string("4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45"));
+    // Longer than one 136-byte block, fed in pieces.
+    const std::string longInput(300, 'a');
+    Keccak256 hasher;
+    hasher.update(reinterpret_cast<const uint8_t*>(longInput.data()), 100);
+    hasher.update(reinterpret_cast<const uint8_t*>(longInput.data()) + 100, 200);
+    uint8_t digest[Keccak256::kDigestSize];
+    hasher.finish(digest);
+    LOGOS_ASSERT_EQ(toHex(digest, sizeof(digest)), keccakHex(longInput));
+
+    // NIST SP 800-38A F.5.1, first two blocks.
+    const uint8_t key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    uint8_t counter[16];
+    for (int i = 0; i < 16; ++i) {
+        counter[i] = static_cast<uint8_t>(0xf0 + i);
+    }
+    const uint8_t plain[32] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+                               0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51};
+    uint8_t cipher[32];
+    aes128Ctr(key, counter, plain, cipher, sizeof(plain));
+    LOGOS_ASSERT_EQ(toHex(cipher, sizeof(cipher)),
+                    std::string("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"));
+
+    // RFC 7914 section 11.
+    uint8_t derived[64];
+    pbkdf2HmacSha256(reinterpret_cast<const uint8_t*>("passwd"), 6, reinterpret_cast<const uint8_t*>("salt"), 4, 1,
+                     derived, sizeof(derived));
+    LOGOS_ASSERT_EQ(toHex(derived, sizeof(derived)),
+                    std::string("55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+                                "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783"));
+}
+
+LOGOS_TEST(scrypt_matches_rfc7914_vectors) {
+    LOGOS_ASSERT(std::string(scryptKernel()) == "sse2" || std::string(scryptKernel()) == "scalar");
+    LOGOS_ASSERT_EQ(scryptHex("", "", 16, 1, 1),
+                    std::string("77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+                                "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906"));
+    // p = 16 runs the lanes in parallel.
+    LOGOS_ASSERT_EQ(scryptHex("password", "NaCl", 1024, 8, 16),
+                    std::string("fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+                                "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640"));
+    LOGOS_ASSERT_EQ(scryptHex("x", "y", 3, 1, 1), std::string("failed"));
+    LOGOS_ASSERT_EQ(scryptHex("x", "y", 16, 0, 1), std::string("failed"));
+    LOGOS_ASSERT_EQ(scryptHex("x", "y", uint64_t(1) << 40, 8, 1), std::string("failed"));
+}
+
+LOGOS_TEST(keyFileDecrypt_opens_web3_secret_storage_vectors) {
+    uint8_t key[32];
+    std::string error;
+    LOGOS_ASSERT(keyFileDecrypt(kPbkdf2KeyFile, "testpassword", key, error));
+    LOGOS_ASSERT_EQ(toHex(key, sizeof(key)), std::string(kSpecKey));
+    std::memset(key, 0, sizeof(key));
+    LOGOS_ASSERT(keyFileDecrypt(kScryptKeyFile, "testpassword", key, error));
+    LOGOS_ASSERT_EQ(toHex(key, sizeof(key)), std::string(kSpecKey));
+
+    LOGOS_ASSERT_FALSE(keyFileDecrypt(kPbkdf2KeyFile, "wrong", key, error));
+    LOGOS_ASSERT_EQ(error, std::string("could not decrypt key with given password"));
+    LOGOS_ASSERT_FALSE(keyFileDecrypt("{\"version\":3}", "testpassword", key, error));
+    LOGOS_ASSERT_FALSE(keyFileDecrypt("not json", "testpassword", key, error));
+    std::string unsupported = kPbkdf2KeyFile;
+    unsupported.replace(unsupported.find("aes-128-ctr"), 11, "aes-256-gcm");
+    LOGOS_ASSERT_FALSE(keyFileDecrypt(unsupported, "testpassword", key, error));
+    LOGOS_ASSERT_EQ(error, std::string("unsupported cipher"));
+}
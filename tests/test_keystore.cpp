@@ -4,6 +4,9 @@
 #include <logos_test.h>
 #include "accounts_module_impl.h"
 
+#include <thread>
+#include <vector>
+
 // ── Keystore: init / close ──────────────────────────────────────────────────
 
 LOGOS_TEST(initKeystore_returns_true_on_success) {
@@ -39,6 +42,80 @@ LOGOS_TEST(closeKeystore_returns_false_without_init) {
     LOGOS_ASSERT_FALSE(impl.closeKeystore(""));
 }
 
+// ── Keystore: background init ───────────────────────────────────────────────
+
+LOGOS_TEST(initKeystoreAsync_becomes_ready) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystoreAsync("/tmp/ks", 4096, 6));
+    LOGOS_ASSERT_TRUE(impl.waitKeystoreReady(-1));
+    LOGOS_ASSERT_EQ(impl.keystoreState(), std::string("ready"));
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keystore_NewKeyStore"));
+}
+
+LOGOS_TEST(initKeystoreAsync_reports_failure) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(0);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initKeystoreAsync("/tmp/ks", 4096, 6));
+    LOGOS_ASSERT_FALSE(impl.waitKeystoreReady(-1));
+    LOGOS_ASSERT_EQ(impl.keystoreState(), std::string("failed"));
+}
+
+LOGOS_TEST(keystore_operations_wait_for_async_init) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_NewAccount").returns("0xABCD1234");
+
+    AccountsModuleImpl impl;
+    impl.initKeystoreAsync("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_EQ(impl.keystoreNewAccount("pass"), std::string("0xABCD1234"));
+    LOGOS_ASSERT_EQ(impl.keystoreState(), std::string("ready"));
+}
+
+LOGOS_TEST(keystoreState_is_closed_after_close) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_EQ(impl.keystoreState(), std::string("closed"));
+    impl.initKeystoreAsync("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.closeKeystore(""));
+    LOGOS_ASSERT_EQ(impl.keystoreState(), std::string("closed"));
+}
+
+LOGOS_TEST(racing_initKeystoreAsync_calls_close_every_handle) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+
+    AccountsModuleImpl impl;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&impl] { impl.initKeystoreAsync("/tmp/ks", 4096, 6); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    LOGOS_ASSERT_TRUE(impl.waitKeystoreReady(-1));
+    LOGOS_ASSERT_TRUE(impl.closeKeystore(""));
+    // Each init waits out the load in flight, so every opened handle is closed.
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewKeyStore"), 8);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_CloseKeyStore"), 8);
+}
+
+LOGOS_TEST(initExtKeystoreAsync_becomes_ready) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(1);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_TRUE(impl.initExtKeystoreAsync("/tmp/ext-ks", 4096, 6));
+    LOGOS_ASSERT_TRUE(impl.waitExtKeystoreReady(-1));
+    LOGOS_ASSERT_EQ(impl.extKeystoreState(), std::string("ready"));
+}
+
 // ── Keystore: accounts ──────────────────────────────────────────────────────
 
 LOGOS_TEST(keystoreAccounts_returns_empty_for_empty_array) {
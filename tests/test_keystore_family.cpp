@@ -0,0 +1,49 @@
+// Tests that the keystore and ext-keystore methods share one call path: the
+// ext keystore gets the same admission, FFI executor, signature cache and
+// single-flight behaviour as the plain keystore, under its own cache scope.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+
+#include <string>
+#include <nlohmann/json.hpp>
+
+LOGOS_TEST(extKeystore_shares_keystore_call_path) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(2);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+    t.mockCFunction("GoWSK_accounts_extkeystore_SignHash").returns("0xEXTSIG");
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.initKeystore("/tmp/ks", 4096, 6));
+    LOGOS_ASSERT(impl.initExtKeystore("/tmp/extks", 4096, 6));
+    LOGOS_ASSERT(impl.configureFfiExecutor(true, 0, 64));
+    const std::string hash = "0x01";
+
+    LOGOS_ASSERT(impl.extKeystoreUnlock("0xABC", "pw"));
+    LOGOS_ASSERT_EQ(impl.extKeystoreSignHash("0xABC", hash), std::string("0xEXTSIG"));
+    LOGOS_ASSERT_EQ(impl.extKeystoreSignHash("0xABC", hash), std::string("0xEXTSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_SignHash"), 1);
+
+    // The same address unlocked in the plain keystore is cached separately.
+    LOGOS_ASSERT(impl.keystoreUnlock("0xABC", "pw"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xABC", hash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 1);
+
+    LOGOS_ASSERT(impl.extKeystoreLock("0xABC"));
+    impl.extKeystoreSignHash("0xABC", hash);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_SignHash"), 2);
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xABC", hash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 1);
+
+    // One unlock per family on the scrypt lane; the three sign calls that
+    // reached the SDK ran on the executor thread.
+    auto admission = nlohmann::json::parse(impl.admissionStatus());
+    LOGOS_ASSERT_EQ(admission["scrypt"]["admitted"].get<int>(), 2);
+    auto executor = nlohmann::json::parse(impl.ffiExecutorStatus());
+    LOGOS_ASSERT_EQ(executor["calls"].get<int>(), 3);
+
+    impl.closeExtKeystore();
+    impl.closeKeystore("");
+}
@@ -0,0 +1,223 @@
+// Unit tests for the multi-keystore registry. KeystoreRegistry is driven with
+// fake open/close operations that record which handles are open; the
+// AccountsModuleImpl tests go through the SDK mock and count the
+// NewKeyStore/CloseKeyStore calls the registry makes.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "keystore_registry.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+struct FakeSdk {
+    std::map<unsigned long long, std::string> open;
+    unsigned long long next = 1;
+    int opens = 0;
+    int closes = 0;
+    uint64_t bytes = 100;
+    bool failOpen = false;
+
+    KeystoreRegistry::Ops ops()
+    {
+        KeystoreRegistry::Ops ops;
+        ops.open = [this](const KeystoreRegistry::Config& config, std::string& error) -> unsigned long long {
+            if (failOpen) {
+                error = "no such directory";
+                return 0;
+            }
+            ++opens;
+            open[next] = config.dir;
+            return next++;
+        };
+        ops.close = [this](const KeystoreRegistry::Config&, unsigned long long handle) {
+            ++closes;
+            open.erase(handle);
+        };
+        ops.footprint = [this](const KeystoreRegistry::Config&) { return bytes; };
+        return ops;
+    }
+
+    bool isOpen(const std::string& dir) const
+    {
+        for (const auto& item : open) {
+            if (item.second == dir) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+KeystoreRegistry::Config config(const std::string& dir)
+{
+    KeystoreRegistry::Config c;
+    c.dir = dir;
+    c.scryptN = 4096;
+    c.scryptP = 6;
+    return c;
+}
+
+void touch(KeystoreRegistry& registry, const std::string& name)
+{
+    std::string error;
+    KeystoreRegistry::Lease lease = registry.acquire(name, error);
+}
+
+} // namespace
+
+LOGOS_TEST(keystoreRegistry_opens_lazily_and_evicts_least_recently_used) {
+    FakeSdk sdk;
+    KeystoreRegistry registry(sdk.ops());
+    registry.setLimits(2, 0);
+    LOGOS_ASSERT(registry.add("a", config("/ks/a")));
+    LOGOS_ASSERT(registry.add("b", config("/ks/b")));
+    LOGOS_ASSERT(registry.add("c", config("/ks/c")));
+    LOGOS_ASSERT(registry.add("a", config("/ks/a")));
+    LOGOS_ASSERT_FALSE(registry.add("a", config("/ks/other")));
+    LOGOS_ASSERT_EQ(sdk.opens, 0);
+
+    touch(registry, "a");
+    touch(registry, "b");
+    touch(registry, "a");
+    LOGOS_ASSERT_EQ(sdk.opens, 2);
+    touch(registry, "c");
+    LOGOS_ASSERT(sdk.isOpen("/ks/a"));
+    LOGOS_ASSERT_FALSE(sdk.isOpen("/ks/b"));
+    LOGOS_ASSERT(sdk.isOpen("/ks/c"));
+
+    KeystoreRegistry::Stats stats = registry.stats();
+    LOGOS_ASSERT_EQ(stats.open, size_t(2));
+    LOGOS_ASSERT_EQ(stats.opens, uint64_t(3));
+    LOGOS_ASSERT_EQ(stats.hits, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.evictions, uint64_t(1));
+
+    std::string error;
+    LOGOS_ASSERT_FALSE(registry.acquire("missing", error));
+    LOGOS_ASSERT_FALSE(error.empty());
+    registry.closeAll();
+    LOGOS_ASSERT(sdk.open.empty());
+}
+
+LOGOS_TEST(keystoreRegistry_keeps_leased_and_unlocked_handles_open) {
+    FakeSdk sdk;
+    KeystoreRegistry registry(sdk.ops());
+    registry.setLimits(1, 0);
+    registry.add("a", config("/ks/a"));
+    registry.add("b", config("/ks/b"));
+    registry.add("c", config("/ks/c"));
+
+    std::string error;
+    {
+        KeystoreRegistry::Lease first = registry.acquire("a", error);
+        KeystoreRegistry::Lease second = registry.acquire("b", error);
+        LOGOS_ASSERT(first);
+        LOGOS_ASSERT(second);
+        // Over the cap while both are busy.
+        LOGOS_ASSERT_EQ(sdk.open.size(), size_t(2));
+    }
+    LOGOS_ASSERT_EQ(sdk.open.size(), size_t(1));
+
+    registry.pin("c", "0xABC", std::chrono::steady_clock::time_point::max());
+    touch(registry, "c");
+    touch(registry, "a");
+    LOGOS_ASSERT(sdk.isOpen("/ks/c"));
+    LOGOS_ASSERT_EQ(registry.stats().open, size_t(1));
+    registry.unpin("c", "0xabc");
+    touch(registry, "b");
+    LOGOS_ASSERT_FALSE(sdk.isOpen("/ks/c"));
+
+    // A timed unlock stops pinning the handle once it expires.
+    registry.pin("b", "0xDEF", std::chrono::steady_clock::now() + std::chrono::milliseconds(20));
+    touch(registry, "a");
+    LOGOS_ASSERT(sdk.isOpen("/ks/b"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    touch(registry, "c");
+    LOGOS_ASSERT_FALSE(sdk.isOpen("/ks/b"));
+    LOGOS_ASSERT_EQ(sdk.open.size(), size_t(1));
+}
+
+LOGOS_TEST(keystoreRegistry_enforces_memory_cap_and_remove) {
+    FakeSdk sdk;
+    KeystoreRegistry registry(sdk.ops());
+    registry.setLimits(0, 250);
+    registry.add("a", config("/ks/a"));
+    registry.add("b", config("/ks/b"));
+    registry.add("c", config("/ks/c"));
+    touch(registry, "a");
+    touch(registry, "b");
+    LOGOS_ASSERT_EQ(sdk.open.size(), size_t(2));
+    touch(registry, "c");
+    LOGOS_ASSERT_EQ(sdk.open.size(), size_t(2));
+    LOGOS_ASSERT_EQ(registry.stats().bytes, uint64_t(200));
+
+    std::string error;
+    {
+        KeystoreRegistry::Lease lease = registry.acquire("c", error);
+        LOGOS_ASSERT(registry.remove("c"));
+        LOGOS_ASSERT(sdk.isOpen("/ks/c"));
+    }
+    LOGOS_ASSERT_FALSE(sdk.isOpen("/ks/c"));
+    LOGOS_ASSERT_FALSE(registry.acquire("c", error));
+
+    sdk.failOpen = true;
+    registry.add("d", config("/ks/d"));
+    LOGOS_ASSERT_FALSE(registry.acquire("d", error));
+    LOGOS_ASSERT_EQ(error, std::string("no such directory"));
+    LOGOS_ASSERT(registry.stats().lastError.find("d:") == 0);
+}
+
+LOGOS_TEST(tenantKeystore_routes_calls_to_each_tenants_handle) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(2);
+    t.mockCFunction("GoWSK_accounts_keystore_NewAccount").returns("0xPLAIN");
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewAccount").returns("0xEXT");
+    t.mockCFunction("GoWSK_accounts_extkeystore_Derive").returns("0xCHILD");
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts")
+        .returns("[{\"address\":\"0xPLAIN\",\"url\":\"keystore:///a/k\"}]");
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.registerKeystore("alice", "/tmp/tenant-alice", 4096, 6));
+    LOGOS_ASSERT(impl.registerExtKeystore("bob", "/tmp/tenant-bob", 4096, 6));
+    LOGOS_ASSERT_FALSE(impl.registerKeystore("alice", "/tmp/elsewhere", 4096, 6));
+    LOGOS_ASSERT_FALSE(impl.configureKeystoreRegistry(-1, 0));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewKeyStore"), 0);
+
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreNewAccount("alice", "pw"), std::string("0xPLAIN"));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreNewAccount("bob", "pw"), std::string("0xEXT"));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreNewAccount("carol", "pw"), std::string());
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreAccounts("alice").size(), size_t(1));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreDerive("bob", "0xEXT", "m/0", 0), std::string("0xCHILD"));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreDerive("alice", "0xPLAIN", "m/0", 0), std::string());
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_NewKeyStore"), 1);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_NewKeyStore"), 1);
+
+    // One open handle at a time: the least recently used tenant is closed,
+    // unless it holds an unlocked account.
+    LOGOS_ASSERT(impl.configureKeystoreRegistry(1, 0));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_CloseKeyStore"), 1);
+    LOGOS_ASSERT(impl.tenantKeystoreUnlock("alice", "0xPLAIN", "pw"));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreNewAccount("bob", "pw"), std::string("0xEXT"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_NewKeyStore"), 2);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_CloseKeyStore"), 0);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_CloseKeyStore"), 2);
+
+    auto status = nlohmann::json::parse(impl.keystoreRegistryStatus());
+    LOGOS_ASSERT_EQ(status["open"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(status["evictions"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["tenants"].size(), size_t(2));
+    LOGOS_ASSERT_EQ(status["tenants"][0]["unlocked"].get<int>(), 1);
+
+    LOGOS_ASSERT(impl.tenantKeystoreLock("alice", "0xPLAIN"));
+    LOGOS_ASSERT_EQ(impl.tenantKeystoreNewAccount("bob", "pw"), std::string("0xEXT"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_CloseKeyStore"), 1);
+    LOGOS_ASSERT(impl.unregisterKeystore("bob"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_CloseKeyStore"), 3);
+    LOGOS_ASSERT_FALSE(impl.unregisterKeystore("bob"));
+}
@@ -0,0 +1,155 @@
+// Unit tests for the inotify-backed keystore view (keystoreWatch), including
+// read-your-writes for key files the module writes itself.
+// Key files are written to a real temporary directory; SDK calls are mocked.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string makeTempDir()
+{
+    char tmpl[] = "/tmp/logos-accounts-watch-XXXXXX";
+    const char* dir = mkdtemp(tmpl);
+    return dir ? std::string(dir) : std::string();
+}
+
+void writeKeyFile(const std::string& path, const std::string& address)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    fprintf(f, "{\"address\":\"%s\",\"crypto\":{},\"version\":3}", address.c_str());
+    fclose(f);
+}
+
+// Polls until the view reports the expected number of accounts or ~5s pass.
+bool waitForAccounts(AccountsModuleImpl& impl, int expected)
+{
+    for (int i = 0; i < 500; ++i) {
+        if (static_cast<int>(impl.keystoreAccounts().size()) == expected) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // namespace
+
+LOGOS_TEST(keystoreWatch_fails_without_init) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_FALSE(impl.keystoreWatch(50));
+    LOGOS_ASSERT_FALSE(impl.keystoreUnwatch());
+}
+
+LOGOS_TEST(keystoreWatch_serves_initial_scan_without_sdk_call) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    const std::string dir = makeTempDir();
+    writeKeyFile(dir + "/UTC--2024-01-01T00-00-00.000000000Z--aaaa", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+    writeKeyFile(dir + "/.hidden.tmp", "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore(dir, 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.keystoreWatch(20));
+
+    auto accts = impl.keystoreAccounts();
+    LOGOS_ASSERT_EQ(static_cast<int>(accts.size()), 1);
+    LOGOS_ASSERT_TRUE(accts[0].find("0xaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa") != std::string::npos);
+    LOGOS_ASSERT_TRUE(impl.keystoreHasAddress("0xAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_Accounts"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_HasAddress"));
+    impl.closeKeystore("");
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreWatch_tracks_added_and_removed_files) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    const std::string dir = makeTempDir();
+
+    AccountsModuleImpl impl;
+    impl.initKeystore(dir, 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.keystoreWatch(20));
+    LOGOS_ASSERT_EQ(static_cast<int>(impl.keystoreAccounts().size()), 0);
+
+    for (int i = 0; i < 20; ++i) {
+        char addr[41];
+        snprintf(addr, sizeof(addr), "%040x", i + 1);
+        writeKeyFile(dir + "/key-" + std::to_string(i), addr);
+    }
+    LOGOS_ASSERT_TRUE(waitForAccounts(impl, 20));
+    LOGOS_ASSERT_TRUE(impl.keystoreHasAddress("0x0000000000000000000000000000000000000014"));
+
+    unlink((dir + "/key-19").c_str());
+    LOGOS_ASSERT_TRUE(waitForAccounts(impl, 19));
+    LOGOS_ASSERT_FALSE(impl.keystoreHasAddress("0x0000000000000000000000000000000000000014"));
+
+    LOGOS_ASSERT_TRUE(impl.keystoreUnwatch());
+    impl.closeKeystore("");
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreWatch_reads_its_own_writes_at_once) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Import").returns("0x00000000000000000000000000000000000000aa");
+    const std::string dir = makeTempDir();
+    const std::string parent = dir.substr(0, dir.rfind('/'));
+    char cwd[4096];
+    LOGOS_ASSERT(getcwd(cwd, sizeof(cwd)) != nullptr);
+
+    // A relative directory is watched under the absolute path the SDK uses.
+    LOGOS_ASSERT(chdir(parent.c_str()) == 0);
+    AccountsModuleImpl impl;
+    impl.initKeystore(dir.substr(parent.size() + 1) + "/", 4096, 6);
+    const bool watching = impl.keystoreWatch(60000);
+    LOGOS_ASSERT(chdir(cwd) == 0);
+    LOGOS_ASSERT_TRUE(watching);
+
+    // The SDK has written the key file when Import returns; with a minute of
+    // debounce, only the module's own flush can make it visible this soon.
+    writeKeyFile(dir + "/UTC--2024-01-01T00-00-00.000000000Z--aa", "00000000000000000000000000000000000000aa");
+    LOGOS_ASSERT_EQ(impl.keystoreImport("{}", "pw", "pw"), std::string("0x00000000000000000000000000000000000000aa"));
+    LOGOS_ASSERT_TRUE(impl.keystoreHasAddress("0x00000000000000000000000000000000000000aa"));
+    const std::vector<std::string> accounts = impl.keystoreAccounts();
+    LOGOS_ASSERT_EQ(accounts.size(), size_t(1));
+    LOGOS_ASSERT(accounts[0].find("\"keystore://" + dir + "/UTC--") != std::string::npos);
+
+    unlink((dir + "/UTC--2024-01-01T00-00-00.000000000Z--aa").c_str());
+    LOGOS_ASSERT_TRUE(impl.keystoreDelete("0x00000000000000000000000000000000000000aa", "pw"));
+    LOGOS_ASSERT_FALSE(impl.keystoreHasAddress("0x00000000000000000000000000000000000000aa"));
+
+    LOGOS_ASSERT_TRUE(impl.keystoreUnwatch());
+    impl.closeKeystore("");
+    std::filesystem::remove_all(dir);
+}
+
+LOGOS_TEST(keystoreWatch_stops_when_the_directory_goes_away) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Accounts").returns("[]");
+    const std::string dir = makeTempDir();
+    writeKeyFile(dir + "/key-1", "0000000000000000000000000000000000000001");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore(dir, 4096, 6);
+    LOGOS_ASSERT_TRUE(impl.keystoreWatch(20));
+    LOGOS_ASSERT_EQ(static_cast<int>(impl.keystoreAccounts().size()), 1);
+
+    // The stale view is dropped; reads go back to the SDK.
+    std::filesystem::rename(dir, dir + "-moved");
+    LOGOS_ASSERT_TRUE(waitForAccounts(impl, 0));
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keystore_Accounts"));
+    LOGOS_ASSERT_FALSE(impl.keystoreUnwatch());
+    impl.closeKeystore("");
+    std::filesystem::remove_all(dir + "-moved");
+}
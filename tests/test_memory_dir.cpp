@@ -0,0 +1,114 @@
+// Tests for in-memory keystores: the private tmpfs directory behind
+// kMemoryKeystoreDir is created on init and removed, contents included, on
+// close.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "memory_dir.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+bool exists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+int countEntries(const std::string& dir, const char* prefix)
+{
+    int count = 0;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            count += std::strncmp(entry->d_name, prefix, std::strlen(prefix)) == 0 ? 1 : 0;
+        }
+        closedir(d);
+    }
+    return count;
+}
+
+} // namespace
+
+LOGOS_TEST(memoryDir_removes_its_tree_on_release) {
+    MemoryDir dir;
+    LOGOS_ASSERT_FALSE(dir.active());
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    const std::string path = dir.path();
+    const std::string root = MemoryDir::root(MemoryDir::Backing::MemoryOrDisk);
+    LOGOS_ASSERT_EQ(path.compare(0, root.size(), root), 0);
+    struct stat st;
+    LOGOS_ASSERT_EQ(stat(path.c_str(), &st), 0);
+    LOGOS_ASSERT_EQ(static_cast<int>(st.st_mode & 0777), 0700);
+
+    LOGOS_ASSERT_EQ(mkdir((path + "/sub").c_str(), 0700), 0);
+    FILE* f = std::fopen((path + "/sub/key.json").c_str(), "w");
+    LOGOS_ASSERT(f != nullptr);
+    std::fputs("{}", f);
+    std::fclose(f);
+
+    // A second create replaces the first directory.
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    LOGOS_ASSERT_FALSE(exists(path));
+    const std::string second = dir.path();
+    dir.release();
+    LOGOS_ASSERT_FALSE(dir.active());
+    LOGOS_ASSERT_FALSE(exists(second));
+}
+
+LOGOS_TEST(memoryDir_sweeps_directories_of_exited_processes) {
+    // Memory-only directories need /dev/shm; without it create() refuses.
+    MemoryDir memory;
+    LOGOS_ASSERT_EQ(memory.create("logos-sweep-"), !MemoryDir::root().empty());
+    memory.release();
+
+    const pid_t child = fork();
+    if (child == 0) {
+        _exit(0);
+    }
+    LOGOS_ASSERT(child > 0);
+    LOGOS_ASSERT_EQ(waitpid(child, nullptr, 0), child);
+
+    const std::string root = MemoryDir::root(MemoryDir::Backing::MemoryOrDisk);
+    const std::string stale = root + "/logos-sweep-" + std::to_string(child) + "-abcdef";
+    LOGOS_ASSERT_EQ(mkdir(stale.c_str(), 0700), 0);
+    LOGOS_ASSERT_EQ(mkdir((stale + "/sub").c_str(), 0700), 0);
+    MemoryDir live;
+    LOGOS_ASSERT(live.create("logos-sweep-", MemoryDir::Backing::MemoryOrDisk));
+
+    MemoryDir::sweep("logos-sweep-");
+    LOGOS_ASSERT_FALSE(exists(stale));
+    LOGOS_ASSERT(exists(live.path()));
+}
+
+LOGOS_TEST(initKeystore_memory_dir_is_removed_on_close) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(2);
+
+    const std::string root = MemoryDir::root();
+    const int keystores = countEntries(root, "logos-keystore-");
+    const int extKeystores = countEntries(root, "logos-extkeystore-");
+    {
+        AccountsModuleImpl impl;
+        LOGOS_ASSERT(impl.initKeystore(AccountsModuleImpl::kMemoryKeystoreDir, 0, 0));
+        LOGOS_ASSERT(impl.initExtKeystore(AccountsModuleImpl::kMemoryKeystoreDir, 0, 0));
+        LOGOS_ASSERT_EQ(countEntries(root, "logos-keystore-"), keystores + 1);
+        LOGOS_ASSERT_EQ(countEntries(root, "logos-extkeystore-"), extKeystores + 1);
+
+        // Re-initialising replaces the directory rather than adding one.
+        LOGOS_ASSERT(impl.initKeystore(AccountsModuleImpl::kMemoryKeystoreDir, 0, 0));
+        LOGOS_ASSERT_EQ(countEntries(root, "logos-keystore-"), keystores + 1);
+        LOGOS_ASSERT(impl.closeKeystore(""));
+        LOGOS_ASSERT_EQ(countEntries(root, "logos-keystore-"), keystores);
+    }
+    // The ext keystore was left open: its directory goes with the module.
+    LOGOS_ASSERT_EQ(countEntries(root, "logos-extkeystore-"), extKeystores);
+}
@@ -0,0 +1,266 @@
+// Unit tests for native mnemonic handling: the SHA-256, ChaCha20 and PBKDF2
+// primitives against published vectors, BIP-39 entropy encoding and seed
+// derivation against the reference vectors, the perfect-hash wordlist lookup
+// and validation, and the batch calls built on them.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "bip39.h"
+#include "bip39_wordlist.h"
+#include "chacha20_drbg.h"
+#include "pbkdf2_sha512.h"
+#include "sha256.h"
+
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < size; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0xf];
+    }
+    return out;
+}
+
+std::string sha256Hex(const std::string& data)
+{
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+    return toHex(digest, sizeof(digest));
+}
+
+std::string mnemonicOf(uint8_t fill, size_t size)
+{
+    std::vector<uint8_t> entropy(size, fill);
+    return bip39MnemonicFromEntropy(entropy.data(), entropy.size());
+}
+
+size_t wordCount(const std::string& mnemonic)
+{
+    std::istringstream in(mnemonic);
+    std::string word;
+    size_t n = 0;
+    while (in >> word) {
+        ++n;
+    }
+    return n;
+}
+
+} // namespace
+
+LOGOS_TEST(sha256_matches_fips_vectors) {
+    LOGOS_ASSERT_EQ(sha256Hex(""), std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    LOGOS_ASSERT_EQ(sha256Hex("abc"), std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    LOGOS_ASSERT_EQ(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                    std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+    // Streaming in uneven pieces must match the one-shot digest.
+    const std::string data(1000, 'a');
+    Sha256 ctx;
+    for (size_t off = 0; off < data.size(); off += 37) {
+        const size_t n = std::min<size_t>(37, data.size() - off);
+        ctx.update(reinterpret_cast<const uint8_t*>(data.data()) + off, n);
+    }
+    uint8_t digest[Sha256::kDigestSize];
+    ctx.finish(digest);
+    LOGOS_ASSERT_EQ(toHex(digest, sizeof(digest)), sha256Hex(data));
+}
+
+LOGOS_TEST(chacha20_block_matches_rfc8439_vector) {
+    uint8_t keyBytes[32];
+    for (int i = 0; i < 32; ++i) {
+        keyBytes[i] = static_cast<uint8_t>(i);
+    }
+    const uint8_t nonceBytes[12] = {0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    uint32_t key[8];
+    uint32_t nonce[3];
+    memcpy(key, keyBytes, sizeof(key));
+    memcpy(nonce, nonceBytes, sizeof(nonce));
+    uint8_t out[64];
+    ChaCha20Drbg::block(key, 1, nonce, out);
+    LOGOS_ASSERT_EQ(toHex(out, 16), std::string("10f1e7e4d13b5915500fdd1fa32071c4"));
+}
+
+LOGOS_TEST(chacha20_drbg_output_differs_between_calls) {
+    ChaCha20Drbg drbg;
+    uint8_t a[32];
+    uint8_t b[32];
+    LOGOS_ASSERT(drbg.generate(a, sizeof(a)));
+    LOGOS_ASSERT(drbg.generate(b, sizeof(b)));
+    LOGOS_ASSERT(memcmp(a, b, sizeof(a)) != 0);
+}
+
+LOGOS_TEST(bip39_encodes_reference_vectors) {
+    LOGOS_ASSERT_EQ(mnemonicOf(0x00, 16),
+                    std::string("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about"));
+    LOGOS_ASSERT_EQ(mnemonicOf(0x7f, 16),
+                    std::string("legal winner thank year wave sausage worth useful legal winner thank yellow"));
+    LOGOS_ASSERT_EQ(mnemonicOf(0x80, 16),
+                    std::string("letter advice cage absurd amount doctor acoustic avoid letter advice cage above"));
+    LOGOS_ASSERT_EQ(mnemonicOf(0xff, 32),
+                    std::string("zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo vote"));
+    LOGOS_ASSERT_EQ(bip39EntropyBytes(12), size_t(16));
+    LOGOS_ASSERT_EQ(bip39EntropyBytes(24), size_t(32));
+    LOGOS_ASSERT_EQ(bip39EntropyBytes(13), size_t(0));
+    LOGOS_ASSERT(mnemonicOf(0x00, 15).empty());
+}
+
+LOGOS_TEST(createRandomMnemonics_returns_distinct_phrases) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    auto batch = impl.createRandomMnemonics(300, 24);
+    LOGOS_ASSERT_EQ(batch.size(), size_t(300));
+    std::set<std::string> unique(batch.begin(), batch.end());
+    LOGOS_ASSERT_EQ(unique.size(), batch.size());
+    for (const auto& m : batch) {
+        LOGOS_ASSERT_EQ(wordCount(m), size_t(24));
+    }
+    LOGOS_ASSERT(!t.cFunctionCalled("GoWSK_accounts_mnemonic_CreateRandomMnemonic"));
+}
+
+LOGOS_TEST(createRandomMnemonics_rejects_invalid_arguments) {
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.createRandomMnemonics(5, 13).empty());
+    LOGOS_ASSERT(impl.createRandomMnemonics(0, 12).empty());
+    LOGOS_ASSERT(impl.createRandomMnemonics(-1, 12).empty());
+    LOGOS_ASSERT_EQ(impl.createRandomMnemonics(3, 15).size(), size_t(3));
+}
+
+LOGOS_TEST(pbkdf2_sha512_batch_matches_single_reference) {
+    // RFC 8018 has no SHA-512 vectors; this is the widely used
+    // PBKDF2-HMAC-SHA512("password", "salt", 2) value.
+    const std::string expected =
+        "e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+        "f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e";
+    // Odd batch sizes exercise partially filled SIMD lane groups.
+    const std::string password = "password";
+    const std::string salt = "salt";
+    std::vector<uint8_t> out(11 * 64);
+    std::vector<Pbkdf2Sha512Job> jobs;
+    for (size_t i = 0; i < 11; ++i) {
+        jobs.push_back({reinterpret_cast<const uint8_t*>(password.data()), password.size(),
+                        reinterpret_cast<const uint8_t*>(salt.data()), salt.size(), out.data() + 64 * i});
+    }
+    pbkdf2HmacSha512Batch(jobs.data(), jobs.size(), 2);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        LOGOS_ASSERT_EQ(toHex(out.data() + 64 * i, 64), expected);
+    }
+}
+
+LOGOS_TEST(createExtKeysFromMnemonics_matches_bip39_vectors) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    auto keys = impl.createExtKeysFromMnemonics(
+        "[\"abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about\","
+        "\"legal winner thank year wave sausage worth useful legal winner thank yellow\"]",
+        "TREZOR");
+    LOGOS_ASSERT_EQ(keys.size(), size_t(2));
+    LOGOS_ASSERT_EQ(keys[0], std::string("xprv9s21ZrQH143K3h3fDYiay8mocZ3afhfULfb5GX8kCBdno77K4HiA15Tg23wpbeF1pLfs1c5SPmYHrEpTuuRhxMwvKDwqdKiGJS9XFKzUsAF"));
+    LOGOS_ASSERT_EQ(keys[1], std::string("xprv9s21ZrQH143K2gA81bYFHqU68xz1cX2APaSq5tt6MFSLeXnCKV1RVUJt9FWNTbrrryem4ZckN8k4Ls1H6nwdvDTvnV7zEXs2HgPezuVccsq"));
+    LOGOS_ASSERT(!t.cFunctionCalled("GoWSK_accounts_keys_CreateExtKeyFromMnemonic"));
+}
+
+LOGOS_TEST(createExtKeysFromMnemonics_routes_non_ascii_through_sdk) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keys_CreateExtKeyFromMnemonic").returns("xprv_from_sdk");
+    AccountsModuleImpl impl;
+    auto keys = impl.createExtKeysFromMnemonics(
+        "[\"abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about\","
+        "\"abandón abandon about\"]",
+        "");
+    LOGOS_ASSERT_EQ(keys.size(), size_t(2));
+    LOGOS_ASSERT(keys[0].rfind("xprv9s21ZrQH143K", 0) == 0);
+    LOGOS_ASSERT_EQ(keys[1], std::string("xprv_from_sdk"));
+    LOGOS_ASSERT(t.cFunctionCalled("GoWSK_accounts_keys_CreateExtKeyFromMnemonic"));
+}
+
+LOGOS_TEST(createExtKeysFromMnemonics_rejects_invalid_phrases_like_the_sdk) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    auto keys = impl.createExtKeysFromMnemonics(
+        "[\"abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon\","
+        "\"abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandonx\","
+        "\"abandon abandon about\","
+        "\"not a mnemonic at all\","
+        "\"abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about\"]",
+        "");
+    LOGOS_ASSERT_EQ(keys.size(), size_t(5));
+    for (size_t i = 0; i < 4; ++i) {
+        LOGOS_ASSERT_TRUE(keys[i].empty());
+    }
+    LOGOS_ASSERT(keys[4].rfind("xprv9s21ZrQH143K", 0) == 0);
+    LOGOS_ASSERT(!t.cFunctionCalled("GoWSK_accounts_keys_CreateExtKeyFromMnemonic"));
+}
+
+LOGOS_TEST(createExtKeysFromMnemonics_rejects_invalid_json) {
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.createExtKeysFromMnemonics("not json", "").empty());
+    LOGOS_ASSERT(impl.createExtKeysFromMnemonics("[1, 2]", "").empty());
+}
+
+LOGOS_TEST(bip39WordIndex_resolves_every_word) {
+    for (size_t i = 0; i < kBip39EnglishWords.size(); ++i) {
+        LOGOS_ASSERT_EQ(bip39WordIndex(kBip39EnglishWords[i]), static_cast<int>(i));
+    }
+    LOGOS_ASSERT_EQ(bip39WordIndex(""), -1);
+    LOGOS_ASSERT_EQ(bip39WordIndex("abandonx"), -1);
+    LOGOS_ASSERT_EQ(bip39WordIndex("abstracts"), -1);
+    LOGOS_ASSERT_EQ(bip39WordIndex("Zoo"), -1);
+}
+
+LOGOS_TEST(validateMnemonic_checks_length_words_and_checksum) {
+    auto t = LogosTestContext("accounts_module");
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.validateMnemonic(
+        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about"));
+    LOGOS_ASSERT(impl.validateMnemonic(
+        "  legal winner thank year wave sausage worth useful\tlegal winner thank yellow\n"));
+    LOGOS_ASSERT(impl.validateMnemonic(mnemonicOf(0xff, 32)));
+    LOGOS_ASSERT(!impl.validateMnemonic(
+        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon"));
+    LOGOS_ASSERT(!impl.validateMnemonic("abandon abandon about"));
+    LOGOS_ASSERT(!impl.validateMnemonic(""));
+    for (const auto& m : impl.createRandomMnemonics(50, 18)) {
+        LOGOS_ASSERT(impl.validateMnemonic(m));
+    }
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keys_CreateExtKeyFromMnemonic"));
+}
+
+LOGOS_TEST(checkMnemonic_reports_unknown_words_with_suggestions) {
+    AccountsModuleImpl impl;
+    auto report = nlohmann::json::parse(impl.checkMnemonic(
+        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandom abandon about"));
+    LOGOS_ASSERT_FALSE(report["valid"].get<bool>());
+    LOGOS_ASSERT_EQ(report["error"].get<std::string>(), std::string("unknownWord"));
+    LOGOS_ASSERT_EQ(report["unknownWords"].size(), size_t(1));
+    LOGOS_ASSERT_EQ(report["unknownWords"][0]["position"].get<int>(), 9);
+    LOGOS_ASSERT_EQ(report["unknownWords"][0]["suggestions"][0].get<std::string>(), std::string("abandon"));
+
+    report = nlohmann::json::parse(impl.checkMnemonic(
+        "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon"));
+    LOGOS_ASSERT_EQ(report["error"].get<std::string>(), std::string("checksum"));
+    report = nlohmann::json::parse(impl.checkMnemonic("abandon about"));
+    LOGOS_ASSERT_EQ(report["error"].get<std::string>(), std::string("wordCount"));
+    LOGOS_ASSERT_EQ(report["words"].get<int>(), 2);
+}
+
+LOGOS_TEST(bip39Suggest_ranks_prefix_then_edit_distance) {
+    int out[5];
+    size_t n = bip39Suggest("sausge", out, 5);
+    LOGOS_ASSERT(n > 0);
+    LOGOS_ASSERT_EQ(std::string(kBip39EnglishWords[out[0]]), std::string("sausage"));
+    n = bip39Suggest("ehco", out, 5);
+    LOGOS_ASSERT(n > 0);
+    LOGOS_ASSERT_EQ(std::string(kBip39EnglishWords[out[0]]), std::string("echo"));
+    LOGOS_ASSERT_EQ(bip39Suggest("abstractly", out, 1), size_t(1));
+    LOGOS_ASSERT_EQ(std::string(kBip39EnglishWords[out[0]]), std::string("abstract"));
+}
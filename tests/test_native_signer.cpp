@@ -0,0 +1,261 @@
+// Tests for native signing with unlocked keys: the curve's RFC 6979 signatures
+// against published and independently computed vectors, the key store's
+// lock and expiry rules, keystoreSignHash answering without the SDK once an
+// account is unlocked, and the SDK unlock being deferred until it is needed.
+// The key file is the Web3 Secret Storage PBKDF2 test vector, in a scratch
+// directory.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "memory_dir.h"
+#include "native_signer.h"
+#include "secp256k1_curve.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+int hexValue(char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+void fromHex(const std::string& hex, uint8_t* out)
+{
+    for (size_t i = 0; i < hex.size() / 2; ++i) {
+        out[i] = static_cast<uint8_t>(hexValue(hex[2 * i]) << 4 | hexValue(hex[2 * i + 1]));
+    }
+}
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += kHex[data[i] >> 4];
+        hex += kHex[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+std::string curveSignHex(const std::string& keyHex, const std::string& hashHex)
+{
+    uint8_t key[32], hash[32], sig[64];
+    fromHex(keyHex, key);
+    fromHex(hashHex, hash);
+    int recoveryId = -1;
+    if (!curveSign(key, hash, sig, recoveryId)) {
+        return "failed";
+    }
+    return toHex(sig, sizeof(sig)) + (recoveryId == 0 ? "00" : recoveryId == 1 ? "01" : "??");
+}
+
+const char* kSpecKey = "7a28b5ba57c53603b0b07b56bba752f7784bf506fa95edc395f5cf6c7514fe9d";
+const char* kSpecAddress = "0x008AEEDA4D805471DF9B2A5B0F38A0C3BCBA786B";
+// Keccak-256 of the empty string, and its signature under the spec key.
+const char* kHash = "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470";
+const char* kSignature = "ba27af25810139fa7590c7eb492dd6ebbb5df0a64859d709451d5f7121911426"
+                         "2f20708e9ae00496b2bdfbbf8824258695659aa71a94e21a3480e9eebd89915e00";
+const char* kKeyFile = R"({"crypto":{"cipher":"aes-128-ctr","cipherparams":{"iv":"6087dab2f9fdbbfaddc31a909735c1e6"},
+    "ciphertext":"5318b4d5bcd28de64ee5559e671353e16f075ecae9f99c7a79a38af5f869aa46","kdf":"pbkdf2",
+    "kdfparams":{"c":262144,"dklen":32,"prf":"hmac-sha256","salt":"ae3cd4e7013836a3df6bd7241b12db061dbe2c6785853cce422d148a624ce0bd"},
+    "mac":"517ead924a9d0dc3124507e3393d175ce3ff7c1e96529c6c555ce9e51205e9b2"},
+    "id":"3198bc9c-6672-5ab3-d995-4942343ae5b6","version":3})";
+
+} // namespace
+
+LOGOS_TEST(curveSign_matches_rfc6979_vectors) {
+    // Key 1 and SHA-256("Satoshi Nakamoto"), a widely published RFC 6979 vector.
+    LOGOS_ASSERT_EQ(curveSignHex("0000000000000000000000000000000000000000000000000000000000000001",
+                                 "a0dc65ffca799873cbea0ac274015b9526505daaaed385155425f7337704883e"),
+                    std::string("934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+                                "2442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e501"));
+    LOGOS_ASSERT_EQ(curveSignHex(kSpecKey, kHash), std::string(kSignature));
+    // The largest key and a hash above the group order, which is reduced first.
+    LOGOS_ASSERT_EQ(curveSignHex("fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+                                 "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"),
+                    std::string("a7f83b5963eaf5332c633327cc967be8f4166d3f1e0b77f9761d8f4e42211e9a"
+                                "58aae31be1eb1e496923bbe8ca5e843cfb89f4d986d61d4edfd7d6fc3c9cf62c00"));
+    LOGOS_ASSERT_EQ(curveSignHex("0000000000000000000000000000000000000000000000000000000000000000", kHash),
+                    std::string("failed"));
+}
+
+LOGOS_TEST(nativeSigner_holds_keys_until_lock_or_expiry) {
+    NativeSigner signer;
+    uint8_t key[32], hash[32], sig[NativeSigner::kSignatureSize];
+    fromHex(kSpecKey, key);
+    fromHex(kHash, hash);
+    const auto forever = std::chrono::steady_clock::time_point::max();
+    auto current = [&](const char* scope) { return signer.generation(scope, kSpecAddress); };
+
+    LOGOS_ASSERT_FALSE(signer.unlocked("keystore", "0x1111111111111111111111111111111111111111", key, forever, 0));
+    LOGOS_ASSERT_FALSE(signer.sign("keystore", kSpecAddress, hash, sig));
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, forever, current("keystore")));
+    // Addresses match in any case and with or without 0x.
+    LOGOS_ASSERT(signer.sign("keystore", "008aeeda4d805471df9b2a5b0f38a0c3bcba786b", hash, sig));
+    LOGOS_ASSERT_EQ(toHex(sig, sizeof(sig)), std::string(kSignature));
+    LOGOS_ASSERT_FALSE(signer.sign("extkeystore", kSpecAddress, hash, sig));
+
+    // A timed unlock does not shorten an indefinite one...
+    const auto past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, past, current("keystore")));
+    LOGOS_ASSERT(signer.sign("keystore", kSpecAddress, hash, sig));
+    signer.invalidate("keystore", kSpecAddress);
+    LOGOS_ASSERT_FALSE(signer.sign("keystore", kSpecAddress, hash, sig));
+
+    // ...but an expired one is wiped on its next use.
+    LOGOS_ASSERT(signer.unlocked("tenant:a", kSpecAddress, key, past, current("tenant:a")));
+    LOGOS_ASSERT_EQ(signer.stats().keys, size_t(1));
+    LOGOS_ASSERT_FALSE(signer.sign("tenant:a", kSpecAddress, hash, sig));
+    LOGOS_ASSERT_EQ(signer.stats().keys, size_t(0));
+
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, forever, current("keystore")));
+    LOGOS_ASSERT(signer.unlocked("tenant:a", kSpecAddress, key, forever, current("tenant:a")));
+    signer.invalidateScope("keystore");
+    LOGOS_ASSERT_FALSE(signer.sign("keystore", kSpecAddress, hash, sig));
+    LOGOS_ASSERT(signer.sign("tenant:a", kSpecAddress, hash, sig));
+
+    // A Lock between the SDK unlock and unlocked() wins over the unlock.
+    const uint64_t generation = current("tenant:b");
+    signer.invalidate("tenant:b", kSpecAddress);
+    LOGOS_ASSERT_FALSE(signer.unlocked("tenant:b", kSpecAddress, key, forever, generation));
+    const uint64_t scopeGeneration = current("tenant:b");
+    signer.invalidateScope("tenant:b");
+    LOGOS_ASSERT_FALSE(signer.unlocked("tenant:b", kSpecAddress, key, forever, scopeGeneration));
+    LOGOS_ASSERT(signer.unlocked("tenant:b", kSpecAddress, key, forever, current("tenant:b")));
+    signer.invalidate("tenant:b", kSpecAddress);
+
+    NativeSigner::Stats stats = signer.stats();
+    LOGOS_ASSERT_EQ(stats.keys, size_t(1));
+    LOGOS_ASSERT_EQ(stats.signatures, uint64_t(3));
+    LOGOS_ASSERT_EQ(stats.misses, uint64_t(5));
+    LOGOS_ASSERT_EQ(stats.expired, uint64_t(1));
+}
+
+LOGOS_TEST(nativeSigner_hands_out_a_deferred_sdk_unlock_once) {
+    NativeSigner signer;
+    uint8_t key[32];
+    fromHex(kSpecKey, key);
+    const auto forever = std::chrono::steady_clock::time_point::max();
+    const std::string passphrase = "testpassword";
+    const std::string tooLong(NativeSigner::kMaxDeferredPassphrase + 1, 'x');
+    NativeSigner::SdkUnlock pending;
+
+    LOGOS_ASSERT_FALSE(signer.unlocked("keystore", kSpecAddress, key, forever, 0, &tooLong));
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, forever, 0, &passphrase));
+    LOGOS_ASSERT_EQ(signer.stats().deferredUnlocks, size_t(1));
+    LOGOS_ASSERT(signer.takeSdkUnlock("keystore", "008aeeda4d805471df9b2a5b0f38a0c3bcba786b", pending));
+    LOGOS_ASSERT_EQ(pending.address, std::string(kSpecAddress));
+    LOGOS_ASSERT_EQ(pending.passphrase, passphrase);
+    LOGOS_ASSERT(pending.until == forever);
+    LOGOS_ASSERT_FALSE(signer.takeSdkUnlock("keystore", kSpecAddress, pending));
+    LOGOS_ASSERT_EQ(signer.stats().keys, size_t(1));
+
+    // A direct SDK unlock drops the deferred one; expired ones are not handed out.
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, forever, 0, &passphrase));
+    LOGOS_ASSERT(signer.unlocked("keystore", kSpecAddress, key, forever, 0));
+    LOGOS_ASSERT_FALSE(signer.takeSdkUnlock("keystore", kSpecAddress, pending));
+    const auto past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    LOGOS_ASSERT(signer.unlocked("tenant:a", kSpecAddress, key, past, 0, &passphrase));
+    LOGOS_ASSERT(signer.takeSdkUnlocks("tenant:a").empty());
+    LOGOS_ASSERT(signer.unlocked("tenant:b", kSpecAddress, key, forever, 0, &passphrase));
+    LOGOS_ASSERT_EQ(signer.takeSdkUnlocks("tenant:b").size(), size_t(1));
+    // The expired key keeps its passphrase until it is next used or invalidated.
+    LOGOS_ASSERT_EQ(signer.stats().deferredUnlocks, size_t(1));
+    signer.invalidateScope("tenant:a");
+    LOGOS_ASSERT_EQ(signer.stats().deferredUnlocks, size_t(0));
+}
+
+LOGOS_TEST(keystoreSignHash_signs_natively_while_unlocked) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    FILE* f = std::fopen((dir.path() + "/UTC--2016-01-01T00-00-00.000000000Z--008aeeda4d805471df9b2a5b0f38a0c3bcba786b").c_str(), "w");
+    std::fputs(kKeyFile, f);
+    std::fclose(f);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.initKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT(impl.configureNativeSigning(true));
+
+    // The SDK accepts the unlock, the key file does not open: signing stays with the SDK.
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "not the password"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash(kSpecAddress, std::string("0x") + kHash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 1);
+    impl.keystoreLock(kSpecAddress);
+
+    LOGOS_ASSERT(impl.keystoreTimedUnlock(kSpecAddress, "testpassword", 3600));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash(kSpecAddress, std::string("0x") + kHash), std::string("0x") + kSignature);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 1);
+    auto status = nlohmann::json::parse(impl.nativeSigningStatus());
+    LOGOS_ASSERT_EQ(status["keys"].get<int>(), 1);
+    LOGOS_ASSERT_EQ(status["signatures"].get<int>(), 1);
+
+    // Lock wipes the key; the SDK answers again (and reports the account locked).
+    LOGOS_ASSERT(impl.keystoreLock(kSpecAddress));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash(kSpecAddress, std::string("0x") + kHash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 2);
+
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+    LOGOS_ASSERT(impl.configureNativeSigning(false));
+    status = nlohmann::json::parse(impl.nativeSigningStatus());
+    LOGOS_ASSERT_FALSE(status["enabled"].get<bool>());
+    LOGOS_ASSERT_EQ(status["keys"].get<int>(), 0);
+
+    // The native decryption is admitted to the scrypt lane; the SDK's unlock
+    // is deferred, so it is the only scrypt run.
+    LOGOS_ASSERT(impl.configureNativeSigning(true));
+    LOGOS_ASSERT(impl.configureAdmissionLane("scrypt", 1, 4, 0));
+    const int admitted = nlohmann::json::parse(impl.admissionStatus())["scrypt"]["admitted"].get<int>();
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+    LOGOS_ASSERT_EQ(nlohmann::json::parse(impl.admissionStatus())["scrypt"]["admitted"].get<int>(), admitted + 1);
+    LOGOS_ASSERT_EQ(nlohmann::json::parse(impl.nativeSigningStatus())["keys"].get<int>(), 1);
+    impl.closeKeystore("");
+}
+
+LOGOS_TEST(keystoreUnlock_defers_the_sdk_unlock_until_an_sdk_call_needs_it) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignTx").returns("0xTX");
+
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-", MemoryDir::Backing::MemoryOrDisk));
+    FILE* f = std::fopen((dir.path() + "/UTC--2016-01-01T00-00-00.000000000Z--008aeeda4d805471df9b2a5b0f38a0c3bcba786b").c_str(), "w");
+    std::fputs(kKeyFile, f);
+    std::fclose(f);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.initKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT(impl.configureNativeSigning(true));
+
+    // One key derivation: the SDK is not asked to unlock while signing stays native.
+    LOGOS_ASSERT(impl.keystoreTimedUnlock(kSpecAddress, "testpassword", 3600));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash(kSpecAddress, std::string("0x") + kHash), std::string("0x") + kSignature);
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_TimedUnlock"));
+    LOGOS_ASSERT_EQ(nlohmann::json::parse(impl.nativeSigningStatus())["deferredUnlocks"].get<int>(), 1);
+
+    // SignTx needs the SDK unlocked: the deferred unlock runs once, timed.
+    LOGOS_ASSERT_EQ(impl.keystoreSignTx(kSpecAddress, "{}", "0x1"), std::string("0xTX"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignTx(kSpecAddress, "{\"nonce\":\"0x1\"}", "0x1"), std::string("0xTX"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_TimedUnlock"), 1);
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_Unlock"));
+    LOGOS_ASSERT_EQ(nlohmann::json::parse(impl.nativeSigningStatus())["deferredUnlocks"].get<int>(), 0);
+
+    // Lock drops a pending deferred unlock.
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+    LOGOS_ASSERT(impl.keystoreLock(kSpecAddress));
+    impl.keystoreSignTx(kSpecAddress, "{}", "0x2");
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_Unlock"));
+
+    // Disabling native signing leaves the account unlocked in the SDK.
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+    LOGOS_ASSERT(impl.configureNativeSigning(false));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_Unlock"), 1);
+    impl.closeKeystore("");
+}
@@ -0,0 +1,229 @@
+// Tests for streaming EIP-191 personal-message signing: the digest against a
+// published vector and the one-shot preimage for any chunking, the declared
+// length, reading from pipes and files, and sessions signed through the
+// keystore's SignHash path, only on the keystore they were begun on.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "keccak.h"
+#include "memory_dir.h"
+#include "personal_message.h"
+#include "secp256k1_curve.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+int hexValue(char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+void fromHex(const std::string& hex, uint8_t* out)
+{
+    for (size_t i = 0; i < hex.size() / 2; ++i) {
+        out[i] = static_cast<uint8_t>(hexValue(hex[2 * i]) << 4 | hexValue(hex[2 * i + 1]));
+    }
+}
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += kHex[data[i] >> 4];
+        hex += kHex[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+std::string oneShot(const std::string& message)
+{
+    const std::string preimage = "\x19" "Ethereum Signed Message:\n" + std::to_string(message.size()) + message;
+    uint8_t digest[Keccak256::kDigestSize];
+    Keccak256::hash(reinterpret_cast<const uint8_t*>(preimage.data()), preimage.size(), digest);
+    return toHex(digest, sizeof(digest));
+}
+
+std::string chunked(const std::string& message, size_t chunk)
+{
+    PersonalMessageHasher hasher(message.size());
+    for (size_t i = 0; i < message.size(); i += chunk) {
+        const std::string part = message.substr(i, chunk);
+        if (!hasher.update(reinterpret_cast<const uint8_t*>(part.data()), part.size())) {
+            return "update failed";
+        }
+    }
+    uint8_t digest[Keccak256::kDigestSize];
+    return hasher.finish(digest) ? toHex(digest, sizeof(digest)) : "finish failed";
+}
+
+std::string message(size_t size)
+{
+    std::string out(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<char>(i * 131 + (i >> 9));
+    }
+    return out;
+}
+
+// The Web3 Secret Storage test key file (PBKDF2), as in test_native_signer.cpp.
+const char* kSpecKey = "7a28b5ba57c53603b0b07b56bba752f7784bf506fa95edc395f5cf6c7514fe9d";
+const char* kSpecAddress = "0x008aeeda4d805471df9b2a5b0f38a0c3bcba786b";
+const char* kKeyFile = R"({"crypto":{"cipher":"aes-128-ctr","cipherparams":{"iv":"6087dab2f9fdbbfaddc31a909735c1e6"},
+    "ciphertext":"5318b4d5bcd28de64ee5559e671353e16f075ecae9f99c7a79a38af5f869aa46","kdf":"pbkdf2",
+    "kdfparams":{"c":262144,"dklen":32,"prf":"hmac-sha256","salt":"ae3cd4e7013836a3df6bd7241b12db061dbe2c6785853cce422d148a624ce0bd"},
+    "mac":"517ead924a9d0dc3124507e3393d175ce3ff7c1e96529c6c555ce9e51205e9b2"},
+    "id":"3198bc9c-6672-5ab3-d995-4942343ae5b6","version":3})";
+
+std::string signDigest(const std::string& digestHex)
+{
+    uint8_t key[32], digest[32], sig[64];
+    fromHex(kSpecKey, key);
+    fromHex(digestHex, digest);
+    int recoveryId = -1;
+    if (!curveSign(key, digest, sig, recoveryId)) {
+        return "failed";
+    }
+    return "0x" + toHex(sig, sizeof(sig)) + (recoveryId == 1 ? "01" : "00");
+}
+
+} // namespace
+
+LOGOS_TEST(personalMessageHasher_matches_one_shot_digest) {
+    // ethers' hashMessage("hello world").
+    LOGOS_ASSERT_EQ(chunked("hello world", 4), std::string("d9eba16ed0ecae432b71fe008c98cc872bb4cc214d3220a36f365326cf807d68"));
+    LOGOS_ASSERT_EQ(chunked("", 1), oneShot(""));
+    const std::string large = message(300000);
+    for (size_t chunk : {size_t(1) << 20, size_t(65536), size_t(136), size_t(135), size_t(7)}) {
+        LOGOS_ASSERT_EQ(chunked(large, chunk), oneShot(large));
+    }
+
+    // The declared length is enforced both ways.
+    PersonalMessageHasher hasher(4);
+    uint8_t digest[Keccak256::kDigestSize];
+    LOGOS_ASSERT_FALSE(hasher.update(reinterpret_cast<const uint8_t*>("hello"), 5));
+    LOGOS_ASSERT(hasher.update(reinterpret_cast<const uint8_t*>("hel"), 3));
+    LOGOS_ASSERT_EQ(hasher.remaining(), uint64_t(1));
+    LOGOS_ASSERT_FALSE(hasher.finish(digest));
+}
+
+LOGOS_TEST(personalMessageHashFd_reads_pipes_and_files) {
+    const std::string large = message(200000);
+    uint8_t digest[Keccak256::kDigestSize];
+    std::string error;
+
+    // A pipe needs the length; the writer runs alongside, as the pipe holds less.
+    int fds[2];
+    LOGOS_ASSERT(pipe(fds) == 0);
+    std::thread writer([&] {
+        LOGOS_ASSERT(write(fds[1], large.data(), large.size()) == static_cast<ssize_t>(large.size()));
+        close(fds[1]);
+    });
+    LOGOS_ASSERT(personalMessageHashFd(fds[0], static_cast<int64_t>(large.size()), digest, error));
+    writer.join();
+    LOGOS_ASSERT_EQ(toHex(digest, sizeof(digest)), oneShot(large));
+    LOGOS_ASSERT_FALSE(personalMessageHashFd(fds[0], -1, digest, error));
+    LOGOS_ASSERT_EQ(error, std::string("length is required unless fd is a regular file"));
+    close(fds[0]);
+
+    // A regular file is read from its offset to the end.
+    FILE* file = std::tmpfile();
+    LOGOS_ASSERT(std::fwrite(large.data(), 1, large.size(), file) == large.size());
+    std::fflush(file);
+    LOGOS_ASSERT(lseek(fileno(file), 100, SEEK_SET) == 100);
+    LOGOS_ASSERT(personalMessageHashFd(fileno(file), -1, digest, error));
+    LOGOS_ASSERT_EQ(toHex(digest, sizeof(digest)), oneShot(large.substr(100)));
+    LOGOS_ASSERT(lseek(fileno(file), 0, SEEK_SET) == 0);
+    LOGOS_ASSERT_FALSE(personalMessageHashFd(fileno(file), static_cast<int64_t>(large.size()) + 1, digest, error));
+    LOGOS_ASSERT_EQ(error, std::string("input ended 1 bytes short"));
+    std::fclose(file);
+}
+
+LOGOS_TEST(signMessage_sessions_sign_the_personal_digest) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_extkeystore_NewKeyStore").returns(2);
+    t.mockCFunction("GoWSK_accounts_extkeystore_SignHash").returns("0xEXTSIG");
+
+    MemoryDir dir;
+    LOGOS_ASSERT(dir.create("logos-test-"));
+    FILE* f = std::fopen((dir.path() + "/UTC--2016-01-01T00-00-00.000000000Z--008aeeda4d805471df9b2a5b0f38a0c3bcba786b").c_str(), "w");
+    std::fputs(kKeyFile, f);
+    std::fclose(f);
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT_EQ(impl.keystoreSignMessageBegin(kSpecAddress, 10), int64_t(0)); // not initialized
+    LOGOS_ASSERT(impl.initKeystore(dir.path(), 4096, 6));
+    LOGOS_ASSERT(impl.configureNativeSigning(true));
+    LOGOS_ASSERT(impl.keystoreUnlock(kSpecAddress, "testpassword"));
+
+    // Signed natively, so the signature shows which digest was signed.
+    const std::string large = message(100000);
+    const int64_t session = impl.keystoreSignMessageBegin(kSpecAddress, static_cast<int64_t>(large.size()));
+    LOGOS_ASSERT(session > 0);
+    for (size_t i = 0; i < large.size(); i += 30000) {
+        LOGOS_ASSERT(impl.signMessageUpdate(session, large.substr(i, 30000)));
+    }
+    LOGOS_ASSERT_FALSE(impl.signMessageUpdate(session, "x"));
+    LOGOS_ASSERT_EQ(impl.signMessageFinish(session), signDigest(oneShot(large)));
+    LOGOS_ASSERT(impl.signMessageFinish(session).empty());
+    LOGOS_ASSERT_FALSE(impl.signMessageUpdate(session, ""));
+
+    // An incomplete message is not signed and its session is closed.
+    const int64_t partial = impl.keystoreSignMessageBegin(kSpecAddress, 5);
+    LOGOS_ASSERT(partial > session);
+    LOGOS_ASSERT(impl.signMessageUpdate(partial, "hell"));
+    LOGOS_ASSERT(impl.signMessageFinish(partial).empty());
+    LOGOS_ASSERT_FALSE(impl.signMessageAbort(partial));
+    const int64_t aborted = impl.keystoreSignMessageBegin(kSpecAddress, 5);
+    LOGOS_ASSERT(impl.signMessageAbort(aborted));
+    LOGOS_ASSERT_FALSE(impl.signMessageUpdate(aborted, "hello"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignMessageBegin(kSpecAddress, -1), int64_t(0));
+
+    int fds[2];
+    LOGOS_ASSERT(pipe(fds) == 0);
+    LOGOS_ASSERT(write(fds[1], "hello world", 11) == 11);
+    close(fds[1]);
+    LOGOS_ASSERT_EQ(impl.keystoreSignMessageFd(kSpecAddress, fds[0], 11), signDigest(oneShot("hello world")));
+    close(fds[0]);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 0);
+
+    // Ext keystore sessions sign through the ext keystore.
+    LOGOS_ASSERT(impl.initExtKeystore(dir.path(), 4096, 6));
+    const int64_t ext = impl.extKeystoreSignMessageBegin(kSpecAddress, 3);
+    LOGOS_ASSERT(impl.signMessageUpdate(ext, "abc"));
+    LOGOS_ASSERT_EQ(impl.signMessageFinish(ext), std::string("0xEXTSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_extkeystore_SignHash"), 1);
+    impl.closeKeystore("");
+}
+
+LOGOS_TEST(signMessageFinish_refuses_a_keystore_reopened_since_begin) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+
+    AccountsModuleImpl impl;
+    LOGOS_ASSERT(impl.initKeystore("/tmp/ks-a", 4096, 6));
+    const int64_t session = impl.keystoreSignMessageBegin(kSpecAddress, 3);
+    LOGOS_ASSERT(impl.signMessageUpdate(session, "abc"));
+    // Same SDK handle value, different keystore: the session is not signed.
+    LOGOS_ASSERT(impl.initKeystore("/tmp/ks-b", 4096, 6));
+    LOGOS_ASSERT(impl.signMessageFinish(session).empty());
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("GoWSK_accounts_keystore_SignHash"));
+
+    const int64_t closed = impl.keystoreSignMessageBegin(kSpecAddress, 3);
+    LOGOS_ASSERT(impl.signMessageUpdate(closed, "abc"));
+    impl.closeKeystore("");
+    LOGOS_ASSERT(impl.signMessageFinish(closed).empty());
+
+    LOGOS_ASSERT(impl.initKeystore("/tmp/ks-b", 4096, 6));
+    const int64_t current = impl.keystoreSignMessageBegin(kSpecAddress, 3);
+    LOGOS_ASSERT(impl.signMessageUpdate(current, "abc"));
+    LOGOS_ASSERT_EQ(impl.signMessageFinish(current), std::string("0xSIG"));
+    impl.closeKeystore("");
+}
@@ -0,0 +1,128 @@
+// Unit tests for the deterministic signature cache: SignatureCache on its own,
+// and keystoreSignHash/keystoreSignTx against the SDK mock, counting how many
+// signing calls reach the SDK.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "signature_cache.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+const auto kForever = std::chrono::steady_clock::time_point::max();
+
+} // namespace
+
+LOGOS_TEST(signatureCache_serves_unlocked_accounts_only) {
+    SignatureCache cache;
+    std::string signature;
+    uint64_t epoch = 0;
+
+    // Never stored for an account not known to be unlocked.
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x01", "", signature, epoch));
+    cache.store("ks", "0xAB", "hash", "0x01", "", "sig1", epoch);
+    LOGOS_ASSERT_EQ(cache.stats().entries, size_t(0));
+
+    cache.unlocked("ks", "0xAB", kForever);
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x01", "", signature, epoch));
+    cache.store("ks", "0xAB", "hash", "0x01", "", "sig1", epoch);
+    LOGOS_ASSERT(cache.lookup("ks", "0xab", "hash", "0x01", "", signature, epoch));
+    LOGOS_ASSERT_EQ(signature, std::string("sig1"));
+    LOGOS_ASSERT_FALSE(cache.lookup("other", "0xAB", "hash", "0x01", "", signature, epoch));
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "tx", "0x01", "", signature, epoch));
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x01", "0x1", signature, epoch));
+
+    // A signature finished after a lock belongs to the old unlock and is dropped.
+    uint64_t stale = 0;
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x02", "", signature, stale));
+    cache.invalidate("ks", "0xAB");
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x01", "", signature, epoch));
+    cache.unlocked("ks", "0xAB", kForever);
+    cache.store("ks", "0xAB", "hash", "0x02", "", "sig2", stale);
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xAB", "hash", "0x02", "", signature, epoch));
+
+    SignatureCache::Stats stats = cache.stats();
+    LOGOS_ASSERT_EQ(stats.hits, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.invalidations, uint64_t(1));
+    LOGOS_ASSERT_EQ(stats.unlockedAccounts, size_t(1));
+}
+
+LOGOS_TEST(signatureCache_expires_timed_unlocks_and_bounds_entries) {
+    SignatureCache cache(2);
+    std::string signature;
+    uint64_t epoch = 0;
+
+    cache.unlocked("ks", "0xA", std::chrono::steady_clock::now() + std::chrono::milliseconds(20));
+    cache.lookup("ks", "0xA", "hash", "h", "", signature, epoch);
+    cache.store("ks", "0xA", "hash", "h", "", "sigA", epoch);
+    LOGOS_ASSERT(cache.lookup("ks", "0xA", "hash", "h", "", signature, epoch));
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xA", "hash", "h", "", signature, epoch));
+    LOGOS_ASSERT_EQ(cache.stats().entries, size_t(0));
+
+    // A timed unlock does not cut an indefinite one short.
+    cache.unlocked("ks", "0xB", kForever);
+    cache.unlocked("ks", "0xB", std::chrono::steady_clock::now());
+    for (const char* input : {"1", "2", "3"}) {
+        cache.lookup("ks", "0xB", "hash", input, "", signature, epoch);
+        cache.store("ks", "0xB", "hash", input, "", std::string("sig") + input, epoch);
+    }
+    LOGOS_ASSERT_EQ(cache.stats().entries, size_t(2));
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xB", "hash", "1", "", signature, epoch));
+    LOGOS_ASSERT(cache.lookup("ks", "0xB", "hash", "3", "", signature, epoch));
+
+    cache.invalidateScope("ks");
+    LOGOS_ASSERT_EQ(cache.stats().entries, size_t(0));
+    LOGOS_ASSERT_EQ(cache.stats().unlockedAccounts, size_t(0));
+    cache.setCapacity(0);
+    cache.unlocked("ks", "0xB", kForever);
+    LOGOS_ASSERT_FALSE(cache.lookup("ks", "0xB", "hash", "3", "", signature, epoch));
+    LOGOS_ASSERT_EQ(epoch, uint64_t(0));
+}
+
+LOGOS_TEST(keystoreSignHash_retries_hit_signature_cache) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_SignHash").returns("0xSIG");
+    t.mockCFunction("GoWSK_accounts_keystore_SignTx").returns("{\"signed\":true}");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    const std::string hash = "0x" + std::string(64, 'a');
+
+    // Locked as far as the module knows: every call goes to the SDK.
+    impl.keystoreSignHash("0xABC", hash);
+    impl.keystoreSignHash("0xABC", hash);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 2);
+
+    LOGOS_ASSERT(impl.keystoreUnlock("0xABC", "pw"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xABC", hash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(impl.keystoreSignHash("0xabc", hash), std::string("0xSIG"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 3);
+    impl.keystoreSignTx("0xABC", "{\"nonce\":\"0x1\"}", "0x1");
+    impl.keystoreSignTx("0xABC", "{\"nonce\":\"0x1\"}", "0x1");
+    impl.keystoreSignTx("0xABC", "{\"nonce\":\"0x1\"}", "0x5");
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignTx"), 2);
+
+    auto status = nlohmann::json::parse(impl.signatureCacheStatus());
+    LOGOS_ASSERT_EQ(status["hits"].get<int>(), 2);
+    LOGOS_ASSERT_EQ(status["entries"].get<int>(), 3);
+
+    LOGOS_ASSERT(impl.keystoreLock("0xABC"));
+    impl.keystoreSignHash("0xABC", hash);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 4);
+    status = nlohmann::json::parse(impl.signatureCacheStatus());
+    LOGOS_ASSERT_EQ(status["entries"].get<int>(), 0);
+
+    LOGOS_ASSERT_FALSE(impl.configureSignatureCache(-1));
+    LOGOS_ASSERT(impl.configureSignatureCache(0));
+    LOGOS_ASSERT(impl.keystoreUnlock("0xABC", "pw"));
+    impl.keystoreSignHash("0xABC", hash);
+    impl.keystoreSignHash("0xABC", hash);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_SignHash"), 6);
+    impl.closeKeystore("");
+}
@@ -0,0 +1,152 @@
+// Unit tests for single-flight coalescing of identical scrypt-bound calls.
+// SingleFlight is driven with a call that blocks until the other callers have
+// joined it; the AccountsModuleImpl test checks the wiring through the mock.
+
+#include <logos_test.h>
+#include "accounts_module_impl.h"
+#include "single_flight.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+template <typename Cond>
+bool eventually(Cond cond)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+} // namespace
+
+LOGOS_TEST(singleFlight_shares_one_call_between_identical_callers) {
+    SingleFlight<std::string> flight;
+    std::atomic<int> runs(0);
+    std::atomic<bool> release(false);
+    const std::string key = singleFlightKey({"Unlock", "keystore", "0xABC", "pw"});
+
+    std::vector<std::string> results(4);
+    std::vector<std::thread> callers;
+    for (size_t i = 0; i < results.size(); ++i) {
+        callers.emplace_back([&, i] {
+            results[i] = flight.run(key, [&] {
+                ++runs;
+                while (!release) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return std::string("done");
+            });
+        });
+    }
+    LOGOS_ASSERT(eventually([&] { return flight.stats().coalesced == 3; }));
+    LOGOS_ASSERT_EQ(flight.stats().inFlight, size_t(1));
+    release = true;
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    LOGOS_ASSERT_EQ(runs.load(), 1);
+    for (const auto& result : results) {
+        LOGOS_ASSERT_EQ(result, std::string("done"));
+    }
+
+    // Finished calls are not reused.
+    flight.run(key, [&] { ++runs; return std::string("again"); });
+    LOGOS_ASSERT_EQ(runs.load(), 2);
+    SingleFlight<std::string>::Stats stats = flight.stats();
+    LOGOS_ASSERT_EQ(stats.calls, uint64_t(2));
+    LOGOS_ASSERT_EQ(stats.inFlight, size_t(0));
+}
+
+LOGOS_TEST(singleFlight_keys_separate_arguments) {
+    LOGOS_ASSERT(singleFlightKey({"ab", "c"}) != singleFlightKey({"a", "bc"}));
+    LOGOS_ASSERT(singleFlightKey({"Unlock", "keystore", "0xA", "pw1"}) !=
+                 singleFlightKey({"Unlock", "keystore", "0xA", "pw2"}));
+    LOGOS_ASSERT_EQ(singleFlightKey({"x"}).size(), size_t(32));
+
+    // A different passphrase never shares another caller's result.
+    SingleFlight<bool> flight;
+    std::atomic<bool> release(false);
+    std::atomic<int> runs(0);
+    std::thread first([&] {
+        flight.run(singleFlightKey({"Unlock", "0xA", "right"}), [&] {
+            ++runs;
+            while (!release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        });
+    });
+    LOGOS_ASSERT(eventually([&] { return flight.stats().inFlight == 1; }));
+    const bool wrong = flight.run(singleFlightKey({"Unlock", "0xA", "wrong"}), [&] { ++runs; return false; });
+    release = true;
+    first.join();
+    LOGOS_ASSERT_FALSE(wrong);
+    LOGOS_ASSERT_EQ(runs.load(), 2);
+    LOGOS_ASSERT_EQ(flight.stats().coalesced, uint64_t(0));
+}
+
+LOGOS_TEST(singleFlight_passes_exceptions_to_waiters_and_recovers) {
+    SingleFlight<std::string> flight;
+    std::atomic<bool> release(false);
+    const std::string key = singleFlightKey({"Export", "keystore", "0xABC", "pw"});
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 3; ++i) {
+        callers.emplace_back([&] {
+            try {
+                flight.run(key, [&]() -> std::string {
+                    while (!release) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    throw std::runtime_error("call failed");
+                });
+            } catch (const std::runtime_error& e) {
+                if (std::string(e.what()) == "call failed") {
+                    ++failures;
+                }
+            }
+        });
+    }
+    LOGOS_ASSERT(eventually([&] { return flight.stats().coalesced == 2; }));
+    release = true;
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    LOGOS_ASSERT_EQ(failures.load(), 3);
+
+    // The failed flight is gone: the next caller runs its own call.
+    LOGOS_ASSERT_EQ(flight.stats().inFlight, size_t(0));
+    LOGOS_ASSERT_EQ(flight.run(key, [] { return std::string("ok"); }), std::string("ok"));
+}
+
+LOGOS_TEST(keystoreUnlock_and_export_run_through_single_flight) {
+    auto t = LogosTestContext("accounts_module");
+    t.mockCFunction("GoWSK_accounts_keystore_NewKeyStore").returns(1);
+    t.mockCFunction("GoWSK_accounts_keystore_Export").returns("{\"address\":\"abc\"}");
+
+    AccountsModuleImpl impl;
+    impl.initKeystore("/tmp/ks", 4096, 6);
+    LOGOS_ASSERT(impl.keystoreUnlock("0xABC", "pw"));
+    LOGOS_ASSERT(impl.keystoreTimedUnlock("0xABC", "pw", 30));
+    LOGOS_ASSERT_EQ(impl.keystoreExport("0xABC", "pw", "new"), std::string("{\"address\":\"abc\"}"));
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_Unlock"), 1);
+    LOGOS_ASSERT_EQ(t.cFunctionCallCount("GoWSK_accounts_keystore_TimedUnlock"), 1);
+
+    auto status = nlohmann::json::parse(impl.coalescedCallsStatus());
+    LOGOS_ASSERT_EQ(status["calls"].get<int>(), 3);
+    LOGOS_ASSERT_EQ(status["coalesced"].get<int>(), 0);
+    LOGOS_ASSERT_EQ(status["inFlight"].get<int>(), 0);
+    impl.closeKeystore("");
+}